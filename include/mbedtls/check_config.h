@@ -707,6 +707,30 @@
 #error "MBEDTLS_PSA_ITS_FILE_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_PSA_ITS_JOURNAL_C) && \
+    !defined(MBEDTLS_FS_IO)
+#error "MBEDTLS_PSA_ITS_JOURNAL_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_PSA_ITS_JOURNAL_C) && defined(MBEDTLS_PSA_ITS_FILE_C)
+#error "MBEDTLS_PSA_ITS_JOURNAL_C and MBEDTLS_PSA_ITS_FILE_C cannot be defined simultaneously"
+#endif
+
+#if defined(MBEDTLS_PSA_ITS_MMAP_C) && \
+    ( defined(MBEDTLS_PSA_ITS_FILE_C) || defined(MBEDTLS_PSA_ITS_JOURNAL_C) )
+#error "MBEDTLS_PSA_ITS_MMAP_C and MBEDTLS_PSA_ITS_FILE_C/MBEDTLS_PSA_ITS_JOURNAL_C cannot be defined simultaneously"
+#endif
+
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && \
+    !defined(MBEDTLS_PSA_CRYPTO_C)
+#error "MBEDTLS_PSA_KEY_CONTEXT_CACHE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && \
+    defined(MBEDTLS_PSA_CRYPTO_DRIVERS)
+#error "MBEDTLS_PSA_KEY_CONTEXT_CACHE and MBEDTLS_PSA_CRYPTO_DRIVERS cannot be defined simultaneously"
+#endif
+
 #if defined(MBEDTLS_RSA_C) && ( !defined(MBEDTLS_BIGNUM_C) ||         \
     !defined(MBEDTLS_OID_C) )
 #error "MBEDTLS_RSA_C defined, but not all prerequisites"
@@ -811,6 +835,17 @@
 #error "MBEDTLS_SSL_PROTO_TLS1_3 defined without MBEDTLS_SSL_KEEP_PEER_CERTIFICATE"
 #endif
 
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE) && \
+    ( !defined(MBEDTLS_SSL_TLS_C) || !defined(MBEDTLS_X509_CRT_PARSE_C) )
+#error "MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION) && \
+    ( !defined(MBEDTLS_SSL_PROTO_TLS1_3) || \
+      !defined(MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED) )
+#error "MBEDTLS_SSL_CERT_COMPRESSION defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_TLS1_2) &&                                    \
     !(defined(MBEDTLS_KEY_EXCHANGE_RSA_ENABLED) ||                          \
       defined(MBEDTLS_KEY_EXCHANGE_DHE_RSA_ENABLED) ||                      \
@@ -877,6 +912,10 @@
 #error "MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE  defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA) && !defined(MBEDTLS_SSL_PROTO_DTLS)
+#error "MBEDTLS_SSL_DTLS_BUFFERING_ARENA defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY) &&                              \
     ( !defined(MBEDTLS_SSL_TLS_C) || !defined(MBEDTLS_SSL_PROTO_DTLS) )
 #error "MBEDTLS_SSL_DTLS_ANTI_REPLAY  defined, but not all prerequisites"
@@ -927,6 +966,23 @@
 #error "MBEDTLS_SSL_RENEGOTIATION defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_CACHE_SHARDS) && \
+    (MBEDTLS_SSL_CACHE_SHARDS < 1 || MBEDTLS_SSL_CACHE_SHARDS > 256)
+#error "MBEDTLS_SSL_CACHE_SHARDS must be between 1 and 256"
+#endif
+
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C) && \
+    ( !defined(MBEDTLS_SSL_PROTO_TLS1_3) || !defined(MBEDTLS_SSL_EARLY_DATA) || \
+      !defined(MBEDTLS_SSL_SRV_C) || !defined(MBEDTLS_HAVE_TIME) )
+#error "MBEDTLS_SSL_EARLY_DATA_REPLAY_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS) && \
+    (MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS < 1 || \
+     MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS > 256)
+#error "MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS must be between 1 and 256"
+#endif
+
 #if defined(MBEDTLS_SSL_TICKET_C) && ( !defined(MBEDTLS_CIPHER_C) && \
                                        !defined(MBEDTLS_USE_PSA_CRYPTO) )
 #error "MBEDTLS_SSL_TICKET_C defined, but not all prerequisites"
@@ -937,6 +993,12 @@
 #error "MBEDTLS_SSL_TICKET_C defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_DTLS_REPLAY_WINDOW) &&        \
+    (MBEDTLS_SSL_DTLS_REPLAY_WINDOW % 64 != 0 ||       \
+    MBEDTLS_SSL_DTLS_REPLAY_WINDOW < 64 || MBEDTLS_SSL_DTLS_REPLAY_WINDOW > 1024)
+#error "MBEDTLS_SSL_DTLS_REPLAY_WINDOW must be a multiple of 64 between 64 and 1024"
+#endif
+
 #if defined(MBEDTLS_SSL_TLS1_3_TICKET_NONCE_LENGTH) && \
     MBEDTLS_SSL_TLS1_3_TICKET_NONCE_LENGTH >= 256
 #error "MBEDTLS_SSL_TLS1_3_TICKET_NONCE_LENGTH must be less than 256"
@@ -947,6 +1009,36 @@
 #error "MBEDTLS_SSL_SERVER_NAME_INDICATION defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_DTLS_DEMUX_C) &&                               \
+    (!defined(MBEDTLS_SSL_SRV_C) || !defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY))
+#error "MBEDTLS_SSL_DTLS_DEMUX_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_CACHE_SHM_C) && \
+    (!defined(MBEDTLS_SSL_TLS_C) || !defined(MBEDTLS_THREADING_PTHREAD))
+#error "MBEDTLS_SSL_CACHE_SHM_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_VERIFY_CACHE_C) && \
+    (!defined(MBEDTLS_SSL_TLS_C) || !defined(MBEDTLS_X509_CRT_PARSE_C))
+#error "MBEDTLS_SSL_VERIFY_CACHE_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_WORKER_POOL_C) && !defined(MBEDTLS_THREADING_PTHREAD)
+#error "MBEDTLS_SSL_WORKER_POOL_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_KEY_SHARE_POOL_C) &&                               \
+    (!defined(MBEDTLS_THREADING_PTHREAD) || !defined(MBEDTLS_ECP_C) ||     \
+    !defined(MBEDTLS_ECDH_C) || !defined(MBEDTLS_SSL_PROTO_TLS1_3))
+#error "MBEDTLS_SSL_KEY_SHARE_POOL_C defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C) && \
+    (!defined(MBEDTLS_SSL_ASYNC_PRIVATE) || !defined(MBEDTLS_ECDH_C))
+#error "MBEDTLS_SSL_ASYNC_BATCH_C defined, but not all prerequisites"
+#endif
+
 #if defined(MBEDTLS_THREADING_PTHREAD)
 #if !defined(MBEDTLS_THREADING_C) || defined(MBEDTLS_THREADING_IMPL)
 #error "MBEDTLS_THREADING_PTHREAD defined, but not all prerequisites"
@@ -1030,6 +1122,34 @@
 #error "MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH defined, but not all prerequisites"
 #endif
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE) && !defined(MBEDTLS_SSL_TLS_C)
+#error "MBEDTLS_SSL_IDLE_BUFFER_RELEASE defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE) && defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+#error "MBEDTLS_SSL_IDLE_BUFFER_RELEASE cannot be defined with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH"
+#endif
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING) && !defined(MBEDTLS_SSL_TLS_C)
+#error "MBEDTLS_SSL_RECORD_BATCHING defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING) && defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
+#error "MBEDTLS_SSL_RECORD_BATCHING cannot be defined with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH"
+#endif
+
+#if defined(MBEDTLS_SSL_KTLS) && !defined(MBEDTLS_SSL_TLS_C)
+#error "MBEDTLS_SSL_KTLS defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION) && !defined(MBEDTLS_SSL_RECORD_BATCHING)
+#error "MBEDTLS_SSL_PARALLEL_ENCRYPTION defined, but not all prerequisites"
+#endif
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION) && defined(MBEDTLS_USE_PSA_CRYPTO)
+#error "MBEDTLS_SSL_PARALLEL_ENCRYPTION cannot be defined with MBEDTLS_USE_PSA_CRYPTO"
+#endif
+
 #if defined(MBEDTLS_SSL_RECORD_SIZE_LIMIT) && ( !defined(MBEDTLS_SSL_PROTO_TLS1_3) )
 #error "MBEDTLS_SSL_RECORD_SIZE_LIMIT defined, but not all prerequisites"
 #endif
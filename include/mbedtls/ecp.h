@@ -999,6 +999,51 @@ int mbedtls_ecp_mul_restartable(mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
                                 int (*f_rng)(void *, unsigned char *, size_t), void *p_rng,
                                 mbedtls_ecp_restart_ctx *rs_ctx);
 
+/**
+ * \brief           This function performs several scalar multiplications
+ *                  on the same curve: \p R[i] = \p m[i] * \p P[i] for
+ *                  \c i from \c 0 to \p n - 1.
+ *
+ *                  The result is the same as calling mbedtls_ecp_mul()
+ *                  \p n times, but on curves in short Weierstrass form,
+ *                  the results are converted to affine coordinates together,
+ *                  with a single modular inversion instead of one per point.
+ *                  On Montgomery curves, this function simply calls
+ *                  mbedtls_ecp_mul() for each point.
+ *
+ *                  It is not thread-safe to use same group in multiple threads.
+ *
+ * \note            This function has the same protections against timing
+ *                  attacks as mbedtls_ecp_mul(). The coordinates of each
+ *                  result are randomized before the shared inversion.
+ *
+ * \param grp       The ECP group to use.
+ *                  This must be initialized and have group parameters
+ *                  set, for example through mbedtls_ecp_group_load().
+ * \param R         The points in which to store the results. They must be
+ *                  initialized and distinct from each other.
+ * \param m         The integers by which to multiply. These must be
+ *                  initialized.
+ * \param P         The points to multiply. These must be initialized.
+ *                  \p P[i] may be the same point as \p R[i], but not
+ *                  as another point of \p R.
+ * \param n         The number of multiplications.
+ * \param f_rng     The RNG function. This must not be \c NULL.
+ * \param p_rng     The RNG context to be passed to \p f_rng. This may be \c
+ *                  NULL if \p f_rng doesn't need a context.
+ *
+ * \return          \c 0 on success.
+ * \return          #MBEDTLS_ERR_ECP_INVALID_KEY if one of \p m is not a valid
+ *                  private key, or one of \p P is not a valid public key. In
+ *                  this case, none of the multiplications is done.
+ * \return          #MBEDTLS_ERR_MPI_ALLOC_FAILED on memory-allocation failure.
+ * \return          Another negative error code on other kinds of failure.
+ */
+int mbedtls_ecp_mul_batch(mbedtls_ecp_group *grp, mbedtls_ecp_point *R[],
+                          const mbedtls_mpi *const m[],
+                          const mbedtls_ecp_point *const P[], size_t n,
+                          int (*f_rng)(void *, unsigned char *, size_t), void *p_rng);
+
 #if defined(MBEDTLS_ECP_SHORT_WEIERSTRASS_ENABLED)
 /**
  * \brief           This function performs multiplication and addition of two
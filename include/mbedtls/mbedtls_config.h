@@ -1299,6 +1299,30 @@
  */
 //#define MBEDTLS_PSA_INJECT_ENTROPY
 
+/**
+ * \def MBEDTLS_PSA_KEY_CONTEXT_CACHE
+ *
+ * Keep the built-in cipher, AEAD or MAC context that was last set up with
+ * each key in the key's slot, so that the next psa_cipher_encrypt(),
+ * psa_cipher_decrypt(), psa_aead_encrypt(), psa_aead_decrypt(),
+ * psa_mac_compute() or psa_mac_verify() call with the same key and
+ * algorithm skips the key setup: AES key schedule, GCM multiplication
+ * tables, HMAC inner and outer padded key hashes, etc. The cached context
+ * is wiped when the key is destroyed or purged from memory.
+ *
+ * The total size of the cached contexts is bounded by
+ * #MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET. This option trades RAM for speed
+ * and is only useful for applications that perform many one-shot
+ * operations with the same keys.
+ *
+ * Module:  library/psa_crypto_key_cache.c
+ * Requires: MBEDTLS_PSA_CRYPTO_C
+ *
+ * This option is incompatible with MBEDTLS_PSA_CRYPTO_DRIVERS, because
+ * cached operations would bypass the transparent drivers.
+ */
+//#define MBEDTLS_PSA_KEY_CONTEXT_CACHE
+
 /**
  * \def MBEDTLS_RSA_NO_CRT
  *
@@ -1517,6 +1541,39 @@
  */
 #define MBEDTLS_SSL_KEEP_PEER_CERTIFICATE
 
+/**
+ * \def MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE
+ *
+ * Serialize the certificate chain passed to mbedtls_ssl_conf_own_cert()
+ * once, in the format of the Certificate handshake message, and send that
+ * copy in every handshake instead of walking the chain and rebuilding the
+ * length fields each time.
+ *
+ * This costs one extra copy of each configured chain (per enabled protocol
+ * version) in the SSL configuration. Certificates set from an SNI callback
+ * with mbedtls_ssl_set_hs_own_cert() are not cached.
+ *
+ * Requires: MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Uncomment this macro to cache serialized own certificate chains.
+ */
+//#define MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE
+
+/**
+ * \def MBEDTLS_SSL_CERT_COMPRESSION
+ *
+ * Enable TLS 1.3 certificate compression (RFC 8879): the compress_certificate
+ * extension and the CompressedCertificate message. The library provides no
+ * compression algorithm, the application sets them with
+ * mbedtls_ssl_conf_cert_compression().
+ *
+ * Requires: MBEDTLS_SSL_PROTO_TLS1_3,
+ *           MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+ *
+ * Uncomment this macro to enable certificate compression.
+ */
+//#define MBEDTLS_SSL_CERT_COMPRESSION
+
 /**
  * \def MBEDTLS_SSL_RENEGOTIATION
  *
@@ -1806,6 +1863,29 @@
  */
 #define MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE
 
+/**
+ * \def MBEDTLS_SSL_DTLS_BUFFERING_ARENA
+ *
+ * Serve all DTLS handshake buffering from one fixed-size arena per
+ * handshake instead of the heap.
+ *
+ * Without this option, each buffered handshake message, its reassembly
+ * bitmap and each buffered future record is allocated separately, which
+ * churns the heap under packet loss and reordering. With this option, a
+ * single block of MBEDTLS_SSL_DTLS_MAX_BUFFERING bytes, plus a few block
+ * headers, is allocated when a DTLS handshake starts and all of these are
+ * carved from it. When the arena is full, buffered future messages and
+ * records are dropped first, since the peer retransmits them.
+ *
+ * The outgoing flight is still allocated from the heap. The usage of the
+ * arena is reported by mbedtls_ssl_get_dtls_buffering_stats().
+ *
+ * Requires: MBEDTLS_SSL_PROTO_DTLS
+ *
+ * Uncomment this to serve DTLS handshake buffering from an arena.
+ */
+//#define MBEDTLS_SSL_DTLS_BUFFERING_ARENA
+
 /**
  * \def MBEDTLS_SSL_SESSION_TICKETS
  *
@@ -1841,6 +1921,89 @@
  */
 //#define MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
 
+/**
+ * \def MBEDTLS_SSL_IDLE_BUFFER_RELEASE
+ *
+ * Enable SSL contexts to give their record buffers back to a buffer pool
+ * while the connection is idle, see mbedtls_ssl_conf_buffer_pool().
+ *
+ * Each SSL context normally holds an input and an output buffer of about
+ * MBEDTLS_SSL_IN_CONTENT_LEN and MBEDTLS_SSL_OUT_CONTENT_LEN bytes for its
+ * whole lifetime. With this option and a configured pool, a context holds
+ * them only while it has data in flight, so that a server with many mostly
+ * idle connections needs memory in proportion to the active ones.
+ *
+ * Requires: MBEDTLS_SSL_TLS_C
+ *
+ * This option is incompatible with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH.
+ *
+ * Uncomment this to enable releasing idle record buffers.
+ */
+//#define MBEDTLS_SSL_IDLE_BUFFER_RELEASE
+
+/**
+ * \def MBEDTLS_SSL_RECORD_BATCHING
+ *
+ * Move several TLS records per call to the underlying transport.
+ *
+ * With this option, mbedtls_ssl_write() encrypts up to
+ * MBEDTLS_SSL_WRITE_BATCH_RECORDS full records of the data it is given
+ * and hands them to the send callback at once, and
+ * mbedtls_ssl_conf_read_ahead() lets the receive callback fill the whole
+ * input buffer rather than stop at the end of the current record. This
+ * saves system calls when transferring large amounts of data over TLS.
+ * It has no effect on DTLS.
+ *
+ * The output buffer of each SSL context grows to hold
+ * MBEDTLS_SSL_WRITE_BATCH_RECORDS records.
+ *
+ * Requires: MBEDTLS_SSL_TLS_C
+ *
+ * This option is incompatible with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH.
+ *
+ * Uncomment this to enable batching of TLS records.
+ */
+//#define MBEDTLS_SSL_RECORD_BATCHING
+
+/**
+ * \def MBEDTLS_SSL_PARALLEL_ENCRYPTION
+ *
+ * Allow the records of a batch written by mbedtls_ssl_write() to be
+ * encrypted concurrently, by the job runner set with
+ * mbedtls_ssl_conf_record_workers().
+ *
+ * Only records protected with an AEAD cipher (GCM, CCM or ChaCha20-Poly1305)
+ * are encrypted in parallel. Since an AEAD context can't process several
+ * records at once, each such transform keeps one encryption context per
+ * record of a batch, that is MBEDTLS_SSL_WRITE_BATCH_RECORDS - 1 more than
+ * without this option.
+ *
+ * Requires: MBEDTLS_SSL_RECORD_BATCHING
+ *
+ * This option is incompatible with MBEDTLS_USE_PSA_CRYPTO, as the PSA
+ * keys of a transform can't be used from several threads at once.
+ *
+ * Uncomment this to enable parallel encryption of records.
+ */
+//#define MBEDTLS_SSL_PARALLEL_ENCRYPTION
+
+/**
+ * \def MBEDTLS_SSL_KTLS
+ *
+ * Allow the record protection state of established TLS connections to be
+ * exported, see mbedtls_ssl_export_ktls_info(), and handed over to the
+ * Linux kernel TLS implementation, see mbedtls_net_ktls_enable(). The
+ * application can then use plain socket calls, including sendfile() and
+ * splice(), on the connection.
+ *
+ * With this option, each transform keeps a copy of its traffic keys.
+ *
+ * Requires: MBEDTLS_SSL_TLS_C
+ *
+ * Uncomment this to enable exporting the record protection state.
+ */
+//#define MBEDTLS_SSL_KTLS
+
 /**
  * \def MBEDTLS_TEST_CONSTANT_FLOW_MEMSAN
  *
@@ -2991,7 +3154,8 @@
  * Module:  library/psa_crypto_storage.c
  *
  * Requires: MBEDTLS_PSA_CRYPTO_C,
- *           either MBEDTLS_PSA_ITS_FILE_C or a native implementation of
+ *           either MBEDTLS_PSA_ITS_FILE_C, MBEDTLS_PSA_ITS_JOURNAL_C,
+ *           MBEDTLS_PSA_ITS_MMAP_C or a native implementation of
  *           the PSA ITS interface
  */
 #define MBEDTLS_PSA_CRYPTO_STORAGE_C
@@ -3008,6 +3172,62 @@
  */
 #define MBEDTLS_PSA_ITS_FILE_C
 
+/**
+ * \def MBEDTLS_PSA_ITS_JOURNAL_C
+ *
+ * Enable the emulation of the Platform Security Architecture
+ * Internal Trusted Storage (PSA ITS) over a single append-only journal file.
+ *
+ * This is an alternative to #MBEDTLS_PSA_ITS_FILE_C for devices that store
+ * many persistent keys. All entries live in one file, indexed in memory, so
+ * reading or writing an entry costs no file creation, open or rename.
+ * Superseded records are reclaimed by rewriting the journal when they
+ * outweigh the live ones, and an append interrupted by a crash is discarded
+ * the next time the journal is loaded. Recently used entries are kept in
+ * a bounded RAM cache.
+ *
+ * The journal state is global and not protected by a mutex: do not call
+ * the PSA ITS functions concurrently from several threads.
+ *
+ * Module:  library/psa_its_journal.c
+ *
+ * Requires: MBEDTLS_FS_IO
+ *
+ * Uncomment to store PSA ITS entries in a journal file.
+ * This is incompatible with #MBEDTLS_PSA_ITS_FILE_C.
+ */
+//#define MBEDTLS_PSA_ITS_JOURNAL_C
+
+/**
+ * \def MBEDTLS_PSA_ITS_MMAP_C
+ *
+ * Enable the emulation of the Platform Security Architecture
+ * Internal Trusted Storage (PSA ITS) over a single memory-mapped container
+ * file.
+ *
+ * This is an alternative to #MBEDTLS_PSA_ITS_FILE_C for devices that store
+ * many persistent keys. The container holds a sorted index of all entries,
+ * so looking up a key touches a couple of pages of the mapping instead of
+ * a directory entry and an inode per key. Every record is protected by
+ * a CRC, and updates are atomic: new data is written to free space and
+ * becomes visible when an alternate superblock is written (shadow paging).
+ * The container holds at least 16000 entries, and up to about 32000
+ * depending on the order in which they are created.
+ *
+ * The container state is global and not protected by a mutex: do not call
+ * the PSA ITS functions concurrently from several threads, and do not share
+ * the container between processes.
+ *
+ * Module:  library/psa_its_mmap.c
+ *
+ * Requires: a POSIX platform with mmap()
+ *
+ * Uncomment to store PSA ITS entries in a memory-mapped container.
+ * This is incompatible with #MBEDTLS_PSA_ITS_FILE_C and
+ * #MBEDTLS_PSA_ITS_JOURNAL_C.
+ */
+//#define MBEDTLS_PSA_ITS_MMAP_C
+
 /**
  * \def MBEDTLS_RIPEMD160_C
  *
@@ -3229,6 +3449,9 @@
  *
  * Enable simple SSL cache implementation.
  *
+ * Sessions are kept in MBEDTLS_SSL_CACHE_SHARDS hash tables keyed by
+ * session ID, each with its own lock and least-recently-used eviction order.
+ *
  * Module:  library/ssl_cache.c
  * Caller:
  *
@@ -3236,6 +3459,135 @@
  */
 #define MBEDTLS_SSL_CACHE_C
 
+/**
+ * \def MBEDTLS_SSL_CACHE_SHM_C
+ *
+ * Enable an SSL session cache shared by several processes, such as the
+ * workers of a forking server, see mbedtls_ssl_cache_shm_setup().
+ *
+ * Sessions are kept in serialized form in a shared memory mapping, either
+ * anonymous and inherited across fork() or backed by a file. Accesses are
+ * serialized by a robust process-shared mutex in the mapping.
+ *
+ * Module:  library/ssl_cache_shm.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_TLS_C, MBEDTLS_THREADING_PTHREAD
+ *
+ * This module only works on POSIX platforms with robust mutexes
+ * (POSIX.1-2008) and mmap().
+ *
+ * Uncomment this to enable the shared SSL session cache.
+ */
+//#define MBEDTLS_SSL_CACHE_SHM_C
+
+/**
+ * \def MBEDTLS_SSL_VERIFY_CACHE_C
+ *
+ * Enable a cache of verified peer certificate chains, so that handshakes
+ * with a peer seen recently skip the signature checks of its chain, see
+ * mbedtls_ssl_conf_verify_cache().
+ *
+ * Chains are kept in a hash table keyed by a digest of the chain and of
+ * its trust anchors, CRLs, profile and hostname, with a timeout counted
+ * from their verification and least-recently-used eviction.
+ *
+ * Module:  library/ssl_verify_cache.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_TLS_C, MBEDTLS_X509_CRT_PARSE_C
+ *
+ * Uncomment this to enable the verified chain cache.
+ */
+//#define MBEDTLS_SSL_VERIFY_CACHE_C
+
+/**
+ * \def MBEDTLS_SSL_BUFFER_POOL_C
+ *
+ * Enable a pool of SSL record buffers that can be shared between SSL
+ * contexts, see mbedtls_ssl_conf_buffer_pool().
+ *
+ * Module:  library/ssl_buffer_pool.c
+ * Caller:
+ *
+ * This module is useful with MBEDTLS_SSL_IDLE_BUFFER_RELEASE.
+ *
+ * Uncomment this to enable the SSL buffer pool.
+ */
+//#define MBEDTLS_SSL_BUFFER_POOL_C
+
+/**
+ * \def MBEDTLS_SSL_WORKER_POOL_C
+ *
+ * Enable a pool of worker threads that runs batches of jobs, see
+ * mbedtls_ssl_worker_pool_run().
+ *
+ * Module:  library/ssl_worker_pool.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_THREADING_PTHREAD
+ *
+ * This module is useful with MBEDTLS_SSL_PARALLEL_ENCRYPTION.
+ *
+ * Uncomment this to enable the SSL worker pool.
+ */
+//#define MBEDTLS_SSL_WORKER_POOL_C
+
+/**
+ * \def MBEDTLS_SSL_ASYNC_BATCH_C
+ *
+ * Enable batching of the ECDHE key agreements and ECDSA signatures of many
+ * concurrent handshakes, through the asynchronous private key callbacks,
+ * see mbedtls_ssl_async_batch_setup().
+ *
+ * The scalar multiplications of a batch that use the same curve share the
+ * modular inversion that converts their results to affine coordinates.
+ *
+ * Module:  library/ssl_async_batch.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_ASYNC_PRIVATE, MBEDTLS_ECDH_C
+ *
+ * Uncomment this to enable batching of handshake private key operations.
+ */
+//#define MBEDTLS_SSL_ASYNC_BATCH_C
+
+/**
+ * \def MBEDTLS_SSL_KEY_SHARE_POOL_C
+ *
+ * Enable a pool of ephemeral ECDHE key pairs that a background thread
+ * generates ahead of TLS 1.3 handshakes, see
+ * mbedtls_ssl_tls13_conf_key_share_pool().
+ *
+ * Module:  library/ssl_key_share_pool.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_THREADING_PTHREAD, MBEDTLS_ECP_C, MBEDTLS_ECDH_C,
+ *           MBEDTLS_SSL_PROTO_TLS1_3
+ *
+ * Uncomment this to enable the SSL key share pool.
+ */
+//#define MBEDTLS_SSL_KEY_SHARE_POOL_C
+
+/**
+ * \def MBEDTLS_SSL_DTLS_DEMUX_C
+ *
+ * Enable a DTLS server demultiplexer that serves many connections on one
+ * UDP socket, see mbedtls_ssl_dtls_demux_dispatch().
+ *
+ * Module:  library/ssl_dtls_demux.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_SRV_C, MBEDTLS_SSL_DTLS_HELLO_VERIFY
+ *
+ * Each connection holds a full SSL context with its own input and output
+ * buffers. With many connections, consider MBEDTLS_SSL_IDLE_BUFFER_RELEASE
+ * and smaller MBEDTLS_SSL_IN_CONTENT_LEN and MBEDTLS_SSL_OUT_CONTENT_LEN.
+ *
+ * Uncomment this to enable the DTLS demultiplexer.
+ */
+//#define MBEDTLS_SSL_DTLS_DEMUX_C
+
 /**
  * \def MBEDTLS_SSL_COOKIE_C
  *
@@ -3246,6 +3598,23 @@
  */
 #define MBEDTLS_SSL_COOKIE_C
 
+/**
+ * \def MBEDTLS_SSL_EARLY_DATA_REPLAY_C
+ *
+ * Enable an anti-replay filter for the TLS 1.3 early data accepted by a
+ * server, see mbedtls_ssl_tls13_conf_early_data_replay() and
+ * mbedtls_ssl_early_data_replay_setup().
+ *
+ * Module:  library/ssl_early_data_replay.c
+ * Caller:
+ *
+ * Requires: MBEDTLS_SSL_PROTO_TLS1_3, MBEDTLS_SSL_EARLY_DATA,
+ *           MBEDTLS_SSL_SRV_C, MBEDTLS_HAVE_TIME
+ *
+ * Uncomment this to enable the early data anti-replay filter.
+ */
+//#define MBEDTLS_SSL_EARLY_DATA_REPLAY_C
+
 /**
  * \def MBEDTLS_SSL_TICKET_C
  *
@@ -3726,9 +4095,46 @@
  */
 //#define MBEDTLS_PSA_KEY_SLOT_COUNT 32
 
+/** \def MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET
+ * Maximum number of bytes of prepared contexts that
+ * #MBEDTLS_PSA_KEY_CONTEXT_CACHE keeps in key slots. Keys used once the
+ * budget is exhausted are processed without caching.
+ *
+ * If this option is unset, the library will fall back to a default value of
+ * 16384 bytes.
+ */
+//#define MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET 16384
+
+/* PSA ITS journal options */
+//#define MBEDTLS_PSA_ITS_JOURNAL_CACHE_SIZE         4096 /**< Maximum number of bytes of entry data cached in RAM, 0 to disable the cache */
+//#define MBEDTLS_PSA_ITS_JOURNAL_SYNC_INTERVAL         8 /**< Number of records appended between two syncs of the journal to the storage medium */
+//#define MBEDTLS_PSA_ITS_JOURNAL_COMPACT_THRESHOLD  4096 /**< Minimum number of superseded bytes before the journal is compacted */
+
 /* SSL Cache options */
 //#define MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT       86400 /**< 1 day  */
 //#define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50 /**< Maximum entries in cache */
+//#define MBEDTLS_SSL_CACHE_SHARDS                    8 /**< Number of independently locked parts of the cache, 1 to 256 */
+//#define MBEDTLS_SSL_CACHE_SHM_DEFAULT_TIMEOUT   86400 /**< Default timeout of the shared cache, 1 day */
+
+/* SSL verified chain cache options */
+//#define MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_TIMEOUT     3600 /**< 1 hour */
+//#define MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_MAX_ENTRIES  256 /**< Maximum entries in cache */
+
+/* SSL early data anti-replay options */
+//#define MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS       16 /**< Number of independently locked parts of the filter, 1 to 256 */
+
+/* SSL buffer pool options */
+//#define MBEDTLS_SSL_BUFFER_POOL_CLASSES             4 /**< Number of distinct buffer sizes kept */
+//#define MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_FREE   32 /**< Maximum free buffers kept per size */
+
+/* DTLS demultiplexer options */
+//#define MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN        32 /**< Maximum length of a peer address */
+
+/* SSL key share pool options */
+//#define MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS       4 /**< Maximum number of groups of a pool */
+
+/* SSL worker pool options */
+//#define MBEDTLS_SSL_WORKER_POOL_MAX_THREADS         8 /**< Maximum number of threads of a pool */
 
 /* SSL options */
 
@@ -3817,9 +4223,54 @@
  * to reassembly a large handshake message (such as a certificate)
  * while buffering multiple smaller handshake messages.
  *
+ * With MBEDTLS_SSL_DTLS_BUFFERING_ARENA, this sets the size of the arena.
+ *
  */
 //#define MBEDTLS_SSL_DTLS_MAX_BUFFERING             32768
 
+/** \def MBEDTLS_SSL_WRITE_BATCH_RECORDS
+ *
+ * Maximum number of records that mbedtls_ssl_write() encrypts before
+ * sending them together, with #MBEDTLS_SSL_RECORD_BATCHING.
+ *
+ * The outgoing TLS I/O buffer is this many times as large as the one
+ * determined by MBEDTLS_SSL_OUT_CONTENT_LEN.
+ */
+//#define MBEDTLS_SSL_WRITE_BATCH_RECORDS            4
+
+/** \def MBEDTLS_SSL_DTLS_REPLAY_WINDOW
+ *
+ * Number of most recent DTLS record sequence numbers remembered by
+ * the anti-replay mechanism (MBEDTLS_SSL_DTLS_ANTI_REPLAY). Records older
+ * than this are discarded, so the window must cover the reordering the
+ * network can cause: 64 (the default, as in RFC 6347) suits most links,
+ * 128 or 1024 suit high-rate streams over paths with heavy reordering.
+ *
+ * This must be a multiple of 64, at most 1024. Each SSL context holds
+ * MBEDTLS_SSL_DTLS_REPLAY_WINDOW / 8 bytes for the window.
+ *
+ * \note Serialized contexts (mbedtls_ssl_context_save()) only hold the 64
+ *       most recent positions of the window. Older records are treated as
+ *       already seen by the restored context.
+ */
+//#define MBEDTLS_SSL_DTLS_REPLAY_WINDOW             64
+
+/** \def MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN
+ *
+ * Maximum number of heap-allocated bytes of handshake messages kept until
+ * the ciphersuite, and so the hash of the handshake transcript, is known.
+ *
+ * Until then, the messages are buffered rather than hashed with every hash
+ * a ciphersuite may use, and then only hashed with the right one. When the
+ * messages before the choice of the ciphersuite don't fit, all the hashes
+ * are computed as if this was 0.
+ *
+ * TLS 1.2 servers that may request a client certificate always compute all
+ * the hashes, since the client may sign its CertificateVerify with another
+ * one.
+ */
+//#define MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN        4096
+
 //#define MBEDTLS_PSK_MAX_LEN               32 /**< Max size of TLS pre-shared keys, in bytes (default 256 or 384 bits) */
 //#define MBEDTLS_SSL_COOKIE_TIMEOUT        60 /**< Default expiration delay of DTLS cookies, in seconds if HAVE_TIME, or in number of cookies issued */
 
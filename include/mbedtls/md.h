@@ -552,6 +552,12 @@ int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output);
  *                  Afterwards call mbedtls_md_hmac_update() to pass the new
  *                  input.
  *
+ * \note            The context keeps the hash states that follow the
+ *                  padded key blocks, so this function does not run the
+ *                  hash compression function. Calling it rather than
+ *                  mbedtls_md_hmac_starts() with the same key saves two
+ *                  compression function calls per message.
+ *
  * \param ctx       The message digest context containing an embedded HMAC
  *                  context.
  *
@@ -566,8 +572,8 @@ int mbedtls_md_hmac_reset(mbedtls_md_context_t *ctx);
  * \brief          This function calculates the full generic HMAC
  *                 on the input buffer with the provided key.
  *
- *                 The function allocates the context, performs the
- *                 calculation, and frees the context.
+ *                 The function performs the calculation on a context
+ *                 on the stack and does not allocate memory.
  *
  *                 The HMAC result is calculated as
  *                 output = generic HMAC(hmac key, input buffer).
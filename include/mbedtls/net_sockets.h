@@ -75,6 +75,8 @@
 
 #define MBEDTLS_NET_LISTEN_BACKLOG         10 /**< The backlog that listen() should use. */
 
+#define MBEDTLS_NET_SENDV_MAX_IOV          16 /**< Maximum number of buffers written by mbedtls_net_sendv(). */
+
 #define MBEDTLS_NET_PROTO_TCP 0 /**< The TCP transport protocol */
 #define MBEDTLS_NET_PROTO_UDP 1 /**< The UDP transport protocol */
 
@@ -253,6 +255,35 @@ int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len);
  */
 int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
 
+/**
+ * \brief          Buffer descriptor for mbedtls_net_sendv()
+ */
+typedef struct mbedtls_net_iovec {
+    const unsigned char *base;  /*!< start of the buffer  */
+    size_t len;                 /*!< length of the buffer */
+} mbedtls_net_iovec;
+
+/**
+ * \brief          Write the content of several buffers, in order, with a
+ *                 single system call where the platform allows it (writev()
+ *                 on POSIX systems). If no error occurs, the actual amount
+ *                 written is returned.
+ *
+ * \note           Like mbedtls_net_send(), this function may write less
+ *                 than the total length of the buffers. At most
+ *                 MBEDTLS_NET_SENDV_MAX_IOV buffers are written per call.
+ *                 On Windows, only the first non-empty buffer is written.
+ *
+ * \param ctx      Socket
+ * \param iov      The buffers to read from
+ * \param iovcnt   The number of buffers in \p iov
+ *
+ * \return         the number of bytes sent,
+ *                 or a non-zero error code; with a non-blocking socket,
+ *                 MBEDTLS_ERR_SSL_WANT_WRITE indicates writev() would block.
+ */
+int mbedtls_net_sendv(void *ctx, const mbedtls_net_iovec *iov, size_t iovcnt);
+
 /**
  * \brief          Read at most 'len' characters, blocking for at most
  *                 'timeout' seconds. If no error occurs, the actual amount
@@ -282,6 +313,132 @@ int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len);
 int mbedtls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len,
                              uint32_t timeout);
 
+/**
+ * \brief          Read one datagram from an unconnected UDP socket, along
+ *                 with the address of its sender.
+ *
+ * \note           The address is returned in the format of the system
+ *                 (a struct sockaddr_in or sockaddr_in6 on POSIX systems),
+ *                 ready to be passed back to mbedtls_net_send_to(). Fields
+ *                 that can vary between datagrams of a same peer, such as
+ *                 the IPv6 flow label, are cleared so that addresses can
+ *                 be compared byte by byte.
+ *
+ * \param ctx      Socket, typically bound with mbedtls_net_bind()
+ * \param buf      The buffer to write to
+ * \param len      Maximum length of the buffer
+ * \param addr     The buffer to write the address of the sender to
+ * \param addr_size Size of \p addr in bytes
+ * \param addr_len Will receive the length of the address
+ *
+ * \return         The number of bytes received if successful.
+ *                 MBEDTLS_ERR_SSL_WANT_READ if no datagram is available on
+ *                 a non-blocking socket.
+ *                 MBEDTLS_ERR_NET_BUFFER_TOO_SMALL if \p addr_size is too
+ *                 small for the address.
+ *                 Another negative error code (MBEDTLS_ERR_NET_xxx)
+ *                 for other failures.
+ */
+int mbedtls_net_recv_from(void *ctx,
+                          unsigned char *buf, size_t len,
+                          void *addr, size_t addr_size, size_t *addr_len);
+
+/**
+ * \brief          Write one datagram to a given address on an unconnected
+ *                 UDP socket.
+ *
+ * \param ctx      Socket (an mbedtls_net_context)
+ * \param addr     The address, as returned by mbedtls_net_recv_from()
+ * \param addr_len Length of \p addr in bytes
+ * \param buf      The datagram to send
+ * \param len      Length of the datagram
+ *
+ * \return         The number of bytes sent if successful.
+ *                 MBEDTLS_ERR_SSL_WANT_WRITE if the datagram could not be
+ *                 sent without blocking on a non-blocking socket.
+ *                 Another negative error code (MBEDTLS_ERR_NET_xxx)
+ *                 for other failures.
+ */
+int mbedtls_net_send_to(void *ctx, const unsigned char *addr, size_t addr_len,
+                        const unsigned char *buf, size_t len);
+
+#if defined(MBEDTLS_SSL_KTLS)
+/**
+ * \brief          Hand the record protection of an established TLS
+ *                 connection over to the Linux kernel (kTLS).
+ *
+ *                 Both directions are exported with
+ *                 mbedtls_ssl_export_ktls_info() and installed on the
+ *                 socket with setsockopt(TCP_ULP, "tls"), TLS_TX and
+ *                 TLS_RX. Afterwards, mbedtls_net_send(), mbedtls_net_recv()
+ *                 and plain socket calls, including sendfile() and splice(),
+ *                 carry application data in clear on \p ctx, and \p ssl
+ *                 must no longer be used for reading or writing.
+ *
+ * \note           Other record types are exchanged with
+ *                 mbedtls_net_ktls_send_record() and
+ *                 mbedtls_net_ktls_recv_record(). This includes alerts
+ *                 such as close_notify, and post-handshake messages. As
+ *                 the record protection state no longer belongs to \p ssl,
+ *                 such messages can't be passed back to it: the
+ *                 application should ignore TLS 1.3 NewSessionTicket
+ *                 messages and close the connection on anything else,
+ *                 including a TLS 1.3 KeyUpdate.
+ *
+ * \param ctx      Socket of the connection, connected by TCP
+ * \param ssl      SSL context of the connection, handshake over. It must
+ *                 not hold unsent or unread data.
+ *
+ * \return         \c 0 if successful.
+ * \return         #MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE if the platform, the
+ *                 kernel or the ciphersuite doesn't support kTLS. The socket
+ *                 is unchanged and \p ssl can still be used.
+ * \return         Another error from mbedtls_ssl_export_ktls_info().
+ * \return         #MBEDTLS_ERR_NET_SOCKET_FAILED if kTLS could only be
+ *                 partially set up. The connection must then be closed.
+ */
+int mbedtls_net_ktls_enable(mbedtls_net_context *ctx,
+                            const mbedtls_ssl_context *ssl);
+
+/**
+ * \brief          Send one record of the given type on a connection set up
+ *                 with mbedtls_net_ktls_enable().
+ *
+ * \param ctx      Socket
+ * \param record_type The record content type, e.g. #MBEDTLS_SSL_MSG_ALERT.
+ * \param buf      The record content
+ * \param len      The length of the content, at most
+ *                 #MBEDTLS_SSL_OUT_CONTENT_LEN
+ *
+ * \return         the number of bytes sent,
+ *                 or a non-zero error code; with a non-blocking socket,
+ *                 MBEDTLS_ERR_SSL_WANT_WRITE indicates sendmsg() would block.
+ */
+int mbedtls_net_ktls_send_record(mbedtls_net_context *ctx,
+                                 unsigned char record_type,
+                                 const unsigned char *buf, size_t len);
+
+/**
+ * \brief          Receive data on a connection set up with
+ *                 mbedtls_net_ktls_enable(), along with its record type.
+ *
+ *                 Application data may be returned across record boundaries,
+ *                 other records are returned one at a time.
+ *
+ * \param ctx      Socket
+ * \param record_type On success, the content type of the data received.
+ * \param buf      The buffer to write to
+ * \param len      Maximum length of the buffer
+ *
+ * \return         the number of bytes received,
+ *                 or a non-zero error code; with a non-blocking socket,
+ *                 MBEDTLS_ERR_SSL_WANT_READ indicates recvmsg() would block.
+ */
+int mbedtls_net_ktls_recv_record(mbedtls_net_context *ctx,
+                                 unsigned char *record_type,
+                                 unsigned char *buf, size_t len);
+#endif /* MBEDTLS_SSL_KTLS */
+
 /**
  * \brief          Closes down the connection and free associated data
  *
@@ -296,6 +296,9 @@
 #define MBEDTLS_SSL_EXTENDED_MS_DISABLED        0
 #define MBEDTLS_SSL_EXTENDED_MS_ENABLED         1
 
+#define MBEDTLS_SSL_READ_AHEAD_DISABLED         0
+#define MBEDTLS_SSL_READ_AHEAD_ENABLED          1
+
 #define MBEDTLS_SSL_CID_DISABLED                0
 #define MBEDTLS_SSL_CID_ENABLED                 1
 
@@ -411,6 +414,28 @@
 #define MBEDTLS_SSL_CID_TLS1_3_PADDING_GRANULARITY 16
 #endif
 
+/*
+ * Maximum number of records sent at once by mbedtls_ssl_write().
+ */
+#if !defined(MBEDTLS_SSL_WRITE_BATCH_RECORDS)
+#define MBEDTLS_SSL_WRITE_BATCH_RECORDS 4
+#endif
+
+/*
+ * Size in bits of the DTLS anti-replay window.
+ */
+#if !defined(MBEDTLS_SSL_DTLS_REPLAY_WINDOW)
+#define MBEDTLS_SSL_DTLS_REPLAY_WINDOW 64
+#endif
+
+/*
+ * Maximum length of the handshake messages buffered before the hash of
+ * the transcript is known.
+ */
+#if !defined(MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN)
+#define MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN 4096
+#endif
+
 /** \} name SECTION: Module settings */
 
 /*
@@ -547,6 +572,7 @@
 #define MBEDTLS_SSL_HS_CERTIFICATE_VERIFY      15
 #define MBEDTLS_SSL_HS_CLIENT_KEY_EXCHANGE     16
 #define MBEDTLS_SSL_HS_FINISHED                20
+#define MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE  25 /* RFC 8879 */
 #define MBEDTLS_SSL_HS_MESSAGE_HASH           254
 
 /*
@@ -576,6 +602,7 @@
 #define MBEDTLS_TLS_EXT_ENCRYPT_THEN_MAC            22 /* 0x16 */
 #define MBEDTLS_TLS_EXT_EXTENDED_MASTER_SECRET  0x0017 /* 23 */
 
+#define MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE        27 /* RFC 8879 (implemented for TLS 1.3 only) */
 #define MBEDTLS_TLS_EXT_RECORD_SIZE_LIMIT           28 /* RFC 8449 (implemented for TLS 1.3 only) */
 
 #define MBEDTLS_TLS_EXT_SESSION_TICKET              35
@@ -602,6 +629,16 @@
 
 #define MBEDTLS_TLS_EXT_RENEGOTIATION_INFO      0xFF01
 
+/*
+ * TLS 1.3 certificate compression algorithms (RFC 8879)
+ */
+#define MBEDTLS_SSL_CERT_COMPRESSION_ZLIB            1
+#define MBEDTLS_SSL_CERT_COMPRESSION_BROTLI          2
+#define MBEDTLS_SSL_CERT_COMPRESSION_ZSTD            3
+
+/* Maximum number of algorithms of mbedtls_ssl_conf_cert_compression() */
+#define MBEDTLS_SSL_CERT_COMPRESSION_MAX_ALGS        8
+
 /*
  * Size defines
  */
@@ -896,6 +933,150 @@ typedef int mbedtls_ssl_cache_set_t(void *data,
                                     size_t session_id_len,
                                     const mbedtls_ssl_session *session);
 
+#if defined(MBEDTLS_X509_CRT_PARSE_C)
+/** Length of the keys of the verified certificate chain cache */
+#define MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN    32
+
+/**
+ * \brief          Callback type: verified certificate chain cache getter
+ *
+ *                 The cache is logically a map from keys, each a digest of
+ *                 a peer certificate chain and of everything its
+ *                 verification depended on, to the validity window of the
+ *                 verified path. The handshake ignores a hit outside of
+ *                 that window.
+ *
+ * \param data     The address of the cache structure to query.
+ * \param key      The buffer holding the key to look up.
+ * \param key_len  The length of \p key in Bytes.
+ * \param valid_from On a hit, the start of the validity window stored
+ *                 with \p key.
+ * \param valid_to On a hit, the end of the validity window stored with
+ *                 \p key.
+ *
+ * \return         \c 0 if the chain was verified successfully before.
+ * \return         A non-zero return value otherwise.
+ */
+typedef int mbedtls_ssl_verify_cache_get_t(void *data,
+                                           unsigned char const *key,
+                                           size_t key_len,
+                                           mbedtls_x509_time *valid_from,
+                                           mbedtls_x509_time *valid_to);
+/**
+ * \brief          Callback type: verified certificate chain cache setter
+ *
+ *                 This callback adds a key to the cache, after the chain
+ *                 was verified successfully.
+ *
+ * \param data     The address of the cache structure to modify.
+ * \param key      The buffer holding the key to add.
+ * \param key_len  The length of \p key in Bytes.
+ * \param valid_from The latest start of validity of the certificates on
+ *                 the verified path, trusted CA included.
+ * \param valid_to The earliest end of validity of the certificates on the
+ *                 verified path, trusted CA included.
+ *
+ * \return         \c 0 on success
+ * \return         A non-zero return value on failure.
+ */
+typedef int mbedtls_ssl_verify_cache_set_t(void *data,
+                                           unsigned char const *key,
+                                           size_t key_len,
+                                           const mbedtls_x509_time *valid_from,
+                                           const mbedtls_x509_time *valid_to);
+#endif /* MBEDTLS_X509_CRT_PARSE_C */
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_ECDH_C)
+/**
+ * \brief          Callback type: take a precomputed ephemeral key share
+ *
+ *                 The callback provides an ECDHE key pair of the given
+ *                 group that was generated in advance, and which it must
+ *                 never provide again. The private key is in the format of
+ *                 psa_import_key(), the public key in the format of the
+ *                 TLS 1.3 key_share extension.
+ *
+ * \param p_pool   The context set with mbedtls_ssl_tls13_conf_key_share_pool().
+ * \param group    The IANA NamedGroup of the key share.
+ * \param priv     Buffer for the private key.
+ * \param priv_size Size of \p priv in bytes.
+ * \param priv_len On success, the length of the private key.
+ * \param pub      Buffer for the public key.
+ * \param pub_size Size of \p pub in bytes.
+ * \param pub_len  On success, the length of the public key.
+ *
+ * \return         0 on success.
+ * \return         Any other value if no key pair is available: the
+ *                 handshake then generates one.
+ */
+typedef int mbedtls_ssl_key_share_take_t(void *p_pool,
+                                         uint16_t group,
+                                         unsigned char *priv,
+                                         size_t priv_size,
+                                         size_t *priv_len,
+                                         unsigned char *pub,
+                                         size_t pub_size,
+                                         size_t *pub_len);
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_ECDH_C */
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+/**
+ * \brief          Callback type: get a record buffer from a buffer pool
+ *
+ * \param p_pool   The address of the buffer pool.
+ * \param len      The length of the buffer in Bytes.
+ *
+ * \return         A buffer of \p len Bytes, all set to zero, or \c NULL
+ *                 if no memory is available.
+ */
+typedef unsigned char *mbedtls_ssl_buffer_acquire_t(void *p_pool, size_t len);
+
+/**
+ * \brief          Callback type: give a record buffer back to a buffer pool
+ *
+ * \note           The buffer may still contain sensitive data. The pool
+ *                 must wipe it before it is reused or freed.
+ *
+ * \param p_pool   The address of the buffer pool.
+ * \param buf      A buffer obtained from the acquire callback of the same
+ *                 pool.
+ * \param len      The length of \p buf in Bytes, as passed to the acquire
+ *                 callback.
+ */
+typedef void mbedtls_ssl_buffer_release_t(void *p_pool, unsigned char *buf,
+                                          size_t len);
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+/**
+ * \brief          Callback type: one job of a batch
+ *
+ * \param p_job    The context shared by the jobs of the batch.
+ * \param index    The index of the job in the batch.
+ */
+typedef void mbedtls_ssl_job_t(void *p_job, size_t index);
+
+/**
+ * \brief          Callback type: run a batch of independent jobs
+ *
+ *                 The callback must call \p f_job once with each index from
+ *                 \c 0 to \p count - 1, in any order and possibly from
+ *                 several threads at the same time, and return only once
+ *                 all these calls have returned.
+ *
+ * \param p_workers The context passed to mbedtls_ssl_conf_record_workers().
+ * \param f_job    The job function.
+ * \param p_job    The context to pass to \p f_job.
+ * \param count    The number of jobs in the batch.
+ *
+ * \return         \c 0 if all jobs have run.
+ * \return         A non-zero value if the jobs couldn't be run. The jobs
+ *                 must then not have been started at all.
+ */
+typedef int mbedtls_ssl_run_jobs_t(void *p_workers, mbedtls_ssl_job_t *f_job,
+                                   void *p_job, size_t count);
+#endif /* MBEDTLS_SSL_PARALLEL_ENCRYPTION */
+
 #if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 /**
@@ -921,9 +1102,21 @@ typedef int mbedtls_ssl_cache_set_t(void *data,
  *                  to store an operation context for later retrieval
  *                  by the resume or cancel callback.
  *
- * \note            For RSA signatures, this function must produce output
- *                  that is consistent with PKCS#1 v1.5 in the same way as
- *                  mbedtls_rsa_pkcs1_sign(). Before the private key operation,
+ *                  In TLS 1.2, this callback is called by the server to sign
+ *                  the ServerKeyExchange message. In TLS 1.3, it is called
+ *                  by the server, and by the client when it authenticates
+ *                  with a certificate, to sign the CertificateVerify
+ *                  message. Use mbedtls_ssl_get_version_number() to tell
+ *                  the two cases apart.
+ *
+ * \note            In TLS 1.3, RSA signatures use RSASSA-PSS as specified
+ *                  in RFC 8017, section 8.1, with MGF1 based on \p md_alg
+ *                  and a salt as long as \p hash, in the same way as
+ *                  mbedtls_pk_sign_ext() with #MBEDTLS_PK_RSASSA_PSS.
+ *
+ * \note            In TLS 1.2, for RSA signatures, this function must produce
+ *                  output that is consistent with PKCS#1 v1.5 in the same way
+ *                  as mbedtls_rsa_pkcs1_sign(). Before the private key operation,
  *                  apply the padding steps described in RFC 8017, section 9.2
  *                  "EMSA-PKCS1-v1_5" as follows.
  *                  - If \p md_alg is #MBEDTLS_MD_NONE, apply the PKCS#1 v1.5
@@ -1041,13 +1234,89 @@ typedef int mbedtls_ssl_async_decrypt_t(mbedtls_ssl_context *ssl,
                                         size_t input_len);
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
+/**
+ * \brief           Callback type: start external key agreement operation.
+ *
+ *                  This callback is called during an SSL handshake to start
+ *                  the computation of the (EC)DHE shared secret using an
+ *                  external processor, for example a pool of worker threads.
+ *                  The library generated the ephemeral key pair and passes
+ *                  its private key together with the peer's public key.
+ *
+ *                  This callback is called:
+ *                  - in TLS 1.2, by the server and the client, for the
+ *                    ECDHE-RSA and ECDHE-ECDSA key exchanges;
+ *                  - in TLS 1.3, by the server and the client, for the
+ *                    ephemeral and psk_ephemeral key exchange modes.
+ *
+ *                  This function typically sends or enqueues a request, and
+ *                  does not wait for the operation to complete. This allows
+ *                  the handshake step to be non-blocking.
+ *
+ *                  This function must save the contents of \p own_key and
+ *                  \p peer_key if the values are needed for later
+ *                  processing, because these buffers are no longer valid
+ *                  after this function returns. It must wipe its copy of
+ *                  \p own_key once the operation completes.
+ *
+ *                  This function may call mbedtls_ssl_set_async_operation_data()
+ *                  to store an operation context for later retrieval
+ *                  by the resume or cancel callback.
+ *
+ * \note            The output of the resume callback is the shared secret
+ *                  in the format of psa_raw_key_agreement() with
+ *                  #PSA_ALG_ECDH: the x-coordinate of the shared point for
+ *                  Weierstrass curves, and the output of the X25519 or X448
+ *                  function for Montgomery curves.
+ *
+ * \note            The peer's public key has not been validated: as
+ *                  psa_raw_key_agreement(), the external processor must
+ *                  reject it if it is not a valid point on the curve.
+ *
+ * \param ssl             The SSL connection instance. It should not be
+ *                        modified other than via
+ *                        mbedtls_ssl_set_async_operation_data().
+ * \param group           The group of the key exchange, as an IANA NamedGroup
+ *                        value (\c MBEDTLS_SSL_IANA_TLS_GROUP_XXX).
+ * \param own_key         Buffer containing the ephemeral private key, in the
+ *                        format of psa_export_key(). This buffer is no longer
+ *                        valid when the function returns.
+ * \param own_key_len     Size of the \p own_key buffer in bytes.
+ * \param peer_key        Buffer containing the peer's public key, in the
+ *                        format of psa_export_public_key(), which is also the
+ *                        TLS encoding. This buffer is no longer valid when the
+ *                        function returns.
+ * \param peer_key_len    Size of the \p peer_key buffer in bytes.
+ *
+ * \return          0 if the operation was started successfully and the SSL
+ *                  stack should call the resume callback immediately.
+ * \return          #MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if the operation
+ *                  was started successfully and the SSL stack should return
+ *                  immediately without calling the resume callback yet.
+ * \return          #MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH if the external
+ *                  processor does not support this group. The SSL stack
+ *                  will compute the shared secret itself.
+ * \return          Any other error indicates a fatal failure and is
+ *                  propagated up the call chain. The callback should
+ *                  use \c MBEDTLS_ERR_ECP_xxx error codes, and <b>must not</b>
+ *                  use \c MBEDTLS_ERR_SSL_xxx error codes except as
+ *                  directed in the documentation of this callback.
+ */
+typedef int mbedtls_ssl_async_key_agreement_t(mbedtls_ssl_context *ssl,
+                                              uint16_t group,
+                                              const unsigned char *own_key,
+                                              size_t own_key_len,
+                                              const unsigned char *peer_key,
+                                              size_t peer_key_len);
+
 /**
  * \brief           Callback type: resume external operation.
  *
  *                  This callback is called during an SSL handshake to resume
  *                  an external operation started by the
- *                  ::mbedtls_ssl_async_sign_t or
- *                  ::mbedtls_ssl_async_decrypt_t callback.
+ *                  ::mbedtls_ssl_async_sign_t,
+ *                  ::mbedtls_ssl_async_decrypt_t or
+ *                  ::mbedtls_ssl_async_key_agreement_t callback.
  *
  *                  This function typically checks the status of a pending
  *                  request or causes the request queue to make progress, and
@@ -1066,8 +1335,8 @@ typedef int mbedtls_ssl_async_decrypt_t(mbedtls_ssl_context *ssl,
  * \param ssl             The SSL connection instance. It should not be
  *                        modified other than via
  *                        mbedtls_ssl_set_async_operation_data().
- * \param output          Buffer containing the output (signature or decrypted
- *                        data) on success.
+ * \param output          Buffer containing the output (signature, decrypted
+ *                        data or shared secret) on success.
  * \param output_len      On success, number of bytes written to \p output.
  * \param output_size     Size of the \p output buffer in bytes.
  *
@@ -1108,6 +1377,58 @@ typedef int mbedtls_ssl_async_resume_t(mbedtls_ssl_context *ssl,
 typedef void mbedtls_ssl_async_cancel_t(mbedtls_ssl_context *ssl);
 #endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/**
+ * \brief           Callback type: compress a TLS 1.3 Certificate message
+ *
+ * \param p_ctx     The context set with mbedtls_ssl_conf_cert_compression().
+ * \param algorithm The CertificateCompressionAlgorithm to use, one of the
+ *                  list passed to mbedtls_ssl_conf_cert_compression().
+ * \param input     The Certificate message, without handshake header.
+ * \param input_len The length of \p input in bytes.
+ * \param output    The buffer for the compressed message.
+ * \param output_size The size of \p output in bytes. It is \p input_len:
+ *                  compression must save at least one byte.
+ * \param output_len On success, the length of the compressed message.
+ *
+ * \return          0 on success.
+ * \return          Any other value if the message can't be compressed with
+ *                  \p algorithm. It is then sent uncompressed to peers
+ *                  that would have chosen \p algorithm.
+ */
+typedef int mbedtls_ssl_cert_compress_t(void *p_ctx,
+                                        uint16_t algorithm,
+                                        const unsigned char *input,
+                                        size_t input_len,
+                                        unsigned char *output,
+                                        size_t output_size,
+                                        size_t *output_len);
+
+/**
+ * \brief           Callback type: decompress a TLS 1.3 Certificate message
+ *
+ * \param p_ctx     The context set with mbedtls_ssl_conf_cert_compression().
+ * \param algorithm The CertificateCompressionAlgorithm of \p input, one of
+ *                  the list passed to mbedtls_ssl_conf_cert_compression().
+ * \param input     The compressed Certificate message.
+ * \param input_len The length of \p input in bytes.
+ * \param output    The buffer for the Certificate message.
+ * \param output_len The length announced by the peer. The callback must
+ *                  fail unless \p input decompresses to exactly that many
+ *                  bytes.
+ *
+ * \return          0 on success.
+ * \return          Any other value if \p input is invalid. The handshake
+ *                  is then aborted with a bad_certificate alert.
+ */
+typedef int mbedtls_ssl_cert_decompress_t(void *p_ctx,
+                                          uint16_t algorithm,
+                                          const unsigned char *input,
+                                          size_t input_len,
+                                          unsigned char *output,
+                                          size_t output_len);
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_KEY_EXCHANGE_WITH_CERT_ENABLED) &&        \
     !defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
 #define MBEDTLS_SSL_PEER_CERT_DIGEST_MAX_LEN  48
@@ -1232,6 +1553,15 @@ struct mbedtls_ssl_session {
     uint8_t MBEDTLS_PRIVATE(resumption_key_len);            /*!< resumption_key length */
     unsigned char MBEDTLS_PRIVATE(resumption_key)[MBEDTLS_SSL_TLS1_3_TICKET_RESUMPTION_KEY_LEN];
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    uint32_t MBEDTLS_PRIVATE(max_early_data_size);          /*!< maximum amount of early data allowed with the ticket */
+#endif
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    char *MBEDTLS_PRIVATE(ticket_alpn);          /*!< ALPN negotiated in the session during which the ticket was generated */
+#endif
+
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION) && defined(MBEDTLS_SSL_CLI_C)
     char *MBEDTLS_PRIVATE(hostname);             /*!< host name binded with tickets */
 #endif /* MBEDTLS_SSL_SERVER_NAME_INDICATION && MBEDTLS_SSL_CLI_C */
@@ -1367,6 +1697,9 @@ struct mbedtls_ssl_config {
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     uint8_t MBEDTLS_PRIVATE(disable_renegotiation); /*!< disable renegotiation?     */
 #endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    uint8_t MBEDTLS_PRIVATE(read_ahead);    /*!< read past the current record?      */
+#endif
 #if defined(MBEDTLS_SSL_SESSION_TICKETS) && \
     defined(MBEDTLS_SSL_CLI_C)
     uint8_t MBEDTLS_PRIVATE(session_tickets);   /*!< use session tickets? */
@@ -1421,6 +1754,20 @@ struct mbedtls_ssl_config {
     mbedtls_ssl_cache_set_t *MBEDTLS_PRIVATE(f_set_cache);
     void *MBEDTLS_PRIVATE(p_cache);                  /*!< context for cache callbacks        */
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    /** Callback to get a record buffer from the buffer pool                */
+    mbedtls_ssl_buffer_acquire_t *MBEDTLS_PRIVATE(f_buffer_acquire);
+    /** Callback to give a record buffer back to the buffer pool            */
+    mbedtls_ssl_buffer_release_t *MBEDTLS_PRIVATE(f_buffer_release);
+    void *MBEDTLS_PRIVATE(p_buffer_pool);            /*!< context for buffer pool callbacks  */
+#endif
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    /** Callback to run the encryption of a batch of records                */
+    mbedtls_ssl_run_jobs_t *MBEDTLS_PRIVATE(f_run_jobs);
+    void *MBEDTLS_PRIVATE(p_workers);                /*!< context for the job runner         */
+#endif
+
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
     /** Callback for setting cert according to SNI extension                */
     int(*MBEDTLS_PRIVATE(f_sni))(void *, mbedtls_ssl_context *, const unsigned char *, size_t);
@@ -1473,13 +1820,24 @@ struct mbedtls_ssl_config {
     mbedtls_x509_crt_ca_cb_t MBEDTLS_PRIVATE(f_ca_cb);
     void *MBEDTLS_PRIVATE(p_ca_cb);
 #endif /* MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK */
+    mbedtls_ssl_verify_cache_get_t *MBEDTLS_PRIVATE(f_get_verify_cache); /*!< look up a verified chain */
+    mbedtls_ssl_verify_cache_set_t *MBEDTLS_PRIVATE(f_set_verify_cache); /*!< store a verified chain   */
+    void *MBEDTLS_PRIVATE(p_verify_cache);           /*!< context for verify cache callbacks */
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    const uint16_t *MBEDTLS_PRIVATE(cert_compression_algs); /*!< certificate compression algorithms */
+    mbedtls_ssl_cert_compress_t *MBEDTLS_PRIVATE(f_cert_compress);     /*!< compress a certificate   */
+    mbedtls_ssl_cert_decompress_t *MBEDTLS_PRIVATE(f_cert_decompress); /*!< decompress a certificate */
+    void *MBEDTLS_PRIVATE(p_cert_compression);       /*!< context for the codec callbacks    */
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
     mbedtls_ssl_async_sign_t *MBEDTLS_PRIVATE(f_async_sign_start); /*!< start asynchronous signature operation */
     mbedtls_ssl_async_decrypt_t *MBEDTLS_PRIVATE(f_async_decrypt_start); /*!< start asynchronous decryption operation */
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
+    mbedtls_ssl_async_key_agreement_t *MBEDTLS_PRIVATE(f_async_key_agreement_start); /*!< start asynchronous key agreement operation */
     mbedtls_ssl_async_resume_t *MBEDTLS_PRIVATE(f_async_resume); /*!< resume asynchronous operation */
     mbedtls_ssl_async_cancel_t *MBEDTLS_PRIVATE(f_async_cancel); /*!< cancel asynchronous operation */
     void *MBEDTLS_PRIVATE(p_async_config_data); /*!< Configuration data set by mbedtls_ssl_conf_async_private_cb(). */
@@ -1499,6 +1857,12 @@ struct mbedtls_ssl_config {
 
     const uint16_t *MBEDTLS_PRIVATE(group_list);     /*!< allowed IANA NamedGroups */
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_ECDH_C)
+    /** Callback to take a precomputed ephemeral key share                  */
+    mbedtls_ssl_key_share_take_t *MBEDTLS_PRIVATE(f_key_share_take);
+    void *MBEDTLS_PRIVATE(p_key_share);              /*!< context for the key share callback */
+#endif
+
 #if defined(MBEDTLS_DHM_C)
     mbedtls_mpi MBEDTLS_PRIVATE(dhm_P);              /*!< prime modulus for DHM              */
     mbedtls_mpi MBEDTLS_PRIVATE(dhm_G);              /*!< generator for DHM                  */
@@ -1545,6 +1909,10 @@ struct mbedtls_ssl_config {
 #if defined(MBEDTLS_SSL_SRV_C)
     /* The maximum amount of 0-RTT data. RFC 8446 section 4.6.1 */
     uint32_t MBEDTLS_PRIVATE(max_early_data_size);
+
+    /** Callback to check that a ClientHello with early data is not a replay */
+    int(*MBEDTLS_PRIVATE(f_early_data_replay))(void *, const unsigned char *, size_t);
+    void *MBEDTLS_PRIVATE(p_early_data_replay);      /*!< context for the replay callback   */
 #endif /* MBEDTLS_SSL_SRV_C */
 
 #endif /* MBEDTLS_SSL_EARLY_DATA */
@@ -1712,6 +2080,17 @@ struct mbedtls_ssl_context {
 #if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
     size_t MBEDTLS_PRIVATE(in_buf_len);          /*!< length of input buffer           */
 #endif
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    unsigned char MBEDTLS_PRIVATE(in_ctr_idle)[MBEDTLS_SSL_SEQUENCE_NUMBER_LEN];
+                                                 /*!< TLS: incoming message counter
+                                                    while in_buf is released   */
+#endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    size_t MBEDTLS_PRIVATE(in_ahead_offset);     /*!< TLS: offset of the data read
+                                                    past the current record   */
+    size_t MBEDTLS_PRIVATE(in_ahead_len);        /*!< TLS: amount of data read
+                                                    past the current record   */
+#endif
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     uint16_t MBEDTLS_PRIVATE(in_epoch);          /*!< DTLS epoch for incoming records  */
     size_t MBEDTLS_PRIVATE(next_record_offset);  /*!< offset of the next record in datagram
@@ -1719,7 +2098,8 @@ struct mbedtls_ssl_context {
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 #if defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY)
     uint64_t MBEDTLS_PRIVATE(in_window_top);     /*!< last validated record seq_num    */
-    uint64_t MBEDTLS_PRIVATE(in_window);         /*!< bitmask for replay detection     */
+    uint64_t MBEDTLS_PRIVATE(in_window)[MBEDTLS_SSL_DTLS_REPLAY_WINDOW / 64];
+    /*!< bitmask for replay detection, most recent records first */
 #endif /* MBEDTLS_SSL_DTLS_ANTI_REPLAY */
 
     size_t MBEDTLS_PRIVATE(in_hslen);            /*!< current handshake message length,
@@ -1745,6 +2125,12 @@ struct mbedtls_ssl_context {
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     uint8_t MBEDTLS_PRIVATE(disable_datagram_packing);  /*!< Disable packing multiple records
                                                          *   within a single datagram.  */
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    size_t MBEDTLS_PRIVATE(dtls_arena_peak);     /*!< highest handshake buffering
+                                                  *   arena usage seen          */
+    size_t MBEDTLS_PRIVATE(dtls_arena_failures); /*!< buffering requests that the
+                                                  *   arena could not serve     */
+#endif /* MBEDTLS_SSL_DTLS_BUFFERING_ARENA */
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 
     /*
@@ -1828,9 +2214,16 @@ struct mbedtls_ssl_context {
                                              *   and #MBEDTLS_SSL_CID_DISABLED. */
 #endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
 
-#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_CLI_C)
+#if defined(MBEDTLS_SSL_EARLY_DATA)
     int MBEDTLS_PRIVATE(early_data_status);
-#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_CLI_C */
+    uint32_t MBEDTLS_PRIVATE(total_early_data_size); /*!< early data sent or received */
+#if defined(MBEDTLS_SSL_SRV_C)
+    int MBEDTLS_PRIVATE(discard_early_data_record); /*!< skip rejected early data records */
+    unsigned char *MBEDTLS_PRIVATE(early_data_buf); /*!< early data not read yet */
+    size_t MBEDTLS_PRIVATE(early_data_len);         /*!< length of early_data_buf */
+    size_t MBEDTLS_PRIVATE(early_data_offt);        /*!< read offset in early_data_buf */
+#endif /* MBEDTLS_SSL_SRV_C */
+#endif /* MBEDTLS_SSL_EARLY_DATA */
 
     /** Callback to export key block and master secret                      */
     mbedtls_ssl_export_keys_t *MBEDTLS_PRIVATE(f_export_keys);
@@ -2008,6 +2401,11 @@ void mbedtls_ssl_tls13_conf_early_data(mbedtls_ssl_config *conf,
  *       The maximum amount of 0-RTT data should thus be large enough
  *       to allow a minimum of early data to be exchanged.
  *
+ * \note The limit is recorded in the tickets: changing it does not affect
+ *       the tickets already issued. It also bounds the memory used to hold
+ *       the accepted early data of a connection until it is read, and the
+ *       amount of rejected early data the server skips.
+ *
  * \param[in] conf                  The SSL configuration to use.
  * \param[in] max_early_data_size   The maximum amount of 0-RTT data.
  *
@@ -2016,6 +2414,54 @@ void mbedtls_ssl_tls13_conf_early_data(mbedtls_ssl_config *conf,
  */
 void mbedtls_ssl_tls13_conf_max_early_data_size(
     mbedtls_ssl_config *conf, uint32_t max_early_data_size);
+
+/**
+ * \brief           Callback type: check that a ClientHello carrying early
+ *                  data is seen for the first time
+ *
+ * \note            This describes what a callback implementation should do.
+ *                  The callback records \p id and reports whether it has
+ *                  recorded the same value before. It must remember the
+ *                  values for at least the ticket age tolerance,
+ *                  #MBEDTLS_SSL_TLS1_3_TICKET_AGE_TOLERANCE milliseconds.
+ *                  It may report a fresh value as a replay (for instance
+ *                  when it is full): the server then only rejects the early
+ *                  data and completes the handshake.
+ *
+ * \param ctx       Context for the callback
+ * \param id        Binder of the PSK the server selected: a MAC of the
+ *                  ClientHello up to the binders, which identifies it
+ *                  (RFC 8446 section 8.2)
+ * \param id_len    Length of the binder
+ *
+ * \return          0 if \p id has not been seen before, or a non-zero
+ *                  value if the ClientHello may be a replay.
+ */
+typedef int mbedtls_ssl_early_data_replay_t(void *ctx,
+                                            const unsigned char *id,
+                                            size_t id_len);
+
+/**
+ * \brief           Set the anti-replay callback of early data (server only)
+ *                  (Default: none.)
+ *
+ * \note            The server rejects early data when no anti-replay
+ *                  callback is set: early data can be replayed by an
+ *                  attacker, see RFC 8446 section 8. The callback is called
+ *                  only for the ClientHello messages that otherwise qualify
+ *                  for early data. mbedtls_ssl_early_data_replay_check() is
+ *                  an implementation, see ssl_early_data_replay.h.
+ *
+ * \param conf      SSL configuration
+ * \param f_replay  Anti-replay callback
+ * \param p_replay  Context for the callback
+ *
+ * \warning This interface is experimental and may change without notice.
+ */
+void mbedtls_ssl_tls13_conf_early_data_replay(
+    mbedtls_ssl_config *conf,
+    mbedtls_ssl_early_data_replay_t *f_replay,
+    void *p_replay);
 #endif /* MBEDTLS_SSL_SRV_C */
 
 #endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA */
@@ -2713,7 +3159,8 @@ static inline uintptr_t mbedtls_ssl_get_user_data_n(
  *                          the description of ::mbedtls_ssl_async_resume_t
  *                          for more information. This may not be \c NULL unless
  *                          \p f_async_sign and \p f_async_decrypt are both
- *                          \c NULL.
+ *                          \c NULL and no key agreement callback is set with
+ *                          mbedtls_ssl_conf_async_key_agreement_cb().
  * \param f_async_cancel    Callback to cancel an asynchronous operation. See
  *                          the description of ::mbedtls_ssl_async_cancel_t
  *                          for more information. This may be \c NULL if
@@ -2730,6 +3177,35 @@ void mbedtls_ssl_conf_async_private_cb(mbedtls_ssl_config *conf,
                                        mbedtls_ssl_async_cancel_t *f_async_cancel,
                                        void *config_data);
 
+/**
+ * \brief           Configure the asynchronous key agreement callback.
+ *
+ *                  The operation started by this callback is resumed and
+ *                  cancelled with the \p f_async_resume and
+ *                  \p f_async_cancel callbacks passed to
+ *                  mbedtls_ssl_conf_async_private_cb(), which must be called
+ *                  as well.
+ *
+ * \note            The ephemeral private key is exported to the callback:
+ *                  with #MBEDTLS_USE_PSA_CRYPTO or TLS 1.3, the ephemeral
+ *                  key is generated with #PSA_KEY_USAGE_EXPORT while this
+ *                  callback is set.
+ *
+ * \note            The ECDHE-PSK key exchange and the TLS 1.2 ECDH-RSA and
+ *                  ECDH-ECDSA key exchanges, which use the key of the
+ *                  certificate, always compute the shared secret locally.
+ *
+ * \param conf              SSL configuration context
+ * \param f_async_key_agreement Callback to start a key agreement operation.
+ *                          See the description of
+ *                          ::mbedtls_ssl_async_key_agreement_t for more
+ *                          information. \c NULL (default) to compute the
+ *                          shared secret locally.
+ */
+void mbedtls_ssl_conf_async_key_agreement_cb(
+    mbedtls_ssl_config *conf,
+    mbedtls_ssl_async_key_agreement_t *f_async_key_agreement);
+
 /**
  * \brief           Retrieve the configuration data set by
  *                  mbedtls_ssl_conf_async_private_cb().
@@ -3020,6 +3496,69 @@ void mbedtls_ssl_conf_session_cache(mbedtls_ssl_config *conf,
                                     mbedtls_ssl_cache_set_t *f_set_cache);
 #endif /* MBEDTLS_SSL_SRV_C */
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+/**
+ * \brief          Set the buffer pool that holds the record buffers of the
+ *                 SSL contexts using this configuration.
+ *
+ *                 Once the handshake is over, a context gives its input and
+ *                 output buffers back to the pool whenever it holds no
+ *                 partial record, typically when mbedtls_ssl_read() returns
+ *                 #MBEDTLS_ERR_SSL_WANT_READ on an idle connection. It gets
+ *                 them back from the pool on the next call that needs them.
+ *                 This bounds the memory used by a large number of mostly
+ *                 idle connections by the number of active ones.
+ *
+ *                 mbedtls_ssl_buffer_pool_acquire() and
+ *                 mbedtls_ssl_buffer_pool_release() implement these
+ *                 callbacks on top of an ::mbedtls_ssl_buffer_pool.
+ *
+ * \note           When no pool is set, the buffers are allocated with
+ *                 mbedtls_calloc() and kept for the lifetime of the context.
+ *
+ * \warning        The pool must not be changed between mbedtls_ssl_setup()
+ *                 and mbedtls_ssl_free() of any context using \p conf.
+ *
+ * \param conf     SSL configuration
+ * \param p_pool   parameter (context) for both callbacks
+ * \param f_acquire  buffer acquire callback
+ * \param f_release  buffer release callback
+ */
+void mbedtls_ssl_conf_buffer_pool(mbedtls_ssl_config *conf,
+                                  void *p_pool,
+                                  mbedtls_ssl_buffer_acquire_t *f_acquire,
+                                  mbedtls_ssl_buffer_release_t *f_release);
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+/**
+ * \brief          Set the job runner used to encrypt the records of a
+ *                 large mbedtls_ssl_write() concurrently.
+ *
+ *                 When mbedtls_ssl_write() splits its data into several
+ *                 records (see #MBEDTLS_SSL_RECORD_BATCHING) and the
+ *                 outgoing transform uses an AEAD cipher, the encryption of
+ *                 each record is a separate job passed to \p f_run_jobs.
+ *                 The records are then sent in order, as without a runner.
+ *                 Other records are encrypted in the calling thread.
+ *
+ *                 mbedtls_ssl_worker_pool_run() implements this callback on
+ *                 top of an ::mbedtls_ssl_worker_pool.
+ *
+ * \note           Jobs of the same context run while the calling thread is
+ *                 inside mbedtls_ssl_write(), but they may call the debug
+ *                 callback from other threads.
+ *
+ * \param conf     SSL configuration
+ * \param f_run_jobs  job runner callback, or \c NULL to encrypt all
+ *                 records in the calling thread (default)
+ * \param p_workers   parameter (context) for the callback
+ */
+void mbedtls_ssl_conf_record_workers(mbedtls_ssl_config *conf,
+                                     mbedtls_ssl_run_jobs_t *f_run_jobs,
+                                     void *p_workers);
+#endif /* MBEDTLS_SSL_PARALLEL_ENCRYPTION */
+
 #if defined(MBEDTLS_SSL_CLI_C)
 /**
  * \brief          Load a session for session resumption.
@@ -3371,6 +3910,42 @@ void mbedtls_ssl_conf_ca_cb(mbedtls_ssl_config *conf,
                             void *p_ca_cb);
 #endif /* MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK */
 
+/**
+ * \brief          Set the verified certificate chain cache callbacks
+ *                 (optional)
+ *
+ *                 Before verifying a peer certificate chain, the handshake
+ *                 looks up a SHA-256 digest of the chain, of the trusted
+ *                 CAs and CRLs, of the verification profile and of the
+ *                 expected hostname. On a hit, the chain is accepted
+ *                 without verifying its signatures again. Chains whose
+ *                 verification succeeded with all flags clear are added.
+ *                 See ssl_verify_cache.h for an implementation.
+ *
+ * \note           Trusted CAs and CRLs are identified by their signature
+ *                 values rather than hashed whole, so that large CA lists
+ *                 don't cost more than the verification they save.
+ *
+ * \note           On a hit, the validity periods of the certificates on
+ *                 the verified path, trusted CA included, and the next
+ *                 update of the CRLs are still checked against the current
+ *                 time (with #MBEDTLS_HAVE_TIME_DATE).
+ *
+ * \note           The cache is not used when a verification callback is
+ *                 set with mbedtls_ssl_conf_verify() or
+ *                 mbedtls_ssl_set_verify(), since that callback must see
+ *                 every chain, nor with mbedtls_ssl_conf_ca_cb().
+ *
+ * \param conf           SSL configuration
+ * \param p_cache        parameter (context) for both callbacks
+ * \param f_get_cache    verified chain get callback
+ * \param f_set_cache    verified chain set callback
+ */
+void mbedtls_ssl_conf_verify_cache(mbedtls_ssl_config *conf,
+                                   void *p_cache,
+                                   mbedtls_ssl_verify_cache_get_t *f_get_cache,
+                                   mbedtls_ssl_verify_cache_set_t *f_set_cache);
+
 /**
  * \brief          Set own certificate chain and private key
  *
@@ -3401,6 +3976,12 @@ void mbedtls_ssl_conf_ca_cb(mbedtls_ssl_config *conf,
  *                 this check yourself, but be aware that this function can
  *                 be computationally expensive on some key types.
  *
+ * \note           With #MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE, \p own_cert is
+ *                 serialized by this function and handshakes send that
+ *                 copy. If you change the chain afterwards, clear the
+ *                 list with mbedtls_ssl_conf_own_cert(conf, NULL, NULL)
+ *                 and configure your certificates again.
+ *
  * \param conf     SSL configuration
  * \param own_cert own public certificate chain
  * \param pk_key   own private key
@@ -3412,6 +3993,51 @@ int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config *conf,
                               mbedtls_pk_context *pk_key);
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/**
+ * \brief          Set up TLS 1.3 certificate compression (RFC 8879)
+ *
+ *                 Both endpoints offer \p algorithms in the
+ *                 compress_certificate extension, in the ClientHello and in
+ *                 the CertificateRequest respectively, when \p f_decompress
+ *                 is set. Both send their Certificate as a
+ *                 CompressedCertificate message with the first of
+ *                 \p algorithms that the peer offered, when \p f_compress is
+ *                 set.
+ *
+ * \note           The certificate chains of mbedtls_ssl_conf_own_cert() are
+ *                 compressed once with each algorithm, by this function or
+ *                 by mbedtls_ssl_conf_own_cert() if it is called later, and
+ *                 handshakes send these copies. Certificates set from an SNI
+ *                 callback with mbedtls_ssl_set_hs_own_cert() are sent
+ *                 uncompressed.
+ *
+ * \param conf     The SSL configuration.
+ * \param algorithms The CertificateCompressionAlgorithms, ordered by
+ *                 preference and terminated by 0, for example
+ *                 #MBEDTLS_SSL_CERT_COMPRESSION_ZLIB. At most
+ *                 #MBEDTLS_SSL_CERT_COMPRESSION_MAX_ALGS. The list must stay
+ *                 valid as long as \p conf is used. \c NULL disables
+ *                 certificate compression (default).
+ * \param f_compress The compression callback, or \c NULL to never send
+ *                 compressed certificates.
+ * \param f_decompress The decompression callback, or \c NULL to never
+ *                 accept compressed certificates.
+ * \param p_ctx    The context to pass to the callbacks.
+ *
+ * \return         0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if there are too many
+ *                 algorithms.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED on allocation failure.
+ *                 The certificate chains are then sent uncompressed.
+ */
+int mbedtls_ssl_conf_cert_compression(mbedtls_ssl_config *conf,
+                                      const uint16_t *algorithms,
+                                      mbedtls_ssl_cert_compress_t *f_compress,
+                                      mbedtls_ssl_cert_decompress_t *f_decompress,
+                                      void *p_ctx);
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_SSL_HANDSHAKE_WITH_PSK_ENABLED)
 /**
  * \brief          Configure pre-shared keys (PSKs) and their
@@ -3714,6 +4340,26 @@ void MBEDTLS_DEPRECATED mbedtls_ssl_conf_curves(mbedtls_ssl_config *conf,
 void mbedtls_ssl_conf_groups(mbedtls_ssl_config *conf,
                              const uint16_t *groups);
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_ECDH_C)
+/**
+ * \brief          Set the source of precomputed ephemeral key shares for
+ *                 TLS 1.3 (EC)DHE. See ssl_key_share_pool.h for an
+ *                 implementation.
+ *
+ *                 Clients and servers take the key pair of their key_share
+ *                 extension from \p f_take rather than generate it during
+ *                 the handshake, when a key pair is available.
+ *
+ * \param conf     The SSL configuration.
+ * \param f_take   The callback, or \c NULL to generate every key share
+ *                 during the handshake (default).
+ * \param p_pool   The context to pass to \p f_take.
+ */
+void mbedtls_ssl_tls13_conf_key_share_pool(mbedtls_ssl_config *conf,
+                                           mbedtls_ssl_key_share_take_t *f_take,
+                                           void *p_pool);
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_ECDH_C */
+
 #if defined(MBEDTLS_SSL_HANDSHAKE_WITH_CERT_ENABLED)
 #if !defined(MBEDTLS_DEPRECATED_REMOVED) && defined(MBEDTLS_SSL_PROTO_TLS1_2)
 /**
@@ -4189,6 +4835,31 @@ void mbedtls_ssl_conf_encrypt_then_mac(mbedtls_ssl_config *conf, char etm);
 void mbedtls_ssl_conf_extended_master_secret(mbedtls_ssl_config *conf, char ems);
 #endif /* MBEDTLS_SSL_EXTENDED_MASTER_SECRET */
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+/**
+ * \brief           Enable or disable reading past the current record.
+ *                  (Default: MBEDTLS_SSL_READ_AHEAD_DISABLED)
+ *
+ *                  When enabled, each call to the receive callback asks
+ *                  for as much data as fits in the input buffer, so that
+ *                  several small records or the header of the next record
+ *                  come in a single call. This only applies to TLS.
+ *
+ * \note            The receive callback must return the data available
+ *                  without waiting for the whole requested length, like
+ *                  mbedtls_net_recv() does.
+ *
+ * \note            Records read ahead are held in the SSL context. Before
+ *                  waiting for the underlying transport to become readable,
+ *                  check for them with mbedtls_ssl_check_pending().
+ *
+ * \param conf      SSL configuration
+ * \param read_ahead MBEDTLS_SSL_READ_AHEAD_ENABLED or
+ *                  MBEDTLS_SSL_READ_AHEAD_DISABLED
+ */
+void mbedtls_ssl_conf_read_ahead(mbedtls_ssl_config *conf, char read_ahead);
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
 #if defined(MBEDTLS_SSL_SRV_C)
 /**
  * \brief          Whether to send a list of acceptable CAs in
@@ -4588,6 +5259,97 @@ int mbedtls_ssl_get_max_out_record_payload(const mbedtls_ssl_context *ssl);
  */
 int mbedtls_ssl_get_max_in_record_payload(const mbedtls_ssl_context *ssl);
 
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+/**
+ * \brief          Usage of the DTLS handshake buffering arena of a context.
+ */
+typedef struct mbedtls_ssl_dtls_buffering_stats {
+    size_t capacity;    /*!< size of the arena in Bytes                     */
+    size_t in_use;      /*!< Bytes currently used by buffered messages and
+                             records, 0 outside handshakes                  */
+    size_t peak;        /*!< highest value of \c in_use since the context
+                             was set up or reset                           */
+    size_t failures;    /*!< number of messages or records that could not
+                             be buffered because the arena was full         */
+} mbedtls_ssl_dtls_buffering_stats;
+
+/**
+ * \brief          Report the usage of the arena that serves DTLS handshake
+ *                 message reassembly and future message buffering, see
+ *                 MBEDTLS_SSL_DTLS_BUFFERING_ARENA.
+ *
+ * \note           A high \c failures count means that
+ *                 MBEDTLS_SSL_DTLS_MAX_BUFFERING is too small for the
+ *                 flights received, which causes extra retransmissions.
+ *
+ * \param ssl      The SSL context to query.
+ * \param stats    The structure to fill.
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the context is not
+ *                 set up for DTLS.
+ */
+int mbedtls_ssl_get_dtls_buffering_stats(const mbedtls_ssl_context *ssl,
+                                         mbedtls_ssl_dtls_buffering_stats *stats);
+#endif /* MBEDTLS_SSL_DTLS_BUFFERING_ARENA */
+
+#if defined(MBEDTLS_SSL_KTLS)
+#define MBEDTLS_SSL_KTLS_TX     0   /*!< Records sent by this endpoint     */
+#define MBEDTLS_SSL_KTLS_RX     1   /*!< Records received by this endpoint */
+
+/**
+ * \brief          Record protection state of one direction of a TLS
+ *                 connection, as needed to hand it over to another
+ *                 implementation of the record layer such as Linux kTLS.
+ */
+typedef struct mbedtls_ssl_ktls_info {
+    mbedtls_ssl_protocol_version tls_version; /*!< TLS 1.2 or TLS 1.3         */
+    mbedtls_cipher_type_t cipher;   /*!< AES-128-GCM, AES-256-GCM or
+                                         ChaCha20-Poly1305                   */
+    unsigned char key[32];          /*!< traffic key                         */
+    size_t key_len;                 /*!< length of \c key in Bytes          */
+    unsigned char iv[12];           /*!< implicit part of the nonce: the
+                                         4-Byte salt of TLS 1.2 GCM, the
+                                         full 12-Byte IV otherwise           */
+    size_t iv_len;                  /*!< length of \c iv in Bytes           */
+    unsigned char rec_seq[MBEDTLS_SSL_SEQUENCE_NUMBER_LEN]; /*!< sequence
+                                         number of the next record           */
+} mbedtls_ssl_ktls_info;
+
+/**
+ * \brief          Export the record protection state of an established
+ *                 TLS connection, typically to offload it to the kernel
+ *                 with mbedtls_net_ktls_enable().
+ *
+ *                 Only TLS 1.2 and TLS 1.3 connections using an AES-GCM or
+ *                 ChaCha20-Poly1305 ciphersuite can be exported.
+ *
+ * \note           Once the state has been handed over, the context must not
+ *                 be used for reading or writing anymore, as its sequence
+ *                 numbers are no longer up to date. It can still be freed
+ *                 or queried.
+ *
+ * \warning        \p info holds secret keys. It should be wiped with
+ *                 mbedtls_platform_zeroize() once it has been used.
+ *
+ * \param ssl      The SSL context to use. The handshake must be over.
+ * \param direction #MBEDTLS_SSL_KTLS_TX or #MBEDTLS_SSL_KTLS_RX.
+ * \param info     The structure to fill.
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE if the connection
+ *                 uses DTLS or a ciphersuite that can't be exported.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the handshake is not
+ *                 over, or if the context holds data that would be lost:
+ *                 for #MBEDTLS_SSL_KTLS_TX, output not sent yet; for
+ *                 #MBEDTLS_SSL_KTLS_RX, input received but not read yet,
+ *                 see mbedtls_ssl_check_pending().
+ */
+int mbedtls_ssl_export_ktls_info(const mbedtls_ssl_context *ssl,
+                                 int direction,
+                                 mbedtls_ssl_ktls_info *info);
+#endif /* MBEDTLS_SSL_KTLS */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 /**
  * \brief          Return the peer certificate from the current connection.
@@ -4875,6 +5637,56 @@ int mbedtls_ssl_renegotiate(mbedtls_ssl_context *ssl);
  */
 int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
 
+/**
+ * \brief          Read application data in place, without copying it out of
+ *                 the record buffer
+ *
+ *                 This function behaves like mbedtls_ssl_read(), but instead
+ *                 of copying the data into a buffer provided by the caller,
+ *                 it gives access to the decrypted content of the current
+ *                 record. Call mbedtls_ssl_read_consume() to tell how much
+ *                 of it has been used.
+ *
+ * \param ssl      SSL context
+ * \param buf      On success, set to the start of the available data, or
+ *                 to \c NULL if the read end of the underlying transport was
+ *                 closed.
+ * \param len      On success, set to the number of bytes available at
+ *                 \p buf. This is \c 0 in the cases where mbedtls_ssl_read()
+ *                 would return \c 0.
+ *
+ * \return         \c 0 if successful.
+ * \return         Any of the error codes of mbedtls_ssl_read(), with the
+ *                 same meaning.
+ *
+ * \note           The data at \p buf remains valid until the next call to
+ *                 any function on \p ssl other than mbedtls_ssl_read_consume()
+ *                 or mbedtls_ssl_get_bytes_avail(). Calling this function
+ *                 again before consuming all of it gives access to the same
+ *                 remaining data.
+ */
+int mbedtls_ssl_read_borrow(mbedtls_ssl_context *ssl,
+                            const unsigned char **buf, size_t *len);
+
+/**
+ * \brief          Mark application data obtained from
+ *                 mbedtls_ssl_read_borrow() as consumed
+ *
+ *                 The consumed bytes are wiped from the record buffer.
+ *                 The remaining bytes, if any, are returned by the next
+ *                 call to mbedtls_ssl_read_borrow() or mbedtls_ssl_read().
+ *
+ * \param ssl      SSL context
+ * \param len      The number of bytes consumed, from the start of the data
+ *                 given by the last call to mbedtls_ssl_read_borrow(). This
+ *                 must not be more than the length it returned.
+ *
+ * \return         \c 0 if successful.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p len is larger than
+ *                 the amount of data available.
+ */
+int mbedtls_ssl_read_consume(mbedtls_ssl_context *ssl, size_t len);
+
 /**
  * \brief          Try to write exactly 'len' application data bytes
  *
@@ -4931,12 +5743,66 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len);
  *                 - with DTLS, MBEDTLS_ERR_SSL_BAD_INPUT_DATA is returned.
  *                 \c mbedtls_ssl_get_max_out_record_payload() may be used to
  *                 query the active maximum fragment length.
+ *                 With #MBEDTLS_SSL_RECORD_BATCHING and TLS, up to
+ *                 #MBEDTLS_SSL_WRITE_BATCH_RECORDS records of that length
+ *                 are written and sent together. With
+ *                 #MBEDTLS_SSL_PARALLEL_ENCRYPTION, they can be encrypted
+ *                 concurrently, see mbedtls_ssl_conf_record_workers().
  *
  * \note           Attempting to write 0 bytes will result in an empty TLS
  *                 application record being sent.
  */
 int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t len);
 
+/**
+ * \brief          Get a buffer to write application data in place, in the
+ *                 plaintext area of the next outgoing record
+ *
+ *                 Write up to \p len bytes at \p buf, then call
+ *                 mbedtls_ssl_write_commit() to encrypt and send them. This
+ *                 saves copying the data as mbedtls_ssl_write() does.
+ *
+ *                 Like mbedtls_ssl_write(), this function completes the
+ *                 handshake if needed. It also sends any record that is still
+ *                 pending after a previous call returned
+ *                 #MBEDTLS_ERR_SSL_WANT_WRITE.
+ *
+ * \param ssl      SSL context
+ * \param buf      On success, set to the area to write the data to.
+ * \param len      On success, set to the size of the area at \p buf, which
+ *                 is the value of mbedtls_ssl_get_max_out_record_payload().
+ *
+ * \return         \c 0 if successful.
+ * \return         Any of the error codes of mbedtls_ssl_write(), with the
+ *                 same meaning.
+ *
+ * \warning        No function other than mbedtls_ssl_write_commit() may be
+ *                 called on \p ssl between this call and the commit, since
+ *                 the area is part of the output buffer.
+ */
+int mbedtls_ssl_write_borrow(mbedtls_ssl_context *ssl,
+                             unsigned char **buf, size_t *len);
+
+/**
+ * \brief          Encrypt and send the application data written in the area
+ *                 given by mbedtls_ssl_write_borrow()
+ *
+ * \param ssl      SSL context
+ * \param len      The number of bytes written at the start of the area.
+ *                 This may be \c 0, to send an empty record.
+ *
+ * \return         \p len if successful.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p len is larger than
+ *                 the size of the area.
+ * \return         #MBEDTLS_ERR_SSL_WANT_WRITE if the record could not be
+ *                 sent completely yet. In this case, call this function
+ *                 again with the same \p len, without writing to the area
+ *                 again, when the underlying transport is ready.
+ * \return         Another SSL error code - in this case you must stop using
+ *                 the context, as with mbedtls_ssl_write().
+ */
+int mbedtls_ssl_write_commit(mbedtls_ssl_context *ssl, size_t len);
+
 /**
  * \brief           Send an alert message
  *
@@ -5017,11 +5883,21 @@ int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl);
  *                 that this function starts the handshake for the SSL context
  *                 \p ssl. But this is not mandatory.
  *
+ * \note           The early data received by mbedtls_ssl_handshake() is
+ *                 kept, up to the maximum configured with
+ *                 mbedtls_ssl_tls13_conf_max_early_data_size(). The early
+ *                 data left unread when the handshake completes is returned
+ *                 by the first calls to mbedtls_ssl_read().
+ *
  */
 int mbedtls_ssl_read_early_data(mbedtls_ssl_context *ssl,
                                 unsigned char *buf, size_t len);
 #endif /* MBEDTLS_SSL_SRV_C */
 
+#define MBEDTLS_SSL_EARLY_DATA_STATUS_NOT_SENT  0
+#define MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED  1
+#define MBEDTLS_SSL_EARLY_DATA_STATUS_REJECTED  2
+
 #if defined(MBEDTLS_SSL_CLI_C)
 /**
  * \brief          Try to write exactly 'len' application data bytes while
@@ -5082,9 +5958,6 @@ int mbedtls_ssl_read_early_data(mbedtls_ssl_context *ssl,
 int mbedtls_ssl_write_early_data(mbedtls_ssl_context *ssl,
                                  const unsigned char *buf, size_t len);
 
-#define MBEDTLS_SSL_EARLY_DATA_STATUS_NOT_SENT  0
-#define MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED  1
-#define MBEDTLS_SSL_EARLY_DATA_STATUS_REJECTED  2
 /**
  * \brief Get the status of the negotiation of the use of early data.
  *
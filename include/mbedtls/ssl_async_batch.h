@@ -0,0 +1,213 @@
+/**
+ * \file ssl_async_batch.h
+ *
+ * \brief Batching of the private key operations of many SSL handshakes
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_ASYNC_BATCH_H
+#define MBEDTLS_SSL_ASYNC_BATCH_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ssl.h"
+
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+
+/** A pending operation, owned by the SSL context that started it. */
+typedef struct mbedtls_ssl_async_batch_op mbedtls_ssl_async_batch_op;
+
+/**
+ * \brief   Batch context: the queue of pending operations shared by the
+ *          SSL contexts of the configurations that use the batch.
+ */
+typedef struct mbedtls_ssl_async_batch {
+    mbedtls_ssl_async_batch_op *MBEDTLS_PRIVATE(head); /*!< oldest queued op  */
+    mbedtls_ssl_async_batch_op *MBEDTLS_PRIVATE(tail); /*!< newest queued op  */
+    size_t MBEDTLS_PRIVATE(queued);              /*!< ops in the queue       */
+    size_t MBEDTLS_PRIVATE(completed);           /*!< ops done since poll    */
+    size_t MBEDTLS_PRIVATE(max_ops);             /*!< size of a full batch   */
+    uint32_t MBEDTLS_PRIVATE(max_delay_us);      /*!< maximum queueing time  */
+    uint64_t MBEDTLS_PRIVATE(now_us);            /*!< time of the last poll  */
+    int (*MBEDTLS_PRIVATE(f_rng))(void *, unsigned char *, size_t);
+    void *MBEDTLS_PRIVATE(p_rng);
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex); /*!< protects the queue */
+#endif
+} mbedtls_ssl_async_batch;
+
+/**
+ * \brief          Initialize a batch context
+ *
+ * \param batch    Batch context
+ */
+void mbedtls_ssl_async_batch_init(mbedtls_ssl_async_batch *batch);
+
+/**
+ * \brief          Set up a batch context
+ *
+ *                 A batch runs when \p max_ops operations are queued, from
+ *                 the start callback that queues the last one, or when
+ *                 mbedtls_ssl_async_batch_poll() finds that the oldest
+ *                 operation has waited for \p max_delay_us microseconds.
+ *
+ * \param batch    Batch context
+ * \param max_ops  Number of operations of a full batch, at least 1
+ * \param max_delay_us Maximum time an operation waits for its batch to fill
+ * \param f_rng    RNG function for the ephemeral keys of the signatures
+ *                 and the blinding of all operations. If the batch is used
+ *                 from several threads, this function must be thread-safe.
+ * \param p_rng    RNG parameter
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p max_ops is 0 or
+ *                 \p f_rng is \c NULL.
+ */
+int mbedtls_ssl_async_batch_setup(mbedtls_ssl_async_batch *batch,
+                                  size_t max_ops, uint32_t max_delay_us,
+                                  int (*f_rng)(void *, unsigned char *, size_t),
+                                  void *p_rng);
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_ECDSA_C)
+/**
+ * \brief          Sign callback implementation, see
+ *                 ::mbedtls_ssl_async_sign_t (Thread-safe)
+ *
+ *                 Queues an ECDSA signature with the private key of the
+ *                 handshake, as configured with mbedtls_ssl_conf_own_cert().
+ *                 Declines (#MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) other
+ *                 keys, including opaque keys.
+ *
+ * \note           The configuration data of the async callbacks, see
+ *                 mbedtls_ssl_conf_async_private_cb(), must be the batch
+ *                 context.
+ */
+int mbedtls_ssl_async_batch_sign(mbedtls_ssl_context *ssl,
+                                 mbedtls_x509_crt *cert,
+                                 mbedtls_md_type_t md_alg,
+                                 const unsigned char *hash,
+                                 size_t hash_len);
+#endif /* MBEDTLS_X509_CRT_PARSE_C && MBEDTLS_ECDSA_C */
+
+/**
+ * \brief          Key agreement callback implementation, see
+ *                 ::mbedtls_ssl_async_key_agreement_t (Thread-safe)
+ *
+ *                 Queues an ECDHE shared secret computation. Declines
+ *                 (#MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) groups that are
+ *                 not elliptic curves.
+ *
+ * \note           The configuration data of the async callbacks, see
+ *                 mbedtls_ssl_conf_async_private_cb(), must be the batch
+ *                 context.
+ */
+int mbedtls_ssl_async_batch_key_agreement(mbedtls_ssl_context *ssl,
+                                          uint16_t group,
+                                          const unsigned char *own_key,
+                                          size_t own_key_len,
+                                          const unsigned char *peer_key,
+                                          size_t peer_key_len);
+
+/**
+ * \brief          Resume callback implementation, see
+ *                 ::mbedtls_ssl_async_resume_t (Thread-safe)
+ *
+ *                 Returns #MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS until the batch
+ *                 of the operation has run.
+ */
+int mbedtls_ssl_async_batch_resume(mbedtls_ssl_context *ssl,
+                                   unsigned char *output,
+                                   size_t *output_len,
+                                   size_t output_size);
+
+/**
+ * \brief          Cancel callback implementation, see
+ *                 ::mbedtls_ssl_async_cancel_t (Thread-safe)
+ */
+void mbedtls_ssl_async_batch_cancel(mbedtls_ssl_context *ssl);
+
+/**
+ * \brief          Run the queued operations if the batch is full or if the
+ *                 oldest one has waited long enough (Thread-safe)
+ *
+ *                 Call this function from the event loop of the server, at
+ *                 least every \c max_delay_us microseconds while operations
+ *                 are queued (see mbedtls_ssl_async_batch_queued()). Then
+ *                 call mbedtls_ssl_handshake() again on the connections that
+ *                 returned #MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if this
+ *                 function reports completed operations.
+ *
+ * \param batch    Batch context
+ * \param now_us   Current time in microseconds, from a monotonic clock of
+ *                 the application's choice. Operations queued after this
+ *                 call are considered queued at this time.
+ *
+ * \return         The number of operations completed since the previous
+ *                 call, including those run by the start callbacks when
+ *                 the batch filled up.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR on a locking failure.
+ */
+int mbedtls_ssl_async_batch_poll(mbedtls_ssl_async_batch *batch,
+                                 uint64_t now_us);
+
+/**
+ * \brief          Run all the queued operations now (Thread-safe)
+ *
+ * \param batch    Batch context
+ *
+ * \return         The number of operations completed by this call.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR on a locking failure.
+ */
+int mbedtls_ssl_async_batch_flush(mbedtls_ssl_async_batch *batch);
+
+/**
+ * \brief          Get the number of queued operations (Thread-safe)
+ *
+ * \param batch    Batch context
+ *
+ * \return         The number of operations waiting for their batch.
+ */
+size_t mbedtls_ssl_async_batch_queued(mbedtls_ssl_async_batch *batch);
+
+/**
+ * \brief          Free a batch context
+ *
+ * \note           Free the SSL contexts that use the batch first.
+ *
+ * \param batch    Batch context to free
+ */
+void mbedtls_ssl_async_batch_free(mbedtls_ssl_async_batch *batch);
+
+#endif /* MBEDTLS_SSL_ASYNC_BATCH_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_async_batch.h */
@@ -0,0 +1,166 @@
+/**
+ * \file ssl_buffer_pool.h
+ *
+ * \brief Pool of SSL record buffers shared between connections
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_BUFFER_POOL_H
+#define MBEDTLS_SSL_BUFFER_POOL_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include <stddef.h>
+
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_BUFFER_POOL_CLASSES)
+#define MBEDTLS_SSL_BUFFER_POOL_CLASSES            4   /*!< Number of distinct buffer sizes kept */
+#endif
+
+#if !defined(MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_FREE)
+#define MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_FREE  32   /*!< Maximum free buffers kept per size */
+#endif
+
+/** \} name SECTION: Module settings */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \brief   Free buffers of a given size
+ */
+typedef struct mbedtls_ssl_buffer_pool_class {
+    size_t MBEDTLS_PRIVATE(len);                 /*!< buffer size, 0 if unused */
+    unsigned char *MBEDTLS_PRIVATE(free_list);   /*!< chain of free buffers    */
+    size_t MBEDTLS_PRIVATE(free_count);          /*!< length of the chain      */
+} mbedtls_ssl_buffer_pool_class;
+
+/**
+ * \brief   Statistics about the use of a buffer pool
+ */
+typedef struct mbedtls_ssl_buffer_pool_stats {
+    size_t in_use;          /*!< buffers currently handed out               */
+    size_t in_use_peak;     /*!< highest value reached by \c in_use         */
+    size_t cached;          /*!< free buffers kept for reuse                */
+    size_t cached_bytes;    /*!< total size of the free buffers kept        */
+    size_t acquired;        /*!< successful calls to the acquire function   */
+    size_t reused;          /*!< acquisitions served from a free buffer     */
+    size_t failed;          /*!< acquisitions that ran out of memory        */
+} mbedtls_ssl_buffer_pool_stats;
+
+/**
+ * \brief   Buffer pool context
+ */
+typedef struct mbedtls_ssl_buffer_pool {
+    mbedtls_ssl_buffer_pool_class MBEDTLS_PRIVATE(classes)[MBEDTLS_SSL_BUFFER_POOL_CLASSES];
+    size_t MBEDTLS_PRIVATE(max_free);            /*!< free buffers kept per size */
+    mbedtls_ssl_buffer_pool_stats MBEDTLS_PRIVATE(stats);
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex);    /*!< mutex                  */
+#endif
+} mbedtls_ssl_buffer_pool;
+
+/**
+ * \brief          Initialize a buffer pool
+ *
+ * \param pool     Buffer pool context
+ */
+void mbedtls_ssl_buffer_pool_init(mbedtls_ssl_buffer_pool *pool);
+
+/**
+ * \brief          Set the maximum number of free buffers of each size that
+ *                 the pool keeps for reuse (Default: MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_FREE)
+ *
+ *                 Buffers released beyond this number are freed. Lowering
+ *                 the limit doesn't free buffers that are already cached.
+ *
+ * \param pool     Buffer pool context
+ * \param max_free Maximum number of free buffers per size
+ */
+void mbedtls_ssl_buffer_pool_set_max_free(mbedtls_ssl_buffer_pool *pool,
+                                          size_t max_free);
+
+/**
+ * \brief          Acquire callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ *                 Buffers are kept by exact size, for up to
+ *                 MBEDTLS_SSL_BUFFER_POOL_CLASSES distinct sizes. Buffers
+ *                 of other sizes are allocated directly.
+ *
+ * \param p_pool   The buffer pool context to use.
+ * \param len      The length of the buffer in bytes.
+ *
+ * \return         A buffer of \p len bytes, all set to zero, or \c NULL
+ *                 if memory allocation failed.
+ */
+unsigned char *mbedtls_ssl_buffer_pool_acquire(void *p_pool, size_t len);
+
+/**
+ * \brief          Release callback implementation
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ *                 The buffer is wiped, then either kept for reuse or freed.
+ *
+ * \param p_pool   The buffer pool context to use.
+ * \param buf      A buffer obtained from mbedtls_ssl_buffer_pool_acquire()
+ *                 on the same pool.
+ * \param len      The length of \p buf in bytes.
+ */
+void mbedtls_ssl_buffer_pool_release(void *p_pool, unsigned char *buf,
+                                     size_t len);
+
+/**
+ * \brief          Get statistics about the use of a buffer pool
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param pool     Buffer pool context
+ * \param stats    The structure to fill.
+ *
+ * \return         \c 0 on success, or a mutex error code.
+ */
+int mbedtls_ssl_buffer_pool_get_stats(mbedtls_ssl_buffer_pool *pool,
+                                      mbedtls_ssl_buffer_pool_stats *stats);
+
+/**
+ * \brief          Free the cached buffers of a pool
+ *
+ * \note           All buffers acquired from the pool must have been released
+ *                 before calling this function.
+ *
+ * \param pool     Buffer pool context to free
+ */
+void mbedtls_ssl_buffer_pool_free(mbedtls_ssl_buffer_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_buffer_pool.h */
@@ -47,6 +47,10 @@
 #define MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES      50   /*!< Maximum entries in cache */
 #endif
 
+#if !defined(MBEDTLS_SSL_CACHE_SHARDS)
+#define MBEDTLS_SSL_CACHE_SHARDS                    8   /*!< Independently locked parts */
+#endif
+
 /** \} name SECTION: Module settings */
 
 #ifdef __cplusplus
@@ -55,6 +59,7 @@ extern "C" {
 
 typedef struct mbedtls_ssl_cache_context mbedtls_ssl_cache_context;
 typedef struct mbedtls_ssl_cache_entry mbedtls_ssl_cache_entry;
+typedef struct mbedtls_ssl_cache_shard mbedtls_ssl_cache_shard;
 
 /**
  * \brief   This structure is used for storing cache entries
@@ -70,19 +75,34 @@ struct mbedtls_ssl_cache_entry {
     unsigned char *MBEDTLS_PRIVATE(session);             /*!< serialized session */
     size_t MBEDTLS_PRIVATE(session_len);
 
-    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(next);      /*!< chain pointer      */
+    uint32_t MBEDTLS_PRIVATE(hash);                      /*!< hash of session ID */
+
+    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(next);      /*!< less recently used */
+    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(prev);      /*!< more recently used */
+};
+
+/**
+ * \brief   Part of the cache: an open-addressed hash table of entries,
+ *          also linked from the most to the least recently used
+ */
+struct mbedtls_ssl_cache_shard {
+    mbedtls_ssl_cache_entry **MBEDTLS_PRIVATE(table);    /*!< hash table, linear probing */
+    size_t MBEDTLS_PRIVATE(table_size);          /*!< power of 2, 0 if unused    */
+    size_t MBEDTLS_PRIVATE(count);               /*!< entries in the shard       */
+    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(lru_head);  /*!< most recently used */
+    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(lru_tail);  /*!< least recently used */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex);    /*!< mutex              */
+#endif
 };
 
 /**
  * \brief Cache context
  */
 struct mbedtls_ssl_cache_context {
-    mbedtls_ssl_cache_entry *MBEDTLS_PRIVATE(chain);     /*!< start of the chain     */
+    mbedtls_ssl_cache_shard MBEDTLS_PRIVATE(shards)[MBEDTLS_SSL_CACHE_SHARDS];
     int MBEDTLS_PRIVATE(timeout);                /*!< cache entry timeout    */
     int MBEDTLS_PRIVATE(max_entries);            /*!< maximum entries        */
-#if defined(MBEDTLS_THREADING_C)
-    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex);    /*!< mutex                  */
-#endif
 };
 
 /**
@@ -157,6 +177,15 @@ void mbedtls_ssl_cache_set_timeout(mbedtls_ssl_cache_context *cache, int timeout
  * \brief          Set the maximum number of cache entries
  *                 (Default: MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES (50))
  *
+ *                 When the cache is full, storing a session evicts the
+ *                 least recently used entry of its shard.
+ *
+ * \note           Entries are spread over MBEDTLS_SSL_CACHE_SHARDS shards,
+ *                 or \p max shards if that is smaller, each holding an
+ *                 equal part of \p max entries. Changing the number of
+ *                 shards in use empties the cache, so call this before
+ *                 the cache is used.
+ *
  * \param cache    SSL cache context
  * \param max      cache entry maximum
  */
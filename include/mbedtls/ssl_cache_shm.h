@@ -0,0 +1,198 @@
+/**
+ * \file ssl_cache_shm.h
+ *
+ * \brief SSL session cache in memory shared between processes
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_CACHE_SHM_H
+#define MBEDTLS_SSL_CACHE_SHM_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ssl.h"
+
+#include <stddef.h>
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_CACHE_SHM_DEFAULT_TIMEOUT)
+#define MBEDTLS_SSL_CACHE_SHM_DEFAULT_TIMEOUT   86400   /*!< 1 day  */
+#endif
+
+/** \} name SECTION: Module settings */
+
+/** Number of entries in each set of the cache: a session can only be stored
+ *  in one of the entries of the set its session ID hashes to. */
+#define MBEDTLS_SSL_CACHE_SHM_WAYS      8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+
+/**
+ * \brief   Shared cache context: a mapping of the shared segment in the
+ *          calling process. The segment itself holds the cache contents.
+ */
+typedef struct mbedtls_ssl_cache_shm_context {
+    unsigned char *MBEDTLS_PRIVATE(base);        /*!< start of the mapping   */
+    size_t MBEDTLS_PRIVATE(map_len);             /*!< length of the mapping  */
+    size_t MBEDTLS_PRIVATE(sets);                /*!< number of sets         */
+    size_t MBEDTLS_PRIVATE(slot_size);           /*!< size of each slot      */
+    int MBEDTLS_PRIVATE(timeout);                /*!< cache entry timeout    */
+} mbedtls_ssl_cache_shm_context;
+
+/**
+ * \brief          Initialize a shared cache context
+ *
+ * \param cache    Shared cache context
+ */
+void mbedtls_ssl_cache_shm_init(mbedtls_ssl_cache_shm_context *cache);
+
+/**
+ * \brief          Map the shared memory segment that holds the cache.
+ *
+ *                 With \p path set to \c NULL, the segment is anonymous:
+ *                 call this function before forking, and the child
+ *                 processes share the cache of their parent.
+ *
+ *                 Otherwise the segment is the file at \p path, created if
+ *                 needed, so that unrelated processes can share the cache
+ *                 by mapping the same file with the same \p entries and
+ *                 \p slot_size. The file is not deleted by
+ *                 mbedtls_ssl_cache_shm_free(). A file of the right size
+ *                 that doesn't hold a cache, for example because a process
+ *                 died while creating it, is formatted again.
+ *
+ *                 The segment holds \p entries sessions of up to
+ *                 \p slot_size bytes in serialized form (see
+ *                 mbedtls_ssl_session_save()). Sessions that don't fit are
+ *                 not cached. A session that keeps the peer certificate
+ *                 (#MBEDTLS_SSL_KEEP_PEER_CERTIFICATE) needs about 200 bytes
+ *                 plus the size of the certificate.
+ *
+ * \note           Concurrent access is serialized by a robust process-shared
+ *                 mutex stored in the segment: a process that dies while
+ *                 holding it doesn't block the others, and the entry it was
+ *                 writing is discarded.
+ *
+ * \param cache    Shared cache context
+ * \param path     File backing the segment, or \c NULL
+ * \param entries  Number of sessions, rounded up to a multiple of
+ *                 #MBEDTLS_SSL_CACHE_SHM_WAYS
+ * \param slot_size Maximum size of a serialized session, at least 64 bytes
+ *
+ * \return         0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if a parameter is invalid
+ *                 or if \p path holds a cache with another geometry.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED if the segment cannot be
+ *                 created or mapped.
+ */
+int mbedtls_ssl_cache_shm_setup(mbedtls_ssl_cache_shm_context *cache,
+                                const char *path,
+                                size_t entries, size_t slot_size);
+
+/**
+ * \brief          Cache get callback implementation
+ *                 (Safe across threads and processes)
+ *
+ * \param data            The shared cache context to use.
+ * \param session_id      The pointer to the buffer holding the session ID
+ *                        for the session to load.
+ * \param session_id_len  The length of \p session_id in bytes.
+ * \param session         The address at which to store the session
+ *                        associated with \p session_id, if present.
+ */
+int mbedtls_ssl_cache_shm_get(void *data,
+                              unsigned char const *session_id,
+                              size_t session_id_len,
+                              mbedtls_ssl_session *session);
+
+/**
+ * \brief          Cache set callback implementation
+ *                 (Safe across threads and processes)
+ *
+ *                 When all entries of the set are in use, the least
+ *                 recently used one is overwritten.
+ *
+ * \param data            The shared cache context to use.
+ * \param session_id      The pointer to the buffer holding the session ID
+ *                        associated to \p session.
+ * \param session_id_len  The length of \p session_id in bytes.
+ * \param session         The session to store.
+ */
+int mbedtls_ssl_cache_shm_set(void *data,
+                              unsigned char const *session_id,
+                              size_t session_id_len,
+                              const mbedtls_ssl_session *session);
+
+/**
+ * \brief          Remove the cache entry by the session ID
+ *                 (Safe across threads and processes)
+ *
+ * \param data            The shared cache context to use.
+ * \param session_id      The pointer to the buffer holding the session ID
+ *                        associated to \p session.
+ * \param session_id_len  The length of \p session_id in bytes.
+ *
+ * \return                0: The cache entry for session with provided ID
+ *                           is removed or does not exist.
+ *                        Otherwise: fail.
+ */
+int mbedtls_ssl_cache_shm_remove(void *data,
+                                 unsigned char const *session_id,
+                                 size_t session_id_len);
+
+#if defined(MBEDTLS_HAVE_TIME)
+/**
+ * \brief          Set the cache timeout of this process
+ *                 (Default: MBEDTLS_SSL_CACHE_SHM_DEFAULT_TIMEOUT (1 day))
+ *
+ *                 A timeout of 0 indicates no timeout. Processes sharing
+ *                 a cache should use the same timeout.
+ *
+ * \param cache    Shared cache context
+ * \param timeout  cache entry timeout in seconds
+ */
+void mbedtls_ssl_cache_shm_set_timeout(mbedtls_ssl_cache_shm_context *cache,
+                                       int timeout);
+#endif /* MBEDTLS_HAVE_TIME */
+
+/**
+ * \brief          Unmap the shared segment from this process. The cache
+ *                 contents stay available to the other processes.
+ *
+ * \param cache    Shared cache context
+ */
+void mbedtls_ssl_cache_shm_free(mbedtls_ssl_cache_shm_context *cache);
+
+#endif /* MBEDTLS_SSL_CACHE_SHM_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_cache_shm.h */
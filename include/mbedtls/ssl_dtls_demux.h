@@ -0,0 +1,256 @@
+/**
+ * \file ssl_dtls_demux.h
+ *
+ * \brief DTLS server demultiplexer: many connections on one UDP socket
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_DTLS_DEMUX_H
+#define MBEDTLS_SSL_DTLS_DEMUX_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ssl.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN)
+#define MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN    32  /*!< Maximum length of a peer address */
+#endif
+
+/** \} name SECTION: Module settings */
+
+/** Room for a HelloVerifyRequest record with a cookie of maximum size */
+#define MBEDTLS_SSL_DTLS_DEMUX_HVR_LEN  (28 + 255)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_DTLS_DEMUX_C)
+
+/**
+ * \brief          Callback type: send a datagram to a peer.
+ *
+ *                 mbedtls_net_send_to() is an implementation of this
+ *                 callback for the sockets of the net_sockets module.
+ *
+ * \param ctx      Context for the callback
+ * \param addr     Address of the peer
+ * \param addr_len Length of \p addr in bytes
+ * \param buf      The datagram to send
+ * \param len      Length of the datagram
+ *
+ * \return         The number of bytes sent, or a negative error code
+ *                 (#MBEDTLS_ERR_SSL_WANT_WRITE if the datagram can't be
+ *                 sent right now).
+ */
+typedef int mbedtls_ssl_dtls_demux_send_t(void *ctx,
+                                          const unsigned char *addr,
+                                          size_t addr_len,
+                                          const unsigned char *buf,
+                                          size_t len);
+
+/**
+ * \brief          Callback type: prepare the context of a new connection.
+ *
+ *                 This is called once the peer has proven that it can
+ *                 receive at its address, and before its ClientHello is
+ *                 processed. This is where timer callbacks, which DTLS
+ *                 requires, and user data are set on the context.
+ *
+ * \param ctx      Context for the callback
+ * \param ssl      The SSL context of the new connection, set up with the
+ *                 configuration of the demultiplexer.
+ * \param addr     Address of the peer
+ * \param addr_len Length of \p addr in bytes
+ *
+ * \return         \c 0 to accept the connection, or a negative error code
+ *                 to refuse it. The ClientHello is then dropped.
+ */
+typedef int mbedtls_ssl_dtls_demux_new_conn_t(void *ctx,
+                                              mbedtls_ssl_context *ssl,
+                                              const unsigned char *addr,
+                                              size_t addr_len);
+
+typedef struct mbedtls_ssl_dtls_demux_conn mbedtls_ssl_dtls_demux_conn;
+
+/**
+ * \brief   DTLS demultiplexer context
+ */
+typedef struct mbedtls_ssl_dtls_demux {
+    const mbedtls_ssl_config *MBEDTLS_PRIVATE(conf);  /*!< for new contexts */
+    mbedtls_ssl_dtls_demux_send_t *MBEDTLS_PRIVATE(f_send);
+    void *MBEDTLS_PRIVATE(p_send);
+    mbedtls_ssl_dtls_demux_new_conn_t *MBEDTLS_PRIVATE(f_new_conn);
+    void *MBEDTLS_PRIVATE(p_new_conn);
+
+    mbedtls_ssl_dtls_demux_conn **MBEDTLS_PRIVATE(by_addr);  /*!< buckets */
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    mbedtls_ssl_dtls_demux_conn **MBEDTLS_PRIVATE(by_cid);   /*!< buckets */
+#endif
+    size_t MBEDTLS_PRIVATE(bucket_mask);    /*!< bucket count - 1           */
+    uint32_t MBEDTLS_PRIVATE(seed);         /*!< hash key                   */
+    size_t MBEDTLS_PRIVATE(count);          /*!< connections                */
+    size_t MBEDTLS_PRIVATE(max_conns);      /*!< limit on \c count          */
+
+    /* The datagram being dispatched and its connection */
+    mbedtls_ssl_dtls_demux_conn *MBEDTLS_PRIVATE(current);
+    const unsigned char *MBEDTLS_PRIVATE(datagram);
+    size_t MBEDTLS_PRIVATE(datagram_len);
+
+    /* Stateless ClientHello cookie exchange */
+    mbedtls_ssl_context MBEDTLS_PRIVATE(hello);  /*!< only conf is set     */
+    unsigned char MBEDTLS_PRIVATE(hvr)[MBEDTLS_SSL_DTLS_DEMUX_HVR_LEN];
+} mbedtls_ssl_dtls_demux;
+
+/**
+ * \brief          Initialize a DTLS demultiplexer context
+ *
+ * \param demux    DTLS demultiplexer context
+ */
+void mbedtls_ssl_dtls_demux_init(mbedtls_ssl_dtls_demux *demux);
+
+/**
+ * \brief          Set up a DTLS demultiplexer
+ *
+ *                 All datagrams received on the server socket are passed
+ *                 to mbedtls_ssl_dtls_demux_dispatch(), which routes them
+ *                 to the context of their connection. ClientHello messages
+ *                 from unknown peers are answered with a HelloVerifyRequest
+ *                 without keeping any state; a context is only created
+ *                 once a ClientHello comes back with a valid cookie.
+ *
+ * \note           The cookie callbacks of \p conf, set with
+ *                 mbedtls_ssl_conf_dtls_cookies(), are used for the
+ *                 stateless exchange, then again by the new context when it
+ *                 parses the ClientHello.
+ *
+ * \note           If \p conf uses DTLS 1.2 Connection IDs, that is, if it
+ *                 has a non-zero CID length set with mbedtls_ssl_conf_cid(),
+ *                 each connection is given a random CID and records
+ *                 carrying it are routed to the connection whatever their
+ *                 source address. When such a record from a new address
+ *                 is authenticated and is the newest one seen, replies go
+ *                 to the new address (RFC 9146, Section 6). This needs
+ *                 MBEDTLS_SSL_DTLS_ANTI_REPLAY.
+ *
+ * \param demux    DTLS demultiplexer context, initialized with
+ *                 mbedtls_ssl_dtls_demux_init().
+ * \param conf     Server configuration for the contexts of the
+ *                 connections. It must be for DTLS and have cookie
+ *                 callbacks and an RNG, and must remain valid until
+ *                 mbedtls_ssl_dtls_demux_free() is called.
+ * \param max_conns Maximum number of connections at a time.
+ * \param f_send   Callback sending a datagram to a peer.
+ * \param p_send   Context for \p f_send, typically the server socket.
+ * \param f_new_conn Optional callback preparing new contexts, or \c NULL.
+ * \param p_new_conn Context for \p f_new_conn.
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p conf can't be used.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED if the lookup tables
+ *                 can't be allocated.
+ */
+int mbedtls_ssl_dtls_demux_setup(mbedtls_ssl_dtls_demux *demux,
+                                 const mbedtls_ssl_config *conf,
+                                 size_t max_conns,
+                                 mbedtls_ssl_dtls_demux_send_t *f_send,
+                                 void *p_send,
+                                 mbedtls_ssl_dtls_demux_new_conn_t *f_new_conn,
+                                 void *p_new_conn);
+
+/**
+ * \brief          Route a datagram received on the server socket
+ *
+ *                 The datagram is matched with a connection by the
+ *                 address of its sender, or by its Connection ID. If no
+ *                 connection matches, the datagram is handled statelessly:
+ *                 a ClientHello without a valid cookie is answered with a
+ *                 HelloVerifyRequest, a ClientHello with a valid cookie
+ *                 creates a new connection, and anything else is dropped.
+ *
+ * \note           The datagram is not copied. It is returned by the
+ *                 receive callback of the connection until the next call
+ *                 to this function, so the caller should process it right
+ *                 away by calling mbedtls_ssl_handshake() or
+ *                 mbedtls_ssl_read() on \p *ssl.
+ *
+ * \param demux    DTLS demultiplexer context
+ * \param addr     Address of the sender
+ * \param addr_len Length of \p addr, at most
+ *                 #MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN bytes.
+ *                 Addresses are compared byte by byte.
+ * \param buf      The datagram
+ * \param len      Length of the datagram
+ * \param ssl      Receives the context of the connection the datagram was
+ *                 routed to, or \c NULL if it was handled statelessly.
+ *
+ * \return         \c 0 on success, including when the datagram is dropped.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if an argument is invalid.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED or another error code if
+ *                 a new connection couldn't be created.
+ */
+int mbedtls_ssl_dtls_demux_dispatch(mbedtls_ssl_dtls_demux *demux,
+                                    const unsigned char *addr,
+                                    size_t addr_len,
+                                    const unsigned char *buf, size_t len,
+                                    mbedtls_ssl_context **ssl);
+
+/**
+ * \brief          Remove a connection and free its context
+ *
+ * \param demux    DTLS demultiplexer context
+ * \param ssl      A context returned by mbedtls_ssl_dtls_demux_dispatch().
+ *                 It must not be used afterwards.
+ */
+void mbedtls_ssl_dtls_demux_close(mbedtls_ssl_dtls_demux *demux,
+                                  mbedtls_ssl_context *ssl);
+
+/**
+ * \brief          Get the number of connections of a demultiplexer
+ *
+ * \param demux    DTLS demultiplexer context
+ *
+ * \return         The number of connections.
+ */
+size_t mbedtls_ssl_dtls_demux_count(const mbedtls_ssl_dtls_demux *demux);
+
+/**
+ * \brief          Free a DTLS demultiplexer and all its connections
+ *
+ * \param demux    DTLS demultiplexer context to free
+ */
+void mbedtls_ssl_dtls_demux_free(mbedtls_ssl_dtls_demux *demux);
+
+#endif /* MBEDTLS_SSL_DTLS_DEMUX_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_dtls_demux.h */
@@ -0,0 +1,164 @@
+/**
+ * \file ssl_early_data_replay.h
+ *
+ * \brief Anti-replay filter for the early data accepted by TLS 1.3 servers
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_EARLY_DATA_REPLAY_H
+#define MBEDTLS_SSL_EARLY_DATA_REPLAY_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ssl.h"
+
+#if defined(MBEDTLS_HAVE_TIME)
+#include "mbedtls/platform_time.h"
+#endif
+
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+
+#include <stddef.h>
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS)
+#define MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS       16   /*!< Independently locked parts */
+#endif
+
+/** \} name SECTION: Module settings */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+
+/**
+ * \brief   Part of the filter: two generations of a Bloom filter, each
+ *          covering a window of time
+ */
+typedef struct mbedtls_ssl_early_data_replay_shard {
+    unsigned char *MBEDTLS_PRIVATE(current);     /*!< filter of the window   */
+    unsigned char *MBEDTLS_PRIVATE(previous);    /*!< filter of the one before */
+    mbedtls_time_t MBEDTLS_PRIVATE(start);       /*!< start of the window    */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex);    /*!< mutex              */
+#endif
+} mbedtls_ssl_early_data_replay_shard;
+
+/**
+ * \brief   Anti-replay context
+ */
+typedef struct mbedtls_ssl_early_data_replay_context {
+    mbedtls_ssl_early_data_replay_shard
+        MBEDTLS_PRIVATE(shards)[MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS];
+    size_t MBEDTLS_PRIVATE(filter_bits);         /*!< bits per filter, power of 2 */
+    uint32_t MBEDTLS_PRIVATE(window);            /*!< generation length in seconds */
+} mbedtls_ssl_early_data_replay_context;
+
+/**
+ * \brief          Initialize an anti-replay context
+ *
+ * \param ctx      Anti-replay context
+ */
+void mbedtls_ssl_early_data_replay_init(mbedtls_ssl_early_data_replay_context *ctx);
+
+/**
+ * \brief          Set up an anti-replay context
+ *
+ *                 The filter remembers the ClientHello messages that came
+ *                 with accepted early data for at least \p window seconds,
+ *                 and for at most twice as long. Servers that use it should
+ *                 keep #MBEDTLS_SSL_TLS1_3_TICKET_AGE_TOLERANCE, the age
+ *                 beyond which a ticket is not accepted, within \p window.
+ *
+ *                 Memory use is about 2 bytes per expected entry and
+ *                 generation. A ClientHello is reported as a possible
+ *                 replay by mistake with a probability of about 0.5% when
+ *                 \p expected_entries are received during a window. This
+ *                 only costs the early data of that connection.
+ *
+ * \param ctx      Anti-replay context
+ * \param window   Length of a generation of the filter, in seconds
+ * \param expected_entries Number of early data offers accepted per window
+ *
+ * \return         0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p window or
+ *                 \p expected_entries is 0, or if \p window is shorter than
+ *                 #MBEDTLS_SSL_TLS1_3_TICKET_AGE_TOLERANCE.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED on allocation failure.
+ */
+int mbedtls_ssl_early_data_replay_setup(mbedtls_ssl_early_data_replay_context *ctx,
+                                        uint32_t window,
+                                        size_t expected_entries);
+
+/**
+ * \brief          Anti-replay callback implementation, see
+ *                 ::mbedtls_ssl_early_data_replay_t (Thread-safe)
+ *
+ * \param p_ctx    The anti-replay context
+ * \param id       Identifier of the ClientHello
+ * \param id_len   Length of \p id, at least 16 bytes
+ *
+ * \return         0 if \p id was not seen in the last window, and records
+ *                 it.
+ * \return         -1 if it may have been seen, or on error.
+ */
+int mbedtls_ssl_early_data_replay_check(void *p_ctx,
+                                        const unsigned char *id,
+                                        size_t id_len);
+
+/**
+ * \brief          Same as mbedtls_ssl_early_data_replay_check(), at a given
+ *                 time rather than mbedtls_time() (Thread-safe)
+ *
+ * \param ctx      The anti-replay context
+ * \param id       Identifier of the ClientHello
+ * \param id_len   Length of \p id, at least 16 bytes
+ * \param now      Current time in seconds
+ *
+ * \return         See mbedtls_ssl_early_data_replay_check().
+ */
+int mbedtls_ssl_early_data_replay_check_at(mbedtls_ssl_early_data_replay_context *ctx,
+                                           const unsigned char *id,
+                                           size_t id_len,
+                                           mbedtls_time_t now);
+
+/**
+ * \brief          Free an anti-replay context
+ *
+ * \param ctx      Anti-replay context to free
+ */
+void mbedtls_ssl_early_data_replay_free(mbedtls_ssl_early_data_replay_context *ctx);
+
+#endif /* MBEDTLS_SSL_EARLY_DATA_REPLAY_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_early_data_replay.h */
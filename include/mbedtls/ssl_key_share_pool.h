@@ -0,0 +1,221 @@
+/**
+ * \file ssl_key_share_pool.h
+ *
+ * \brief Pool of precomputed ephemeral key shares for TLS 1.3 handshakes
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_KEY_SHARE_POOL_H
+#define MBEDTLS_SSL_KEY_SHARE_POOL_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ecp.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(MBEDTLS_THREADING_PTHREAD)
+#include <pthread.h>
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS)
+#define MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS    4   /*!< Maximum number of groups of a pool */
+#endif
+
+/** \} name SECTION: Module settings */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_KEY_SHARE_POOL_C)
+
+/**
+ * \brief   Precomputed key pair
+ */
+typedef struct mbedtls_ssl_key_share_pool_entry {
+    unsigned char MBEDTLS_PRIVATE(priv)[MBEDTLS_ECP_MAX_BYTES];  /*!< private key */
+    unsigned char MBEDTLS_PRIVATE(pub)[MBEDTLS_ECP_MAX_PT_LEN];  /*!< public key  */
+    size_t MBEDTLS_PRIVATE(priv_len);            /*!< length of the private key */
+    size_t MBEDTLS_PRIVATE(pub_len);             /*!< length of the public key  */
+} mbedtls_ssl_key_share_pool_entry;
+
+/**
+ * \brief   Key pairs of one group
+ */
+typedef struct mbedtls_ssl_key_share_pool_group {
+    uint16_t MBEDTLS_PRIVATE(tls_id);            /*!< IANA NamedGroup        */
+    mbedtls_ecp_group_id MBEDTLS_PRIVATE(grp_id); /*!< curve of the group    */
+    mbedtls_ssl_key_share_pool_entry *MBEDTLS_PRIVATE(entries); /*!< key pairs */
+    size_t MBEDTLS_PRIVATE(count);               /*!< key pairs available    */
+} mbedtls_ssl_key_share_pool_group;
+
+/**
+ * \brief   Key share pool context
+ */
+typedef struct mbedtls_ssl_key_share_pool {
+    pthread_mutex_t MBEDTLS_PRIVATE(mutex);      /*!< protects the fields below  */
+    pthread_cond_t MBEDTLS_PRIVATE(taken);       /*!< key pair taken or shutdown */
+    pthread_t MBEDTLS_PRIVATE(thread);           /*!< refill thread              */
+    mbedtls_ssl_key_share_pool_group
+        MBEDTLS_PRIVATE(groups)[MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS];
+    size_t MBEDTLS_PRIVATE(group_count);         /*!< groups in use              */
+    size_t MBEDTLS_PRIVATE(size);                /*!< key pairs kept per group   */
+    int(*MBEDTLS_PRIVATE(f_rng))(void *, unsigned char *, size_t); /*!< RNG     */
+    void *MBEDTLS_PRIVATE(p_rng);                /*!< context for the RNG        */
+    int MBEDTLS_PRIVATE(shutdown);               /*!< the thread must exit       */
+    int MBEDTLS_PRIVATE(has_thread);             /*!< the thread was started     */
+    int MBEDTLS_PRIVATE(is_valid);               /*!< set up successfully        */
+} mbedtls_ssl_key_share_pool;
+
+/**
+ * \brief          Initialize a key share pool
+ *
+ * \param pool     Key share pool context
+ */
+void mbedtls_ssl_key_share_pool_init(mbedtls_ssl_key_share_pool *pool);
+
+/**
+ * \brief          Set up a key share pool and start its refill thread
+ *
+ *                 The refill thread generates key pairs with the ECP
+ *                 module whenever a group has fewer than \p size of them,
+ *                 and sleeps otherwise. If generating a key pair fails, it
+ *                 retries after a delay that doubles on each failure, up to
+ *                 10 seconds. Each key pair is handed out once by
+ *                 mbedtls_ssl_key_share_pool_take(), and wiped from the
+ *                 pool at that time.
+ *
+ * \note           The pool starts empty: handshakes generate their key
+ *                 shares until the refill thread has caught up. Call
+ *                 mbedtls_ssl_key_share_pool_refill() to fill it first.
+ *
+ * \note           Private keys wait in memory until they are used or the
+ *                 pool is freed. Keep \p size small enough that they are
+ *                 used soon.
+ *
+ * \param pool     Key share pool context, initialized with
+ *                 mbedtls_ssl_key_share_pool_init().
+ * \param groups   The IANA NamedGroups to keep key pairs of, terminated by
+ *                 0, for example #MBEDTLS_SSL_IANA_TLS_GROUP_X25519 and
+ *                 #MBEDTLS_SSL_IANA_TLS_GROUP_SECP256R1. At most
+ *                 #MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS, all supported by
+ *                 the ECP module. Finite field groups are not supported.
+ * \param size     Number of key pairs to keep per group.
+ * \param f_rng    RNG function. It is called from the refill thread, so it
+ *                 must be thread-safe, like mbedtls_ctr_drbg_random() with
+ *                 #MBEDTLS_THREADING_C.
+ * \param p_rng    RNG parameter.
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p size is 0, a group
+ *                 is not supported, there are too many groups, or the pool
+ *                 is already set up.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED on allocation failure.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR if the thread or a
+ *                 synchronization object couldn't be created.
+ */
+int mbedtls_ssl_key_share_pool_setup(mbedtls_ssl_key_share_pool *pool,
+                                     const uint16_t *groups,
+                                     size_t size,
+                                     int (*f_rng)(void *, unsigned char *, size_t),
+                                     void *p_rng);
+
+/**
+ * \brief          Fill the pool from the calling thread (Thread-safe)
+ *
+ * \param pool     Key share pool context
+ *
+ * \return         \c 0 once every group has \c size key pairs.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the pool isn't set up.
+ * \return         An \c MBEDTLS_ERR_ECP_XXX error code if a key pair
+ *                 couldn't be generated.
+ */
+int mbedtls_ssl_key_share_pool_refill(mbedtls_ssl_key_share_pool *pool);
+
+/**
+ * \brief          Key share callback implementation, see
+ *                 ::mbedtls_ssl_key_share_take_t (Thread-safe)
+ *
+ *                 Hands out a key pair of \p group, removes it from the
+ *                 pool and wakes the refill thread up. If \p group has no
+ *                 key pair left, this wakes the refill thread up too, so
+ *                 that it retries a failed generation at once.
+ *
+ * \param p_pool   The key share pool context
+ * \param group    The IANA NamedGroup of the key share
+ * \param priv     Buffer for the private key
+ * \param priv_size Size of \p priv in bytes
+ * \param priv_len On success, the length of the private key
+ * \param pub      Buffer for the public key
+ * \param pub_size Size of \p pub in bytes
+ * \param pub_len  On success, the length of the public key
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE if no key pair of
+ *                 \p group is available.
+ * \return         #MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL if a buffer is too
+ *                 small. The key pair stays in the pool.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if the pool isn't set up.
+ */
+int mbedtls_ssl_key_share_pool_take(void *p_pool,
+                                    uint16_t group,
+                                    unsigned char *priv,
+                                    size_t priv_size,
+                                    size_t *priv_len,
+                                    unsigned char *pub,
+                                    size_t pub_size,
+                                    size_t *pub_len);
+
+/**
+ * \brief          Get the number of key pairs of a group that are ready
+ *                 (Thread-safe)
+ *
+ * \param pool     Key share pool context
+ * \param group    The IANA NamedGroup
+ *
+ * \return         The number of key pairs of \p group in the pool, 0 if
+ *                 the group isn't kept.
+ */
+size_t mbedtls_ssl_key_share_pool_available(mbedtls_ssl_key_share_pool *pool,
+                                            uint16_t group);
+
+/**
+ * \brief          Stop the refill thread, wipe the key pairs and free the
+ *                 pool
+ *
+ * \param pool     Key share pool context to free
+ */
+void mbedtls_ssl_key_share_pool_free(mbedtls_ssl_key_share_pool *pool);
+
+#endif /* MBEDTLS_SSL_KEY_SHARE_POOL_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_key_share_pool.h */
@@ -29,6 +29,12 @@
  * This implementation of the session ticket callbacks includes key
  * management, rotating the keys periodically in order to preserve forward
  * secrecy, when MBEDTLS_HAVE_TIME is defined.
+ *
+ * Keys are reference counted and never modified once in use: rotating the
+ * keys publishes a new one, and a retired key is freed when the last ticket
+ * operation using it completes. The context's lock is only held to pick up
+ * or drop a reference and to call the RNG, so that tickets are encrypted
+ * and decrypted in parallel.
  */
 
 #include "mbedtls/ssl.h"
@@ -55,6 +61,9 @@ extern "C" {
 
 /**
  * \brief   Information for session ticket protection
+ *
+ *          Apart from its reference count, a key is not modified once
+ *          published in a ticket context.
  */
 typedef struct mbedtls_ssl_ticket_key {
     unsigned char MBEDTLS_PRIVATE(name)[MBEDTLS_SSL_TICKET_KEY_NAME_BYTES];
@@ -63,13 +72,14 @@ typedef struct mbedtls_ssl_ticket_key {
     mbedtls_time_t MBEDTLS_PRIVATE(generation_time); /*!< key generation timestamp (seconds) */
 #endif
 #if !defined(MBEDTLS_USE_PSA_CRYPTO)
-    mbedtls_cipher_context_t MBEDTLS_PRIVATE(ctx);   /*!< context for auth enc/decryption    */
+    unsigned char MBEDTLS_PRIVATE(raw)[MBEDTLS_SSL_TICKET_MAX_KEY_BYTES];
+    /*!< key material                       */
+    struct mbedtls_ssl_ticket_cipher *MBEDTLS_PRIVATE(spare);
+    /*!< idle contexts for auth enc/decryption with this key */
 #else
     mbedtls_svc_key_id_t MBEDTLS_PRIVATE(key);       /*!< key used for auth enc/decryption   */
-    psa_algorithm_t MBEDTLS_PRIVATE(alg);            /*!< algorithm of auth enc/decryption   */
-    psa_key_type_t MBEDTLS_PRIVATE(key_type);        /*!< key type                           */
-    size_t MBEDTLS_PRIVATE(key_bits);                /*!< key length in bits                 */
 #endif
+    size_t MBEDTLS_PRIVATE(refs);                    /*!< references to the key              */
 }
 mbedtls_ssl_ticket_key;
 
@@ -77,11 +87,20 @@ mbedtls_ssl_ticket_key;
  * \brief   Context for session ticket handling functions
  */
 typedef struct mbedtls_ssl_ticket_context {
-    mbedtls_ssl_ticket_key MBEDTLS_PRIVATE(keys)[2]; /*!< ticket protection keys             */
+    mbedtls_ssl_ticket_key *MBEDTLS_PRIVATE(keys)[2]; /*!< ticket protection keys            */
     unsigned char MBEDTLS_PRIVATE(active);           /*!< index of the currently active key  */
+    unsigned char MBEDTLS_PRIVATE(rotating);         /*!< a new key is being generated       */
 
     uint32_t MBEDTLS_PRIVATE(ticket_lifetime);       /*!< lifetime of tickets in seconds     */
 
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    const mbedtls_cipher_info_t *MBEDTLS_PRIVATE(cipher_info); /*!< cipher of the keys   */
+#else
+    psa_algorithm_t MBEDTLS_PRIVATE(alg);            /*!< algorithm of auth enc/decryption   */
+    psa_key_type_t MBEDTLS_PRIVATE(key_type);        /*!< key type                           */
+    size_t MBEDTLS_PRIVATE(key_bits);                /*!< key length in bits                 */
+#endif
+
     /** Callback for getting (pseudo-)random numbers                        */
     int(*MBEDTLS_PRIVATE(f_rng))(void *, unsigned char *, size_t);
     void *MBEDTLS_PRIVATE(p_rng);                    /*!< context for the RNG function       */
@@ -157,6 +176,10 @@ int mbedtls_ssl_ticket_setup(mbedtls_ssl_ticket_context *ctx,
  *                  It is recommended to pick a reasonable lifetime so as not
  *                  to negate the benefits of forward secrecy.
  *
+ * \note            This function may be called while other threads write
+ *                  and parse tickets with \p ctx: operations in progress
+ *                  complete with the keys they started with.
+ *
  * \return          0 if successful,
  *                  or a specific MBEDTLS_ERR_XXX error code
  */
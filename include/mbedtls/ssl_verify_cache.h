@@ -0,0 +1,191 @@
+/**
+ * \file ssl_verify_cache.h
+ *
+ * \brief Cache of verified peer certificate chains
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_VERIFY_CACHE_H
+#define MBEDTLS_SSL_VERIFY_CACHE_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ssl.h"
+
+#if defined(MBEDTLS_THREADING_C)
+#include "mbedtls/threading.h"
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_TIMEOUT)
+#define MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_TIMEOUT     3600   /*!< 1 hour */
+#endif
+
+#if !defined(MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_MAX_ENTRIES)
+#define MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_MAX_ENTRIES  256   /*!< Maximum entries in cache */
+#endif
+
+/** \} name SECTION: Module settings */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_VERIFY_CACHE_C)
+
+typedef struct mbedtls_ssl_verify_cache_context mbedtls_ssl_verify_cache_context;
+typedef struct mbedtls_ssl_verify_cache_entry mbedtls_ssl_verify_cache_entry;
+
+/**
+ * \brief   A verified chain, known by its key
+ */
+struct mbedtls_ssl_verify_cache_entry {
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t MBEDTLS_PRIVATE(timestamp);           /*!< time of verification */
+#endif
+
+    unsigned char MBEDTLS_PRIVATE(key)[MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN]; /*!< chain digest */
+    mbedtls_x509_time MBEDTLS_PRIVATE(valid_from);       /*!< start of validity of the path */
+    mbedtls_x509_time MBEDTLS_PRIVATE(valid_to);         /*!< end of validity of the path   */
+
+    mbedtls_ssl_verify_cache_entry *MBEDTLS_PRIVATE(chain); /*!< next in the bucket */
+    mbedtls_ssl_verify_cache_entry *MBEDTLS_PRIVATE(next);  /*!< less recently used */
+    mbedtls_ssl_verify_cache_entry *MBEDTLS_PRIVATE(prev);  /*!< more recently used */
+};
+
+/**
+ * \brief   Verified chain cache context: a hash table of entries, also
+ *          linked from the most to the least recently used
+ */
+struct mbedtls_ssl_verify_cache_context {
+    mbedtls_ssl_verify_cache_entry **MBEDTLS_PRIVATE(buckets); /*!< hash table   */
+    size_t MBEDTLS_PRIVATE(bucket_count);        /*!< power of 2, 0 if unused    */
+    size_t MBEDTLS_PRIVATE(count);               /*!< entries in the cache       */
+    mbedtls_ssl_verify_cache_entry *MBEDTLS_PRIVATE(lru_head); /*!< most recently used  */
+    mbedtls_ssl_verify_cache_entry *MBEDTLS_PRIVATE(lru_tail); /*!< least recently used */
+    int MBEDTLS_PRIVATE(timeout);                /*!< cache entry timeout        */
+    int MBEDTLS_PRIVATE(max_entries);            /*!< maximum entries            */
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_threading_mutex_t MBEDTLS_PRIVATE(mutex); /*!< mutex                 */
+#endif
+};
+
+/**
+ * \brief          Initialize a verified chain cache context
+ *
+ * \param cache    Verified chain cache context
+ */
+void mbedtls_ssl_verify_cache_init(mbedtls_ssl_verify_cache_context *cache);
+
+/**
+ * \brief          Verified chain cache get callback implementation, see
+ *                 ::mbedtls_ssl_verify_cache_get_t
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ * \param data     The verified chain cache context to use.
+ * \param key      The key of the chain.
+ * \param key_len  The length of \p key in bytes.
+ * \param valid_from On a hit, the start of validity of the verified path.
+ * \param valid_to On a hit, the end of validity of the verified path.
+ *
+ * \return         \c 0 if the key is in the cache and hasn't expired.
+ * \return         \c 1 if it isn't.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR on a mutex error.
+ */
+int mbedtls_ssl_verify_cache_get(void *data,
+                                 unsigned char const *key,
+                                 size_t key_len,
+                                 mbedtls_x509_time *valid_from,
+                                 mbedtls_x509_time *valid_to);
+
+/**
+ * \brief          Verified chain cache set callback implementation, see
+ *                 ::mbedtls_ssl_verify_cache_set_t
+ *                 (Thread-safe if MBEDTLS_THREADING_C is enabled)
+ *
+ *                 When the cache is full, this evicts the least recently
+ *                 used entry.
+ *
+ * \param data     The verified chain cache context to use.
+ * \param key      The key of the chain.
+ * \param key_len  The length of \p key in bytes.
+ * \param valid_from The start of validity of the verified path.
+ * \param valid_to The end of validity of the verified path.
+ *
+ * \return         \c 0 on success.
+ * \return         \c 1 if \p key_len is not #MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN
+ *                 or the cache holds no entries.
+ * \return         #MBEDTLS_ERR_SSL_ALLOC_FAILED on allocation failure.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR on a mutex error.
+ */
+int mbedtls_ssl_verify_cache_set(void *data,
+                                 unsigned char const *key,
+                                 size_t key_len,
+                                 const mbedtls_x509_time *valid_from,
+                                 const mbedtls_x509_time *valid_to);
+
+#if defined(MBEDTLS_HAVE_TIME)
+/**
+ * \brief          Set the cache timeout
+ *                 (Default: MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_TIMEOUT (1 hour))
+ *
+ *                 A timeout of 0 indicates no timeout.
+ *
+ * \note           The timeout counts from the verification, not from the
+ *                 last use of an entry. It bounds how long a chain is
+ *                 trusted without checking its signatures again.
+ *
+ * \param cache    Verified chain cache context
+ * \param timeout  cache entry timeout in seconds
+ */
+void mbedtls_ssl_verify_cache_set_timeout(mbedtls_ssl_verify_cache_context *cache,
+                                          int timeout);
+#endif /* MBEDTLS_HAVE_TIME */
+
+/**
+ * \brief          Set the maximum number of cache entries
+ *                 (Default: MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_MAX_ENTRIES (256))
+ *
+ * \param cache    Verified chain cache context
+ * \param max      cache entry maximum
+ */
+void mbedtls_ssl_verify_cache_set_max_entries(mbedtls_ssl_verify_cache_context *cache,
+                                              int max);
+
+/**
+ * \brief          Free referenced items in a verified chain cache context
+ *                 and clear memory
+ *
+ * \param cache    Verified chain cache context
+ */
+void mbedtls_ssl_verify_cache_free(mbedtls_ssl_verify_cache_context *cache);
+
+#endif /* MBEDTLS_SSL_VERIFY_CACHE_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_verify_cache.h */
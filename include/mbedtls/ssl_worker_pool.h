@@ -0,0 +1,137 @@
+/**
+ * \file ssl_worker_pool.h
+ *
+ * \brief Pool of worker threads running batches of SSL jobs
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+#ifndef MBEDTLS_SSL_WORKER_POOL_H
+#define MBEDTLS_SSL_WORKER_POOL_H
+#include "mbedtls/private_access.h"
+
+#include "mbedtls/build_info.h"
+
+#include <stddef.h>
+
+#if defined(MBEDTLS_THREADING_PTHREAD)
+#include <pthread.h>
+#endif
+
+/**
+ * \name SECTION: Module settings
+ *
+ * The configuration options you can set for this module are in this section.
+ * Either change them in mbedtls_config.h or define them on the compiler command line.
+ * \{
+ */
+
+#if !defined(MBEDTLS_SSL_WORKER_POOL_MAX_THREADS)
+#define MBEDTLS_SSL_WORKER_POOL_MAX_THREADS    8   /*!< Maximum number of threads of a pool */
+#endif
+
+/** \} name SECTION: Module settings */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_SSL_WORKER_POOL_C)
+
+/**
+ * \brief   Worker pool context
+ */
+typedef struct mbedtls_ssl_worker_pool {
+    pthread_mutex_t MBEDTLS_PRIVATE(mutex);      /*!< protects the fields below  */
+    pthread_cond_t MBEDTLS_PRIVATE(work);        /*!< jobs posted or shutdown    */
+    pthread_cond_t MBEDTLS_PRIVATE(done);        /*!< last job of a batch done   */
+    pthread_t MBEDTLS_PRIVATE(threads)[MBEDTLS_SSL_WORKER_POOL_MAX_THREADS];
+    size_t MBEDTLS_PRIVATE(thread_count);        /*!< threads started            */
+    void (*MBEDTLS_PRIVATE(f_job))(void *, size_t); /*!< current batch, or NULL  */
+    void *MBEDTLS_PRIVATE(p_job);                /*!< context of the batch       */
+    size_t MBEDTLS_PRIVATE(count);               /*!< jobs in the batch          */
+    size_t MBEDTLS_PRIVATE(next);                /*!< next job to start          */
+    size_t MBEDTLS_PRIVATE(pending);             /*!< jobs not finished yet      */
+    int MBEDTLS_PRIVATE(shutdown);               /*!< threads must exit          */
+    int MBEDTLS_PRIVATE(is_valid);               /*!< set up successfully        */
+} mbedtls_ssl_worker_pool;
+
+/**
+ * \brief          Initialize a worker pool
+ *
+ * \param pool     Worker pool context
+ */
+void mbedtls_ssl_worker_pool_init(mbedtls_ssl_worker_pool *pool);
+
+/**
+ * \brief          Start the threads of a worker pool
+ *
+ * \param pool     Worker pool context, initialized with
+ *                 mbedtls_ssl_worker_pool_init().
+ * \param threads  Number of threads to start, at most
+ *                 #MBEDTLS_SSL_WORKER_POOL_MAX_THREADS. The thread calling
+ *                 mbedtls_ssl_worker_pool_run() also runs jobs, so a
+ *                 batch can use up to \p threads + 1 cores.
+ *
+ * \return         \c 0 on success.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA if \p threads is too large
+ *                 or the pool is already set up.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR if a thread or a
+ *                 synchronization object couldn't be created.
+ */
+int mbedtls_ssl_worker_pool_setup(mbedtls_ssl_worker_pool *pool,
+                                  size_t threads);
+
+/**
+ * \brief          Job runner callback implementation, see
+ *                 ::mbedtls_ssl_run_jobs_t (Thread-safe)
+ *
+ *                 The jobs are shared between the threads of the pool and
+ *                 the calling thread. If the pool is busy with the batch of
+ *                 another caller, all jobs run in the calling thread.
+ *
+ * \param p_pool   The worker pool context to use.
+ * \param f_job    The job function.
+ * \param p_job    The context to pass to \p f_job.
+ * \param count    The number of jobs in the batch.
+ *
+ * \return         \c 0 once all jobs have run.
+ * \return         #MBEDTLS_ERR_SSL_BAD_INPUT_DATA, without running any job,
+ *                 if the pool isn't set up.
+ * \return         #MBEDTLS_ERR_THREADING_MUTEX_ERROR, without running any
+ *                 job, if the pool mutex couldn't be locked.
+ */
+int mbedtls_ssl_worker_pool_run(void *p_pool,
+                                void (*f_job)(void *p_job, size_t index),
+                                void *p_job, size_t count);
+
+/**
+ * \brief          Stop the threads of a worker pool and free it
+ *
+ * \note           No call to mbedtls_ssl_worker_pool_run() may be in
+ *                 progress.
+ *
+ * \param pool     Worker pool context to free
+ */
+void mbedtls_ssl_worker_pool_free(mbedtls_ssl_worker_pool *pool);
+
+#endif /* MBEDTLS_SSL_WORKER_POOL_C */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ssl_worker_pool.h */
@@ -256,6 +256,46 @@ typedef struct mbedtls_psa_stats_s {
  */
 void mbedtls_psa_get_stats(mbedtls_psa_stats_t *stats);
 
+#if defined(MBEDTLS_PSA_ITS_JOURNAL_C)
+/** \brief Force pending PSA ITS journal records out to storage.
+ *
+ * The journal is synced automatically every
+ * \c MBEDTLS_PSA_ITS_JOURNAL_SYNC_INTERVAL records. Call this function
+ * after a batch of key creations or destructions that must survive a power
+ * failure.
+ *
+ * This is an Mbed TLS extension, available when #MBEDTLS_PSA_ITS_JOURNAL_C
+ * is enabled.
+ *
+ * \retval #PSA_SUCCESS
+ *         All the records appended so far are on the storage medium.
+ * \retval #PSA_ERROR_STORAGE_FAILURE \emptydescription
+ */
+psa_status_t mbedtls_psa_its_journal_sync(void);
+
+/** \brief Sync and close the PSA ITS journal and wipe its RAM cache.
+ *
+ * mbedtls_psa_crypto_free() calls this function. The next PSA ITS access
+ * loads the journal again.
+ *
+ * This is an Mbed TLS extension, available when #MBEDTLS_PSA_ITS_JOURNAL_C
+ * is enabled.
+ */
+void mbedtls_psa_its_journal_close(void);
+#endif /* MBEDTLS_PSA_ITS_JOURNAL_C */
+
+#if defined(MBEDTLS_PSA_ITS_MMAP_C)
+/** \brief Unmap and close the PSA ITS container.
+ *
+ * mbedtls_psa_crypto_free() calls this function. The next PSA ITS access
+ * maps the container again.
+ *
+ * This is an Mbed TLS extension, available when #MBEDTLS_PSA_ITS_MMAP_C
+ * is enabled.
+ */
+void mbedtls_psa_its_mmap_close(void);
+#endif /* MBEDTLS_PSA_ITS_MMAP_C */
+
 /**
  * \brief Inject an initial entropy seed for the random generator into
  *        secure storage.
@@ -817,6 +857,109 @@ psa_status_t mbedtls_psa_platform_get_builtin_key(
 
 /** @} */
 
+/** \defgroup psa_aead_batch Batched AEAD operations
+ * @{
+ */
+
+/** One message of a batched AEAD operation.
+ *
+ * The caller fills in the input fields. psa_aead_encrypt_batch()
+ * and psa_aead_decrypt_batch() fill in \c output_length and
+ * \c status.
+ */
+typedef struct psa_aead_batch_entry_s {
+    const uint8_t *nonce;               /**< Nonce or IV to use. */
+    size_t nonce_length;                /**< Size of \c nonce in bytes. */
+    const uint8_t *additional_data;     /**< Additional data that is
+                                         *   authenticated but not
+                                         *   encrypted. */
+    size_t additional_data_length;      /**< Size of \c additional_data in
+                                         *   bytes. */
+    const uint8_t *input;               /**< Plaintext to encrypt, or
+                                         *   ciphertext followed by the
+                                         *   tag to decrypt. */
+    size_t input_length;                /**< Size of \c input in bytes. */
+    uint8_t *output;                    /**< Output buffer. */
+    size_t output_size;                 /**< Size of \c output in bytes. */
+    size_t output_length;               /**< On output, the size of the
+                                         *   data written to \c output. */
+    psa_status_t status;                /**< On output, the result of
+                                         *   processing this message. */
+} psa_aead_batch_entry_t;
+
+/** Encrypt and authenticate many messages with the same key.
+ *
+ * The result for each message is the same as calling psa_aead_encrypt()
+ * with the parameters in the corresponding entry. The key is looked up
+ * and its policy checked once for the whole batch, and the built-in
+ * implementation expands the key (for example the AES key schedule and
+ * the GHASH tables of GCM) only once.
+ *
+ * A failure in one message does not stop the processing of the following
+ * messages. The output buffer of a message that failed is wiped.
+ *
+ * This is an Mbed TLS extension.
+ *
+ * \param key                   Identifier of the key to use for the
+ *                              operation. It must allow the usage
+ *                              #PSA_KEY_USAGE_ENCRYPT.
+ * \param alg                   The AEAD algorithm to compute
+ *                              (\c PSA_ALG_XXX value such that
+ *                              #PSA_ALG_IS_AEAD(\p alg) is true).
+ * \param[in,out] entries       The messages to encrypt. On return, each
+ *                              entry's \c status and \c output_length
+ *                              are filled in.
+ * \param entry_count           Number of elements in \p entries.
+ *
+ * \retval #PSA_SUCCESS
+ *         All the messages were encrypted successfully.
+ * \return Otherwise, the status of the first entry that failed. If the
+ *         error concerns the key or the algorithm, for example
+ *         #PSA_ERROR_INVALID_HANDLE or #PSA_ERROR_NOT_PERMITTED, every
+ *         entry has this status.
+ */
+psa_status_t psa_aead_encrypt_batch(
+    mbedtls_svc_key_id_t key,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries,
+    size_t entry_count);
+
+/** Decrypt and verify many messages with the same key.
+ *
+ * The result for each message is the same as calling psa_aead_decrypt()
+ * with the parameters in the corresponding entry. See
+ * psa_aead_encrypt_batch() for the benefits and the handling of
+ * failures. In particular, a message that is not authentic gets the
+ * status #PSA_ERROR_INVALID_SIGNATURE and the other messages are still
+ * decrypted.
+ *
+ * This is an Mbed TLS extension.
+ *
+ * \param key                   Identifier of the key to use for the
+ *                              operation. It must allow the usage
+ *                              #PSA_KEY_USAGE_DECRYPT.
+ * \param alg                   The AEAD algorithm to compute
+ *                              (\c PSA_ALG_XXX value such that
+ *                              #PSA_ALG_IS_AEAD(\p alg) is true).
+ * \param[in,out] entries       The messages to decrypt. On return, each
+ *                              entry's \c status and \c output_length
+ *                              are filled in.
+ * \param entry_count           Number of elements in \p entries.
+ *
+ * \retval #PSA_SUCCESS
+ *         All the messages were decrypted and verified successfully.
+ * \return Otherwise, the status of the first entry that failed. If the
+ *         error concerns the key or the algorithm, every entry has this
+ *         status.
+ */
+psa_status_t psa_aead_decrypt_batch(
+    mbedtls_svc_key_id_t key,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries,
+    size_t entry_count);
+
+/** @} */
+
 /** \addtogroup crypto_types
  * @{
  */
@@ -29,6 +29,7 @@
 
 #include "mbedtls/ecdsa.h"
 #include "mbedtls/asn1write.h"
+#include "ecdsa_internal.h"
 
 #include <string.h>
 
@@ -235,6 +236,51 @@ cleanup:
 #endif /* ECDSA_DETERMINISTIC || !ECDSA_SIGN_ALT || !ECDSA_VERIFY_ALT */
 
 #if !defined(MBEDTLS_ECDSA_SIGN_ALT)
+/*
+ * Steps 5 and 6 of SEC1 4.1.3, once r has been derived from the ephemeral
+ * key k: s = (e + r * d) / k mod n. Overwrites k.
+ */
+static int ecdsa_sign_s(const mbedtls_ecp_group *grp, mbedtls_mpi *s,
+                        const mbedtls_mpi *r, const mbedtls_mpi *d,
+                        mbedtls_mpi *k, const unsigned char *buf, size_t blen,
+                        int (*f_rng_blind)(void *, unsigned char *, size_t),
+                        void *p_rng_blind)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_mpi e, t;
+
+    mbedtls_mpi_init(&e); mbedtls_mpi_init(&t);
+
+    /*
+     * Step 5: derive MPI from hashed message
+     */
+    MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
+
+    /*
+     * Generate a random value to blind inv_mod in next step,
+     * avoiding a potential timing leak.
+     */
+    MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &t, f_rng_blind,
+                                            p_rng_blind));
+
+    /*
+     * Step 6: compute s = (e + r * d) / k = t (e + rd) / (kt) mod n
+     */
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, r, d));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&e, &e, s));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&e, &e, &t));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(k, k, &t));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(k, k, &grp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(s, k, &grp->N));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, s, &e));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(s, s, &grp->N));
+
+cleanup:
+    mbedtls_mpi_free(&e); mbedtls_mpi_free(&t);
+
+    return ret;
+}
+
 /*
  * Compute ECDSA signature of a hashed message (SEC1 4.1.3)
  * Obviously, compared to SEC1 4.1.3, we skip step 4 (hash message)
@@ -250,7 +296,7 @@ int mbedtls_ecdsa_sign_restartable(mbedtls_ecp_group *grp,
     int ret, key_tries, sign_tries;
     int *p_sign_tries = &sign_tries, *p_key_tries = &key_tries;
     mbedtls_ecp_point R;
-    mbedtls_mpi k, e, t;
+    mbedtls_mpi k;
     mbedtls_mpi *pk = &k, *pr = r;
 
     /* Fail cleanly on curves such as Curve25519 that can't be used for ECDSA */
@@ -264,7 +310,7 @@ int mbedtls_ecdsa_sign_restartable(mbedtls_ecp_group *grp,
     }
 
     mbedtls_ecp_point_init(&R);
-    mbedtls_mpi_init(&k); mbedtls_mpi_init(&e); mbedtls_mpi_init(&t);
+    mbedtls_mpi_init(&k);
 
     ECDSA_RS_ENTER(sig);
 
@@ -333,29 +379,8 @@ modn:
          */
         ECDSA_BUDGET(MBEDTLS_ECP_OPS_INV + 4);
 
-        /*
-         * Step 5: derive MPI from hashed message
-         */
-        MBEDTLS_MPI_CHK(derive_mpi(grp, &e, buf, blen));
-
-        /*
-         * Generate a random value to blind inv_mod in next step,
-         * avoiding a potential timing leak.
-         */
-        MBEDTLS_MPI_CHK(mbedtls_ecp_gen_privkey(grp, &t, f_rng_blind,
-                                                p_rng_blind));
-
-        /*
-         * Step 6: compute s = (e + r * d) / k = t (e + rd) / (kt) mod n
-         */
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, pr, d));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_add_mpi(&e, &e, s));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(&e, &e, &t));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(pk, pk, &t));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(pk, pk, &grp->N));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_inv_mod(s, pk, &grp->N));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mul_mpi(s, s, &e));
-        MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(s, s, &grp->N));
+        MBEDTLS_MPI_CHK(ecdsa_sign_s(grp, s, pr, d, pk, buf, blen,
+                                     f_rng_blind, p_rng_blind));
     } while (mbedtls_mpi_cmp_int(s, 0) == 0);
 
 #if defined(MBEDTLS_ECP_RESTARTABLE)
@@ -366,7 +391,7 @@ modn:
 
 cleanup:
     mbedtls_ecp_point_free(&R);
-    mbedtls_mpi_free(&k); mbedtls_mpi_free(&e); mbedtls_mpi_free(&t);
+    mbedtls_mpi_free(&k);
 
     ECDSA_RS_LEAVE(sig);
 
@@ -709,6 +734,64 @@ int mbedtls_ecdsa_write_signature(mbedtls_ecdsa_context *ctx,
         f_rng, p_rng, NULL);
 }
 
+#if !defined(MBEDTLS_ECDSA_SIGN_ALT)
+/*
+ * Finish and write a signature whose ephemeral point R = k G was computed
+ * by the caller
+ */
+int mbedtls_ecdsa_write_signature_with_point(mbedtls_ecp_group *grp,
+                                             const mbedtls_mpi *d,
+                                             mbedtls_mpi *k,
+                                             const mbedtls_ecp_point *R,
+                                             const unsigned char *hash,
+                                             size_t hlen,
+                                             unsigned char *sig,
+                                             size_t sig_size, size_t *slen,
+                                             int (*f_rng)(void *, unsigned char *, size_t),
+                                             void *p_rng)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_mpi r, s;
+
+    if (f_rng == NULL) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    /* Same checks as mbedtls_ecdsa_sign_restartable() */
+    if (!mbedtls_ecdsa_can_do(grp->id) || grp->N.p == NULL) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    if (mbedtls_mpi_cmp_int(d, 1) < 0 || mbedtls_mpi_cmp_mpi(d, &grp->N) >= 0) {
+        return MBEDTLS_ERR_ECP_INVALID_KEY;
+    }
+
+    mbedtls_mpi_init(&r);
+    mbedtls_mpi_init(&s);
+
+    MBEDTLS_MPI_CHK(mbedtls_mpi_mod_mpi(&r, &R->X, &grp->N));
+    if (mbedtls_mpi_cmp_int(&r, 0) != 0) {
+        MBEDTLS_MPI_CHK(ecdsa_sign_s(grp, &s, &r, d, k, hash, hlen,
+                                     f_rng, p_rng));
+    }
+
+    if (mbedtls_mpi_cmp_int(&r, 0) == 0 || mbedtls_mpi_cmp_int(&s, 0) == 0) {
+        MBEDTLS_MPI_CHK(mbedtls_ecdsa_sign_restartable(grp, &r, &s, d,
+                                                       hash, hlen,
+                                                       f_rng, p_rng,
+                                                       f_rng, p_rng, NULL));
+    }
+
+    MBEDTLS_MPI_CHK(ecdsa_signature_to_asn1(&r, &s, sig, sig_size, slen));
+
+cleanup:
+    mbedtls_mpi_free(&r);
+    mbedtls_mpi_free(&s);
+
+    return ret;
+}
+#endif /* !MBEDTLS_ECDSA_SIGN_ALT */
+
 /*
  * Read and check signature
  */
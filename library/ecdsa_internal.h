@@ -0,0 +1,87 @@
+/**
+ * \file ecdsa_internal.h
+ *
+ * \brief Internal ECDSA functions
+ *
+ *  This module declares ECDSA functions that other modules of the library
+ *  use to compute signatures in batches. They are not part of the public
+ *  interface: end-users of Mbed TLS should only use the functions declared
+ *  in ecdsa.h.
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef MBEDTLS_ECDSA_INTERNAL_H
+#define MBEDTLS_ECDSA_INTERNAL_H
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/ecdsa.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(MBEDTLS_ECDSA_C) && !defined(MBEDTLS_ECDSA_SIGN_ALT)
+/**
+ * \brief           Finish an ECDSA signature whose ephemeral point was
+ *                  computed by the caller, for example together with other
+ *                  points by mbedtls_ecp_mul_batch(), and write it in the
+ *                  format of mbedtls_ecdsa_write_signature().
+ *
+ *                  In the unlikely case that \p R leads to a zero \c r or
+ *                  \c s, the signature is computed again from scratch with
+ *                  a new ephemeral key.
+ *
+ * \warning         \p k must be a fresh output of mbedtls_ecp_gen_privkey()
+ *                  for this signature only: reusing an ephemeral key for
+ *                  two signatures reveals the private key.
+ *
+ * \param grp       The ECP group of the key.
+ * \param d         The private key.
+ * \param k         The ephemeral private key. It is overwritten.
+ * \param R         The ephemeral public key \p k * G, normalized.
+ * \param hash      The hash of the message to sign.
+ * \param hlen      The length of \p hash in bytes.
+ * \param sig       The buffer to which to write the signature.
+ * \param sig_size  The size of the \p sig buffer in bytes.
+ * \param slen      On success, the length of the signature in bytes.
+ * \param f_rng     The RNG function used for blinding. This must not be
+ *                  \c NULL.
+ * \param p_rng     The RNG context to be passed to \p f_rng.
+ *
+ * \return          \c 0 on success.
+ * \return          An \c MBEDTLS_ERR_ECP_XXX, \c MBEDTLS_ERR_MPI_XXX or
+ *                  \c MBEDTLS_ERR_ASN1_XXX error code on failure.
+ */
+int mbedtls_ecdsa_write_signature_with_point(mbedtls_ecp_group *grp,
+                                             const mbedtls_mpi *d,
+                                             mbedtls_mpi *k,
+                                             const mbedtls_ecp_point *R,
+                                             const unsigned char *hash,
+                                             size_t hlen,
+                                             unsigned char *sig,
+                                             size_t sig_size, size_t *slen,
+                                             int (*f_rng)(void *, unsigned char *, size_t),
+                                             void *p_rng);
+#endif /* MBEDTLS_ECDSA_C && !MBEDTLS_ECDSA_SIGN_ALT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ecdsa_internal.h */
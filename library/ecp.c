@@ -2168,6 +2168,9 @@ cleanup:
  *
  * Scalar recoding may use a parity trick that makes us compute -m * P,
  * if that is the case we'll need to recover m * P at the end.
+ *
+ * Without norm, the result is left in Jacobian coordinates for the caller
+ * to randomize and normalize (see mbedtls_ecp_mul_batch()).
  */
 static int ecp_mul_comb_after_precomp(const mbedtls_ecp_group *grp,
                                       mbedtls_ecp_point *R,
@@ -2178,7 +2181,8 @@ static int ecp_mul_comb_after_precomp(const mbedtls_ecp_group *grp,
                                       size_t d,
                                       int (*f_rng)(void *, unsigned char *, size_t),
                                       void *p_rng,
-                                      mbedtls_ecp_restart_ctx *rs_ctx)
+                                      mbedtls_ecp_restart_ctx *rs_ctx,
+                                      unsigned char norm)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     unsigned char parity_trick;
@@ -2201,6 +2205,10 @@ static int ecp_mul_comb_after_precomp(const mbedtls_ecp_group *grp,
                                       f_rng, p_rng, rs_ctx));
     MBEDTLS_MPI_CHK(ecp_safe_invert_jac(grp, RR, parity_trick));
 
+    if (!norm) {
+        goto cleanup;
+    }
+
 #if defined(MBEDTLS_ECP_RESTARTABLE)
     if (rs_ctx != NULL && rs_ctx->rsm != NULL) {
         rs_ctx->rsm->state = ecp_rsm_final_norm;
@@ -2298,7 +2306,8 @@ static int ecp_mul_comb(mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
                         const mbedtls_mpi *m, const mbedtls_ecp_point *P,
                         int (*f_rng)(void *, unsigned char *, size_t),
                         void *p_rng,
-                        mbedtls_ecp_restart_ctx *rs_ctx)
+                        mbedtls_ecp_restart_ctx *rs_ctx,
+                        unsigned char norm)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     unsigned char w, p_eq_g, i;
@@ -2369,7 +2378,7 @@ static int ecp_mul_comb(mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     /* Actual comb multiplication using precomputed points */
     MBEDTLS_MPI_CHK(ecp_mul_comb_after_precomp(grp, R, m,
                                                T, T_size, w, d,
-                                               f_rng, p_rng, rs_ctx));
+                                               f_rng, p_rng, rs_ctx, norm));
 
 cleanup:
 
@@ -2678,7 +2687,7 @@ static int ecp_mul_restartable_internal(mbedtls_ecp_group *grp, mbedtls_ecp_poin
 #endif
 #if defined(MBEDTLS_ECP_SHORT_WEIERSTRASS_ENABLED)
     if (mbedtls_ecp_get_type(grp) == MBEDTLS_ECP_TYPE_SHORT_WEIERSTRASS) {
-        MBEDTLS_MPI_CHK(ecp_mul_comb(grp, R, m, P, f_rng, p_rng, rs_ctx));
+        MBEDTLS_MPI_CHK(ecp_mul_comb(grp, R, m, P, f_rng, p_rng, rs_ctx, 1));
     }
 #endif
 
@@ -2724,6 +2733,82 @@ int mbedtls_ecp_mul(mbedtls_ecp_group *grp, mbedtls_ecp_point *R,
     return mbedtls_ecp_mul_restartable(grp, R, m, P, f_rng, p_rng, NULL);
 }
 
+/*
+ * Batch of multiplications R[i] = m[i] * P[i] sharing the final
+ * normalization
+ */
+int mbedtls_ecp_mul_batch(mbedtls_ecp_group *grp, mbedtls_ecp_point *R[],
+                          const mbedtls_mpi *const m[],
+                          const mbedtls_ecp_point *const P[], size_t n,
+                          int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+    int ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    size_t i;
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    char is_grp_capable = 0;
+#endif
+
+    if (f_rng == NULL) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+    if (n == 0) {
+        return 0;
+    }
+
+#if defined(MBEDTLS_ECP_MONTGOMERY_ENABLED)
+    if (mbedtls_ecp_get_type(grp) == MBEDTLS_ECP_TYPE_MONTGOMERY) {
+        /* The ladder only keeps X and Z: nothing to share */
+        for (i = 0; i < n; i++) {
+            MBEDTLS_MPI_CHK(mbedtls_ecp_mul(grp, R[i], m[i], P[i],
+                                            f_rng, p_rng));
+        }
+        return 0;
+    }
+#endif
+
+    if (mbedtls_ecp_get_type(grp) != MBEDTLS_ECP_TYPE_SHORT_WEIERSTRASS) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_ECP_SHORT_WEIERSTRASS_ENABLED)
+    /* Check all the inputs first: a bad peer key must not cost the
+     * multiplications of the other operations of the batch. */
+    for (i = 0; i < n; i++) {
+        MBEDTLS_MPI_CHK(mbedtls_ecp_check_privkey(grp, m[i]));
+        MBEDTLS_MPI_CHK(mbedtls_ecp_check_pubkey(grp, P[i]));
+    }
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    if ((is_grp_capable = mbedtls_internal_ecp_grp_capable(grp))) {
+        MBEDTLS_MPI_CHK(mbedtls_internal_ecp_init(grp));
+    }
+#endif /* MBEDTLS_ECP_INTERNAL_ALT */
+
+    for (i = 0; i < n; i++) {
+        MBEDTLS_MPI_CHK(ecp_mul_comb(grp, R[i], m[i], P[i],
+                                     f_rng, p_rng, NULL, 0));
+
+        /* Same countermeasure as in ecp_mul_comb_after_precomp(): the
+         * inputs of the inversion must not be the raw Jacobian coordinates */
+        MBEDTLS_MPI_CHK(ecp_randomize_jac(grp, R[i], f_rng, p_rng));
+    }
+
+    /* Since m[i] is in [1, N-1] and N is prime, no result is zero */
+    MBEDTLS_MPI_CHK(ecp_normalize_jac_many(grp, R, n));
+#endif /* MBEDTLS_ECP_SHORT_WEIERSTRASS_ENABLED */
+
+cleanup:
+
+#if defined(MBEDTLS_ECP_INTERNAL_ALT)
+    if (is_grp_capable) {
+        mbedtls_internal_ecp_free(grp);
+    }
+#endif /* MBEDTLS_ECP_INTERNAL_ALT */
+
+    return ret;
+}
+
 #if defined(MBEDTLS_ECP_SHORT_WEIERSTRASS_ENABLED)
 /*
  * Check that an affine point is valid as a public key,
@@ -295,164 +295,183 @@ static int mbedtls_md_error_from_psa(psa_status_t status)
 }
 #endif /* MBEDTLS_MD_SOME_PSA */
 
-void mbedtls_md_init(mbedtls_md_context_t *ctx)
-{
-    /* Note: this sets engine (if present) to MBEDTLS_MD_ENGINE_LEGACY */
-    memset(ctx, 0, sizeof(mbedtls_md_context_t));
-}
-
-void mbedtls_md_free(mbedtls_md_context_t *ctx)
+#if defined(MBEDTLS_MD_C)
+/* Initialize a legacy hash context. */
+static int md_init_legacy(mbedtls_md_type_t md_type, void *md_ctx)
 {
-    if (ctx == NULL || ctx->md_info == NULL) {
-        return;
-    }
-
-    if (ctx->md_ctx != NULL) {
-#if defined(MBEDTLS_MD_SOME_PSA)
-        if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
-            psa_hash_abort(ctx->md_ctx);
-        } else
-#endif
-        switch (ctx->md_info->type) {
+    switch (md_type) {
 #if defined(MBEDTLS_MD2_C)
-            case MBEDTLS_MD_MD2:
-                mbedtls_md2_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_MD2:
+            mbedtls_md2_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_MD4_C)
-            case MBEDTLS_MD_MD4:
-                mbedtls_md4_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_MD4:
+            mbedtls_md4_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_MD5_C)
-            case MBEDTLS_MD_MD5:
-                mbedtls_md5_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_MD5:
+            mbedtls_md5_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_RIPEMD160_C)
-            case MBEDTLS_MD_RIPEMD160:
-                mbedtls_ripemd160_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_RIPEMD160:
+            mbedtls_ripemd160_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA1_C)
-            case MBEDTLS_MD_SHA1:
-                mbedtls_sha1_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_SHA1:
+            mbedtls_sha1_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA224_C)
-            case MBEDTLS_MD_SHA224:
-                mbedtls_sha256_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_SHA224:
+            mbedtls_sha256_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA256_C)
-            case MBEDTLS_MD_SHA256:
-                mbedtls_sha256_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_SHA256:
+            mbedtls_sha256_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA384_C)
-            case MBEDTLS_MD_SHA384:
-                mbedtls_sha512_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_SHA384:
+            mbedtls_sha512_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA512_C)
-            case MBEDTLS_MD_SHA512:
-                mbedtls_sha512_free(ctx->md_ctx);
-                break;
+        case MBEDTLS_MD_SHA512:
+            mbedtls_sha512_init(md_ctx);
+            break;
 #endif
 #if defined(MBEDTLS_SHA3_C)
-            case MBEDTLS_MD_SHA3_224:
-            case MBEDTLS_MD_SHA3_256:
-            case MBEDTLS_MD_SHA3_384:
-            case MBEDTLS_MD_SHA3_512:
-                mbedtls_sha3_free(ctx->md_ctx);
-                break;
-#endif
-            default:
-                /* Shouldn't happen */
-                break;
-        }
-        mbedtls_free(ctx->md_ctx);
-    }
-
-#if defined(MBEDTLS_MD_C)
-    if (ctx->hmac_ctx != NULL) {
-        mbedtls_platform_zeroize(ctx->hmac_ctx,
-                                 2 * ctx->md_info->block_size);
-        mbedtls_free(ctx->hmac_ctx);
-    }
+        case MBEDTLS_MD_SHA3_224:
+        case MBEDTLS_MD_SHA3_256:
+        case MBEDTLS_MD_SHA3_384:
+        case MBEDTLS_MD_SHA3_512:
+            mbedtls_sha3_init(md_ctx);
+            break;
 #endif
+        default:
+            return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
 
-    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_md_context_t));
+    return 0;
 }
+#endif /* MBEDTLS_MD_C */
 
-int mbedtls_md_clone(mbedtls_md_context_t *dst,
-                     const mbedtls_md_context_t *src)
+/* Free a legacy hash context. */
+static void md_free_legacy(mbedtls_md_type_t md_type, void *md_ctx)
 {
-    if (dst == NULL || dst->md_info == NULL ||
-        src == NULL || src->md_info == NULL ||
-        dst->md_info != src->md_info) {
-        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
-    }
-
-#if defined(MBEDTLS_MD_SOME_PSA)
-    if (src->engine != dst->engine) {
-        /* This can happen with src set to legacy because PSA wasn't ready
-         * yet, and dst to PSA because it became ready in the meantime.
-         * We currently don't support that case (we'd need to re-allocate
-         * md_ctx to the size of the appropriate MD context). */
-        return MBEDTLS_ERR_MD_FEATURE_UNAVAILABLE;
-    }
-
-    if (src->engine == MBEDTLS_MD_ENGINE_PSA) {
-        psa_status_t status = psa_hash_clone(src->md_ctx, dst->md_ctx);
-        return mbedtls_md_error_from_psa(status);
-    }
+    switch (md_type) {
+#if defined(MBEDTLS_MD2_C)
+        case MBEDTLS_MD_MD2:
+            mbedtls_md2_free(md_ctx);
+            break;
 #endif
+#if defined(MBEDTLS_MD4_C)
+        case MBEDTLS_MD_MD4:
+            mbedtls_md4_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_MD5_C)
+        case MBEDTLS_MD_MD5:
+            mbedtls_md5_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_RIPEMD160_C)
+        case MBEDTLS_MD_RIPEMD160:
+            mbedtls_ripemd160_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA1_C)
+        case MBEDTLS_MD_SHA1:
+            mbedtls_sha1_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA224_C)
+        case MBEDTLS_MD_SHA224:
+            mbedtls_sha256_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA256_C)
+        case MBEDTLS_MD_SHA256:
+            mbedtls_sha256_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA384_C)
+        case MBEDTLS_MD_SHA384:
+            mbedtls_sha512_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA512_C)
+        case MBEDTLS_MD_SHA512:
+            mbedtls_sha512_free(md_ctx);
+            break;
+#endif
+#if defined(MBEDTLS_SHA3_C)
+        case MBEDTLS_MD_SHA3_224:
+        case MBEDTLS_MD_SHA3_256:
+        case MBEDTLS_MD_SHA3_384:
+        case MBEDTLS_MD_SHA3_512:
+            mbedtls_sha3_free(md_ctx);
+            break;
+#endif
+        default:
+            /* Shouldn't happen */
+            break;
+    }
+}
 
-    switch (src->md_info->type) {
+/* Copy the state of a legacy hash context. */
+static int md_clone_legacy(mbedtls_md_type_t md_type,
+                           void *dst, const void *src)
+{
+    switch (md_type) {
 #if defined(MBEDTLS_MD2_C)
         case MBEDTLS_MD_MD2:
-            mbedtls_md2_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_md2_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_MD4_C)
         case MBEDTLS_MD_MD4:
-            mbedtls_md4_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_md4_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_MD5_C)
         case MBEDTLS_MD_MD5:
-            mbedtls_md5_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_md5_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_RIPEMD160_C)
         case MBEDTLS_MD_RIPEMD160:
-            mbedtls_ripemd160_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_ripemd160_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA1_C)
         case MBEDTLS_MD_SHA1:
-            mbedtls_sha1_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha1_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA224_C)
         case MBEDTLS_MD_SHA224:
-            mbedtls_sha256_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha256_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA256_C)
         case MBEDTLS_MD_SHA256:
-            mbedtls_sha256_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha256_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA384_C)
         case MBEDTLS_MD_SHA384:
-            mbedtls_sha512_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha512_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA512_C)
         case MBEDTLS_MD_SHA512:
-            mbedtls_sha512_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha512_clone(dst, src);
             break;
 #endif
 #if defined(MBEDTLS_SHA3_C)
@@ -460,7 +479,7 @@ int mbedtls_md_clone(mbedtls_md_context_t *dst,
         case MBEDTLS_MD_SHA3_256:
         case MBEDTLS_MD_SHA3_384:
         case MBEDTLS_MD_SHA3_512:
-            mbedtls_sha3_clone(dst->md_ctx, src->md_ctx);
+            mbedtls_sha3_clone(dst, src);
             break;
 #endif
         default:
@@ -470,6 +489,212 @@ int mbedtls_md_clone(mbedtls_md_context_t *dst,
     return 0;
 }
 
+#if defined(MBEDTLS_MD_C)
+/*
+ * An HMAC context keeps, in the buffer hmac_ctx:
+ * - the key XORed with ipad and with opad, one block each;
+ * - the hash state after absorbing each of those two blocks, so that
+ *   mbedtls_md_hmac_reset() and mbedtls_md_hmac_finish() restore them
+ *   instead of running the compression function again.
+ * The hash states start at an aligned offset after the two blocks.
+ */
+#define MD_HMAC_STATE_ALIGN 16
+
+/* Any of the hash contexts that md_ctx can point to. */
+typedef union {
+#if defined(MBEDTLS_MD2_C)
+    mbedtls_md2_context md2;
+#endif
+#if defined(MBEDTLS_MD4_C)
+    mbedtls_md4_context md4;
+#endif
+#if defined(MBEDTLS_MD5_C)
+    mbedtls_md5_context md5;
+#endif
+#if defined(MBEDTLS_RIPEMD160_C)
+    mbedtls_ripemd160_context ripemd160;
+#endif
+#if defined(MBEDTLS_SHA1_C)
+    mbedtls_sha1_context sha1;
+#endif
+#if defined(MBEDTLS_SHA224_C) || defined(MBEDTLS_SHA256_C)
+    mbedtls_sha256_context sha256;
+#endif
+#if defined(MBEDTLS_SHA384_C) || defined(MBEDTLS_SHA512_C)
+    mbedtls_sha512_context sha512;
+#endif
+#if defined(MBEDTLS_SHA3_C)
+    mbedtls_sha3_context sha3;
+#endif
+#if defined(MBEDTLS_MD_SOME_PSA)
+    psa_hash_operation_t psa;
+#endif
+    unsigned char dummy; /* Make the union non-empty with no hash. */
+} md_any_context_t;
+
+/* Size of the hash context used by ctx, or 0 if unknown. */
+static size_t md_ctx_size(const mbedtls_md_context_t *ctx)
+{
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
+        return sizeof(psa_hash_operation_t);
+    }
+#endif
+
+    switch (ctx->md_info->type) {
+#if defined(MBEDTLS_MD2_C)
+        case MBEDTLS_MD_MD2:
+            return sizeof(mbedtls_md2_context);
+#endif
+#if defined(MBEDTLS_MD4_C)
+        case MBEDTLS_MD_MD4:
+            return sizeof(mbedtls_md4_context);
+#endif
+#if defined(MBEDTLS_MD5_C)
+        case MBEDTLS_MD_MD5:
+            return sizeof(mbedtls_md5_context);
+#endif
+#if defined(MBEDTLS_RIPEMD160_C)
+        case MBEDTLS_MD_RIPEMD160:
+            return sizeof(mbedtls_ripemd160_context);
+#endif
+#if defined(MBEDTLS_SHA1_C)
+        case MBEDTLS_MD_SHA1:
+            return sizeof(mbedtls_sha1_context);
+#endif
+#if defined(MBEDTLS_SHA224_C)
+        case MBEDTLS_MD_SHA224:
+            return sizeof(mbedtls_sha256_context);
+#endif
+#if defined(MBEDTLS_SHA256_C)
+        case MBEDTLS_MD_SHA256:
+            return sizeof(mbedtls_sha256_context);
+#endif
+#if defined(MBEDTLS_SHA384_C)
+        case MBEDTLS_MD_SHA384:
+            return sizeof(mbedtls_sha512_context);
+#endif
+#if defined(MBEDTLS_SHA512_C)
+        case MBEDTLS_MD_SHA512:
+            return sizeof(mbedtls_sha512_context);
+#endif
+#if defined(MBEDTLS_SHA3_C)
+        case MBEDTLS_MD_SHA3_224:
+        case MBEDTLS_MD_SHA3_256:
+        case MBEDTLS_MD_SHA3_384:
+        case MBEDTLS_MD_SHA3_512:
+            return sizeof(mbedtls_sha3_context);
+#endif
+        default:
+            return 0;
+    }
+}
+
+static size_t hmac_state_offset(const mbedtls_md_info_t *md_info)
+{
+    return (2 * (size_t) md_info->block_size + MD_HMAC_STATE_ALIGN - 1) &
+           ~(size_t) (MD_HMAC_STATE_ALIGN - 1);
+}
+
+static size_t hmac_ctx_size(const mbedtls_md_context_t *ctx)
+{
+    return hmac_state_offset(ctx->md_info) + 2 * md_ctx_size(ctx);
+}
+
+/* The hash state after the ipad block (outer = 0) or the opad block
+ * (outer = 1). */
+static void *hmac_state(const mbedtls_md_context_t *ctx, int outer)
+{
+    return (unsigned char *) ctx->hmac_ctx +
+           hmac_state_offset(ctx->md_info) + outer * md_ctx_size(ctx);
+}
+
+/* Copy a hash state of ctx, between md_ctx and the saved HMAC states. */
+static int hmac_copy_state(const mbedtls_md_context_t *ctx,
+                           void *dst, const void *src)
+{
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
+        psa_status_t status;
+        psa_hash_abort(dst);
+        status = psa_hash_clone(src, dst);
+        return mbedtls_md_error_from_psa(status);
+    }
+#endif
+
+    return md_clone_legacy(ctx->md_info->type, dst, src);
+}
+#endif /* MBEDTLS_MD_C */
+
+void mbedtls_md_init(mbedtls_md_context_t *ctx)
+{
+    /* Note: this sets engine (if present) to MBEDTLS_MD_ENGINE_LEGACY */
+    memset(ctx, 0, sizeof(mbedtls_md_context_t));
+}
+
+void mbedtls_md_free(mbedtls_md_context_t *ctx)
+{
+    if (ctx == NULL || ctx->md_info == NULL) {
+        return;
+    }
+
+    if (ctx->md_ctx != NULL) {
+#if defined(MBEDTLS_MD_SOME_PSA)
+        if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
+            psa_hash_abort(ctx->md_ctx);
+        } else
+#endif
+        md_free_legacy(ctx->md_info->type, ctx->md_ctx);
+        mbedtls_free(ctx->md_ctx);
+    }
+
+#if defined(MBEDTLS_MD_C)
+    if (ctx->hmac_ctx != NULL) {
+#if defined(MBEDTLS_MD_SOME_PSA)
+        if (ctx->engine == MBEDTLS_MD_ENGINE_PSA) {
+            psa_hash_abort(hmac_state(ctx, 0));
+            psa_hash_abort(hmac_state(ctx, 1));
+        } else
+#endif
+        {
+            md_free_legacy(ctx->md_info->type, hmac_state(ctx, 0));
+            md_free_legacy(ctx->md_info->type, hmac_state(ctx, 1));
+        }
+        mbedtls_platform_zeroize(ctx->hmac_ctx, hmac_ctx_size(ctx));
+        mbedtls_free(ctx->hmac_ctx);
+    }
+#endif
+
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_md_context_t));
+}
+
+int mbedtls_md_clone(mbedtls_md_context_t *dst,
+                     const mbedtls_md_context_t *src)
+{
+    if (dst == NULL || dst->md_info == NULL ||
+        src == NULL || src->md_info == NULL ||
+        dst->md_info != src->md_info) {
+        return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (src->engine != dst->engine) {
+        /* This can happen with src set to legacy because PSA wasn't ready
+         * yet, and dst to PSA because it became ready in the meantime.
+         * We currently don't support that case (we'd need to re-allocate
+         * md_ctx to the size of the appropriate MD context). */
+        return MBEDTLS_ERR_MD_FEATURE_UNAVAILABLE;
+    }
+
+    if (src->engine == MBEDTLS_MD_ENGINE_PSA) {
+        psa_status_t status = psa_hash_clone(src->md_ctx, dst->md_ctx);
+        return mbedtls_md_error_from_psa(status);
+    }
+#endif
+
+    return md_clone_legacy(src->md_info->type, dst->md_ctx, src->md_ctx);
+}
+
 #define ALLOC(type)                                                   \
     do {                                                                \
         ctx->md_ctx = mbedtls_calloc(1, sizeof(mbedtls_##type##_context)); \
@@ -564,11 +789,19 @@ int mbedtls_md_setup(mbedtls_md_context_t *ctx, const mbedtls_md_info_t *md_info
 
 #if defined(MBEDTLS_MD_C)
     if (hmac != 0) {
-        ctx->hmac_ctx = mbedtls_calloc(2, md_info->block_size);
+        ctx->hmac_ctx = mbedtls_calloc(1, hmac_ctx_size(ctx));
         if (ctx->hmac_ctx == NULL) {
             mbedtls_md_free(ctx);
             return MBEDTLS_ERR_MD_ALLOC_FAILED;
         }
+#if defined(MBEDTLS_MD_SOME_PSA)
+        if (ctx->engine != MBEDTLS_MD_ENGINE_PSA)
+#endif
+        {
+            /* The saved states are hash contexts of their own */
+            (void) md_init_legacy(md_info->type, hmac_state(ctx, 0));
+            (void) md_init_legacy(md_info->type, hmac_state(ctx, 1));
+        }
     }
 #endif
 
@@ -1060,6 +1293,19 @@ int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key,
     mbedtls_xor(ipad, ipad, key, keylen);
     mbedtls_xor(opad, opad, key, keylen);
 
+    /* Save the state after each padded key block, so that later messages
+     * with the same key start from there. */
+    if ((ret = mbedtls_md_starts(ctx)) != 0) {
+        goto cleanup;
+    }
+    if ((ret = mbedtls_md_update(ctx, opad,
+                                 ctx->md_info->block_size)) != 0) {
+        goto cleanup;
+    }
+    if ((ret = hmac_copy_state(ctx, hmac_state(ctx, 1), ctx->md_ctx)) != 0) {
+        goto cleanup;
+    }
+
     if ((ret = mbedtls_md_starts(ctx)) != 0) {
         goto cleanup;
     }
@@ -1067,6 +1313,7 @@ int mbedtls_md_hmac_starts(mbedtls_md_context_t *ctx, const unsigned char *key,
                                  ctx->md_info->block_size)) != 0) {
         goto cleanup;
     }
+    ret = hmac_copy_state(ctx, hmac_state(ctx, 0), ctx->md_ctx);
 
 cleanup:
     mbedtls_platform_zeroize(sum, sizeof(sum));
@@ -1087,22 +1334,15 @@ int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     unsigned char tmp[MBEDTLS_MD_MAX_SIZE];
-    unsigned char *opad;
 
     if (ctx == NULL || ctx->md_info == NULL || ctx->hmac_ctx == NULL) {
         return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
     }
 
-    opad = (unsigned char *) ctx->hmac_ctx + ctx->md_info->block_size;
-
     if ((ret = mbedtls_md_finish(ctx, tmp)) != 0) {
         return ret;
     }
-    if ((ret = mbedtls_md_starts(ctx)) != 0) {
-        return ret;
-    }
-    if ((ret = mbedtls_md_update(ctx, opad,
-                                 ctx->md_info->block_size)) != 0) {
+    if ((ret = hmac_copy_state(ctx, ctx->md_ctx, hmac_state(ctx, 1))) != 0) {
         return ret;
     }
     if ((ret = mbedtls_md_update(ctx, tmp,
@@ -1114,19 +1354,11 @@ int mbedtls_md_hmac_finish(mbedtls_md_context_t *ctx, unsigned char *output)
 
 int mbedtls_md_hmac_reset(mbedtls_md_context_t *ctx)
 {
-    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
-    unsigned char *ipad;
-
     if (ctx == NULL || ctx->md_info == NULL || ctx->hmac_ctx == NULL) {
         return MBEDTLS_ERR_MD_BAD_INPUT_DATA;
     }
 
-    ipad = (unsigned char *) ctx->hmac_ctx;
-
-    if ((ret = mbedtls_md_starts(ctx)) != 0) {
-        return ret;
-    }
-    return mbedtls_md_update(ctx, ipad, ctx->md_info->block_size);
+    return hmac_copy_state(ctx, ctx->md_ctx, hmac_state(ctx, 0));
 }
 
 int mbedtls_md_hmac(const mbedtls_md_info_t *md_info,
@@ -1134,7 +1366,13 @@ int mbedtls_md_hmac(const mbedtls_md_info_t *md_info,
                     const unsigned char *input, size_t ilen,
                     unsigned char *output)
 {
+    /* A single message gains nothing from saving the padded key states,
+     * so run the hash directly on a context on the stack. */
     mbedtls_md_context_t ctx;
+    md_any_context_t md_ctx;
+    unsigned char pad[MBEDTLS_MD_MAX_BLOCK_SIZE];
+    unsigned char sum[MBEDTLS_MD_MAX_SIZE];
+    unsigned char tmp[MBEDTLS_MD_MAX_SIZE];
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
 
     if (md_info == NULL) {
@@ -1142,23 +1380,71 @@ int mbedtls_md_hmac(const mbedtls_md_info_t *md_info,
     }
 
     mbedtls_md_init(&ctx);
+    ctx.md_info = md_info;
+    ctx.md_ctx = &md_ctx;
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (md_can_use_psa(md_info)) {
+        ctx.engine = MBEDTLS_MD_ENGINE_PSA;
+        md_ctx.psa = psa_hash_operation_init();
+    } else
+#endif
+    if ((ret = md_init_legacy(md_info->type, &md_ctx)) != 0) {
+        return ret;
+    }
 
-    if ((ret = mbedtls_md_setup(&ctx, md_info, 1)) != 0) {
+    if (keylen > (size_t) md_info->block_size) {
+        if ((ret = mbedtls_md_starts(&ctx)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_update(&ctx, key, keylen)) != 0) {
+            goto cleanup;
+        }
+        if ((ret = mbedtls_md_finish(&ctx, sum)) != 0) {
+            goto cleanup;
+        }
+
+        keylen = md_info->size;
+        key = sum;
+    }
+
+    memset(pad, 0x36, md_info->block_size);
+    mbedtls_xor(pad, pad, key, keylen);
+    if ((ret = mbedtls_md_starts(&ctx)) != 0) {
+        goto cleanup;
+    }
+    if ((ret = mbedtls_md_update(&ctx, pad, md_info->block_size)) != 0) {
+        goto cleanup;
+    }
+    if ((ret = mbedtls_md_update(&ctx, input, ilen)) != 0) {
+        goto cleanup;
+    }
+    if ((ret = mbedtls_md_finish(&ctx, tmp)) != 0) {
         goto cleanup;
     }
 
-    if ((ret = mbedtls_md_hmac_starts(&ctx, key, keylen)) != 0) {
+    memset(pad, 0x5C, md_info->block_size);
+    mbedtls_xor(pad, pad, key, keylen);
+    if ((ret = mbedtls_md_starts(&ctx)) != 0) {
         goto cleanup;
     }
-    if ((ret = mbedtls_md_hmac_update(&ctx, input, ilen)) != 0) {
+    if ((ret = mbedtls_md_update(&ctx, pad, md_info->block_size)) != 0) {
         goto cleanup;
     }
-    if ((ret = mbedtls_md_hmac_finish(&ctx, output)) != 0) {
+    if ((ret = mbedtls_md_update(&ctx, tmp, md_info->size)) != 0) {
         goto cleanup;
     }
+    ret = mbedtls_md_finish(&ctx, output);
 
 cleanup:
-    mbedtls_md_free(&ctx);
+#if defined(MBEDTLS_MD_SOME_PSA)
+    if (ctx.engine == MBEDTLS_MD_ENGINE_PSA) {
+        psa_hash_abort(&md_ctx.psa);
+    } else
+#endif
+    md_free_legacy(md_info->type, &md_ctx);
+    mbedtls_platform_zeroize(pad, sizeof(pad));
+    mbedtls_platform_zeroize(sum, sizeof(sum));
+    mbedtls_platform_zeroize(tmp, sizeof(tmp));
 
     return ret;
 }
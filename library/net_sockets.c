@@ -80,6 +80,7 @@ static int wsa_init_done = 0;
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
@@ -108,6 +109,20 @@ static int wsa_init_done = 0;
 #endif
 
 #include <stdint.h>
+#include <limits.h>
+
+#if defined(MBEDTLS_SSL_KTLS) && defined(__linux__)
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include "mbedtls/platform_util.h"
+#define MBEDTLS_NET_HAVE_KTLS
+#if !defined(TCP_ULP)
+#define TCP_ULP 31
+#endif
+#if !defined(SOL_TLS)
+#define SOL_TLS 282
+#endif
+#endif /* MBEDTLS_SSL_KTLS && __linux__ */
 
 /*
  * Prepare for using the sockets interface
@@ -550,6 +565,33 @@ void mbedtls_net_usleep(unsigned long usec)
 #endif
 }
 
+/*
+ * Translate the failure of a read into an error code
+ */
+static int net_recv_error(void *ctx)
+{
+    if (net_would_block(ctx) != 0) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+
+#if (defined(_WIN32) || defined(_WIN32_WCE)) && !defined(EFIX64) && \
+    !defined(EFI32)
+    if (WSAGetLastError() == WSAECONNRESET) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+#else
+    if (errno == EPIPE || errno == ECONNRESET) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+
+    if (errno == EINTR) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+#endif
+
+    return MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
 /*
  * Read at most 'len' characters
  */
@@ -566,26 +608,7 @@ int mbedtls_net_recv(void *ctx, unsigned char *buf, size_t len)
     ret = (int) read(fd, buf, len);
 
     if (ret < 0) {
-        if (net_would_block(ctx) != 0) {
-            return MBEDTLS_ERR_SSL_WANT_READ;
-        }
-
-#if (defined(_WIN32) || defined(_WIN32_WCE)) && !defined(EFIX64) && \
-        !defined(EFI32)
-        if (WSAGetLastError() == WSAECONNRESET) {
-            return MBEDTLS_ERR_NET_CONN_RESET;
-        }
-#else
-        if (errno == EPIPE || errno == ECONNRESET) {
-            return MBEDTLS_ERR_NET_CONN_RESET;
-        }
-
-        if (errno == EINTR) {
-            return MBEDTLS_ERR_SSL_WANT_READ;
-        }
-#endif
-
-        return MBEDTLS_ERR_NET_RECV_FAILED;
+        return net_recv_error(ctx);
     }
 
     return ret;
@@ -639,6 +662,79 @@ int mbedtls_net_recv_timeout(void *ctx, unsigned char *buf,
     return mbedtls_net_recv(ctx, buf, len);
 }
 
+/*
+ * Read one datagram and the address of its sender
+ */
+int mbedtls_net_recv_from(void *ctx,
+                          unsigned char *buf, size_t len,
+                          void *addr, size_t addr_size, size_t *addr_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    int fd = ((mbedtls_net_context *) ctx)->fd;
+    struct sockaddr_storage peer_addr;
+
+#if defined(__socklen_t_defined) || defined(_SOCKLEN_T) ||  \
+    defined(_SOCKLEN_T_DECLARED) || defined(__DEFINED_socklen_t) || \
+    defined(socklen_t) || (defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112L)
+    socklen_t n = (socklen_t) sizeof(peer_addr);
+#else
+    int n = (int) sizeof(peer_addr);
+#endif
+
+    ret = check_fd(fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    memset(&peer_addr, 0, sizeof(peer_addr));
+    ret = (int) recvfrom(fd, (void *) buf, MSVC_INT_CAST len, 0,
+                         (struct sockaddr *) &peer_addr, &n);
+
+    if (ret < 0) {
+        return net_recv_error(ctx);
+    }
+
+    if (peer_addr.ss_family == AF_INET6) {
+        ((struct sockaddr_in6 *) &peer_addr)->sin6_flowinfo = 0;
+    }
+
+    if ((size_t) n > addr_size) {
+        return MBEDTLS_ERR_NET_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(addr, &peer_addr, (size_t) n);
+    *addr_len = (size_t) n;
+
+    return ret;
+}
+
+/*
+ * Translate the failure of a write into an error code
+ */
+static int net_send_error(void *ctx)
+{
+    if (net_would_block(ctx) != 0) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+
+#if (defined(_WIN32) || defined(_WIN32_WCE)) && !defined(EFIX64) && \
+    !defined(EFI32)
+    if (WSAGetLastError() == WSAECONNRESET) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+#else
+    if (errno == EPIPE || errno == ECONNRESET) {
+        return MBEDTLS_ERR_NET_CONN_RESET;
+    }
+
+    if (errno == EINTR) {
+        return MBEDTLS_ERR_SSL_WANT_WRITE;
+    }
+#endif
+
+    return MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
 /*
  * Write at most 'len' characters
  */
@@ -655,30 +751,363 @@ int mbedtls_net_send(void *ctx, const unsigned char *buf, size_t len)
     ret = (int) write(fd, buf, len);
 
     if (ret < 0) {
-        if (net_would_block(ctx) != 0) {
-            return MBEDTLS_ERR_SSL_WANT_WRITE;
-        }
+        return net_send_error(ctx);
+    }
+
+    return ret;
+}
+
+/*
+ * Write one datagram to a given address
+ */
+int mbedtls_net_send_to(void *ctx, const unsigned char *addr, size_t addr_len,
+                        const unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    int fd = ((mbedtls_net_context *) ctx)->fd;
+
+    ret = check_fd(fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (addr_len > sizeof(struct sockaddr_storage)) {
+        return MBEDTLS_ERR_NET_BAD_INPUT_DATA;
+    }
+
+    ret = (int) sendto(fd, (const void *) buf, MSVC_INT_CAST len, 0,
+                       (const struct sockaddr *) addr, MSVC_INT_CAST addr_len);
+
+    if (ret < 0) {
+        return net_send_error(ctx);
+    }
+
+    return ret;
+}
+
+/*
+ * Write several buffers at once
+ */
+int mbedtls_net_sendv(void *ctx, const mbedtls_net_iovec *iov, size_t iovcnt)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    int fd = ((mbedtls_net_context *) ctx)->fd;
+    size_t i;
+#if !((defined(_WIN32) || defined(_WIN32_WCE)) && !defined(EFIX64) && \
+    !defined(EFI32))
+    struct iovec vec[MBEDTLS_NET_SENDV_MAX_IOV];
+    size_t count = 0;
+    size_t total = 0;
+#endif
+
+    ret = check_fd(fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
 
 #if (defined(_WIN32) || defined(_WIN32_WCE)) && !defined(EFIX64) && \
-        !defined(EFI32)
-        if (WSAGetLastError() == WSAECONNRESET) {
-            return MBEDTLS_ERR_NET_CONN_RESET;
-        }
+    !defined(EFI32)
+    for (i = 0; i < iovcnt && iov[i].len == 0; i++) {
+        ;
+    }
+    if (i == iovcnt) {
+        return 0;
+    }
+
+    ret = (int) write(fd, iov[i].base, iov[i].len);
 #else
-        if (errno == EPIPE || errno == ECONNRESET) {
-            return MBEDTLS_ERR_NET_CONN_RESET;
-        }
+    /* The total must fit in the return value. */
+    for (i = 0; i < iovcnt && count < MBEDTLS_NET_SENDV_MAX_IOV; i++) {
+        size_t len = iov[i].len;
 
-        if (errno == EINTR) {
-            return MBEDTLS_ERR_SSL_WANT_WRITE;
+        if (len > (size_t) INT_MAX - total) {
+            len = (size_t) INT_MAX - total;
+        }
+        if (len == 0) {
+            continue;
         }
+
+        vec[count].iov_base = (void *) iov[i].base;
+        vec[count].iov_len = len;
+        count++;
+        total += len;
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    ret = (int) writev(fd, vec, (int) count);
 #endif
 
-        return MBEDTLS_ERR_NET_SEND_FAILED;
+    if (ret < 0) {
+        return net_send_error(ctx);
+    }
+
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_KTLS)
+#if defined(MBEDTLS_NET_HAVE_KTLS)
+/* Kernel description of one direction of a connection */
+typedef union {
+    struct tls_crypto_info info;
+    struct tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+    struct tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+    struct tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+} net_ktls_crypto;
+
+/*
+ * Translate exported record protection state into the kernel format.
+ * The nonce is salt || iv. For TLS 1.2 with AES-GCM, the kernel sends the
+ * explicit part (iv) in each record; start it at the sequence number like
+ * the SSL module does.
+ */
+static int net_ktls_crypto_info(const mbedtls_ssl_ktls_info *ktls,
+                                net_ktls_crypto *crypto, size_t *len)
+{
+    unsigned char *salt, *iv, *key, *rec_seq;
+    size_t salt_len, iv_len, key_len;
+
+    memset(crypto, 0, sizeof(*crypto));
+
+    switch (ktls->cipher) {
+        case MBEDTLS_CIPHER_AES_128_GCM:
+            crypto->info.cipher_type = TLS_CIPHER_AES_GCM_128;
+            salt = crypto->aes_gcm_128.salt;
+            iv = crypto->aes_gcm_128.iv;
+            key = crypto->aes_gcm_128.key;
+            rec_seq = crypto->aes_gcm_128.rec_seq;
+            salt_len = TLS_CIPHER_AES_GCM_128_SALT_SIZE;
+            iv_len = TLS_CIPHER_AES_GCM_128_IV_SIZE;
+            key_len = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+            *len = sizeof(crypto->aes_gcm_128);
+            break;
+        case MBEDTLS_CIPHER_AES_256_GCM:
+            crypto->info.cipher_type = TLS_CIPHER_AES_GCM_256;
+            salt = crypto->aes_gcm_256.salt;
+            iv = crypto->aes_gcm_256.iv;
+            key = crypto->aes_gcm_256.key;
+            rec_seq = crypto->aes_gcm_256.rec_seq;
+            salt_len = TLS_CIPHER_AES_GCM_256_SALT_SIZE;
+            iv_len = TLS_CIPHER_AES_GCM_256_IV_SIZE;
+            key_len = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+            *len = sizeof(crypto->aes_gcm_256);
+            break;
+        case MBEDTLS_CIPHER_CHACHA20_POLY1305:
+            crypto->info.cipher_type = TLS_CIPHER_CHACHA20_POLY1305;
+            salt = crypto->chacha20_poly1305.salt;
+            iv = crypto->chacha20_poly1305.iv;
+            key = crypto->chacha20_poly1305.key;
+            rec_seq = crypto->chacha20_poly1305.rec_seq;
+            salt_len = TLS_CIPHER_CHACHA20_POLY1305_SALT_SIZE;
+            iv_len = TLS_CIPHER_CHACHA20_POLY1305_IV_SIZE;
+            key_len = TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE;
+            *len = sizeof(crypto->chacha20_poly1305);
+            break;
+        default:
+            return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    if (ktls->tls_version == MBEDTLS_SSL_VERSION_TLS1_2) {
+        crypto->info.version = TLS_1_2_VERSION;
+    } else if (ktls->tls_version == MBEDTLS_SSL_VERSION_TLS1_3) {
+        crypto->info.version = TLS_1_3_VERSION;
+    } else {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    if (ktls->key_len != key_len) {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    if (ktls->iv_len == salt_len) {
+        /* TLS 1.2 AES-GCM: implicit salt, explicit nonce in each record */
+        memcpy(iv, ktls->rec_seq, iv_len);
+    } else if (ktls->iv_len == salt_len + iv_len) {
+        memcpy(iv, ktls->iv + salt_len, iv_len);
+    } else {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+    memcpy(salt, ktls->iv, salt_len);
+    memcpy(key, ktls->key, key_len);
+    memcpy(rec_seq, ktls->rec_seq, sizeof(ktls->rec_seq));
+
+    return 0;
+}
+#endif /* MBEDTLS_NET_HAVE_KTLS */
+
+/*
+ * Offload the record protection of a TLS connection to the kernel
+ */
+int mbedtls_net_ktls_enable(mbedtls_net_context *ctx,
+                            const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_NET_HAVE_KTLS)
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_ktls_info tx, rx;
+    net_ktls_crypto crypto_tx, crypto_rx;
+    size_t len_tx, len_rx;
+
+    ret = check_fd(ctx->fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if ((ret = mbedtls_ssl_export_ktls_info(ssl, MBEDTLS_SSL_KTLS_TX,
+                                            &tx)) != 0 ||
+        (ret = mbedtls_ssl_export_ktls_info(ssl, MBEDTLS_SSL_KTLS_RX,
+                                            &rx)) != 0 ||
+        (ret = net_ktls_crypto_info(&tx, &crypto_tx, &len_tx)) != 0 ||
+        (ret = net_ktls_crypto_info(&rx, &crypto_rx, &len_rx)) != 0) {
+        goto exit;
+    }
+
+    /* Fails with ENOENT if the tls module is not available, and leaves
+     * the socket as it was. */
+    if (setsockopt(ctx->fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) != 0) {
+        ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+        goto exit;
+    }
+
+    if (setsockopt(ctx->fd, SOL_TLS, TLS_TX, &crypto_tx, (socklen_t) len_tx) != 0 ||
+        setsockopt(ctx->fd, SOL_TLS, TLS_RX, &crypto_rx, (socklen_t) len_rx) != 0) {
+        ret = MBEDTLS_ERR_NET_SOCKET_FAILED;
+        goto exit;
+    }
+
+    ret = 0;
+
+exit:
+    mbedtls_platform_zeroize(&tx, sizeof(tx));
+    mbedtls_platform_zeroize(&rx, sizeof(rx));
+    mbedtls_platform_zeroize(&crypto_tx, sizeof(crypto_tx));
+    mbedtls_platform_zeroize(&crypto_rx, sizeof(crypto_rx));
+    return ret;
+#else
+    (void) ctx;
+    (void) ssl;
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif /* MBEDTLS_NET_HAVE_KTLS */
+}
+
+/*
+ * Send a record of a given type through kTLS
+ */
+int mbedtls_net_ktls_send_record(mbedtls_net_context *ctx,
+                                 unsigned char record_type,
+                                 const unsigned char *buf, size_t len)
+{
+#if defined(MBEDTLS_NET_HAVE_KTLS)
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    union {
+        struct cmsghdr align;
+        unsigned char buf[CMSG_SPACE(sizeof(unsigned char))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+
+    ret = check_fd(ctx->fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (len > INT_MAX) {
+        return MBEDTLS_ERR_NET_BAD_INPUT_DATA;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    vec.iov_base = (void *) buf;
+    vec.iov_len = len;
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_TLS;
+    cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+    *CMSG_DATA(cmsg) = record_type;
+
+    ret = (int) sendmsg(ctx->fd, &msg, 0);
+
+    if (ret < 0) {
+        return net_send_error(ctx);
     }
 
     return ret;
+#else
+    (void) ctx;
+    (void) record_type;
+    (void) buf;
+    (void) len;
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif /* MBEDTLS_NET_HAVE_KTLS */
+}
+
+/*
+ * Receive data and its record type through kTLS
+ */
+int mbedtls_net_ktls_recv_record(mbedtls_net_context *ctx,
+                                 unsigned char *record_type,
+                                 unsigned char *buf, size_t len)
+{
+#if defined(MBEDTLS_NET_HAVE_KTLS)
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    union {
+        struct cmsghdr align;
+        unsigned char buf[CMSG_SPACE(sizeof(unsigned char))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec vec;
+
+    ret = check_fd(ctx->fd, 0);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (len > INT_MAX) {
+        len = INT_MAX;
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    memset(&control, 0, sizeof(control));
+    vec.iov_base = buf;
+    vec.iov_len = len;
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    ret = (int) recvmsg(ctx->fd, &msg, 0);
+
+    if (ret < 0) {
+        return net_recv_error(ctx);
+    }
+
+    /* Application data comes without a record type. */
+    *record_type = MBEDTLS_SSL_MSG_APPLICATION_DATA;
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_TLS &&
+            cmsg->cmsg_type == TLS_GET_RECORD_TYPE) {
+            *record_type = *CMSG_DATA(cmsg);
+        }
+    }
+
+    return ret;
+#else
+    (void) ctx;
+    (void) record_type;
+    (void) buf;
+    (void) len;
+    return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif /* MBEDTLS_NET_HAVE_KTLS */
 }
+#endif /* MBEDTLS_SSL_KTLS */
 
 /*
  * Close the connection
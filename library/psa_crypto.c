@@ -29,12 +29,14 @@
 #include "psa/crypto.h"
 #include "psa/crypto_values.h"
 
+#include "psa_crypto_aead.h"
 #include "psa_crypto_cipher.h"
 #include "psa_crypto_core.h"
 #include "psa_crypto_invasive.h"
 #include "psa_crypto_driver_wrappers.h"
 #include "psa_crypto_ecp.h"
 #include "psa_crypto_hash.h"
+#include "psa_crypto_key_cache.h"
 #include "psa_crypto_mac.h"
 #include "psa_crypto_rsa.h"
 #include "psa_crypto_ecp.h"
@@ -1042,6 +1044,11 @@ static psa_status_t psa_get_and_lock_transparent_key_slot_with_policy(
 
 psa_status_t psa_remove_key_data_from_memory(psa_key_slot_t *slot)
 {
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE)
+    /* The cached context is derived from the key material. */
+    psa_key_cache_free(slot);
+#endif
+
     /* Data pointer will always be either a valid pointer or NULL in an
      * initialized slot, so we can just free it. */
     if (slot->key.data != NULL) {
@@ -2661,12 +2668,24 @@ static psa_status_t psa_mac_compute_internal(mbedtls_svc_key_id_t key,
         goto exit;
     }
 
-    status = psa_driver_wrapper_mac_compute(
-        &attributes,
-        slot->key.data, slot->key.bytes,
-        alg,
-        input, input_length,
-        mac, operation_mac_size, mac_length);
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && defined(MBEDTLS_PSA_BUILTIN_MAC)
+    mbedtls_psa_mac_prepared_t *prepared =
+        psa_key_cache_get_mac(slot, alg);
+    if (prepared != NULL) {
+        status = mbedtls_psa_mac_compute_prepared(
+            prepared,
+            input, input_length,
+            mac, operation_mac_size, mac_length);
+    } else
+#endif
+    {
+        status = psa_driver_wrapper_mac_compute(
+            &attributes,
+            slot->key.data, slot->key.bytes,
+            alg,
+            input, input_length,
+            mac, operation_mac_size, mac_length);
+    }
 
 exit:
     /* In case of success, set the potential excess room in the output buffer
@@ -4251,11 +4270,23 @@ psa_status_t psa_cipher_encrypt(mbedtls_svc_key_id_t key,
         }
     }
 
-    status = psa_driver_wrapper_cipher_encrypt(
-        &attributes, slot->key.data, slot->key.bytes,
-        alg, local_iv, default_iv_length, input, input_length,
-        mbedtls_buffer_offset(output, default_iv_length),
-        output_size - default_iv_length, output_length);
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+    mbedtls_psa_cipher_operation_t *prepared =
+        psa_key_cache_get_cipher(slot, alg, 1);
+    if (prepared != NULL) {
+        status = mbedtls_psa_cipher_encrypt_prepared(
+            prepared, local_iv, default_iv_length, input, input_length,
+            mbedtls_buffer_offset(output, default_iv_length),
+            output_size - default_iv_length, output_length);
+    } else
+#endif
+    {
+        status = psa_driver_wrapper_cipher_encrypt(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg, local_iv, default_iv_length, input, input_length,
+            mbedtls_buffer_offset(output, default_iv_length),
+            output_size - default_iv_length, output_length);
+    }
 
 exit:
     unlock_status = psa_unlock_key_slot(slot);
@@ -4312,10 +4343,21 @@ psa_status_t psa_cipher_decrypt(mbedtls_svc_key_id_t key,
         goto exit;
     }
 
-    status = psa_driver_wrapper_cipher_decrypt(
-        &attributes, slot->key.data, slot->key.bytes,
-        alg, input, input_length,
-        output, output_size, output_length);
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+    mbedtls_psa_cipher_operation_t *prepared =
+        psa_key_cache_get_cipher(slot, alg, 0);
+    if (prepared != NULL) {
+        status = mbedtls_psa_cipher_decrypt_prepared(
+            prepared, input, input_length,
+            output, output_size, output_length);
+    } else
+#endif
+    {
+        status = psa_driver_wrapper_cipher_decrypt(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg, input, input_length,
+            output, output_size, output_length);
+    }
 
 exit:
     unlock_status = psa_unlock_key_slot(slot);
@@ -4431,13 +4473,27 @@ psa_status_t psa_aead_encrypt(mbedtls_svc_key_id_t key,
         goto exit;
     }
 
-    status = psa_driver_wrapper_aead_encrypt(
-        &attributes, slot->key.data, slot->key.bytes,
-        alg,
-        nonce, nonce_length,
-        additional_data, additional_data_length,
-        plaintext, plaintext_length,
-        ciphertext, ciphertext_size, ciphertext_length);
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && defined(MBEDTLS_PSA_BUILTIN_AEAD)
+    mbedtls_psa_aead_operation_t *prepared =
+        psa_key_cache_get_aead(slot, alg);
+    if (prepared != NULL) {
+        status = mbedtls_psa_aead_encrypt_prepared(
+            prepared,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            plaintext, plaintext_length,
+            ciphertext, ciphertext_size, ciphertext_length);
+    } else
+#endif
+    {
+        status = psa_driver_wrapper_aead_encrypt(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            plaintext, plaintext_length,
+            ciphertext, ciphertext_size, ciphertext_length);
+    }
 
     if (status != PSA_SUCCESS && ciphertext_size != 0) {
         memset(ciphertext, 0, ciphertext_size);
@@ -4486,13 +4542,27 @@ psa_status_t psa_aead_decrypt(mbedtls_svc_key_id_t key,
         goto exit;
     }
 
-    status = psa_driver_wrapper_aead_decrypt(
-        &attributes, slot->key.data, slot->key.bytes,
-        alg,
-        nonce, nonce_length,
-        additional_data, additional_data_length,
-        ciphertext, ciphertext_length,
-        plaintext, plaintext_size, plaintext_length);
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE) && defined(MBEDTLS_PSA_BUILTIN_AEAD)
+    mbedtls_psa_aead_operation_t *prepared =
+        psa_key_cache_get_aead(slot, alg);
+    if (prepared != NULL) {
+        status = mbedtls_psa_aead_decrypt_prepared(
+            prepared,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            ciphertext, ciphertext_length,
+            plaintext, plaintext_size, plaintext_length);
+    } else
+#endif
+    {
+        status = psa_driver_wrapper_aead_decrypt(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            ciphertext, ciphertext_length,
+            plaintext, plaintext_size, plaintext_length);
+    }
 
     if (status != PSA_SUCCESS && plaintext_size != 0) {
         memset(plaintext, 0, plaintext_size);
@@ -4504,6 +4574,108 @@ exit:
     return status;
 }
 
+/* Set the status of every entry of a batch, for errors that concern
+ * the whole batch rather than one message. */
+static void psa_aead_batch_set_status(psa_aead_batch_entry_t *entries,
+                                      size_t entry_count,
+                                      psa_status_t status)
+{
+    size_t i;
+
+    for (i = 0; i < entry_count; i++) {
+        entries[i].status = status;
+        entries[i].output_length = 0;
+    }
+}
+
+static psa_status_t psa_aead_batch(mbedtls_svc_key_id_t key,
+                                   psa_algorithm_t alg,
+                                   psa_aead_batch_entry_t *entries,
+                                   size_t entry_count,
+                                   int is_encrypt)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    psa_key_slot_t *slot;
+    psa_aead_batch_entry_t *entry;
+    size_t i;
+
+    status = psa_aead_check_algorithm(alg);
+    if (status != PSA_SUCCESS) {
+        psa_aead_batch_set_status(entries, entry_count, status);
+        return status;
+    }
+
+    status = psa_get_and_lock_key_slot_with_policy(
+        key, &slot,
+        is_encrypt ? PSA_KEY_USAGE_ENCRYPT : PSA_KEY_USAGE_DECRYPT,
+        alg);
+    if (status != PSA_SUCCESS) {
+        psa_aead_batch_set_status(entries, entry_count, status);
+        return status;
+    }
+
+    psa_key_attributes_t attributes = {
+        .core = slot->attr
+    };
+
+    /* Messages rejected here keep their error status and the driver
+     * layer skips them. */
+    for (i = 0; i < entry_count; i++) {
+        entries[i].output_length = 0;
+        entries[i].status = psa_aead_check_nonce_length(
+            alg, entries[i].nonce_length);
+    }
+
+    if (is_encrypt) {
+        status = psa_driver_wrapper_aead_encrypt_batch(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg, entries, entry_count);
+    } else {
+        status = psa_driver_wrapper_aead_decrypt_batch(
+            &attributes, slot->key.data, slot->key.bytes,
+            alg, entries, entry_count);
+    }
+    if (status != PSA_SUCCESS) {
+        psa_aead_batch_set_status(entries, entry_count, status);
+    }
+
+    for (i = 0; i < entry_count; i++) {
+        entry = &entries[i];
+        if (entry->status == PSA_SUCCESS) {
+            continue;
+        }
+        if (entry->output_size != 0) {
+            memset(entry->output, 0, entry->output_size);
+        }
+        entry->output_length = 0;
+        if (status == PSA_SUCCESS) {
+            status = entry->status;
+        }
+    }
+
+    psa_unlock_key_slot(slot);
+
+    return status;
+}
+
+psa_status_t psa_aead_encrypt_batch(
+    mbedtls_svc_key_id_t key,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries,
+    size_t entry_count)
+{
+    return psa_aead_batch(key, alg, entries, entry_count, 1);
+}
+
+psa_status_t psa_aead_decrypt_batch(
+    mbedtls_svc_key_id_t key,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries,
+    size_t entry_count)
+{
+    return psa_aead_batch(key, alg, entries, entry_count, 0);
+}
+
 static psa_status_t psa_validate_tag_length(psa_algorithm_t alg)
 {
     const uint8_t tag_len = PSA_ALG_AEAD_GET_TAG_LENGTH(alg);
@@ -7123,6 +7295,14 @@ void mbedtls_psa_crypto_free(void)
 
     /* Terminate drivers */
     psa_driver_wrapper_free();
+
+#if defined(MBEDTLS_PSA_ITS_JOURNAL_C)
+    /* Wipe cached copies of persistent keys */
+    mbedtls_psa_its_journal_close();
+#endif
+#if defined(MBEDTLS_PSA_ITS_MMAP_C)
+    mbedtls_psa_its_mmap_close();
+#endif
 }
 
 #if defined(PSA_CRYPTO_STORAGE_HAS_TRANSACTIONS)
@@ -130,66 +130,54 @@ static psa_status_t psa_aead_setup(
     return PSA_SUCCESS;
 }
 
-psa_status_t mbedtls_psa_aead_encrypt(
-    const psa_key_attributes_t *attributes,
-    const uint8_t *key_buffer, size_t key_buffer_size,
-    psa_algorithm_t alg,
+psa_status_t mbedtls_psa_aead_encrypt_prepared(
+    mbedtls_psa_aead_operation_t *operation,
     const uint8_t *nonce, size_t nonce_length,
     const uint8_t *additional_data, size_t additional_data_length,
     const uint8_t *plaintext, size_t plaintext_length,
     uint8_t *ciphertext, size_t ciphertext_size, size_t *ciphertext_length)
 {
     psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
-    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
     uint8_t *tag;
 
-    status = psa_aead_setup(&operation, attributes, key_buffer,
-                            key_buffer_size, alg);
-
-    if (status != PSA_SUCCESS) {
-        goto exit;
-    }
-
     /* For all currently supported modes, the tag is at the end of the
      * ciphertext. */
-    if (ciphertext_size < (plaintext_length + operation.tag_length)) {
-        status = PSA_ERROR_BUFFER_TOO_SMALL;
-        goto exit;
+    if (ciphertext_size < (plaintext_length + operation->tag_length)) {
+        return PSA_ERROR_BUFFER_TOO_SMALL;
     }
     tag = ciphertext + plaintext_length;
 
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_CCM)
-    if (operation.alg == PSA_ALG_CCM) {
+    if (operation->alg == PSA_ALG_CCM) {
         status = mbedtls_to_psa_error(
-            mbedtls_ccm_encrypt_and_tag(&operation.ctx.ccm,
+            mbedtls_ccm_encrypt_and_tag(&operation->ctx.ccm,
                                         plaintext_length,
                                         nonce, nonce_length,
                                         additional_data,
                                         additional_data_length,
                                         plaintext, ciphertext,
-                                        tag, operation.tag_length));
+                                        tag, operation->tag_length));
     } else
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_CCM */
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_GCM)
-    if (operation.alg == PSA_ALG_GCM) {
+    if (operation->alg == PSA_ALG_GCM) {
         status = mbedtls_to_psa_error(
-            mbedtls_gcm_crypt_and_tag(&operation.ctx.gcm,
+            mbedtls_gcm_crypt_and_tag(&operation->ctx.gcm,
                                       MBEDTLS_GCM_ENCRYPT,
                                       plaintext_length,
                                       nonce, nonce_length,
                                       additional_data, additional_data_length,
                                       plaintext, ciphertext,
-                                      operation.tag_length, tag));
+                                      operation->tag_length, tag));
     } else
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_GCM */
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_CHACHA20_POLY1305)
-    if (operation.alg == PSA_ALG_CHACHA20_POLY1305) {
-        if (operation.tag_length != 16) {
-            status = PSA_ERROR_NOT_SUPPORTED;
-            goto exit;
+    if (operation->alg == PSA_ALG_CHACHA20_POLY1305) {
+        if (operation->tag_length != 16) {
+            return PSA_ERROR_NOT_SUPPORTED;
         }
         status = mbedtls_to_psa_error(
-            mbedtls_chachapoly_encrypt_and_tag(&operation.ctx.chachapoly,
+            mbedtls_chachapoly_encrypt_and_tag(&operation->ctx.chachapoly,
                                                plaintext_length,
                                                nonce,
                                                additional_data,
@@ -210,7 +198,69 @@ psa_status_t mbedtls_psa_aead_encrypt(
     }
 
     if (status == PSA_SUCCESS) {
-        *ciphertext_length = plaintext_length + operation.tag_length;
+        *ciphertext_length = plaintext_length + operation->tag_length;
+    }
+
+    return status;
+}
+
+psa_status_t mbedtls_psa_aead_encrypt(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    const uint8_t *nonce, size_t nonce_length,
+    const uint8_t *additional_data, size_t additional_data_length,
+    const uint8_t *plaintext, size_t plaintext_length,
+    uint8_t *ciphertext, size_t ciphertext_size, size_t *ciphertext_length)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
+
+    status = psa_aead_setup(&operation, attributes, key_buffer,
+                            key_buffer_size, alg);
+
+    if (status == PSA_SUCCESS) {
+        status = mbedtls_psa_aead_encrypt_prepared(
+            &operation,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            plaintext, plaintext_length,
+            ciphertext, ciphertext_size, ciphertext_length);
+    }
+
+    mbedtls_psa_aead_abort(&operation);
+
+    return status;
+}
+
+psa_status_t mbedtls_psa_aead_encrypt_batch(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries, size_t entry_count)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
+    psa_aead_batch_entry_t *entry;
+    size_t i;
+
+    status = psa_aead_setup(&operation, attributes, key_buffer,
+                            key_buffer_size, alg);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+
+    for (i = 0; i < entry_count; i++) {
+        entry = &entries[i];
+        if (entry->status != PSA_SUCCESS) {
+            continue;
+        }
+        entry->status = mbedtls_psa_aead_encrypt_prepared(
+            &operation,
+            entry->nonce, entry->nonce_length,
+            entry->additional_data, entry->additional_data_length,
+            entry->input, entry->input_length,
+            entry->output, entry->output_size, &entry->output_length);
     }
 
 exit:
@@ -242,66 +292,55 @@ static psa_status_t psa_aead_unpadded_locate_tag(size_t tag_length,
     return PSA_SUCCESS;
 }
 
-psa_status_t mbedtls_psa_aead_decrypt(
-    const psa_key_attributes_t *attributes,
-    const uint8_t *key_buffer, size_t key_buffer_size,
-    psa_algorithm_t alg,
+psa_status_t mbedtls_psa_aead_decrypt_prepared(
+    mbedtls_psa_aead_operation_t *operation,
     const uint8_t *nonce, size_t nonce_length,
     const uint8_t *additional_data, size_t additional_data_length,
     const uint8_t *ciphertext, size_t ciphertext_length,
     uint8_t *plaintext, size_t plaintext_size, size_t *plaintext_length)
 {
     psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
-    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
     const uint8_t *tag = NULL;
 
-    status = psa_aead_setup(&operation, attributes, key_buffer,
-                            key_buffer_size, alg);
-
-    if (status != PSA_SUCCESS) {
-        goto exit;
-    }
-
-    status = psa_aead_unpadded_locate_tag(operation.tag_length,
+    status = psa_aead_unpadded_locate_tag(operation->tag_length,
                                           ciphertext, ciphertext_length,
                                           plaintext_size, &tag);
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_CCM)
-    if (operation.alg == PSA_ALG_CCM) {
+    if (operation->alg == PSA_ALG_CCM) {
         status = mbedtls_to_psa_error(
-            mbedtls_ccm_auth_decrypt(&operation.ctx.ccm,
-                                     ciphertext_length - operation.tag_length,
+            mbedtls_ccm_auth_decrypt(&operation->ctx.ccm,
+                                     ciphertext_length - operation->tag_length,
                                      nonce, nonce_length,
                                      additional_data,
                                      additional_data_length,
                                      ciphertext, plaintext,
-                                     tag, operation.tag_length));
+                                     tag, operation->tag_length));
     } else
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_CCM */
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_GCM)
-    if (operation.alg == PSA_ALG_GCM) {
+    if (operation->alg == PSA_ALG_GCM) {
         status = mbedtls_to_psa_error(
-            mbedtls_gcm_auth_decrypt(&operation.ctx.gcm,
-                                     ciphertext_length - operation.tag_length,
+            mbedtls_gcm_auth_decrypt(&operation->ctx.gcm,
+                                     ciphertext_length - operation->tag_length,
                                      nonce, nonce_length,
                                      additional_data,
                                      additional_data_length,
-                                     tag, operation.tag_length,
+                                     tag, operation->tag_length,
                                      ciphertext, plaintext));
     } else
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_GCM */
 #if defined(MBEDTLS_PSA_BUILTIN_ALG_CHACHA20_POLY1305)
-    if (operation.alg == PSA_ALG_CHACHA20_POLY1305) {
-        if (operation.tag_length != 16) {
-            status = PSA_ERROR_NOT_SUPPORTED;
-            goto exit;
+    if (operation->alg == PSA_ALG_CHACHA20_POLY1305) {
+        if (operation->tag_length != 16) {
+            return PSA_ERROR_NOT_SUPPORTED;
         }
         status = mbedtls_to_psa_error(
-            mbedtls_chachapoly_auth_decrypt(&operation.ctx.chachapoly,
-                                            ciphertext_length - operation.tag_length,
+            mbedtls_chachapoly_auth_decrypt(&operation->ctx.chachapoly,
+                                            ciphertext_length - operation->tag_length,
                                             nonce,
                                             additional_data,
                                             additional_data_length,
@@ -311,6 +350,7 @@ psa_status_t mbedtls_psa_aead_decrypt(
     } else
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_CHACHA20_POLY1305 */
     {
+        (void) tag;
         (void) nonce;
         (void) nonce_length;
         (void) additional_data;
@@ -320,15 +360,74 @@ psa_status_t mbedtls_psa_aead_decrypt(
     }
 
     if (status == PSA_SUCCESS) {
-        *plaintext_length = ciphertext_length - operation.tag_length;
+        *plaintext_length = ciphertext_length - operation->tag_length;
     }
 
-exit:
-    mbedtls_psa_aead_abort(&operation);
+    return status;
+}
+
+psa_status_t mbedtls_psa_aead_decrypt(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    const uint8_t *nonce, size_t nonce_length,
+    const uint8_t *additional_data, size_t additional_data_length,
+    const uint8_t *ciphertext, size_t ciphertext_length,
+    uint8_t *plaintext, size_t plaintext_size, size_t *plaintext_length)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
+
+    status = psa_aead_setup(&operation, attributes, key_buffer,
+                            key_buffer_size, alg);
 
     if (status == PSA_SUCCESS) {
-        *plaintext_length = ciphertext_length - operation.tag_length;
+        status = mbedtls_psa_aead_decrypt_prepared(
+            &operation,
+            nonce, nonce_length,
+            additional_data, additional_data_length,
+            ciphertext, ciphertext_length,
+            plaintext, plaintext_size, plaintext_length);
     }
+
+    mbedtls_psa_aead_abort(&operation);
+
+    return status;
+}
+
+psa_status_t mbedtls_psa_aead_decrypt_batch(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries, size_t entry_count)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_aead_operation_t operation = MBEDTLS_PSA_AEAD_OPERATION_INIT;
+    psa_aead_batch_entry_t *entry;
+    size_t i;
+
+    status = psa_aead_setup(&operation, attributes, key_buffer,
+                            key_buffer_size, alg);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+
+    for (i = 0; i < entry_count; i++) {
+        entry = &entries[i];
+        if (entry->status != PSA_SUCCESS) {
+            continue;
+        }
+        entry->status = mbedtls_psa_aead_decrypt_prepared(
+            &operation,
+            entry->nonce, entry->nonce_length,
+            entry->additional_data, entry->additional_data_length,
+            entry->input, entry->input_length,
+            entry->output, entry->output_size, &entry->output_length);
+    }
+
+exit:
+    mbedtls_psa_aead_abort(&operation);
+
     return status;
 }
 
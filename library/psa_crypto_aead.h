@@ -148,6 +148,132 @@ psa_status_t mbedtls_psa_aead_decrypt(
     const uint8_t *ciphertext, size_t ciphertext_length,
     uint8_t *plaintext, size_t plaintext_size, size_t *plaintext_length);
 
+/**
+ * \brief Encrypt a message with an operation that is already set up.
+ *
+ * This function does the work of mbedtls_psa_aead_encrypt() after the key
+ * setup. It does not change the key state of \p operation, so the same
+ * operation can encrypt further messages.
+ *
+ * \param[in,out] operation       An operation set up by
+ *                                mbedtls_psa_aead_encrypt_setup() or
+ *                                mbedtls_psa_aead_decrypt_setup(), on which
+ *                                no multipart function has been called.
+ * \param[in]  nonce              Nonce or IV to use.
+ * \param      nonce_length       Size of the nonce buffer in bytes.
+ * \param[in]  additional_data    Additional data that will be authenticated
+ *                                but not encrypted.
+ * \param      additional_data_length  Size of additional_data in bytes.
+ * \param[in]  plaintext          Data that will be authenticated and encrypted.
+ * \param      plaintext_length   Size of plaintext in bytes.
+ * \param[out] ciphertext         Output buffer for the authenticated and
+ *                                encrypted data, followed by the tag.
+ * \param      ciphertext_size    Size of the ciphertext buffer in bytes.
+ * \param[out] ciphertext_length  On success, the size of the output in the
+ *                                ciphertext buffer.
+ *
+ * \return The same status codes as mbedtls_psa_aead_encrypt().
+ */
+psa_status_t mbedtls_psa_aead_encrypt_prepared(
+    mbedtls_psa_aead_operation_t *operation,
+    const uint8_t *nonce, size_t nonce_length,
+    const uint8_t *additional_data, size_t additional_data_length,
+    const uint8_t *plaintext, size_t plaintext_length,
+    uint8_t *ciphertext, size_t ciphertext_size, size_t *ciphertext_length);
+
+/**
+ * \brief Decrypt a message with an operation that is already set up.
+ *
+ * This function does the work of mbedtls_psa_aead_decrypt() after the key
+ * setup. It does not change the key state of \p operation, so the same
+ * operation can decrypt further messages.
+ *
+ * \param[in,out] operation       An operation set up by
+ *                                mbedtls_psa_aead_encrypt_setup() or
+ *                                mbedtls_psa_aead_decrypt_setup(), on which
+ *                                no multipart function has been called.
+ * \param[in]  nonce              Nonce or IV to use.
+ * \param      nonce_length       Size of the nonce buffer in bytes.
+ * \param[in]  additional_data    Additional data that has been authenticated
+ *                                but not encrypted.
+ * \param      additional_data_length  Size of additional_data in bytes.
+ * \param[in]  ciphertext         Encrypted data followed by the tag.
+ * \param      ciphertext_length  Size of ciphertext in bytes.
+ * \param[out] plaintext          Output buffer for the decrypted data.
+ * \param      plaintext_size     Size of the plaintext buffer in bytes.
+ * \param[out] plaintext_length   On success, the size of the output in the
+ *                                plaintext buffer.
+ *
+ * \return The same status codes as mbedtls_psa_aead_decrypt().
+ */
+psa_status_t mbedtls_psa_aead_decrypt_prepared(
+    mbedtls_psa_aead_operation_t *operation,
+    const uint8_t *nonce, size_t nonce_length,
+    const uint8_t *additional_data, size_t additional_data_length,
+    const uint8_t *ciphertext, size_t ciphertext_length,
+    uint8_t *plaintext, size_t plaintext_size, size_t *plaintext_length);
+
+/**
+ * \brief Encrypt many messages with the same key.
+ *
+ * The key is set up once and each entry is processed as by
+ * mbedtls_psa_aead_encrypt(). Entries whose \c status is not
+ * #PSA_SUCCESS on entry are skipped: the core uses this to leave out
+ * messages that it has already rejected.
+ *
+ * \param[in]  attributes         The attributes of the key to use for the
+ *                                operation.
+ * \param[in]  key_buffer         The buffer containing the key context.
+ * \param      key_buffer_size    Size of the \p key_buffer buffer in bytes.
+ * \param      alg                The AEAD algorithm to compute.
+ * \param[in,out] entries         The messages to encrypt. The \c status
+ *                                and \c output_length of each processed
+ *                                entry are updated.
+ * \param      entry_count        Number of elements in \p entries.
+ *
+ * \retval #PSA_SUCCESS
+ *         The key was set up. The result of each message is in its entry.
+ * \retval #PSA_ERROR_NOT_SUPPORTED
+ *         \p alg is not supported. No entry was processed.
+ * \retval #PSA_ERROR_INSUFFICIENT_MEMORY \emptydescription
+ * \retval #PSA_ERROR_CORRUPTION_DETECTED \emptydescription
+ */
+psa_status_t mbedtls_psa_aead_encrypt_batch(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries, size_t entry_count);
+
+/**
+ * \brief Decrypt many messages with the same key.
+ *
+ * This is the decryption counterpart of mbedtls_psa_aead_encrypt_batch().
+ * Each processed entry gets the status that mbedtls_psa_aead_decrypt()
+ * would return for it.
+ *
+ * \param[in]  attributes         The attributes of the key to use for the
+ *                                operation.
+ * \param[in]  key_buffer         The buffer containing the key context.
+ * \param      key_buffer_size    Size of the \p key_buffer buffer in bytes.
+ * \param      alg                The AEAD algorithm to compute.
+ * \param[in,out] entries         The messages to decrypt. The \c status
+ *                                and \c output_length of each processed
+ *                                entry are updated.
+ * \param      entry_count        Number of elements in \p entries.
+ *
+ * \retval #PSA_SUCCESS
+ *         The key was set up. The result of each message is in its entry.
+ * \retval #PSA_ERROR_NOT_SUPPORTED
+ *         \p alg is not supported. No entry was processed.
+ * \retval #PSA_ERROR_INSUFFICIENT_MEMORY \emptydescription
+ * \retval #PSA_ERROR_CORRUPTION_DETECTED \emptydescription
+ */
+psa_status_t mbedtls_psa_aead_decrypt_batch(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer, size_t key_buffer_size,
+    psa_algorithm_t alg,
+    psa_aead_batch_entry_t *entries, size_t entry_count);
+
 /** Set the key for a multipart authenticated encryption operation.
  *
  *  \note The signature of this function is that of a PSA driver
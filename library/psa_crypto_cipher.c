@@ -484,11 +484,8 @@ psa_status_t mbedtls_psa_cipher_abort(
     return PSA_SUCCESS;
 }
 
-psa_status_t mbedtls_psa_cipher_encrypt(
-    const psa_key_attributes_t *attributes,
-    const uint8_t *key_buffer,
-    size_t key_buffer_size,
-    psa_algorithm_t alg,
+psa_status_t mbedtls_psa_cipher_encrypt_prepared(
+    mbedtls_psa_cipher_operation_t *operation,
     const uint8_t *iv,
     size_t iv_length,
     const uint8_t *input,
@@ -498,55 +495,44 @@ psa_status_t mbedtls_psa_cipher_encrypt(
     size_t *output_length)
 {
     psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
-    mbedtls_psa_cipher_operation_t operation = MBEDTLS_PSA_CIPHER_OPERATION_INIT;
     size_t update_output_length, finish_output_length;
 
-    status = mbedtls_psa_cipher_encrypt_setup(&operation, attributes,
-                                              key_buffer, key_buffer_size,
-                                              alg);
+    /* Forget any leftover of a previous message. */
+    status = mbedtls_to_psa_error(
+        mbedtls_cipher_reset(&operation->ctx.cipher));
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
     if (iv_length > 0) {
-        status = mbedtls_psa_cipher_set_iv(&operation, iv, iv_length);
+        status = mbedtls_psa_cipher_set_iv(operation, iv, iv_length);
         if (status != PSA_SUCCESS) {
-            goto exit;
+            return status;
         }
     }
 
-    status = mbedtls_psa_cipher_update(&operation, input, input_length,
+    status = mbedtls_psa_cipher_update(operation, input, input_length,
                                        output, output_size,
                                        &update_output_length);
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
     status = mbedtls_psa_cipher_finish(
-        &operation,
+        operation,
         mbedtls_buffer_offset(output, update_output_length),
         output_size - update_output_length, &finish_output_length);
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
     *output_length = update_output_length + finish_output_length;
 
-exit:
-    if (status == PSA_SUCCESS) {
-        status = mbedtls_psa_cipher_abort(&operation);
-    } else {
-        mbedtls_psa_cipher_abort(&operation);
-    }
-
-    return status;
+    return PSA_SUCCESS;
 }
 
-psa_status_t mbedtls_psa_cipher_decrypt(
-    const psa_key_attributes_t *attributes,
-    const uint8_t *key_buffer,
-    size_t key_buffer_size,
-    psa_algorithm_t alg,
+psa_status_t mbedtls_psa_cipher_decrypt_prepared(
+    mbedtls_psa_cipher_operation_t *operation,
     const uint8_t *input,
     size_t input_length,
     uint8_t *output,
@@ -554,45 +540,112 @@ psa_status_t mbedtls_psa_cipher_decrypt(
     size_t *output_length)
 {
     psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
-    mbedtls_psa_cipher_operation_t operation = MBEDTLS_PSA_CIPHER_OPERATION_INIT;
     size_t olength, accumulated_length;
 
-    status = mbedtls_psa_cipher_decrypt_setup(&operation, attributes,
-                                              key_buffer, key_buffer_size,
-                                              alg);
+    /* Forget any leftover of a previous message. */
+    status = mbedtls_to_psa_error(
+        mbedtls_cipher_reset(&operation->ctx.cipher));
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
-    if (operation.iv_length > 0) {
-        status = mbedtls_psa_cipher_set_iv(&operation,
-                                           input, operation.iv_length);
+    if (operation->iv_length > 0) {
+        status = mbedtls_psa_cipher_set_iv(operation,
+                                           input, operation->iv_length);
         if (status != PSA_SUCCESS) {
-            goto exit;
+            return status;
         }
     }
 
     status = mbedtls_psa_cipher_update(
-        &operation,
-        mbedtls_buffer_offset_const(input, operation.iv_length),
-        input_length - operation.iv_length,
+        operation,
+        mbedtls_buffer_offset_const(input, operation->iv_length),
+        input_length - operation->iv_length,
         output, output_size, &olength);
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
     accumulated_length = olength;
 
     status = mbedtls_psa_cipher_finish(
-        &operation,
+        operation,
         mbedtls_buffer_offset(output, accumulated_length),
         output_size - accumulated_length, &olength);
     if (status != PSA_SUCCESS) {
-        goto exit;
+        return status;
     }
 
     *output_length = accumulated_length + olength;
 
+    return PSA_SUCCESS;
+}
+
+psa_status_t mbedtls_psa_cipher_encrypt(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer,
+    size_t key_buffer_size,
+    psa_algorithm_t alg,
+    const uint8_t *iv,
+    size_t iv_length,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *output,
+    size_t output_size,
+    size_t *output_length)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_cipher_operation_t operation = MBEDTLS_PSA_CIPHER_OPERATION_INIT;
+
+    status = mbedtls_psa_cipher_encrypt_setup(&operation, attributes,
+                                              key_buffer, key_buffer_size,
+                                              alg);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+
+    status = mbedtls_psa_cipher_encrypt_prepared(&operation,
+                                                 iv, iv_length,
+                                                 input, input_length,
+                                                 output, output_size,
+                                                 output_length);
+
+exit:
+    if (status == PSA_SUCCESS) {
+        status = mbedtls_psa_cipher_abort(&operation);
+    } else {
+        mbedtls_psa_cipher_abort(&operation);
+    }
+
+    return status;
+}
+
+psa_status_t mbedtls_psa_cipher_decrypt(
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer,
+    size_t key_buffer_size,
+    psa_algorithm_t alg,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *output,
+    size_t output_size,
+    size_t *output_length)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    mbedtls_psa_cipher_operation_t operation = MBEDTLS_PSA_CIPHER_OPERATION_INIT;
+
+    status = mbedtls_psa_cipher_decrypt_setup(&operation, attributes,
+                                              key_buffer, key_buffer_size,
+                                              alg);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+
+    status = mbedtls_psa_cipher_decrypt_prepared(&operation,
+                                                 input, input_length,
+                                                 output, output_size,
+                                                 output_length);
+
 exit:
     if (status == PSA_SUCCESS) {
         status = mbedtls_psa_cipher_abort(&operation);
@@ -302,4 +302,58 @@ psa_status_t mbedtls_psa_cipher_decrypt(const psa_key_attributes_t *attributes,
                                         size_t output_size,
                                         size_t *output_length);
 
+/** Encrypt a message with an operation that is already set up.
+ *
+ * This function does the work of mbedtls_psa_cipher_encrypt() after the
+ * key setup. The operation stays set up with the same key afterwards, so
+ * it can encrypt further messages.
+ *
+ * \param[in,out] operation     An operation set up by
+ *                              mbedtls_psa_cipher_encrypt_setup().
+ * \param[in] iv                Buffer containing the IV for encryption.
+ * \param[in] iv_length         Size of the \p iv in bytes.
+ * \param[in] input             Buffer containing the message to encrypt.
+ * \param[in] input_length      Size of the \p input buffer in bytes.
+ * \param[out] output           Buffer where the output is to be written.
+ * \param[in]  output_size      Size of the \p output buffer in bytes.
+ * \param[out] output_length    On success, the number of bytes that make up
+ *                              the returned output.
+ *
+ * \return The same status codes as mbedtls_psa_cipher_encrypt().
+ */
+psa_status_t mbedtls_psa_cipher_encrypt_prepared(
+    mbedtls_psa_cipher_operation_t *operation,
+    const uint8_t *iv,
+    size_t iv_length,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *output,
+    size_t output_size,
+    size_t *output_length);
+
+/** Decrypt a message with an operation that is already set up.
+ *
+ * This function does the work of mbedtls_psa_cipher_decrypt() after the
+ * key setup. The operation stays set up with the same key afterwards, so
+ * it can decrypt further messages.
+ *
+ * \param[in,out] operation     An operation set up by
+ *                              mbedtls_psa_cipher_decrypt_setup().
+ * \param[in]  input            Buffer containing the iv and the ciphertext.
+ * \param[in]  input_length     Size of the \p input buffer in bytes.
+ * \param[out] output           Buffer where the output is to be written.
+ * \param[in]  output_size      Size of the \p output buffer in bytes.
+ * \param[out] output_length    On success, the number of bytes that make up
+ *                              the returned output.
+ *
+ * \return The same status codes as mbedtls_psa_cipher_decrypt().
+ */
+psa_status_t mbedtls_psa_cipher_decrypt_prepared(
+    mbedtls_psa_cipher_operation_t *operation,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *output,
+    size_t output_size,
+    size_t *output_length);
+
 #endif /* PSA_CRYPTO_CIPHER_H */
@@ -96,6 +96,12 @@ typedef struct {
         uint8_t *data;
         size_t bytes;
     } key;
+
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE)
+    /* Built-in operation set up with this key for its last one-shot
+     * cipher, AEAD or MAC use, or NULL. See psa_crypto_key_cache.h. */
+    struct psa_key_cache_entry_s *cache;
+#endif
 } psa_key_slot_t;
 
 /* A mask of key attribute flags used only internally.
@@ -0,0 +1,242 @@
+/*
+ *  PSA crypto layer on top of Mbed TLS crypto: per-key cache of prepared
+ *  cipher, AEAD and MAC contexts
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_PSA_CRYPTO_C) && defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE)
+
+#include "psa_crypto_key_cache.h"
+#include "psa_crypto_aead.h"
+#include "psa_crypto_cipher.h"
+#include "psa_crypto_mac.h"
+
+#include <string.h>
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+/* What a cache entry holds. The direction matters for block cipher modes
+ * such as CBC, whose key schedule differs for encryption and decryption. */
+typedef enum {
+    PSA_KEY_CACHE_AEAD = 1,
+    PSA_KEY_CACHE_CIPHER_ENCRYPT,
+    PSA_KEY_CACHE_CIPHER_DECRYPT,
+    PSA_KEY_CACHE_MAC,
+} psa_key_cache_kind_t;
+
+struct psa_key_cache_entry_s {
+    psa_key_cache_kind_t kind;
+    psa_algorithm_t alg;
+    union {
+        unsigned dummy; /* Make the union non-empty with no algorithm. */
+#if defined(MBEDTLS_PSA_BUILTIN_AEAD)
+        mbedtls_psa_aead_operation_t aead;
+#endif
+#if defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+        mbedtls_psa_cipher_operation_t cipher;
+#endif
+#if defined(MBEDTLS_PSA_BUILTIN_MAC)
+        mbedtls_psa_mac_prepared_t mac;
+#endif
+    } op;
+};
+
+/* Bytes of the budget in use. Each entry counts for the size of its
+ * structure, which holds the whole context for hash-based MACs, including
+ * both HMAC hash states. The contexts built on a block cipher also
+ * allocate the cipher's key schedule on the heap, which is not accounted
+ * for. */
+static size_t psa_key_cache_usage = 0;
+
+static void psa_key_cache_release(struct psa_key_cache_entry_s *entry)
+{
+    switch (entry->kind) {
+#if defined(MBEDTLS_PSA_BUILTIN_AEAD)
+        case PSA_KEY_CACHE_AEAD:
+            mbedtls_psa_aead_abort(&entry->op.aead);
+            break;
+#endif
+#if defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+        case PSA_KEY_CACHE_CIPHER_ENCRYPT:
+        case PSA_KEY_CACHE_CIPHER_DECRYPT:
+            mbedtls_psa_cipher_abort(&entry->op.cipher);
+            break;
+#endif
+#if defined(MBEDTLS_PSA_BUILTIN_MAC)
+        case PSA_KEY_CACHE_MAC:
+            mbedtls_psa_mac_prepared_abort(&entry->op.mac);
+            break;
+#endif
+        default:
+            break;
+    }
+    mbedtls_platform_zeroize(entry, sizeof(*entry));
+    mbedtls_free(entry);
+}
+
+void psa_key_cache_free(psa_key_slot_t *slot)
+{
+    if (slot->cache == NULL) {
+        return;
+    }
+    psa_key_cache_release(slot->cache);
+    slot->cache = NULL;
+    psa_key_cache_usage -= sizeof(struct psa_key_cache_entry_s);
+}
+
+size_t psa_key_cache_get_usage(void)
+{
+    return psa_key_cache_usage;
+}
+
+/* Return the entry of the slot if it matches, otherwise evict it and
+ * return a blank entry for the caller to set up, or NULL if the key can't
+ * be cached. Set *is_new to tell the two cases apart. */
+static struct psa_key_cache_entry_s *psa_key_cache_lookup(
+    psa_key_slot_t *slot,
+    psa_key_cache_kind_t kind,
+    psa_algorithm_t alg,
+    int *is_new)
+{
+    struct psa_key_cache_entry_s *entry = slot->cache;
+
+    *is_new = 0;
+    if (entry != NULL && entry->kind == kind && entry->alg == alg) {
+        return entry;
+    }
+
+    if (PSA_KEY_LIFETIME_GET_LOCATION(slot->attr.lifetime) !=
+        PSA_KEY_LOCATION_LOCAL_STORAGE) {
+        return NULL;
+    }
+
+    /* Each key caches a single context: the one of its last use. */
+    psa_key_cache_free(slot);
+    if (psa_key_cache_usage + sizeof(*entry) >
+        MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET) {
+        return NULL;
+    }
+
+    entry = mbedtls_calloc(1, sizeof(*entry));
+    if (entry == NULL) {
+        return NULL;
+    }
+    entry->kind = kind;
+    entry->alg = alg;
+    *is_new = 1;
+    return entry;
+}
+
+/* Take ownership of a new entry after a successful setup, or discard it. */
+static struct psa_key_cache_entry_s *psa_key_cache_install(
+    psa_key_slot_t *slot,
+    struct psa_key_cache_entry_s *entry,
+    psa_status_t setup_status)
+{
+    if (setup_status != PSA_SUCCESS) {
+        psa_key_cache_release(entry);
+        return NULL;
+    }
+    slot->cache = entry;
+    psa_key_cache_usage += sizeof(*entry);
+    return entry;
+}
+
+#if defined(MBEDTLS_PSA_BUILTIN_AEAD)
+mbedtls_psa_aead_operation_t *psa_key_cache_get_aead(psa_key_slot_t *slot,
+                                                     psa_algorithm_t alg)
+{
+    struct psa_key_cache_entry_s *entry;
+    psa_key_attributes_t attributes = {
+        .core = slot->attr
+    };
+    int is_new;
+
+    entry = psa_key_cache_lookup(slot, PSA_KEY_CACHE_AEAD, alg, &is_new);
+    if (entry != NULL && is_new) {
+        entry = psa_key_cache_install(
+            slot, entry,
+            mbedtls_psa_aead_encrypt_setup(&entry->op.aead, &attributes,
+                                           slot->key.data, slot->key.bytes,
+                                           alg));
+    }
+    return entry == NULL ? NULL : &entry->op.aead;
+}
+#endif /* MBEDTLS_PSA_BUILTIN_AEAD */
+
+#if defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+mbedtls_psa_cipher_operation_t *psa_key_cache_get_cipher(psa_key_slot_t *slot,
+                                                         psa_algorithm_t alg,
+                                                         int is_encrypt)
+{
+    struct psa_key_cache_entry_s *entry;
+    psa_key_attributes_t attributes = {
+        .core = slot->attr
+    };
+    psa_status_t status;
+    int is_new;
+
+    entry = psa_key_cache_lookup(slot,
+                                 is_encrypt ? PSA_KEY_CACHE_CIPHER_ENCRYPT :
+                                 PSA_KEY_CACHE_CIPHER_DECRYPT,
+                                 alg, &is_new);
+    if (entry != NULL && is_new) {
+        if (is_encrypt) {
+            status = mbedtls_psa_cipher_encrypt_setup(&entry->op.cipher,
+                                                      &attributes,
+                                                      slot->key.data,
+                                                      slot->key.bytes,
+                                                      alg);
+        } else {
+            status = mbedtls_psa_cipher_decrypt_setup(&entry->op.cipher,
+                                                      &attributes,
+                                                      slot->key.data,
+                                                      slot->key.bytes,
+                                                      alg);
+        }
+        entry = psa_key_cache_install(slot, entry, status);
+    }
+    return entry == NULL ? NULL : &entry->op.cipher;
+}
+#endif /* MBEDTLS_PSA_BUILTIN_CIPHER */
+
+#if defined(MBEDTLS_PSA_BUILTIN_MAC)
+mbedtls_psa_mac_prepared_t *psa_key_cache_get_mac(psa_key_slot_t *slot,
+                                                  psa_algorithm_t alg)
+{
+    struct psa_key_cache_entry_s *entry;
+    psa_key_attributes_t attributes = {
+        .core = slot->attr
+    };
+    int is_new;
+
+    entry = psa_key_cache_lookup(slot, PSA_KEY_CACHE_MAC, alg, &is_new);
+    if (entry != NULL && is_new) {
+        entry = psa_key_cache_install(
+            slot, entry,
+            mbedtls_psa_mac_prepare(&entry->op.mac, &attributes,
+                                    slot->key.data, slot->key.bytes, alg));
+    }
+    return entry == NULL ? NULL : &entry->op.mac;
+}
+#endif /* MBEDTLS_PSA_BUILTIN_MAC */
+
+#endif /* MBEDTLS_PSA_CRYPTO_C && MBEDTLS_PSA_KEY_CONTEXT_CACHE */
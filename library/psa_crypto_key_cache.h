@@ -0,0 +1,74 @@
+/*
+ *  PSA crypto layer on top of Mbed TLS crypto: per-key cache of prepared
+ *  cipher, AEAD and MAC contexts
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PSA_CRYPTO_KEY_CACHE_H
+#define PSA_CRYPTO_KEY_CACHE_H
+
+#include "psa/crypto.h"
+#include "psa_crypto_core.h"
+#include "psa_crypto_mac.h"
+
+#if defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE)
+
+#if !defined(MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET)
+#define MBEDTLS_PSA_KEY_CONTEXT_CACHE_BUDGET 16384
+#endif
+
+/* The functions below return a built-in operation object that is set up
+ * with the key in \p slot for \p alg, creating and caching it if needed.
+ * They return NULL when the caller must go through the driver wrappers
+ * instead: the key is not stored in local storage, the built-in
+ * implementation doesn't support \p alg, or the cache budget is exhausted.
+ *
+ * The returned object belongs to the slot. It remains valid until the
+ * next call to one of these functions on the same slot, or until the key
+ * material is removed from the slot. The caller must hold a lock on the
+ * slot while using it.
+ */
+
+#if defined(MBEDTLS_PSA_BUILTIN_AEAD)
+mbedtls_psa_aead_operation_t *psa_key_cache_get_aead(psa_key_slot_t *slot,
+                                                     psa_algorithm_t alg);
+#endif
+
+#if defined(MBEDTLS_PSA_BUILTIN_CIPHER)
+mbedtls_psa_cipher_operation_t *psa_key_cache_get_cipher(psa_key_slot_t *slot,
+                                                         psa_algorithm_t alg,
+                                                         int is_encrypt);
+#endif
+
+#if defined(MBEDTLS_PSA_BUILTIN_MAC)
+mbedtls_psa_mac_prepared_t *psa_key_cache_get_mac(psa_key_slot_t *slot,
+                                                  psa_algorithm_t alg);
+#endif
+
+/** Wipe and free the prepared context cached in a key slot, if any.
+ *
+ * \param[in,out] slot  The key slot.
+ */
+void psa_key_cache_free(psa_key_slot_t *slot);
+
+/** Return the number of bytes of the cache budget in use. */
+size_t psa_key_cache_get_usage(void);
+
+#endif /* MBEDTLS_PSA_KEY_CONTEXT_CACHE */
+
+#endif /* PSA_CRYPTO_KEY_CACHE_H */
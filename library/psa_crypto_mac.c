@@ -502,6 +502,124 @@ exit:
     return status;
 }
 
+psa_status_t mbedtls_psa_mac_prepare(
+    mbedtls_psa_mac_prepared_t *prepared,
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer,
+    size_t key_buffer_size,
+    psa_algorithm_t alg)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+
+    status = mbedtls_psa_mac_sign_setup(&prepared->op, attributes,
+                                        key_buffer, key_buffer_size, alg);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+
+#if defined(MBEDTLS_PSA_BUILTIN_ALG_HMAC)
+    if (PSA_ALG_IS_HMAC(alg)) {
+        mbedtls_psa_hmac_operation_t *hmac = &prepared->op.ctx.hmac;
+
+        /* Hash the outer padded key once, like the inner one. */
+        status = psa_hash_setup(&prepared->hmac_outer, hmac->alg);
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_update(&prepared->hmac_outer, hmac->opad,
+                                     PSA_HASH_BLOCK_LENGTH(hmac->alg));
+        }
+        if (status != PSA_SUCCESS) {
+            mbedtls_psa_mac_prepared_abort(prepared);
+        }
+    }
+#endif /* MBEDTLS_PSA_BUILTIN_ALG_HMAC */
+
+    return status;
+}
+
+void mbedtls_psa_mac_prepared_abort(mbedtls_psa_mac_prepared_t *prepared)
+{
+#if defined(MBEDTLS_PSA_BUILTIN_ALG_HMAC)
+    psa_hash_abort(&prepared->hmac_outer);
+#endif
+    mbedtls_psa_mac_abort(&prepared->op);
+}
+
+psa_status_t mbedtls_psa_mac_compute_prepared(
+    mbedtls_psa_mac_prepared_t *prepared,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *mac,
+    size_t mac_size,
+    size_t *mac_length)
+{
+    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+
+#if defined(MBEDTLS_PSA_BUILTIN_ALG_CMAC)
+    if (PSA_ALG_FULL_LENGTH_MAC(prepared->op.alg) == PSA_ALG_CMAC) {
+        mbedtls_psa_mac_operation_t *operation = &prepared->op;
+
+        status = mbedtls_to_psa_error(
+            mbedtls_cipher_cmac_reset(&operation->ctx.cmac));
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+        if (input_length > 0) {
+            status = mbedtls_psa_mac_update(operation, input, input_length);
+            if (status != PSA_SUCCESS) {
+                return status;
+            }
+        }
+        status = psa_mac_finish_internal(operation, mac, mac_size);
+    } else
+#endif /* MBEDTLS_PSA_BUILTIN_ALG_CMAC */
+#if defined(MBEDTLS_PSA_BUILTIN_ALG_HMAC)
+    if (PSA_ALG_IS_HMAC(prepared->op.alg)) {
+        /* Finishing consumes the hash states, so keep the prepared ones
+         * and work on copies. */
+        psa_hash_operation_t inner = PSA_HASH_OPERATION_INIT;
+        psa_hash_operation_t outer = PSA_HASH_OPERATION_INIT;
+        uint8_t tmp[PSA_HASH_MAX_SIZE];
+        size_t hash_size = 0;
+
+        status = psa_hash_clone(&prepared->op.ctx.hmac.hash_ctx, &inner);
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_update(&inner, input, input_length);
+        }
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_finish(&inner, tmp, sizeof(tmp), &hash_size);
+        }
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_clone(&prepared->hmac_outer, &outer);
+        }
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_update(&outer, tmp, hash_size);
+        }
+        if (status == PSA_SUCCESS) {
+            status = psa_hash_finish(&outer, tmp, sizeof(tmp), &hash_size);
+        }
+        if (status == PSA_SUCCESS) {
+            memcpy(mac, tmp, mac_size);
+        }
+
+        mbedtls_platform_zeroize(tmp, sizeof(tmp));
+        psa_hash_abort(&inner);
+        psa_hash_abort(&outer);
+    } else
+#endif /* MBEDTLS_PSA_BUILTIN_ALG_HMAC */
+    {
+        (void) input;
+        (void) input_length;
+        (void) mac;
+        return PSA_ERROR_BAD_STATE;
+    }
+
+    if (status == PSA_SUCCESS) {
+        *mac_length = mac_size;
+    }
+
+    return status;
+}
+
 #endif /* MBEDTLS_PSA_BUILTIN_ALG_HMAC || MBEDTLS_PSA_BUILTIN_ALG_CMAC */
 
 #endif /* MBEDTLS_PSA_CRYPTO_C */
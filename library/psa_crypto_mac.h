@@ -66,6 +66,71 @@ psa_status_t mbedtls_psa_mac_compute(
     size_t mac_size,
     size_t *mac_length);
 
+/** A MAC operation set up with a key, kept to compute the MAC of several
+ *  messages without setting the key up again. For HMAC, it holds both the
+ *  inner hash state, in \c op, and the outer one, each of which has
+ *  absorbed its padded key. */
+typedef struct {
+    mbedtls_psa_mac_operation_t op;
+#if defined(MBEDTLS_PSA_BUILTIN_ALG_HMAC)
+    psa_hash_operation_t hmac_outer;
+#endif
+} mbedtls_psa_mac_prepared_t;
+
+/** Set up a prepared MAC operation with a key.
+ *
+ * \param[out] prepared         The object to set up. It must have been
+ *                              zeroed.
+ * \param[in] attributes        The attributes of the key to use for the
+ *                              operation.
+ * \param[in] key_buffer        The buffer containing the key, in export
+ *                              representation.
+ * \param key_buffer_size       Size of the \p key_buffer buffer in bytes.
+ * \param alg                   The MAC algorithm to use (\c PSA_ALG_XXX value
+ *                              such that #PSA_ALG_IS_MAC(\p alg) is true).
+ *
+ * \return The same status codes as mbedtls_psa_mac_sign_setup().
+ */
+psa_status_t mbedtls_psa_mac_prepare(
+    mbedtls_psa_mac_prepared_t *prepared,
+    const psa_key_attributes_t *attributes,
+    const uint8_t *key_buffer,
+    size_t key_buffer_size,
+    psa_algorithm_t alg);
+
+/** Wipe a prepared MAC operation.
+ *
+ * \param[in,out] prepared      An object set up by mbedtls_psa_mac_prepare(),
+ *                              or zeroed.
+ */
+void mbedtls_psa_mac_prepared_abort(mbedtls_psa_mac_prepared_t *prepared);
+
+/** Calculate the MAC of a message with a prepared operation.
+ *
+ * This function does the work of mbedtls_psa_mac_compute() after the key
+ * setup. \p prepared keeps its key state, so it can compute the MAC of
+ * further messages: for HMAC, the function works on copies of the inner
+ * and outer hash states.
+ *
+ * \param[in,out] prepared      An object set up by mbedtls_psa_mac_prepare().
+ * \param[in] input             Buffer containing the input message.
+ * \param input_length          Size of the \p input buffer in bytes.
+ * \param[out] mac              Buffer where the MAC value is to be written.
+ * \param mac_size              Size of the \p mac buffer in bytes. This is
+ *                              the length of the MAC to compute.
+ * \param[out] mac_length       On success, the number of bytes
+ *                              that make up the MAC value.
+ *
+ * \return The same status codes as mbedtls_psa_mac_compute().
+ */
+psa_status_t mbedtls_psa_mac_compute_prepared(
+    mbedtls_psa_mac_prepared_t *prepared,
+    const uint8_t *input,
+    size_t input_length,
+    uint8_t *mac,
+    size_t mac_size,
+    size_t *mac_length);
+
 /** Set up a multipart MAC calculation operation using Mbed TLS.
  *
  * \note The signature of this function is that of a PSA driver mac_sign_setup
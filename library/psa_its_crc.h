@@ -0,0 +1,65 @@
+/**
+ * \file psa_its_crc.h
+ *
+ * \brief CRC-32 used by the PSA ITS backends to detect torn or damaged
+ *        records. This is an integrity check against accidents, not
+ *        against tampering.
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#ifndef PSA_ITS_CRC_H
+#define PSA_ITS_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Start value of a CRC computation. */
+#define PSA_ITS_CRC_INIT 0xffffffff
+
+/** Update a CRC-32 (IEEE 802.3, reflected) with more data.
+ *
+ * This processes a nibble at a time to keep the table small: the records
+ * protected by this CRC are small and read rarely.
+ *
+ * \param crc       The CRC so far, #PSA_ITS_CRC_INIT at the start.
+ * \param buf       The data to add.
+ * \param len       The length of \p buf in bytes.
+ *
+ * \return          The updated CRC.
+ */
+static inline uint32_t psa_its_crc_update(uint32_t crc,
+                                          const unsigned char *buf,
+                                          size_t len)
+{
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        crc ^= buf[i];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+        crc = (crc >> 4) ^ table[crc & 0x0f];
+    }
+    return crc;
+}
+
+#endif /* PSA_ITS_CRC_H */
@@ -0,0 +1,846 @@
+/*
+ *  PSA ITS over a single append-only journal file.
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Enable definition of fileno() even when compiling with -std=c99. Must
+ * be set before mbedtls_config.h, which pulls in glibc's features.h indirectly.
+ * Harmless on other platforms. */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "common.h"
+
+#if defined(MBEDTLS_PSA_ITS_JOURNAL_C)
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#elif defined(unix) || defined(__unix__) || defined(__unix) || \
+    defined(__APPLE__) || defined(__QNXNTO__) || \
+    defined(__HAIKU__) || defined(__midipix__)
+#include <unistd.h>
+#define PSA_ITS_JOURNAL_HAVE_FSYNC
+#endif
+
+#include "psa_crypto_its.h"
+#include "psa_its_crc.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "psa/crypto.h"
+
+#if !defined(PSA_ITS_STORAGE_PREFIX)
+#define PSA_ITS_STORAGE_PREFIX ""
+#endif
+
+#define PSA_ITS_JOURNAL_FILENAME \
+    PSA_ITS_STORAGE_PREFIX "journal.psa_its"
+#define PSA_ITS_JOURNAL_TEMP \
+    PSA_ITS_STORAGE_PREFIX "journal.tmp.psa_its"
+
+#if !defined(MBEDTLS_PSA_ITS_JOURNAL_CACHE_SIZE)
+#define MBEDTLS_PSA_ITS_JOURNAL_CACHE_SIZE 4096
+#endif
+
+#if !defined(MBEDTLS_PSA_ITS_JOURNAL_SYNC_INTERVAL)
+#define MBEDTLS_PSA_ITS_JOURNAL_SYNC_INTERVAL 8
+#endif
+
+#if !defined(MBEDTLS_PSA_ITS_JOURNAL_COMPACT_THRESHOLD)
+#define MBEDTLS_PSA_ITS_JOURNAL_COMPACT_THRESHOLD 4096
+#endif
+
+#define PSA_ITS_JOURNAL_MAGIC_STRING "PSA\0ITSJ"
+#define PSA_ITS_JOURNAL_MAGIC_LENGTH 8
+
+#define PSA_ITS_JOURNAL_RECORD_SET      1
+#define PSA_ITS_JOURNAL_RECORD_REMOVE   2
+
+/* The largest journal we can address with fseek(). */
+#define PSA_ITS_JOURNAL_MAX_OFFSET LONG_MAX
+
+/* As rename fails on Windows if the new filepath already exists,
+ * use MoveFileExA with the MOVEFILE_REPLACE_EXISTING flag instead.
+ * Returns 0 on success, nonzero on failure. */
+#if defined(_WIN32)
+#define rename_replace_existing(oldpath, newpath) \
+    (!MoveFileExA(oldpath, newpath, MOVEFILE_REPLACE_EXISTING))
+#else
+#define rename_replace_existing(oldpath, newpath) rename(oldpath, newpath)
+#endif
+
+/* On-disk header of a journal record. All fields are little-endian.
+ * The CRC covers all the fields before it and the record data. */
+typedef struct {
+    uint8_t type[sizeof(uint32_t)];
+    uint8_t uid[sizeof(psa_storage_uid_t)];
+    uint8_t size[sizeof(uint32_t)];
+    uint8_t flags[sizeof(psa_storage_create_flags_t)];
+    uint8_t crc[sizeof(uint32_t)];
+} psa_its_journal_record_t;
+
+#define PSA_ITS_JOURNAL_RECORD_CRC_OFFSET \
+    (sizeof(psa_its_journal_record_t) - sizeof(uint32_t))
+
+/* In-memory index entry for one live UID. */
+typedef struct {
+    psa_storage_uid_t uid;
+    uint32_t size;
+    psa_storage_create_flags_t flags;
+    uint32_t crc;
+    long offset;            /* offset of the data in the journal */
+    unsigned char *cache;   /* cached copy of the data, or NULL */
+    uint32_t last_use;      /* LRU stamp of the cached copy */
+} psa_its_journal_entry_t;
+
+typedef struct {
+    FILE *stream;
+    psa_its_journal_entry_t *entries; /* sorted by UID */
+    size_t count;
+    size_t capacity;
+    long end;                   /* end of the last valid record */
+    size_t live_bytes;          /* bytes of records that are still live */
+    size_t dead_bytes;          /* bytes of superseded records */
+    size_t cache_bytes;
+    uint32_t clock;
+    unsigned pending_syncs;
+} psa_its_journal_t;
+
+static psa_its_journal_t psa_its_journal;
+
+static void psa_its_journal_fill_record(psa_its_journal_record_t *record,
+                                        uint32_t type,
+                                        psa_storage_uid_t uid,
+                                        uint32_t size,
+                                        psa_storage_create_flags_t flags)
+{
+    MBEDTLS_PUT_UINT32_LE(type, record->type, 0);
+    MBEDTLS_PUT_UINT32_LE((uint32_t) (uid & 0xffffffff), record->uid, 0);
+    MBEDTLS_PUT_UINT32_LE((uint32_t) (uid >> 32), record->uid, 4);
+    MBEDTLS_PUT_UINT32_LE(size, record->size, 0);
+    MBEDTLS_PUT_UINT32_LE(flags, record->flags, 0);
+}
+
+static uint32_t psa_its_journal_record_crc(
+    const psa_its_journal_record_t *record)
+{
+    return psa_its_crc_update(PSA_ITS_CRC_INIT,
+                              (const unsigned char *) record,
+                              PSA_ITS_JOURNAL_RECORD_CRC_OFFSET);
+}
+
+/* Force the content of a stream out to the storage medium. Where the
+ * platform offers no way to do so, this is equivalent to fflush(). */
+static psa_status_t psa_its_journal_sync_stream(FILE *stream)
+{
+    if (fflush(stream) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+#if defined(_WIN32)
+    if (_commit(_fileno(stream)) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+#elif defined(PSA_ITS_JOURNAL_HAVE_FSYNC)
+    if (fsync(fileno(stream)) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+#endif
+    return PSA_SUCCESS;
+}
+
+/*
+ * Index management
+ */
+
+/* Return the position of uid in the index, or the position where it should
+ * be inserted if it is absent. */
+static size_t psa_its_journal_search(psa_storage_uid_t uid)
+{
+    size_t lo = 0;
+    size_t hi = psa_its_journal.count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (psa_its_journal.entries[mid].uid < uid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static psa_its_journal_entry_t *psa_its_journal_find(psa_storage_uid_t uid)
+{
+    size_t i = psa_its_journal_search(uid);
+
+    if (i < psa_its_journal.count && psa_its_journal.entries[i].uid == uid) {
+        return &psa_its_journal.entries[i];
+    }
+    return NULL;
+}
+
+static void psa_its_journal_uncache(psa_its_journal_entry_t *entry)
+{
+    if (entry->cache != NULL) {
+        mbedtls_platform_zeroize(entry->cache, entry->size);
+        mbedtls_free(entry->cache);
+        entry->cache = NULL;
+        psa_its_journal.cache_bytes -= entry->size;
+    }
+}
+
+/* Make room for size bytes in the cache by evicting the least recently
+ * used entries other than keep. Return 0 if the data cannot be cached. */
+static int psa_its_journal_make_room(const psa_its_journal_entry_t *keep,
+                                     size_t size)
+{
+    if (size == 0 || size > MBEDTLS_PSA_ITS_JOURNAL_CACHE_SIZE) {
+        return 0;
+    }
+    while (psa_its_journal.cache_bytes + size >
+           MBEDTLS_PSA_ITS_JOURNAL_CACHE_SIZE) {
+        psa_its_journal_entry_t *victim = NULL;
+        size_t i;
+        for (i = 0; i < psa_its_journal.count; i++) {
+            psa_its_journal_entry_t *entry = &psa_its_journal.entries[i];
+            if (entry == keep || entry->cache == NULL) {
+                continue;
+            }
+            if (victim == NULL ||
+                (uint32_t) (psa_its_journal.clock - entry->last_use) >
+                (uint32_t) (psa_its_journal.clock - victim->last_use)) {
+                victim = entry;
+            }
+        }
+        if (victim == NULL) {
+            return 0;
+        }
+        psa_its_journal_uncache(victim);
+    }
+    return 1;
+}
+
+/* Store a copy of data in the cache if it fits. Failing to cache is not
+ * an error: the data can always be read back from the journal. */
+static void psa_its_journal_cache(psa_its_journal_entry_t *entry,
+                                  const void *data)
+{
+    psa_its_journal_uncache(entry);
+    if (!psa_its_journal_make_room(entry, entry->size)) {
+        return;
+    }
+    entry->cache = mbedtls_calloc(1, entry->size);
+    if (entry->cache == NULL) {
+        return;
+    }
+    memcpy(entry->cache, data, entry->size);
+    psa_its_journal.cache_bytes += entry->size;
+    entry->last_use = ++psa_its_journal.clock;
+}
+
+/* Record that the data of uid is now at offset. */
+static psa_status_t psa_its_journal_index_set(psa_storage_uid_t uid,
+                                              uint32_t size,
+                                              psa_storage_create_flags_t flags,
+                                              uint32_t crc,
+                                              long offset)
+{
+    size_t i = psa_its_journal_search(uid);
+    psa_its_journal_entry_t *entry;
+
+    if (i < psa_its_journal.count && psa_its_journal.entries[i].uid == uid) {
+        entry = &psa_its_journal.entries[i];
+        psa_its_journal_uncache(entry);
+        psa_its_journal.live_bytes -=
+            sizeof(psa_its_journal_record_t) + entry->size;
+        psa_its_journal.dead_bytes +=
+            sizeof(psa_its_journal_record_t) + entry->size;
+    } else {
+        if (psa_its_journal.count == psa_its_journal.capacity) {
+            size_t new_capacity = psa_its_journal.capacity == 0 ?
+                                  16 : 2 * psa_its_journal.capacity;
+            psa_its_journal_entry_t *new_entries =
+                mbedtls_calloc(new_capacity, sizeof(*new_entries));
+            if (new_entries == NULL) {
+                return PSA_ERROR_INSUFFICIENT_MEMORY;
+            }
+            if (psa_its_journal.count != 0) {
+                memcpy(new_entries, psa_its_journal.entries,
+                       psa_its_journal.count * sizeof(*new_entries));
+            }
+            mbedtls_free(psa_its_journal.entries);
+            psa_its_journal.entries = new_entries;
+            psa_its_journal.capacity = new_capacity;
+        }
+        entry = &psa_its_journal.entries[i];
+        memmove(entry + 1, entry,
+                (psa_its_journal.count - i) * sizeof(*entry));
+        memset(entry, 0, sizeof(*entry));
+        entry->uid = uid;
+        psa_its_journal.count++;
+    }
+
+    entry->size = size;
+    entry->flags = flags;
+    entry->crc = crc;
+    entry->offset = offset;
+    psa_its_journal.live_bytes += sizeof(psa_its_journal_record_t) + size;
+    return PSA_SUCCESS;
+}
+
+static void psa_its_journal_index_remove(psa_its_journal_entry_t *entry)
+{
+    size_t i = (size_t) (entry - psa_its_journal.entries);
+
+    psa_its_journal_uncache(entry);
+    psa_its_journal.live_bytes -= sizeof(psa_its_journal_record_t) + entry->size;
+    psa_its_journal.dead_bytes += sizeof(psa_its_journal_record_t) + entry->size;
+    memmove(entry, entry + 1,
+            (psa_its_journal.count - i - 1) * sizeof(*entry));
+    psa_its_journal.count--;
+}
+
+/*
+ * Journal file management
+ */
+
+/* Copy length bytes at offset in the current journal to out,
+ * updating the CRC if p_crc is not NULL. */
+static psa_status_t psa_its_journal_copy(FILE *out, long offset,
+                                         uint32_t length, uint32_t *p_crc)
+{
+    psa_status_t status = PSA_ERROR_STORAGE_FAILURE;
+    unsigned char buf[256];
+    size_t n;
+
+    if (fseek(psa_its_journal.stream, offset, SEEK_SET) != 0) {
+        goto exit;
+    }
+    while (length > 0) {
+        size_t chunk = length < sizeof(buf) ? length : sizeof(buf);
+        n = fread(buf, 1, chunk, psa_its_journal.stream);
+        if (n != chunk) {
+            goto exit;
+        }
+        if (p_crc != NULL) {
+            *p_crc = psa_its_crc_update(*p_crc, buf, chunk);
+        }
+        if (out != NULL && fwrite(buf, 1, chunk, out) != chunk) {
+            status = PSA_ERROR_INSUFFICIENT_STORAGE;
+            goto exit;
+        }
+        length -= (uint32_t) chunk;
+    }
+    status = PSA_SUCCESS;
+
+exit:
+    mbedtls_platform_zeroize(buf, sizeof(buf));
+    return status;
+}
+
+/* Rewrite the journal so that it only contains the live records, then
+ * atomically replace the old journal by the new one. This also creates
+ * the journal if it doesn't exist yet. */
+static psa_status_t psa_its_journal_compact(void)
+{
+    psa_status_t status = PSA_ERROR_STORAGE_FAILURE;
+    FILE *temp = NULL;
+    psa_its_journal_record_t record;
+    long offset = PSA_ITS_JOURNAL_MAGIC_LENGTH;
+    size_t i;
+
+    temp = fopen(PSA_ITS_JOURNAL_TEMP, "wb");
+    if (temp == NULL) {
+        goto exit;
+    }
+
+    /* Ensure no stdio buffering of secrets, as such buffers cannot be wiped. */
+    mbedtls_setbuf(temp, NULL);
+
+    status = PSA_ERROR_INSUFFICIENT_STORAGE;
+    if (fwrite(PSA_ITS_JOURNAL_MAGIC_STRING, 1, PSA_ITS_JOURNAL_MAGIC_LENGTH,
+               temp) != PSA_ITS_JOURNAL_MAGIC_LENGTH) {
+        goto exit;
+    }
+    for (i = 0; i < psa_its_journal.count; i++) {
+        const psa_its_journal_entry_t *entry = &psa_its_journal.entries[i];
+
+        psa_its_journal_fill_record(&record, PSA_ITS_JOURNAL_RECORD_SET,
+                                    entry->uid, entry->size, entry->flags);
+        MBEDTLS_PUT_UINT32_LE(entry->crc, record.crc, 0);
+        if (fwrite(&record, 1, sizeof(record), temp) != sizeof(record)) {
+            goto exit;
+        }
+        if (entry->cache != NULL) {
+            if (fwrite(entry->cache, 1, entry->size, temp) != entry->size) {
+                goto exit;
+            }
+        } else {
+            status = psa_its_journal_copy(temp, entry->offset,
+                                          entry->size, NULL);
+            if (status != PSA_SUCCESS) {
+                goto exit;
+            }
+            status = PSA_ERROR_INSUFFICIENT_STORAGE;
+        }
+    }
+
+    status = psa_its_journal_sync_stream(temp);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+    if (fclose(temp) != 0) {
+        temp = NULL;
+        status = PSA_ERROR_INSUFFICIENT_STORAGE;
+        goto exit;
+    }
+    temp = NULL;
+
+    /* Windows can't rename over an open file, so close the old journal
+     * first. From here on, any failure leaves the journal closed and the
+     * next access will reload it from whichever file is in place. */
+    if (psa_its_journal.stream != NULL) {
+        fclose(psa_its_journal.stream);
+        psa_its_journal.stream = NULL;
+    }
+    status = PSA_ERROR_STORAGE_FAILURE;
+    if (rename_replace_existing(PSA_ITS_JOURNAL_TEMP,
+                                PSA_ITS_JOURNAL_FILENAME) != 0) {
+        goto exit;
+    }
+    psa_its_journal.stream = fopen(PSA_ITS_JOURNAL_FILENAME, "r+b");
+    if (psa_its_journal.stream == NULL) {
+        goto exit;
+    }
+    mbedtls_setbuf(psa_its_journal.stream, NULL);
+
+    for (i = 0; i < psa_its_journal.count; i++) {
+        psa_its_journal.entries[i].offset =
+            offset + (long) sizeof(psa_its_journal_record_t);
+        offset += (long) (sizeof(psa_its_journal_record_t) +
+                          psa_its_journal.entries[i].size);
+    }
+    psa_its_journal.end = offset;
+    psa_its_journal.dead_bytes = 0;
+    psa_its_journal.pending_syncs = 0;
+    status = PSA_SUCCESS;
+
+exit:
+    if (temp != NULL) {
+        fclose(temp);
+    }
+    /* The temporary file may still exist, but only in failure cases where
+     * we're already reporting an error. */
+    (void) remove(PSA_ITS_JOURNAL_TEMP);
+    if (status != PSA_SUCCESS && psa_its_journal.stream == NULL) {
+        mbedtls_psa_its_journal_close();
+    }
+    return status;
+}
+
+/* Replay the records of the journal into the index. Stop at the first
+ * record that is incomplete or fails its integrity check: this is what
+ * an append interrupted by a crash or power failure looks like. */
+static psa_status_t psa_its_journal_replay(long *p_file_end)
+{
+    psa_status_t status;
+    psa_its_journal_record_t record;
+    unsigned char magic[PSA_ITS_JOURNAL_MAGIC_LENGTH];
+    long offset = PSA_ITS_JOURNAL_MAGIC_LENGTH;
+    FILE *stream = psa_its_journal.stream;
+
+    if (fread(magic, 1, sizeof(magic), stream) != sizeof(magic) ||
+        memcmp(magic, PSA_ITS_JOURNAL_MAGIC_STRING,
+               PSA_ITS_JOURNAL_MAGIC_LENGTH) != 0) {
+        return PSA_ERROR_DATA_CORRUPT;
+    }
+
+    if (fseek(stream, 0, SEEK_END) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+    *p_file_end = ftell(stream);
+    if (*p_file_end < 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+
+    while (*p_file_end - offset >= (long) sizeof(record)) {
+        uint32_t type, size, crc;
+        psa_storage_uid_t uid;
+        psa_storage_create_flags_t flags;
+        psa_its_journal_entry_t *entry;
+
+        if (fseek(stream, offset, SEEK_SET) != 0 ||
+            fread(&record, 1, sizeof(record), stream) != sizeof(record)) {
+            return PSA_ERROR_STORAGE_FAILURE;
+        }
+        type = MBEDTLS_GET_UINT32_LE(record.type, 0);
+        uid = (psa_storage_uid_t) MBEDTLS_GET_UINT32_LE(record.uid, 0) |
+              (psa_storage_uid_t) MBEDTLS_GET_UINT32_LE(record.uid, 4) << 32;
+        size = MBEDTLS_GET_UINT32_LE(record.size, 0);
+        flags = MBEDTLS_GET_UINT32_LE(record.flags, 0);
+
+        if ((type != PSA_ITS_JOURNAL_RECORD_SET &&
+             type != PSA_ITS_JOURNAL_RECORD_REMOVE) ||
+            (type == PSA_ITS_JOURNAL_RECORD_REMOVE && size != 0) ||
+            uid == 0 ||
+            size > (uint32_t) (*p_file_end - offset -
+                               (long) sizeof(record))) {
+            break;
+        }
+
+        crc = psa_its_journal_record_crc(&record);
+        status = psa_its_journal_copy(NULL, offset + (long) sizeof(record),
+                                      size, &crc);
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+        if (crc != MBEDTLS_GET_UINT32_LE(record.crc, 0)) {
+            break;
+        }
+
+        if (type == PSA_ITS_JOURNAL_RECORD_SET) {
+            status = psa_its_journal_index_set(uid, size, flags, crc,
+                                               offset + (long) sizeof(record));
+            if (status != PSA_SUCCESS) {
+                return status;
+            }
+        } else {
+            entry = psa_its_journal_find(uid);
+            if (entry != NULL) {
+                psa_its_journal_index_remove(entry);
+            }
+            psa_its_journal.dead_bytes += sizeof(record);
+        }
+        offset += (long) (sizeof(record) + size);
+    }
+
+    psa_its_journal.end = offset;
+    return PSA_SUCCESS;
+}
+
+/* Load the journal into memory if this hasn't been done yet. */
+static psa_status_t psa_its_journal_open(void)
+{
+    psa_status_t status;
+    long file_end = 0;
+
+    if (psa_its_journal.stream != NULL) {
+        return PSA_SUCCESS;
+    }
+
+    psa_its_journal.stream = fopen(PSA_ITS_JOURNAL_FILENAME, "r+b");
+    if (psa_its_journal.stream == NULL) {
+        /* No journal yet. Compacting an empty index creates it. */
+        return psa_its_journal_compact();
+    }
+
+    /* Ensure no stdio buffering of secrets, as such buffers cannot be wiped. */
+    mbedtls_setbuf(psa_its_journal.stream, NULL);
+
+    status = psa_its_journal_replay(&file_end);
+    if (status != PSA_SUCCESS) {
+        mbedtls_psa_its_journal_close();
+        return status;
+    }
+
+    /* Discard a torn record at the end of the journal, so that the next
+     * append starts from a clean state. */
+    if (file_end != psa_its_journal.end) {
+        return psa_its_journal_compact();
+    }
+    return PSA_SUCCESS;
+}
+
+/* Append a record to the journal. On success, return the offset of the
+ * record data in *p_offset and the CRC of the record in *p_crc. */
+static psa_status_t psa_its_journal_append(uint32_t type,
+                                           psa_storage_uid_t uid,
+                                           uint32_t data_length,
+                                           const void *p_data,
+                                           psa_storage_create_flags_t flags,
+                                           long *p_offset,
+                                           uint32_t *p_crc)
+{
+    psa_status_t status = PSA_ERROR_INSUFFICIENT_STORAGE;
+    psa_its_journal_record_t record;
+    FILE *stream = psa_its_journal.stream;
+    uint32_t crc;
+
+    if ((unsigned long) data_length + sizeof(record) >
+        (unsigned long) (PSA_ITS_JOURNAL_MAX_OFFSET - psa_its_journal.end)) {
+        return PSA_ERROR_INSUFFICIENT_STORAGE;
+    }
+
+    psa_its_journal_fill_record(&record, type, uid, data_length, flags);
+    crc = psa_its_journal_record_crc(&record);
+    if (data_length != 0) {
+        crc = psa_its_crc_update(crc, p_data, data_length);
+    }
+    MBEDTLS_PUT_UINT32_LE(crc, record.crc, 0);
+
+    if (fseek(stream, psa_its_journal.end, SEEK_SET) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+    if (fwrite(&record, 1, sizeof(record), stream) != sizeof(record)) {
+        goto exit;
+    }
+    if (data_length != 0 &&
+        fwrite(p_data, 1, data_length, stream) != data_length) {
+        goto exit;
+    }
+    if (fflush(stream) != 0) {
+        goto exit;
+    }
+
+    *p_offset = psa_its_journal.end + (long) sizeof(record);
+    *p_crc = crc;
+    psa_its_journal.end = *p_offset + (long) data_length;
+    status = PSA_SUCCESS;
+
+exit:
+    if (status == PSA_ERROR_INSUFFICIENT_STORAGE) {
+        /* Part of the record may have made it to the file. Rewrite the
+         * journal to get rid of it before anything else is appended. */
+        (void) psa_its_journal_compact();
+    }
+    return status;
+}
+
+/* Called once the index reflects a newly appended record: sync the journal
+ * if enough records are pending, and reclaim dead space if it is worth it. */
+static psa_status_t psa_its_journal_commit(void)
+{
+    if (++psa_its_journal.pending_syncs >=
+        MBEDTLS_PSA_ITS_JOURNAL_SYNC_INTERVAL) {
+        psa_status_t status = mbedtls_psa_its_journal_sync();
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+    }
+    if (psa_its_journal.dead_bytes >=
+        MBEDTLS_PSA_ITS_JOURNAL_COMPACT_THRESHOLD &&
+        psa_its_journal.dead_bytes > psa_its_journal.live_bytes) {
+        return psa_its_journal_compact();
+    }
+    return PSA_SUCCESS;
+}
+
+/*
+ * PSA ITS interface
+ */
+
+psa_status_t psa_its_get_info(psa_storage_uid_t uid,
+                              struct psa_storage_info_t *p_info)
+{
+    psa_status_t status;
+    const psa_its_journal_entry_t *entry;
+
+    status = psa_its_journal_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    entry = psa_its_journal_find(uid);
+    if (entry == NULL) {
+        return PSA_ERROR_DOES_NOT_EXIST;
+    }
+    p_info->size = entry->size;
+    p_info->flags = entry->flags;
+    return PSA_SUCCESS;
+}
+
+psa_status_t psa_its_get(psa_storage_uid_t uid,
+                         uint32_t data_offset,
+                         uint32_t data_length,
+                         void *p_data,
+                         size_t *p_data_length)
+{
+    psa_status_t status;
+    psa_its_journal_entry_t *entry;
+    unsigned char *data = NULL;
+    size_t n;
+
+    status = psa_its_journal_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    entry = psa_its_journal_find(uid);
+    if (entry == NULL) {
+        return PSA_ERROR_DOES_NOT_EXIST;
+    }
+
+    if (data_offset + data_length < data_offset) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+#if SIZE_MAX < 0xffffffff
+    if (data_offset + data_length > SIZE_MAX) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+#endif
+    if (data_offset + data_length > entry->size) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (entry->cache == NULL &&
+        psa_its_journal_make_room(entry, entry->size)) {
+        /* Cache miss: load the whole entry so that the next reader
+         * doesn't need to go to the file. */
+        data = mbedtls_calloc(1, entry->size);
+        if (data != NULL) {
+            if (fseek(psa_its_journal.stream, entry->offset, SEEK_SET) != 0 ||
+                fread(data, 1, entry->size, psa_its_journal.stream) !=
+                entry->size) {
+                mbedtls_platform_zeroize(data, entry->size);
+                mbedtls_free(data);
+                return PSA_ERROR_STORAGE_FAILURE;
+            }
+            entry->cache = data;
+            psa_its_journal.cache_bytes += entry->size;
+        }
+    }
+
+    if (entry->cache != NULL) {
+        entry->last_use = ++psa_its_journal.clock;
+        if (data_length != 0) {
+            memcpy(p_data, entry->cache + data_offset, data_length);
+        }
+        n = data_length;
+    } else {
+        if (fseek(psa_its_journal.stream,
+                  entry->offset + (long) data_offset, SEEK_SET) != 0) {
+            return PSA_ERROR_STORAGE_FAILURE;
+        }
+        n = data_length == 0 ? 0 :
+            fread(p_data, 1, data_length, psa_its_journal.stream);
+        if (n != data_length) {
+            return PSA_ERROR_STORAGE_FAILURE;
+        }
+    }
+
+    if (p_data_length != NULL) {
+        *p_data_length = n;
+    }
+    return PSA_SUCCESS;
+}
+
+psa_status_t psa_its_set(psa_storage_uid_t uid,
+                         uint32_t data_length,
+                         const void *p_data,
+                         psa_storage_create_flags_t create_flags)
+{
+    psa_status_t status;
+    long offset = 0;
+    uint32_t crc = 0;
+
+    if (uid == 0) {
+        return PSA_ERROR_INVALID_HANDLE;
+    }
+
+    status = psa_its_journal_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+
+    status = psa_its_journal_append(PSA_ITS_JOURNAL_RECORD_SET, uid,
+                                    data_length, p_data, create_flags,
+                                    &offset, &crc);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    status = psa_its_journal_index_set(uid, data_length, create_flags,
+                                       crc, offset);
+    if (status != PSA_SUCCESS) {
+        /* The record is in the journal but we can't track it. Drop the
+         * in-memory state so that it is rebuilt from the file. */
+        mbedtls_psa_its_journal_close();
+        return status;
+    }
+    psa_its_journal_cache(psa_its_journal_find(uid), p_data);
+
+    return psa_its_journal_commit();
+}
+
+psa_status_t psa_its_remove(psa_storage_uid_t uid)
+{
+    psa_status_t status;
+    psa_its_journal_entry_t *entry;
+    long offset = 0;
+    uint32_t crc = 0;
+
+    status = psa_its_journal_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    entry = psa_its_journal_find(uid);
+    if (entry == NULL) {
+        return PSA_ERROR_DOES_NOT_EXIST;
+    }
+
+    status = psa_its_journal_append(PSA_ITS_JOURNAL_RECORD_REMOVE, uid,
+                                    0, NULL, 0, &offset, &crc);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    psa_its_journal_index_remove(entry);
+    psa_its_journal.dead_bytes += sizeof(psa_its_journal_record_t);
+
+    return psa_its_journal_commit();
+}
+
+/*
+ * Mbed TLS extensions
+ */
+
+psa_status_t mbedtls_psa_its_journal_sync(void)
+{
+    psa_status_t status;
+
+    if (psa_its_journal.stream == NULL) {
+        return PSA_SUCCESS;
+    }
+    status = psa_its_journal_sync_stream(psa_its_journal.stream);
+    if (status == PSA_SUCCESS) {
+        psa_its_journal.pending_syncs = 0;
+    }
+    return status;
+}
+
+void mbedtls_psa_its_journal_close(void)
+{
+    size_t i;
+
+    if (psa_its_journal.stream != NULL) {
+        (void) mbedtls_psa_its_journal_sync();
+        fclose(psa_its_journal.stream);
+    }
+    for (i = 0; i < psa_its_journal.count; i++) {
+        psa_its_journal_uncache(&psa_its_journal.entries[i]);
+    }
+    mbedtls_free(psa_its_journal.entries);
+    memset(&psa_its_journal, 0, sizeof(psa_its_journal));
+}
+
+#endif /* MBEDTLS_PSA_ITS_JOURNAL_C */
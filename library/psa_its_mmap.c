@@ -0,0 +1,1004 @@
+/*
+ *  PSA ITS over a single memory-mapped container file.
+ */
+/*
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/* Enable definition of ftruncate() and fsync() even when compiling with
+ * -std=c99. Must be set before mbedtls_config.h, which pulls in glibc's
+ * features.h indirectly. Harmless on other platforms. */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include "common.h"
+
+#if defined(MBEDTLS_PSA_ITS_MMAP_C)
+
+#if !defined(unix) && !defined(__unix__) && !defined(__unix) && \
+    !defined(__APPLE__) && !defined(__QNXNTO__) && \
+    !defined(__HAIKU__) && !defined(__midipix__)
+#error "The PSA ITS mmap backend only works on POSIX platforms, see MBEDTLS_PSA_ITS_MMAP_C in mbedtls_config.h"
+#endif
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+#include "psa_crypto_its.h"
+#include "psa_its_crc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "psa/crypto.h"
+
+#if !defined(PSA_ITS_STORAGE_PREFIX)
+#define PSA_ITS_STORAGE_PREFIX ""
+#endif
+
+#define PSA_ITS_MMAP_FILENAME \
+    PSA_ITS_STORAGE_PREFIX "container.psa_its"
+#define PSA_ITS_MMAP_TEMP \
+    PSA_ITS_STORAGE_PREFIX "container.tmp.psa_its"
+
+#define PSA_ITS_MMAP_MAGIC_STRING "PSA\0ITSM"
+#define PSA_ITS_MMAP_MAGIC_LENGTH 8
+
+/*
+ * Container layout
+ *
+ * The container starts with two superblock slots. Each superblock holds
+ * a generation counter and a directory of index nodes, sorted by the first
+ * UID of each node. Each index node holds a sorted array of entries, and
+ * each entry points to the data of one UID elsewhere in the container.
+ *
+ * Updates never modify anything that the current superblock can reach.
+ * New data and new copies of the affected index node are written to free
+ * space, then a superblock with the next generation number is written to
+ * the other slot. On load, the valid superblock with the highest generation
+ * wins, so a crash at any point leaves either the old or the new state.
+ *
+ * All multi-byte integers are little-endian.
+ */
+#define PSA_ITS_MMAP_SLOT_SIZE          4096
+#define PSA_ITS_MMAP_SUPERBLOCK_HEADER  32
+#define PSA_ITS_MMAP_DIR_ENTRY_SIZE     16
+#define PSA_ITS_MMAP_MAX_NODES \
+    ((PSA_ITS_MMAP_SLOT_SIZE - PSA_ITS_MMAP_SUPERBLOCK_HEADER) / \
+     PSA_ITS_MMAP_DIR_ENTRY_SIZE)
+
+#define PSA_ITS_MMAP_NODE_SIZE          4096
+#define PSA_ITS_MMAP_NODE_HEADER        8
+#define PSA_ITS_MMAP_ENTRY_SIZE         32
+#define PSA_ITS_MMAP_NODE_CAPACITY \
+    ((PSA_ITS_MMAP_NODE_SIZE - PSA_ITS_MMAP_NODE_HEADER) / \
+     PSA_ITS_MMAP_ENTRY_SIZE)
+
+/* Superblock header fields */
+#define PSA_ITS_MMAP_SB_MAGIC           0
+#define PSA_ITS_MMAP_SB_GENERATION      8
+#define PSA_ITS_MMAP_SB_NODE_COUNT      16
+#define PSA_ITS_MMAP_SB_ENTRY_COUNT     20
+#define PSA_ITS_MMAP_SB_CRC             28
+
+/* Directory entry fields */
+#define PSA_ITS_MMAP_DIR_OFFSET         0
+#define PSA_ITS_MMAP_DIR_FIRST_UID      8
+
+/* Index node header fields. The CRC covers the count and the entries. */
+#define PSA_ITS_MMAP_NODE_COUNT         0
+#define PSA_ITS_MMAP_NODE_CRC           4
+
+/* Entry fields */
+#define PSA_ITS_MMAP_ENTRY_UID          0
+#define PSA_ITS_MMAP_ENTRY_OFFSET       8
+#define PSA_ITS_MMAP_ENTRY_SIZE_FIELD   16
+#define PSA_ITS_MMAP_ENTRY_FLAGS        20
+#define PSA_ITS_MMAP_ENTRY_CRC          24
+
+/* Data extents are aligned to this many bytes, index nodes to their size. */
+#define PSA_ITS_MMAP_DATA_ALIGN         16
+
+/* The container grows by multiples of this many bytes. */
+#define PSA_ITS_MMAP_GROW_SIZE          65536
+
+/* A range of the container that the current state refers to. */
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} psa_its_mmap_extent_t;
+
+typedef struct {
+    int fd;
+    int has_fd;
+    unsigned char *map;             /* NULL when the container is closed */
+    size_t map_size;
+    size_t active;                  /* slot of the current superblock */
+    psa_its_mmap_extent_t *extents; /* sorted by offset */
+    size_t extent_count;
+    size_t extent_capacity;
+    int extents_loaded;
+    /* verified[i] is set once the CRC of index node i has been checked. */
+    unsigned char verified[PSA_ITS_MMAP_MAX_NODES];
+} psa_its_mmap_t;
+
+static psa_its_mmap_t psa_its_mmap;
+
+static uint64_t psa_its_mmap_get_u64(const unsigned char *p)
+{
+    return (uint64_t) MBEDTLS_GET_UINT32_LE(p, 0) |
+           (uint64_t) MBEDTLS_GET_UINT32_LE(p, 4) << 32;
+}
+
+static void psa_its_mmap_put_u64(uint64_t n, unsigned char *p)
+{
+    MBEDTLS_PUT_UINT32_LE((uint32_t) (n & 0xffffffff), p, 0);
+    MBEDTLS_PUT_UINT32_LE((uint32_t) (n >> 32), p, 4);
+}
+
+static psa_status_t psa_its_mmap_errno_to_status(int err)
+{
+    switch (err) {
+        case ENOSPC:
+#if defined(EDQUOT)
+        case EDQUOT:
+#endif
+        case EFBIG:
+            return PSA_ERROR_INSUFFICIENT_STORAGE;
+        case ENOMEM:
+            return PSA_ERROR_INSUFFICIENT_MEMORY;
+        default:
+            return PSA_ERROR_STORAGE_FAILURE;
+    }
+}
+
+/*
+ * Superblocks
+ */
+
+static unsigned char *psa_its_mmap_superblock(size_t slot)
+{
+    return psa_its_mmap.map + slot * PSA_ITS_MMAP_SLOT_SIZE;
+}
+
+static uint32_t psa_its_mmap_superblock_crc(const unsigned char *sb,
+                                            uint32_t node_count)
+{
+    uint32_t crc = psa_its_crc_update(PSA_ITS_CRC_INIT, sb,
+                                      PSA_ITS_MMAP_SB_CRC);
+    return psa_its_crc_update(crc, sb + PSA_ITS_MMAP_SUPERBLOCK_HEADER,
+                              (size_t) node_count * PSA_ITS_MMAP_DIR_ENTRY_SIZE);
+}
+
+/* Return 1 if the superblock in slot is intact, 0 otherwise. */
+static int psa_its_mmap_superblock_is_valid(size_t slot)
+{
+    const unsigned char *sb = psa_its_mmap_superblock(slot);
+    uint32_t node_count = MBEDTLS_GET_UINT32_LE(sb, PSA_ITS_MMAP_SB_NODE_COUNT);
+
+    if (memcmp(sb + PSA_ITS_MMAP_SB_MAGIC, PSA_ITS_MMAP_MAGIC_STRING,
+               PSA_ITS_MMAP_MAGIC_LENGTH) != 0) {
+        return 0;
+    }
+    if (node_count > PSA_ITS_MMAP_MAX_NODES) {
+        return 0;
+    }
+    return psa_its_mmap_superblock_crc(sb, node_count) ==
+           MBEDTLS_GET_UINT32_LE(sb, PSA_ITS_MMAP_SB_CRC);
+}
+
+static uint32_t psa_its_mmap_node_count(void)
+{
+    return MBEDTLS_GET_UINT32_LE(psa_its_mmap_superblock(psa_its_mmap.active),
+                                 PSA_ITS_MMAP_SB_NODE_COUNT);
+}
+
+static const unsigned char *psa_its_mmap_dir_entry(uint32_t i)
+{
+    return psa_its_mmap_superblock(psa_its_mmap.active) +
+           PSA_ITS_MMAP_SUPERBLOCK_HEADER + i * PSA_ITS_MMAP_DIR_ENTRY_SIZE;
+}
+
+/*
+ * Index nodes
+ */
+
+static uint32_t psa_its_mmap_node_crc(const unsigned char *node,
+                                      uint32_t count)
+{
+    uint32_t crc = psa_its_crc_update(PSA_ITS_CRC_INIT,
+                                      node + PSA_ITS_MMAP_NODE_COUNT, 4);
+    return psa_its_crc_update(crc, node + PSA_ITS_MMAP_NODE_HEADER,
+                              (size_t) count * PSA_ITS_MMAP_ENTRY_SIZE);
+}
+
+/* Return a pointer to index node i of the current directory, after checking
+ * that it lies within the container and that its CRC is correct. */
+static psa_status_t psa_its_mmap_node(uint32_t i, const unsigned char **p_node)
+{
+    uint64_t offset =
+        psa_its_mmap_get_u64(psa_its_mmap_dir_entry(i) + PSA_ITS_MMAP_DIR_OFFSET);
+    const unsigned char *node;
+    uint32_t count;
+
+    if (offset < 2 * PSA_ITS_MMAP_SLOT_SIZE ||
+        offset > psa_its_mmap.map_size - PSA_ITS_MMAP_NODE_SIZE) {
+        return PSA_ERROR_DATA_CORRUPT;
+    }
+    node = psa_its_mmap.map + offset;
+    if (!psa_its_mmap.verified[i]) {
+        count = MBEDTLS_GET_UINT32_LE(node, PSA_ITS_MMAP_NODE_COUNT);
+        if (count == 0 || count > PSA_ITS_MMAP_NODE_CAPACITY ||
+            psa_its_mmap_node_crc(node, count) !=
+            MBEDTLS_GET_UINT32_LE(node, PSA_ITS_MMAP_NODE_CRC)) {
+            return PSA_ERROR_DATA_CORRUPT;
+        }
+        psa_its_mmap.verified[i] = 1;
+    }
+    *p_node = node;
+    return PSA_SUCCESS;
+}
+
+static const unsigned char *psa_its_mmap_node_entry(const unsigned char *node,
+                                                    uint32_t i)
+{
+    return node + PSA_ITS_MMAP_NODE_HEADER + i * PSA_ITS_MMAP_ENTRY_SIZE;
+}
+
+/* Return the position of uid in node, or the position where it should
+ * be inserted if it is absent. */
+static uint32_t psa_its_mmap_node_search(const unsigned char *node,
+                                         uint32_t count,
+                                         psa_storage_uid_t uid)
+{
+    uint32_t lo = 0;
+    uint32_t hi = count;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (psa_its_mmap_get_u64(psa_its_mmap_node_entry(node, mid) +
+                                 PSA_ITS_MMAP_ENTRY_UID) < uid) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Return the directory position of the node that holds, or should hold,
+ * uid. The directory must not be empty. */
+static uint32_t psa_its_mmap_dir_search(psa_storage_uid_t uid)
+{
+    uint32_t lo = 0;
+    uint32_t hi = psa_its_mmap_node_count();
+
+    /* Find the last node whose first UID is at most uid. */
+    while (hi - lo > 1) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (psa_its_mmap_get_u64(psa_its_mmap_dir_entry(mid) +
+                                 PSA_ITS_MMAP_DIR_FIRST_UID) <= uid) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/* Look up uid. On success, *p_entry points to its entry in the container,
+ * or is NULL if uid is absent. */
+static psa_status_t psa_its_mmap_lookup(psa_storage_uid_t uid,
+                                        const unsigned char **p_entry)
+{
+    psa_status_t status;
+    const unsigned char *node;
+    uint32_t count, i;
+
+    *p_entry = NULL;
+    if (psa_its_mmap_node_count() == 0) {
+        return PSA_SUCCESS;
+    }
+    status = psa_its_mmap_node(psa_its_mmap_dir_search(uid), &node);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    count = MBEDTLS_GET_UINT32_LE(node, PSA_ITS_MMAP_NODE_COUNT);
+    i = psa_its_mmap_node_search(node, count, uid);
+    if (i < count &&
+        psa_its_mmap_get_u64(psa_its_mmap_node_entry(node, i) +
+                             PSA_ITS_MMAP_ENTRY_UID) == uid) {
+        *p_entry = psa_its_mmap_node_entry(node, i);
+    }
+    return PSA_SUCCESS;
+}
+
+/*
+ * Space management
+ *
+ * The list of extents in use is only needed to make updates, so it is
+ * built on the first update. Reads only touch the superblock, one index
+ * node and the data they return.
+ */
+
+static psa_status_t psa_its_mmap_extent_add(uint64_t offset, uint64_t length)
+{
+    size_t lo = 0;
+    size_t hi = psa_its_mmap.extent_count;
+
+    if (psa_its_mmap.extent_count == psa_its_mmap.extent_capacity) {
+        size_t new_capacity = psa_its_mmap.extent_capacity == 0 ?
+                              32 : 2 * psa_its_mmap.extent_capacity;
+        psa_its_mmap_extent_t *new_extents =
+            mbedtls_calloc(new_capacity, sizeof(*new_extents));
+        if (new_extents == NULL) {
+            return PSA_ERROR_INSUFFICIENT_MEMORY;
+        }
+        if (psa_its_mmap.extent_count != 0) {
+            memcpy(new_extents, psa_its_mmap.extents,
+                   psa_its_mmap.extent_count * sizeof(*new_extents));
+        }
+        mbedtls_free(psa_its_mmap.extents);
+        psa_its_mmap.extents = new_extents;
+        psa_its_mmap.extent_capacity = new_capacity;
+    }
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (psa_its_mmap.extents[mid].offset < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    /* Overlapping extents mean that the container is inconsistent. */
+    if ((lo > 0 && psa_its_mmap.extents[lo - 1].offset +
+         psa_its_mmap.extents[lo - 1].length > offset) ||
+        (lo < psa_its_mmap.extent_count &&
+         offset + length > psa_its_mmap.extents[lo].offset)) {
+        return PSA_ERROR_DATA_CORRUPT;
+    }
+    memmove(&psa_its_mmap.extents[lo + 1], &psa_its_mmap.extents[lo],
+            (psa_its_mmap.extent_count - lo) * sizeof(psa_its_mmap_extent_t));
+    psa_its_mmap.extents[lo].offset = offset;
+    psa_its_mmap.extents[lo].length = length;
+    psa_its_mmap.extent_count++;
+    return PSA_SUCCESS;
+}
+
+static void psa_its_mmap_extent_release(uint64_t offset)
+{
+    size_t i;
+
+    for (i = 0; i < psa_its_mmap.extent_count; i++) {
+        if (psa_its_mmap.extents[i].offset == offset) {
+            memmove(&psa_its_mmap.extents[i], &psa_its_mmap.extents[i + 1],
+                    (psa_its_mmap.extent_count - i - 1) *
+                    sizeof(psa_its_mmap_extent_t));
+            psa_its_mmap.extent_count--;
+            return;
+        }
+    }
+}
+
+static psa_status_t psa_its_mmap_load_extents(void)
+{
+    psa_status_t status;
+    uint32_t node_count = psa_its_mmap_node_count();
+    uint32_t i, j;
+
+    if (psa_its_mmap.extents_loaded) {
+        return PSA_SUCCESS;
+    }
+    psa_its_mmap.extent_count = 0;
+
+    for (i = 0; i < node_count; i++) {
+        const unsigned char *node;
+        uint32_t count;
+
+        status = psa_its_mmap_node(i, &node);
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+        status = psa_its_mmap_extent_add((uint64_t) (node - psa_its_mmap.map),
+                                         PSA_ITS_MMAP_NODE_SIZE);
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+        count = MBEDTLS_GET_UINT32_LE(node, PSA_ITS_MMAP_NODE_COUNT);
+        for (j = 0; j < count; j++) {
+            const unsigned char *entry = psa_its_mmap_node_entry(node, j);
+            uint64_t offset =
+                psa_its_mmap_get_u64(entry + PSA_ITS_MMAP_ENTRY_OFFSET);
+            uint32_t size =
+                MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_SIZE_FIELD);
+            if (size == 0) {
+                continue;
+            }
+            status = psa_its_mmap_extent_add(offset, size);
+            if (status != PSA_SUCCESS) {
+                return status;
+            }
+        }
+    }
+
+    psa_its_mmap.extents_loaded = 1;
+    return PSA_SUCCESS;
+}
+
+/* Grow the container and its mapping to at least size bytes. */
+static psa_status_t psa_its_mmap_grow(uint64_t size)
+{
+    size_t new_size;
+    unsigned char *map;
+
+    if (size > SIZE_MAX - PSA_ITS_MMAP_GROW_SIZE) {
+        return PSA_ERROR_INSUFFICIENT_STORAGE;
+    }
+    new_size = (size_t) size + PSA_ITS_MMAP_GROW_SIZE - 1;
+    new_size -= new_size % PSA_ITS_MMAP_GROW_SIZE;
+    if ((off_t) new_size < 0 || (size_t) (off_t) new_size != new_size) {
+        return PSA_ERROR_INSUFFICIENT_STORAGE;
+    }
+
+    if (ftruncate(psa_its_mmap.fd, (off_t) new_size) != 0) {
+        return psa_its_mmap_errno_to_status(errno);
+    }
+    map = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+               psa_its_mmap.fd, 0);
+    if (map == MAP_FAILED) {
+        return psa_its_mmap_errno_to_status(errno);
+    }
+    munmap(psa_its_mmap.map, psa_its_mmap.map_size);
+    psa_its_mmap.map = map;
+    psa_its_mmap.map_size = new_size;
+    return PSA_SUCCESS;
+}
+
+/* Reserve length bytes of free space aligned on align bytes, growing the
+ * container if needed. This may move the mapping. */
+static psa_status_t psa_its_mmap_alloc(uint64_t length, uint64_t align,
+                                       uint64_t *p_offset)
+{
+    psa_status_t status;
+    uint64_t candidate = 2 * PSA_ITS_MMAP_SLOT_SIZE;
+    size_t i;
+
+    for (i = 0; i <= psa_its_mmap.extent_count; i++) {
+        candidate = (candidate + align - 1) / align * align;
+        if (i == psa_its_mmap.extent_count ||
+            candidate + length <= psa_its_mmap.extents[i].offset) {
+            break;
+        }
+        if (psa_its_mmap.extents[i].offset + psa_its_mmap.extents[i].length >
+            candidate) {
+            candidate = psa_its_mmap.extents[i].offset +
+                        psa_its_mmap.extents[i].length;
+        }
+    }
+
+    if (candidate + length > psa_its_mmap.map_size) {
+        status = psa_its_mmap_grow(candidate + length);
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+    }
+    status = psa_its_mmap_extent_add(candidate, length);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    *p_offset = candidate;
+    return PSA_SUCCESS;
+}
+
+/*
+ * Container file management
+ */
+
+static psa_status_t psa_its_mmap_create(void)
+{
+    psa_status_t status = PSA_ERROR_STORAGE_FAILURE;
+    unsigned char *sb = NULL;
+    int fd = -1;
+    size_t written = 0;
+
+    sb = mbedtls_calloc(1, 2 * PSA_ITS_MMAP_SLOT_SIZE);
+    if (sb == NULL) {
+        return PSA_ERROR_INSUFFICIENT_MEMORY;
+    }
+    memcpy(sb + PSA_ITS_MMAP_SB_MAGIC, PSA_ITS_MMAP_MAGIC_STRING,
+           PSA_ITS_MMAP_MAGIC_LENGTH);
+    psa_its_mmap_put_u64(1, sb + PSA_ITS_MMAP_SB_GENERATION);
+    MBEDTLS_PUT_UINT32_LE(psa_its_mmap_superblock_crc(sb, 0),
+                          sb, PSA_ITS_MMAP_SB_CRC);
+
+    fd = open(PSA_ITS_MMAP_TEMP, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        goto exit;
+    }
+    while (written < 2 * PSA_ITS_MMAP_SLOT_SIZE) {
+        ssize_t n = write(fd, sb + written,
+                          2 * PSA_ITS_MMAP_SLOT_SIZE - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            status = psa_its_mmap_errno_to_status(errno);
+            goto exit;
+        }
+        written += (size_t) n;
+    }
+    if (fsync(fd) != 0) {
+        goto exit;
+    }
+    if (close(fd) != 0) {
+        fd = -1;
+        goto exit;
+    }
+    fd = -1;
+    if (rename(PSA_ITS_MMAP_TEMP, PSA_ITS_MMAP_FILENAME) != 0) {
+        goto exit;
+    }
+    status = PSA_SUCCESS;
+
+exit:
+    if (fd >= 0) {
+        close(fd);
+    }
+    (void) remove(PSA_ITS_MMAP_TEMP);
+    mbedtls_free(sb);
+    return status;
+}
+
+/* Map the container if this hasn't been done yet. */
+static psa_status_t psa_its_mmap_open(void)
+{
+    psa_status_t status;
+    struct stat st;
+    int valid0, valid1;
+
+    if (psa_its_mmap.map != NULL) {
+        return PSA_SUCCESS;
+    }
+
+    psa_its_mmap.fd = open(PSA_ITS_MMAP_FILENAME, O_RDWR);
+    if (psa_its_mmap.fd < 0 && errno == ENOENT) {
+        status = psa_its_mmap_create();
+        if (status != PSA_SUCCESS) {
+            return status;
+        }
+        psa_its_mmap.fd = open(PSA_ITS_MMAP_FILENAME, O_RDWR);
+    }
+    if (psa_its_mmap.fd < 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+    psa_its_mmap.has_fd = 1;
+
+    status = PSA_ERROR_STORAGE_FAILURE;
+    if (fstat(psa_its_mmap.fd, &st) != 0) {
+        goto exit;
+    }
+    status = PSA_ERROR_DATA_CORRUPT;
+    if (st.st_size < 2 * PSA_ITS_MMAP_SLOT_SIZE ||
+        (uintmax_t) st.st_size > SIZE_MAX) {
+        goto exit;
+    }
+    psa_its_mmap.map_size = (size_t) st.st_size;
+    psa_its_mmap.map = mmap(NULL, psa_its_mmap.map_size,
+                            PROT_READ | PROT_WRITE, MAP_SHARED,
+                            psa_its_mmap.fd, 0);
+    if (psa_its_mmap.map == MAP_FAILED) {
+        psa_its_mmap.map = NULL;
+        status = psa_its_mmap_errno_to_status(errno);
+        goto exit;
+    }
+
+    valid0 = psa_its_mmap_superblock_is_valid(0);
+    valid1 = psa_its_mmap_superblock_is_valid(1);
+    if (!valid0 && !valid1) {
+        goto exit;
+    }
+    if (valid0 && valid1) {
+        psa_its_mmap.active =
+            psa_its_mmap_get_u64(psa_its_mmap_superblock(1) +
+                                 PSA_ITS_MMAP_SB_GENERATION) >
+            psa_its_mmap_get_u64(psa_its_mmap_superblock(0) +
+                                 PSA_ITS_MMAP_SB_GENERATION);
+    } else {
+        psa_its_mmap.active = valid1;
+    }
+    memset(psa_its_mmap.verified, 0, sizeof(psa_its_mmap.verified));
+    status = PSA_SUCCESS;
+
+exit:
+    if (status != PSA_SUCCESS) {
+        mbedtls_psa_its_mmap_close();
+    }
+    return status;
+}
+
+/* Make the new state described by dir, node_count and entry_count current.
+ * Everything that dir refers to must already be written. */
+static psa_status_t psa_its_mmap_commit(const unsigned char *dir,
+                                        uint32_t node_count,
+                                        uint32_t entry_count)
+{
+    size_t next = 1 - psa_its_mmap.active;
+    unsigned char *sb = psa_its_mmap_superblock(next);
+    uint64_t generation =
+        psa_its_mmap_get_u64(psa_its_mmap_superblock(psa_its_mmap.active) +
+                             PSA_ITS_MMAP_SB_GENERATION);
+
+    /* The superblock must not reach the disk before what it refers to. */
+    if (msync(psa_its_mmap.map, psa_its_mmap.map_size, MS_SYNC) != 0) {
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+
+    memset(sb, 0, PSA_ITS_MMAP_SLOT_SIZE);
+    memcpy(sb + PSA_ITS_MMAP_SB_MAGIC, PSA_ITS_MMAP_MAGIC_STRING,
+           PSA_ITS_MMAP_MAGIC_LENGTH);
+    psa_its_mmap_put_u64(generation + 1, sb + PSA_ITS_MMAP_SB_GENERATION);
+    MBEDTLS_PUT_UINT32_LE(node_count, sb, PSA_ITS_MMAP_SB_NODE_COUNT);
+    MBEDTLS_PUT_UINT32_LE(entry_count, sb, PSA_ITS_MMAP_SB_ENTRY_COUNT);
+    memcpy(sb + PSA_ITS_MMAP_SUPERBLOCK_HEADER, dir,
+           (size_t) node_count * PSA_ITS_MMAP_DIR_ENTRY_SIZE);
+    MBEDTLS_PUT_UINT32_LE(psa_its_mmap_superblock_crc(sb, node_count),
+                          sb, PSA_ITS_MMAP_SB_CRC);
+
+    if (msync(psa_its_mmap.map, psa_its_mmap.map_size, MS_SYNC) != 0) {
+        /* We can't tell whether the new superblock made it to the disk,
+         * so let the next access decide from what is in the file. */
+        mbedtls_psa_its_mmap_close();
+        return PSA_ERROR_STORAGE_FAILURE;
+    }
+
+    psa_its_mmap.active = next;
+    memset(psa_its_mmap.verified, 0, sizeof(psa_its_mmap.verified));
+    return PSA_SUCCESS;
+}
+
+/* Write an index node holding count entries from entries to newly
+ * allocated space. */
+static psa_status_t psa_its_mmap_write_node(const unsigned char *entries,
+                                            uint32_t count,
+                                            uint64_t *p_offset)
+{
+    psa_status_t status;
+    unsigned char *node;
+
+    status = psa_its_mmap_alloc(PSA_ITS_MMAP_NODE_SIZE,
+                                PSA_ITS_MMAP_NODE_SIZE, p_offset);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    node = psa_its_mmap.map + *p_offset;
+    memset(node, 0, PSA_ITS_MMAP_NODE_SIZE);
+    MBEDTLS_PUT_UINT32_LE(count, node, PSA_ITS_MMAP_NODE_COUNT);
+    memcpy(node + PSA_ITS_MMAP_NODE_HEADER, entries,
+           (size_t) count * PSA_ITS_MMAP_ENTRY_SIZE);
+    MBEDTLS_PUT_UINT32_LE(psa_its_mmap_node_crc(node, count),
+                          node, PSA_ITS_MMAP_NODE_CRC);
+    return PSA_SUCCESS;
+}
+
+/* Replace or insert (if data is not NULL), or remove (if data is NULL)
+ * the entry for uid, with shadow paging. */
+static psa_status_t psa_its_mmap_update(psa_storage_uid_t uid,
+                                        uint32_t data_length,
+                                        const void *p_data,
+                                        psa_storage_create_flags_t flags,
+                                        int remove)
+{
+    psa_status_t status;
+    unsigned char *entries = NULL;  /* copy of the affected node's entries */
+    unsigned char *dir = NULL;      /* the new directory */
+    uint32_t node_count, entry_count, count = 0, pos = 0, i = 0;
+    uint32_t new_node_count;
+    uint64_t old_node = 0, old_data = 0, new_data = 0;
+    uint64_t new_nodes[2] = { 0, 0 };
+    int has_old_node = 0, has_old_data = 0, has_new_data = 0, found = 0;
+    unsigned n_new_nodes = 0, k;
+
+    status = psa_its_mmap_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    status = psa_its_mmap_load_extents();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+
+    entries = mbedtls_calloc(PSA_ITS_MMAP_NODE_CAPACITY + 1,
+                             PSA_ITS_MMAP_ENTRY_SIZE);
+    dir = mbedtls_calloc(PSA_ITS_MMAP_MAX_NODES, PSA_ITS_MMAP_DIR_ENTRY_SIZE);
+    if (entries == NULL || dir == NULL) {
+        status = PSA_ERROR_INSUFFICIENT_MEMORY;
+        goto exit;
+    }
+
+    node_count = psa_its_mmap_node_count();
+    entry_count = MBEDTLS_GET_UINT32_LE(
+        psa_its_mmap_superblock(psa_its_mmap.active),
+        PSA_ITS_MMAP_SB_ENTRY_COUNT);
+    memcpy(dir, psa_its_mmap_dir_entry(0),
+           (size_t) node_count * PSA_ITS_MMAP_DIR_ENTRY_SIZE);
+
+    /* Take a private copy of the node that holds, or will hold, uid,
+     * because allocating space may move the mapping. */
+    if (node_count != 0) {
+        const unsigned char *node;
+        pos = psa_its_mmap_dir_search(uid);
+        status = psa_its_mmap_node(pos, &node);
+        if (status != PSA_SUCCESS) {
+            goto exit;
+        }
+        count = MBEDTLS_GET_UINT32_LE(node, PSA_ITS_MMAP_NODE_COUNT);
+        memcpy(entries, psa_its_mmap_node_entry(node, 0),
+               (size_t) count * PSA_ITS_MMAP_ENTRY_SIZE);
+        old_node = (uint64_t) (node - psa_its_mmap.map);
+        has_old_node = 1;
+        i = psa_its_mmap_node_search(node, count, uid);
+        found = (i < count &&
+                 psa_its_mmap_get_u64(entries + i * PSA_ITS_MMAP_ENTRY_SIZE +
+                                      PSA_ITS_MMAP_ENTRY_UID) == uid);
+    }
+    if (found) {
+        const unsigned char *entry = entries + i * PSA_ITS_MMAP_ENTRY_SIZE;
+        if (MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_SIZE_FIELD) != 0) {
+            old_data = psa_its_mmap_get_u64(entry + PSA_ITS_MMAP_ENTRY_OFFSET);
+            has_old_data = 1;
+        }
+    } else if (remove) {
+        status = PSA_ERROR_DOES_NOT_EXIST;
+        goto exit;
+    }
+
+    if (remove) {
+        memmove(entries + i * PSA_ITS_MMAP_ENTRY_SIZE,
+                entries + (i + 1) * PSA_ITS_MMAP_ENTRY_SIZE,
+                (size_t) (count - i - 1) * PSA_ITS_MMAP_ENTRY_SIZE);
+        count--;
+        entry_count--;
+    } else {
+        unsigned char *entry;
+
+        if (data_length != 0) {
+            status = psa_its_mmap_alloc(data_length, PSA_ITS_MMAP_DATA_ALIGN,
+                                        &new_data);
+            if (status != PSA_SUCCESS) {
+                goto exit;
+            }
+            has_new_data = 1;
+            memcpy(psa_its_mmap.map + new_data, p_data, data_length);
+        }
+        if (!found) {
+            memmove(entries + (i + 1) * PSA_ITS_MMAP_ENTRY_SIZE,
+                    entries + i * PSA_ITS_MMAP_ENTRY_SIZE,
+                    (size_t) (count - i) * PSA_ITS_MMAP_ENTRY_SIZE);
+            count++;
+            entry_count++;
+        }
+        entry = entries + i * PSA_ITS_MMAP_ENTRY_SIZE;
+        memset(entry, 0, PSA_ITS_MMAP_ENTRY_SIZE);
+        psa_its_mmap_put_u64(uid, entry + PSA_ITS_MMAP_ENTRY_UID);
+        psa_its_mmap_put_u64(new_data, entry + PSA_ITS_MMAP_ENTRY_OFFSET);
+        MBEDTLS_PUT_UINT32_LE(data_length, entry,
+                              PSA_ITS_MMAP_ENTRY_SIZE_FIELD);
+        MBEDTLS_PUT_UINT32_LE(flags, entry, PSA_ITS_MMAP_ENTRY_FLAGS);
+        MBEDTLS_PUT_UINT32_LE(psa_its_crc_update(PSA_ITS_CRC_INIT, p_data,
+                                                 data_length),
+                              entry, PSA_ITS_MMAP_ENTRY_CRC);
+    }
+
+    /* Write the new node(s), splitting a node that overflows. */
+    if (count > PSA_ITS_MMAP_NODE_CAPACITY) {
+        uint32_t half = count / 2;
+        if (node_count == PSA_ITS_MMAP_MAX_NODES) {
+            status = PSA_ERROR_INSUFFICIENT_STORAGE;
+            goto exit;
+        }
+        status = psa_its_mmap_write_node(entries, half, &new_nodes[0]);
+        if (status != PSA_SUCCESS) {
+            goto exit;
+        }
+        n_new_nodes = 1;
+        status = psa_its_mmap_write_node(
+            entries + half * PSA_ITS_MMAP_ENTRY_SIZE, count - half,
+            &new_nodes[1]);
+        if (status != PSA_SUCCESS) {
+            goto exit;
+        }
+        n_new_nodes = 2;
+    } else if (count != 0) {
+        status = psa_its_mmap_write_node(entries, count, &new_nodes[0]);
+        if (status != PSA_SUCCESS) {
+            goto exit;
+        }
+        n_new_nodes = 1;
+    }
+
+    /* Splice the new node(s) into the directory in place of the old one. */
+    new_node_count = node_count - (has_old_node ? 1 : 0) + n_new_nodes;
+    if (has_old_node) {
+        memmove(dir + (pos + n_new_nodes) * PSA_ITS_MMAP_DIR_ENTRY_SIZE,
+                dir + (pos + 1) * PSA_ITS_MMAP_DIR_ENTRY_SIZE,
+                (size_t) (node_count - pos - 1) * PSA_ITS_MMAP_DIR_ENTRY_SIZE);
+    }
+    for (k = 0; k < n_new_nodes; k++) {
+        unsigned char *d = dir + (pos + k) * PSA_ITS_MMAP_DIR_ENTRY_SIZE;
+        const unsigned char *first =
+            psa_its_mmap.map + new_nodes[k] + PSA_ITS_MMAP_NODE_HEADER;
+        psa_its_mmap_put_u64(new_nodes[k], d + PSA_ITS_MMAP_DIR_OFFSET);
+        psa_its_mmap_put_u64(psa_its_mmap_get_u64(first +
+                                                  PSA_ITS_MMAP_ENTRY_UID),
+                             d + PSA_ITS_MMAP_DIR_FIRST_UID);
+    }
+
+    status = psa_its_mmap_commit(dir, new_node_count, entry_count);
+    if (status != PSA_SUCCESS) {
+        goto exit;
+    }
+
+    /* The old node and data are no longer reachable. */
+    if (has_old_node) {
+        psa_its_mmap_extent_release(old_node);
+    }
+    if (has_old_data) {
+        psa_its_mmap_extent_release(old_data);
+    }
+
+exit:
+    if (status != PSA_SUCCESS && psa_its_mmap.map != NULL) {
+        for (k = 0; k < n_new_nodes; k++) {
+            psa_its_mmap_extent_release(new_nodes[k]);
+        }
+        if (has_new_data) {
+            psa_its_mmap_extent_release(new_data);
+        }
+    }
+    if (entries != NULL) {
+        mbedtls_platform_zeroize(entries, (PSA_ITS_MMAP_NODE_CAPACITY + 1) *
+                                 PSA_ITS_MMAP_ENTRY_SIZE);
+    }
+    mbedtls_free(entries);
+    mbedtls_free(dir);
+    return status;
+}
+
+/*
+ * PSA ITS interface
+ */
+
+psa_status_t psa_its_get_info(psa_storage_uid_t uid,
+                              struct psa_storage_info_t *p_info)
+{
+    psa_status_t status;
+    const unsigned char *entry;
+
+    status = psa_its_mmap_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    status = psa_its_mmap_lookup(uid, &entry);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    if (entry == NULL) {
+        return PSA_ERROR_DOES_NOT_EXIST;
+    }
+    p_info->size = MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_SIZE_FIELD);
+    p_info->flags = MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_FLAGS);
+    return PSA_SUCCESS;
+}
+
+psa_status_t psa_its_get(psa_storage_uid_t uid,
+                         uint32_t data_offset,
+                         uint32_t data_length,
+                         void *p_data,
+                         size_t *p_data_length)
+{
+    psa_status_t status;
+    const unsigned char *entry;
+    uint64_t offset;
+    uint32_t size;
+
+    status = psa_its_mmap_open();
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    status = psa_its_mmap_lookup(uid, &entry);
+    if (status != PSA_SUCCESS) {
+        return status;
+    }
+    if (entry == NULL) {
+        return PSA_ERROR_DOES_NOT_EXIST;
+    }
+    offset = psa_its_mmap_get_u64(entry + PSA_ITS_MMAP_ENTRY_OFFSET);
+    size = MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_SIZE_FIELD);
+
+    if (data_offset + data_length < data_offset) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+#if SIZE_MAX < 0xffffffff
+    if (data_offset + data_length > SIZE_MAX) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+#endif
+    if (data_offset + data_length > size) {
+        return PSA_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (size != 0) {
+        if (offset > psa_its_mmap.map_size ||
+            size > psa_its_mmap.map_size - offset) {
+            return PSA_ERROR_DATA_CORRUPT;
+        }
+        if (psa_its_crc_update(PSA_ITS_CRC_INIT, psa_its_mmap.map + offset,
+                               size) !=
+            MBEDTLS_GET_UINT32_LE(entry, PSA_ITS_MMAP_ENTRY_CRC)) {
+            return PSA_ERROR_DATA_CORRUPT;
+        }
+    }
+    if (data_length != 0) {
+        memcpy(p_data, psa_its_mmap.map + offset + data_offset, data_length);
+    }
+    if (p_data_length != NULL) {
+        *p_data_length = data_length;
+    }
+    return PSA_SUCCESS;
+}
+
+psa_status_t psa_its_set(psa_storage_uid_t uid,
+                         uint32_t data_length,
+                         const void *p_data,
+                         psa_storage_create_flags_t create_flags)
+{
+    if (uid == 0) {
+        return PSA_ERROR_INVALID_HANDLE;
+    }
+    return psa_its_mmap_update(uid, data_length, p_data, create_flags, 0);
+}
+
+psa_status_t psa_its_remove(psa_storage_uid_t uid)
+{
+    return psa_its_mmap_update(uid, 0, NULL, 0, 1);
+}
+
+/*
+ * Mbed TLS extensions
+ */
+
+void mbedtls_psa_its_mmap_close(void)
+{
+    if (psa_its_mmap.map != NULL) {
+        munmap(psa_its_mmap.map, psa_its_mmap.map_size);
+    }
+    if (psa_its_mmap.has_fd) {
+        close(psa_its_mmap.fd);
+    }
+    mbedtls_free(psa_its_mmap.extents);
+    memset(&psa_its_mmap, 0, sizeof(psa_its_mmap));
+}
+
+#endif /* MBEDTLS_PSA_ITS_MMAP_C */
@@ -0,0 +1,615 @@
+/*
+ *  Batching of the private key operations of many SSL handshakes
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * Each operation is a scalar multiplication on an elliptic curve: d * Q for
+ * an ECDHE shared secret, k * G for the ephemeral point of an ECDSA
+ * signature. The start callbacks queue them; a batch takes the whole queue,
+ * and does the multiplications of each curve with mbedtls_ecp_mul_batch(),
+ * so that they share the inversion that converts the results to affine
+ * coordinates.
+ *
+ * An operation belongs to the SSL context that started it, through the
+ * async operation data. Its state tells who may touch it: while QUEUED it is
+ * linked in the queue, while RUNNING the batch computes it without holding
+ * the lock, and once DONE only the SSL context accesses it again. A cancel
+ * during the batch leaves the operation for the batch to free.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_async_batch.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/error.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+#include "ssl_misc.h"
+
+#if defined(MBEDTLS_ECDSA_C)
+#include "mbedtls/ecdsa.h"
+#include "ecdsa_internal.h"
+#endif
+
+#include <string.h>
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_ECDSA_C) && \
+    !defined(MBEDTLS_ECDSA_SIGN_ALT)
+#define SSL_ASYNC_BATCH_SIGN
+#endif
+
+#if defined(SSL_ASYNC_BATCH_SIGN)
+#define SSL_ASYNC_BATCH_OUT_LEN MBEDTLS_ECDSA_MAX_LEN
+#else
+#define SSL_ASYNC_BATCH_OUT_LEN MBEDTLS_ECP_MAX_BYTES
+#endif
+
+typedef enum {
+    SSL_ASYNC_BATCH_OP_KEY_AGREEMENT,
+    SSL_ASYNC_BATCH_OP_SIGN,
+} ssl_async_batch_type;
+
+typedef enum {
+    SSL_ASYNC_BATCH_QUEUED,
+    SSL_ASYNC_BATCH_RUNNING,
+    SSL_ASYNC_BATCH_DONE,
+} ssl_async_batch_state;
+
+struct mbedtls_ssl_async_batch_op {
+    mbedtls_ssl_async_batch_op *next;   /* queue, then list of a batch */
+    mbedtls_ssl_async_batch *batch;
+    ssl_async_batch_type type;
+    ssl_async_batch_state state;        /* protected by the batch mutex */
+    int cancelled;                      /* protected by the batch mutex */
+    int computed;                       /* only used by the batch */
+    uint64_t queued_us;
+    mbedtls_ecp_group_id grp_id;
+    mbedtls_mpi m;                      /* ECDHE private key or ECDSA k */
+    mbedtls_ecp_point P;                /* peer public key (ECDHE) */
+    mbedtls_ecp_point R;                /* m * P, or m * G */
+#if defined(SSL_ASYNC_BATCH_SIGN)
+    const mbedtls_ecp_keypair *key;     /* signing key (ECDSA) */
+    unsigned char hash[MBEDTLS_MD_MAX_SIZE];
+    size_t hash_len;
+#endif
+    unsigned char out[SSL_ASYNC_BATCH_OUT_LEN];
+    size_t out_len;
+    int ret;
+};
+
+static int ssl_async_batch_lock(mbedtls_ssl_async_batch *batch)
+{
+#if defined(MBEDTLS_THREADING_C)
+    return mbedtls_mutex_lock(&batch->mutex);
+#else
+    (void) batch;
+    return 0;
+#endif
+}
+
+static void ssl_async_batch_unlock(mbedtls_ssl_async_batch *batch)
+{
+#if defined(MBEDTLS_THREADING_C)
+    (void) mbedtls_mutex_unlock(&batch->mutex);
+#else
+    (void) batch;
+#endif
+}
+
+static mbedtls_ssl_async_batch_op *ssl_async_batch_op_new(
+    mbedtls_ssl_async_batch *batch, ssl_async_batch_type type)
+{
+    mbedtls_ssl_async_batch_op *op = mbedtls_calloc(1, sizeof(*op));
+
+    if (op == NULL) {
+        return NULL;
+    }
+
+    op->batch = batch;
+    op->type = type;
+    mbedtls_mpi_init(&op->m);
+    mbedtls_ecp_point_init(&op->P);
+    mbedtls_ecp_point_init(&op->R);
+
+    return op;
+}
+
+static void ssl_async_batch_op_free(mbedtls_ssl_async_batch_op *op)
+{
+    mbedtls_mpi_free(&op->m);
+    mbedtls_ecp_point_free(&op->P);
+    mbedtls_ecp_point_free(&op->R);
+    mbedtls_platform_zeroize(op, sizeof(*op));
+    mbedtls_free(op);
+}
+
+void mbedtls_ssl_async_batch_init(mbedtls_ssl_async_batch *batch)
+{
+    memset(batch, 0, sizeof(mbedtls_ssl_async_batch));
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_init(&batch->mutex);
+#endif
+}
+
+int mbedtls_ssl_async_batch_setup(mbedtls_ssl_async_batch *batch,
+                                  size_t max_ops, uint32_t max_delay_us,
+                                  int (*f_rng)(void *, unsigned char *, size_t),
+                                  void *p_rng)
+{
+    if (max_ops == 0 || f_rng == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    batch->max_ops = max_ops;
+    batch->max_delay_us = max_delay_us;
+    batch->f_rng = f_rng;
+    batch->p_rng = p_rng;
+
+    return 0;
+}
+
+/*
+ * Compute the ECDHE shared secret or the ECDSA signature once R is known.
+ */
+static int ssl_async_batch_finish(mbedtls_ssl_async_batch *batch,
+                                  mbedtls_ecp_group *grp,
+                                  mbedtls_ssl_async_batch_op *op)
+{
+#if defined(SSL_ASYNC_BATCH_SIGN)
+    if (op->type == SSL_ASYNC_BATCH_OP_SIGN) {
+        return mbedtls_ecdsa_write_signature_with_point(
+            grp, &op->key->MBEDTLS_PRIVATE(d), &op->m, &op->R,
+            op->hash, op->hash_len, op->out, sizeof(op->out), &op->out_len,
+            batch->f_rng, batch->p_rng);
+    }
+#else
+    (void) batch;
+#endif
+
+    /* Same output as psa_raw_key_agreement() */
+    if (mbedtls_ecp_is_zero(&op->R)) {
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+    }
+    op->out_len = (grp->pbits + 7) / 8;
+    if (mbedtls_ecp_get_type(grp) == MBEDTLS_ECP_TYPE_MONTGOMERY) {
+        return mbedtls_mpi_write_binary_le(&op->R.X, op->out, op->out_len);
+    }
+    return mbedtls_mpi_write_binary(&op->R.X, op->out, op->out_len);
+}
+
+/*
+ * Compute the operations of the list that use the curve grp_id.
+ */
+static void ssl_async_batch_compute_group(mbedtls_ssl_async_batch *batch,
+                                          mbedtls_ssl_async_batch_op *ops,
+                                          mbedtls_ecp_group_id grp_id)
+{
+    int ret;
+    mbedtls_ecp_group grp;
+    mbedtls_ssl_async_batch_op *op;
+    mbedtls_ssl_async_batch_op **members = NULL;
+    mbedtls_ecp_point **R = NULL;
+    const mbedtls_mpi **m = NULL;
+    const mbedtls_ecp_point **P = NULL;
+    size_t count = 0, n = 0, i;
+
+    mbedtls_ecp_group_init(&grp);
+
+    for (op = ops; op != NULL; op = op->next) {
+        if (!op->computed && op->grp_id == grp_id) {
+            count++;
+        }
+    }
+
+    ret = mbedtls_ecp_group_load(&grp, grp_id);
+    if (ret == 0) {
+        members = mbedtls_calloc(count, sizeof(*members));
+        R = mbedtls_calloc(count, sizeof(*R));
+        m = mbedtls_calloc(count, sizeof(*m));
+        P = mbedtls_calloc(count, sizeof(*P));
+        if (members == NULL || R == NULL || m == NULL || P == NULL) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+    }
+
+    /* Check the inputs one by one, so that one bad peer key only fails
+     * its own handshake. */
+    for (op = ops; op != NULL; op = op->next) {
+        if (op->computed || op->grp_id != grp_id) {
+            continue;
+        }
+        op->computed = 1;
+
+        op->ret = ret;
+        if (op->ret != 0) {
+            continue;
+        }
+
+#if defined(SSL_ASYNC_BATCH_SIGN)
+        if (op->type == SSL_ASYNC_BATCH_OP_SIGN) {
+            op->ret = mbedtls_ecp_gen_privkey(&grp, &op->m,
+                                              batch->f_rng, batch->p_rng);
+            P[n] = &grp.G;
+        } else
+#endif
+        {
+            op->ret = mbedtls_ecp_check_privkey(&grp, &op->m);
+            if (op->ret == 0) {
+                op->ret = mbedtls_ecp_check_pubkey(&grp, &op->P);
+            }
+            P[n] = &op->P;
+        }
+
+        if (op->ret == 0) {
+            members[n] = op;
+            R[n] = &op->R;
+            m[n] = &op->m;
+            n++;
+        }
+    }
+
+    if (n > 0) {
+        ret = mbedtls_ecp_mul_batch(&grp, R, m, P, n,
+                                    batch->f_rng, batch->p_rng);
+        for (i = 0; i < n; i++) {
+            members[i]->ret = ret != 0 ? ret :
+                              ssl_async_batch_finish(batch, &grp, members[i]);
+        }
+    }
+
+    mbedtls_free(members);
+    mbedtls_free(R);
+    mbedtls_free(m);
+    mbedtls_free(P);
+    mbedtls_ecp_group_free(&grp);
+}
+
+/*
+ * Take the whole queue and compute it, curve by curve.
+ */
+static int ssl_async_batch_run(mbedtls_ssl_async_batch *batch)
+{
+    int ret;
+    mbedtls_ssl_async_batch_op *ops, *op, *next;
+    int done = 0;
+
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        return ret;
+    }
+    ops = batch->head;
+    batch->head = NULL;
+    batch->tail = NULL;
+    batch->queued = 0;
+    for (op = ops; op != NULL; op = op->next) {
+        op->state = SSL_ASYNC_BATCH_RUNNING;
+    }
+    ssl_async_batch_unlock(batch);
+
+    for (op = ops; op != NULL; op = op->next) {
+        if (!op->computed) {
+            ssl_async_batch_compute_group(batch, ops, op->grp_id);
+        }
+    }
+
+    /* Hand the results over to the SSL contexts, even if the lock fails:
+     * they would wait for ever otherwise. */
+    ret = ssl_async_batch_lock(batch);
+    for (op = ops; op != NULL; op = next) {
+        next = op->next;
+        op->next = NULL;
+        if (op->cancelled) {
+            ssl_async_batch_op_free(op);
+        } else {
+            op->state = SSL_ASYNC_BATCH_DONE;
+            done++;
+        }
+    }
+    batch->completed += done;
+    if (ret == 0) {
+        ssl_async_batch_unlock(batch);
+    }
+
+    return done;
+}
+
+/*
+ * Queue an operation on behalf of ssl, and run the batch if it is full.
+ */
+static int ssl_async_batch_enqueue(mbedtls_ssl_context *ssl,
+                                   mbedtls_ssl_async_batch_op *op)
+{
+    int ret;
+    mbedtls_ssl_async_batch *batch = op->batch;
+    int full;
+
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        ssl_async_batch_op_free(op);
+        return ret;
+    }
+    op->state = SSL_ASYNC_BATCH_QUEUED;
+    op->queued_us = batch->now_us;
+    if (batch->tail == NULL) {
+        batch->head = op;
+    } else {
+        batch->tail->next = op;
+    }
+    batch->tail = op;
+    batch->queued++;
+    full = batch->queued >= batch->max_ops;
+    ssl_async_batch_unlock(batch);
+
+    mbedtls_ssl_set_async_operation_data(ssl, op);
+
+    if (!full) {
+        return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+    }
+
+    if ((ret = ssl_async_batch_run(batch)) < 0) {
+        return ret;
+    }
+
+    /* Another thread may have taken the queue in the meantime */
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        return ret;
+    }
+    ret = op->state == SSL_ASYNC_BATCH_DONE ?
+          0 : MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+    ssl_async_batch_unlock(batch);
+
+    return ret;
+}
+
+#if defined(MBEDTLS_X509_CRT_PARSE_C) && defined(MBEDTLS_ECDSA_C)
+int mbedtls_ssl_async_batch_sign(mbedtls_ssl_context *ssl,
+                                 mbedtls_x509_crt *cert,
+                                 mbedtls_md_type_t md_alg,
+                                 const unsigned char *hash,
+                                 size_t hash_len)
+{
+#if defined(SSL_ASYNC_BATCH_SIGN)
+    mbedtls_ssl_async_batch *batch = ssl->conf->p_async_config_data;
+    mbedtls_pk_context *pk = mbedtls_ssl_own_key(ssl);
+    const mbedtls_ecp_keypair *key;
+    mbedtls_ssl_async_batch_op *op;
+
+    (void) cert;
+    (void) md_alg;
+
+    /* The pk context type tells that mbedtls_pk_ec() is safe: opaque keys
+     * are left to the library. */
+    if (pk == NULL ||
+        (mbedtls_pk_get_type(pk) != MBEDTLS_PK_ECKEY &&
+         mbedtls_pk_get_type(pk) != MBEDTLS_PK_ECDSA)) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+    key = mbedtls_pk_ec(*pk);
+    if (!mbedtls_ecdsa_can_do(key->MBEDTLS_PRIVATE(grp).id)) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+    if (hash_len > MBEDTLS_MD_MAX_SIZE) {
+        return MBEDTLS_ERR_PK_BAD_INPUT_DATA;
+    }
+
+    op = ssl_async_batch_op_new(batch, SSL_ASYNC_BATCH_OP_SIGN);
+    if (op == NULL) {
+        return MBEDTLS_ERR_PK_ALLOC_FAILED;
+    }
+    op->grp_id = key->MBEDTLS_PRIVATE(grp).id;
+    op->key = key;
+    memcpy(op->hash, hash, hash_len);
+    op->hash_len = hash_len;
+
+    return ssl_async_batch_enqueue(ssl, op);
+#else
+    (void) ssl;
+    (void) cert;
+    (void) md_alg;
+    (void) hash;
+    (void) hash_len;
+
+    return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+#endif /* SSL_ASYNC_BATCH_SIGN */
+}
+#endif /* MBEDTLS_X509_CRT_PARSE_C && MBEDTLS_ECDSA_C */
+
+int mbedtls_ssl_async_batch_key_agreement(mbedtls_ssl_context *ssl,
+                                          uint16_t group,
+                                          const unsigned char *own_key,
+                                          size_t own_key_len,
+                                          const unsigned char *peer_key,
+                                          size_t peer_key_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_async_batch *batch = ssl->conf->p_async_config_data;
+    mbedtls_ecp_group_id grp_id;
+    mbedtls_ecp_keypair own;
+    mbedtls_ssl_async_batch_op *op;
+
+    grp_id = mbedtls_ssl_get_ecp_group_id_from_tls_id(group);
+    if (grp_id == MBEDTLS_ECP_DP_NONE) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    op = ssl_async_batch_op_new(batch, SSL_ASYNC_BATCH_OP_KEY_AGREEMENT);
+    if (op == NULL) {
+        return MBEDTLS_ERR_ECP_ALLOC_FAILED;
+    }
+    op->grp_id = grp_id;
+
+    /* The key formats are those of psa_export_key() and
+     * psa_export_public_key(), which these functions read for both types
+     * of curves. The peer key is validated by the batch. */
+    mbedtls_ecp_keypair_init(&own);
+    MBEDTLS_MPI_CHK(mbedtls_ecp_read_key(grp_id, &own, own_key, own_key_len));
+    MBEDTLS_MPI_CHK(mbedtls_mpi_copy(&op->m, &own.MBEDTLS_PRIVATE(d)));
+    MBEDTLS_MPI_CHK(mbedtls_ecp_point_read_binary(&own.MBEDTLS_PRIVATE(grp),
+                                                  &op->P,
+                                                  peer_key, peer_key_len));
+
+cleanup:
+    mbedtls_ecp_keypair_free(&own);
+    if (ret != 0) {
+        ssl_async_batch_op_free(op);
+        return ret;
+    }
+
+    return ssl_async_batch_enqueue(ssl, op);
+}
+
+int mbedtls_ssl_async_batch_resume(mbedtls_ssl_context *ssl,
+                                   unsigned char *output,
+                                   size_t *output_len,
+                                   size_t output_size)
+{
+    int ret;
+    mbedtls_ssl_async_batch_op *op = mbedtls_ssl_get_async_operation_data(ssl);
+    mbedtls_ssl_async_batch *batch = op->batch;
+    int done;
+
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        return ret;
+    }
+    done = op->state == SSL_ASYNC_BATCH_DONE;
+    ssl_async_batch_unlock(batch);
+
+    if (!done) {
+        return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+    }
+
+    ret = op->ret;
+    if (ret == 0) {
+        if (op->out_len > output_size) {
+            ret = MBEDTLS_ERR_ECP_BUFFER_TOO_SMALL;
+        } else {
+            memcpy(output, op->out, op->out_len);
+            *output_len = op->out_len;
+        }
+    }
+
+    ssl_async_batch_op_free(op);
+    mbedtls_ssl_set_async_operation_data(ssl, NULL);
+
+    return ret;
+}
+
+void mbedtls_ssl_async_batch_cancel(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_async_batch_op *op = mbedtls_ssl_get_async_operation_data(ssl);
+    mbedtls_ssl_async_batch *batch;
+    mbedtls_ssl_async_batch_op *prev = NULL, *cur;
+    int owned = 1;
+
+    if (op == NULL) {
+        return;
+    }
+    batch = op->batch;
+    mbedtls_ssl_set_async_operation_data(ssl, NULL);
+
+    if (ssl_async_batch_lock(batch) != 0) {
+        /* Leak the operation rather than risk freeing it under a batch */
+        return;
+    }
+    if (op->state == SSL_ASYNC_BATCH_QUEUED) {
+        for (cur = batch->head; cur != op; cur = cur->next) {
+            prev = cur;
+        }
+        if (prev == NULL) {
+            batch->head = op->next;
+        } else {
+            prev->next = op->next;
+        }
+        if (batch->tail == op) {
+            batch->tail = prev;
+        }
+        batch->queued--;
+    } else if (op->state == SSL_ASYNC_BATCH_RUNNING) {
+        op->cancelled = 1;
+        owned = 0;
+    }
+    ssl_async_batch_unlock(batch);
+
+    if (owned) {
+        ssl_async_batch_op_free(op);
+    }
+}
+
+int mbedtls_ssl_async_batch_poll(mbedtls_ssl_async_batch *batch,
+                                 uint64_t now_us)
+{
+    int ret;
+    int due;
+
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        return ret;
+    }
+    batch->now_us = now_us;
+    due = batch->head != NULL &&
+          (batch->queued >= batch->max_ops ||
+           now_us - batch->head->queued_us >= batch->max_delay_us);
+    ssl_async_batch_unlock(batch);
+
+    if (due && (ret = ssl_async_batch_run(batch)) < 0) {
+        return ret;
+    }
+
+    if ((ret = ssl_async_batch_lock(batch)) != 0) {
+        return ret;
+    }
+    ret = (int) batch->completed;
+    batch->completed = 0;
+    ssl_async_batch_unlock(batch);
+
+    return ret;
+}
+
+int mbedtls_ssl_async_batch_flush(mbedtls_ssl_async_batch *batch)
+{
+    return ssl_async_batch_run(batch);
+}
+
+size_t mbedtls_ssl_async_batch_queued(mbedtls_ssl_async_batch *batch)
+{
+    size_t queued;
+
+    if (ssl_async_batch_lock(batch) != 0) {
+        return 0;
+    }
+    queued = batch->queued;
+    ssl_async_batch_unlock(batch);
+
+    return queued;
+}
+
+void mbedtls_ssl_async_batch_free(mbedtls_ssl_async_batch *batch)
+{
+    if (batch == NULL) {
+        return;
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_free(&batch->mutex);
+#endif
+
+    mbedtls_platform_zeroize(batch, sizeof(mbedtls_ssl_async_batch));
+}
+
+#endif /* MBEDTLS_SSL_ASYNC_BATCH_C */
@@ -0,0 +1,215 @@
+/*
+ *  Pool of SSL record buffers shared between connections
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * Free buffers are kept in one singly linked list per buffer size. The
+ * link to the next free buffer is stored in the first bytes of each free
+ * buffer, which are otherwise zero, so the pool needs no memory of its own.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+
+#include "mbedtls/ssl_buffer_pool.h"
+
+#include <string.h>
+
+/* Size of the link to the next free buffer */
+#define SSL_BUFFER_POOL_LINK_LEN sizeof(unsigned char *)
+
+void mbedtls_ssl_buffer_pool_init(mbedtls_ssl_buffer_pool *pool)
+{
+    memset(pool, 0, sizeof(mbedtls_ssl_buffer_pool));
+
+    pool->max_free = MBEDTLS_SSL_BUFFER_POOL_DEFAULT_MAX_FREE;
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_init(&pool->mutex);
+#endif
+}
+
+void mbedtls_ssl_buffer_pool_set_max_free(mbedtls_ssl_buffer_pool *pool,
+                                          size_t max_free)
+{
+    pool->max_free = max_free;
+}
+
+/* Find the class of buffers of size len, assigning a new class if create
+ * is set and one is unused. Return NULL if buffers of this size are not
+ * pooled. */
+static mbedtls_ssl_buffer_pool_class *ssl_buffer_pool_find_class(
+    mbedtls_ssl_buffer_pool *pool, size_t len, int create)
+{
+    mbedtls_ssl_buffer_pool_class *unused = NULL;
+    size_t i;
+
+    /* Free buffers must be able to hold the chain pointer. */
+    if (len < SSL_BUFFER_POOL_LINK_LEN) {
+        return NULL;
+    }
+
+    for (i = 0; i < MBEDTLS_SSL_BUFFER_POOL_CLASSES; i++) {
+        if (pool->classes[i].len == len) {
+            return &pool->classes[i];
+        }
+        if (pool->classes[i].len == 0 && unused == NULL) {
+            unused = &pool->classes[i];
+        }
+    }
+
+    if (create && unused != NULL) {
+        unused->len = len;
+        return unused;
+    }
+    return NULL;
+}
+
+unsigned char *mbedtls_ssl_buffer_pool_acquire(void *p_pool, size_t len)
+{
+    mbedtls_ssl_buffer_pool *pool = (mbedtls_ssl_buffer_pool *) p_pool;
+    mbedtls_ssl_buffer_pool_class *cls;
+    unsigned char *buf = NULL;
+
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_lock(&pool->mutex) != 0) {
+        return NULL;
+    }
+#endif
+
+    cls = ssl_buffer_pool_find_class(pool, len, 1);
+    if (cls != NULL && cls->free_list != NULL) {
+        buf = cls->free_list;
+        memcpy(&cls->free_list, buf, SSL_BUFFER_POOL_LINK_LEN);
+        mbedtls_platform_zeroize(buf, SSL_BUFFER_POOL_LINK_LEN);
+        cls->free_count--;
+        pool->stats.cached--;
+        pool->stats.cached_bytes -= len;
+        pool->stats.reused++;
+    } else {
+        buf = mbedtls_calloc(1, len);
+    }
+
+    if (buf == NULL) {
+        pool->stats.failed++;
+    } else {
+        pool->stats.acquired++;
+        pool->stats.in_use++;
+        if (pool->stats.in_use > pool->stats.in_use_peak) {
+            pool->stats.in_use_peak = pool->stats.in_use;
+        }
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&pool->mutex) != 0) {
+        mbedtls_free(buf);
+        return NULL;
+    }
+#endif
+
+    return buf;
+}
+
+void mbedtls_ssl_buffer_pool_release(void *p_pool, unsigned char *buf,
+                                     size_t len)
+{
+    mbedtls_ssl_buffer_pool *pool = (mbedtls_ssl_buffer_pool *) p_pool;
+    mbedtls_ssl_buffer_pool_class *cls;
+
+    if (buf == NULL) {
+        return;
+    }
+
+    mbedtls_platform_zeroize(buf, len);
+
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_lock(&pool->mutex) != 0) {
+        mbedtls_free(buf);
+        return;
+    }
+#endif
+
+    pool->stats.in_use--;
+
+    cls = ssl_buffer_pool_find_class(pool, len, 0);
+    if (cls != NULL && cls->free_count < pool->max_free) {
+        memcpy(buf, &cls->free_list, SSL_BUFFER_POOL_LINK_LEN);
+        cls->free_list = buf;
+        cls->free_count++;
+        pool->stats.cached++;
+        pool->stats.cached_bytes += len;
+        buf = NULL;
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    (void) mbedtls_mutex_unlock(&pool->mutex);
+#endif
+
+    mbedtls_free(buf);
+}
+
+int mbedtls_ssl_buffer_pool_get_stats(mbedtls_ssl_buffer_pool *pool,
+                                      mbedtls_ssl_buffer_pool_stats *stats)
+{
+#if defined(MBEDTLS_THREADING_C)
+    int ret;
+
+    if ((ret = mbedtls_mutex_lock(&pool->mutex)) != 0) {
+        return ret;
+    }
+#endif
+
+    *stats = pool->stats;
+
+#if defined(MBEDTLS_THREADING_C)
+    if ((ret = mbedtls_mutex_unlock(&pool->mutex)) != 0) {
+        return ret;
+    }
+#endif
+
+    return 0;
+}
+
+void mbedtls_ssl_buffer_pool_free(mbedtls_ssl_buffer_pool *pool)
+{
+    unsigned char *buf;
+    size_t i;
+
+    if (pool == NULL) {
+        return;
+    }
+
+    for (i = 0; i < MBEDTLS_SSL_BUFFER_POOL_CLASSES; i++) {
+        while ((buf = pool->classes[i].free_list) != NULL) {
+            memcpy(&pool->classes[i].free_list, buf,
+                   SSL_BUFFER_POOL_LINK_LEN);
+            mbedtls_free(buf);
+        }
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_free(&pool->mutex);
+#endif
+
+    mbedtls_platform_zeroize(pool, sizeof(mbedtls_ssl_buffer_pool));
+}
+
+#endif /* MBEDTLS_SSL_BUFFER_POOL_C */
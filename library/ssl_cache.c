@@ -17,8 +17,10 @@
  *  limitations under the License.
  */
 /*
- * These session callbacks use a simple chained list
- * to store and retrieve the session information.
+ * These session callbacks keep sessions in MBEDTLS_SSL_CACHE_SHARDS
+ * independently locked shards. Each shard is an open-addressed hash table
+ * of entries keyed by session ID, with linear probing, and a doubly linked
+ * list of the same entries from the most to the least recently used.
  */
 
 #include "common.h"
@@ -32,93 +34,68 @@
 
 #include <string.h>
 
+/* Maximum number of expired entries freed by each cache access */
+#define SSL_CACHE_EXPIRE_STEPS  4
+
 void mbedtls_ssl_cache_init(mbedtls_ssl_cache_context *cache)
 {
+#if defined(MBEDTLS_THREADING_C)
+    size_t i;
+#endif
+
     memset(cache, 0, sizeof(mbedtls_ssl_cache_context));
 
     cache->timeout = MBEDTLS_SSL_CACHE_DEFAULT_TIMEOUT;
     cache->max_entries = MBEDTLS_SSL_CACHE_DEFAULT_MAX_ENTRIES;
 
 #if defined(MBEDTLS_THREADING_C)
-    mbedtls_mutex_init(&cache->mutex);
+    for (i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++) {
+        mbedtls_mutex_init(&cache->shards[i].mutex);
+    }
 #endif
 }
 
-MBEDTLS_CHECK_RETURN_CRITICAL
-static int ssl_cache_find_entry(mbedtls_ssl_cache_context *cache,
-                                unsigned char const *session_id,
-                                size_t session_id_len,
-                                mbedtls_ssl_cache_entry **dst)
+/* FNV-1a: session IDs are random, any cheap mix will do */
+static uint32_t ssl_cache_hash(unsigned char const *session_id,
+                               size_t session_id_len)
 {
-    int ret = 1;
-#if defined(MBEDTLS_HAVE_TIME)
-    mbedtls_time_t t = mbedtls_time(NULL);
-#endif
-    mbedtls_ssl_cache_entry *cur;
-
-    for (cur = cache->chain; cur != NULL; cur = cur->next) {
-#if defined(MBEDTLS_HAVE_TIME)
-        if (cache->timeout != 0 &&
-            (int) (t - cur->timestamp) > cache->timeout) {
-            continue;
-        }
-#endif
+    uint32_t hash = 0x811c9dc5;
+    size_t i;
 
-        if (session_id_len != cur->session_id_len ||
-            memcmp(session_id, cur->session_id,
-                   cur->session_id_len) != 0) {
-            continue;
-        }
-
-        break;
-    }
-
-    if (cur != NULL) {
-        *dst = cur;
-        ret = 0;
+    for (i = 0; i < session_id_len; i++) {
+        hash ^= session_id[i];
+        hash *= 0x01000193;
     }
 
-    return ret;
+    return hash;
 }
 
-
-int mbedtls_ssl_cache_get(void *data,
-                          unsigned char const *session_id,
-                          size_t session_id_len,
-                          mbedtls_ssl_session *session)
+/* Small caches use fewer shards, so that each shard holds an entry at least */
+static size_t ssl_cache_shards_in_use(int max_entries)
 {
-    int ret = 1;
-    mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
-    mbedtls_ssl_cache_entry *entry;
-
-#if defined(MBEDTLS_THREADING_C)
-    if ((ret = mbedtls_mutex_lock(&cache->mutex)) != 0) {
-        return ret;
+    if (max_entries <= 1) {
+        return 1;
     }
-#endif
-
-    ret = ssl_cache_find_entry(cache, session_id, session_id_len, &entry);
-    if (ret != 0) {
-        goto exit;
-    }
-
-    ret = mbedtls_ssl_session_load(session,
-                                   entry->session,
-                                   entry->session_len);
-    if (ret != 0) {
-        goto exit;
+    if (max_entries < MBEDTLS_SSL_CACHE_SHARDS) {
+        return (size_t) max_entries;
     }
+    return MBEDTLS_SSL_CACHE_SHARDS;
+}
 
-    ret = 0;
+/* Share of max_entries held by the shard of index idx out of n */
+static size_t ssl_cache_shard_max(const mbedtls_ssl_cache_context *cache,
+                                  size_t idx, size_t n)
+{
+    size_t max = (size_t) cache->max_entries;
 
-exit:
-#if defined(MBEDTLS_THREADING_C)
-    if (mbedtls_mutex_unlock(&cache->mutex) != 0) {
-        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
-    }
-#endif
+    return max / n + (idx < max % n ? 1 : 0);
+}
 
-    return ret;
+/* The shard is picked by hash % n, the slot by the remaining bits */
+static size_t ssl_cache_home(const mbedtls_ssl_cache_shard *shard,
+                             uint32_t hash, size_t n)
+{
+    return (size_t) (hash / n) & (shard->table_size - 1);
 }
 
 /* zeroize a cache entry */
@@ -138,120 +115,257 @@ static void ssl_cache_entry_zeroize(mbedtls_ssl_cache_entry *entry)
     mbedtls_platform_zeroize(entry, sizeof(mbedtls_ssl_cache_entry));
 }
 
-MBEDTLS_CHECK_RETURN_CRITICAL
-static int ssl_cache_pick_writing_slot(mbedtls_ssl_cache_context *cache,
-                                       unsigned char const *session_id,
-                                       size_t session_id_len,
-                                       mbedtls_ssl_cache_entry **dst)
+static void ssl_cache_lru_unlink(mbedtls_ssl_cache_shard *shard,
+                                 mbedtls_ssl_cache_entry *entry)
 {
-#if defined(MBEDTLS_HAVE_TIME)
-    mbedtls_time_t t = mbedtls_time(NULL), oldest = 0;
-#endif /* MBEDTLS_HAVE_TIME */
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        shard->lru_head = entry->next;
+    }
 
-    mbedtls_ssl_cache_entry *old = NULL;
-    int count = 0;
-    mbedtls_ssl_cache_entry *cur, *last;
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        shard->lru_tail = entry->prev;
+    }
 
-    /* Check 1: Is there already an entry with the given session ID?
-     *
-     * If yes, overwrite it.
-     *
-     * If not, `count` will hold the size of the session cache
-     * at the end of this loop, and `last` will point to the last
-     * entry, both of which will be used later. */
-
-    last = NULL;
-    for (cur = cache->chain; cur != NULL; cur = cur->next) {
-        count++;
-        if (session_id_len == cur->session_id_len &&
-            memcmp(session_id, cur->session_id, cur->session_id_len) == 0) {
-            goto found;
-        }
-        last = cur;
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void ssl_cache_lru_push(mbedtls_ssl_cache_shard *shard,
+                               mbedtls_ssl_cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = shard->lru_head;
+
+    if (shard->lru_head != NULL) {
+        shard->lru_head->prev = entry;
+    } else {
+        shard->lru_tail = entry;
     }
+    shard->lru_head = entry;
+}
 
-    /* Check 2: Is there an outdated entry in the cache?
-     *
-     * If so, overwrite it.
-     *
-     * If not, remember the oldest entry in `old` for later.
-     */
+/* Return the slot holding the given session ID, or SIZE_MAX */
+static size_t ssl_cache_find_slot(const mbedtls_ssl_cache_shard *shard,
+                                  size_t n, uint32_t hash,
+                                  unsigned char const *session_id,
+                                  size_t session_id_len)
+{
+    size_t mask, i;
+    const mbedtls_ssl_cache_entry *cur;
 
-#if defined(MBEDTLS_HAVE_TIME)
-    for (cur = cache->chain; cur != NULL; cur = cur->next) {
-        if (cache->timeout != 0 &&
-            (int) (t - cur->timestamp) > cache->timeout) {
-            goto found;
-        }
+    if (shard->table_size == 0) {
+        return SIZE_MAX;
+    }
 
-        if (oldest == 0 || cur->timestamp < oldest) {
-            oldest = cur->timestamp;
-            old = cur;
+    /* The table is at most half full, so there always is an empty slot */
+    mask = shard->table_size - 1;
+    for (i = ssl_cache_home(shard, hash, n);
+         (cur = shard->table[i]) != NULL;
+         i = (i + 1) & mask) {
+        if (cur->hash == hash &&
+            cur->session_id_len == session_id_len &&
+            memcmp(cur->session_id, session_id, session_id_len) == 0) {
+            return i;
         }
     }
-#endif /* MBEDTLS_HAVE_TIME */
 
-    /* Check 3: Is there free space in the cache? */
+    return SIZE_MAX;
+}
 
-    if (count < cache->max_entries) {
-        /* Create new entry */
-        cur = mbedtls_calloc(1, sizeof(mbedtls_ssl_cache_entry));
-        if (cur == NULL) {
-            return 1;
-        }
+static void ssl_cache_insert(mbedtls_ssl_cache_shard *shard, size_t n,
+                             mbedtls_ssl_cache_entry *entry)
+{
+    size_t mask = shard->table_size - 1;
+    size_t i = ssl_cache_home(shard, entry->hash, n);
+
+    while (shard->table[i] != NULL) {
+        i = (i + 1) & mask;
+    }
+
+    shard->table[i] = entry;
+    ssl_cache_lru_push(shard, entry);
+    shard->count++;
+}
+
+/*
+ * Free the entry in the given slot. Instead of leaving a tombstone, move
+ * back the entries that follow it in the same probe sequence, so that
+ * lookups never need to probe past deleted entries.
+ */
+static void ssl_cache_remove_slot(mbedtls_ssl_cache_shard *shard, size_t n,
+                                  size_t slot)
+{
+    size_t mask = shard->table_size - 1;
+    size_t hole = slot, i, home;
+    mbedtls_ssl_cache_entry *entry = shard->table[slot];
+
+    ssl_cache_lru_unlink(shard, entry);
+    ssl_cache_entry_zeroize(entry);
+    mbedtls_free(entry);
+    shard->count--;
 
-        /* Append to the end of the linked list. */
-        if (last == NULL) {
-            cache->chain = cur;
-        } else {
-            last->next = cur;
+    for (i = (slot + 1) & mask; shard->table[i] != NULL; i = (i + 1) & mask) {
+        home = ssl_cache_home(shard, shard->table[i]->hash, n);
+
+        /* Move the entry unless its home lies between the hole and it */
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            shard->table[hole] = shard->table[i];
+            hole = i;
         }
+    }
+
+    shard->table[hole] = NULL;
+}
 
-        goto found;
+static void ssl_cache_remove_entry(mbedtls_ssl_cache_shard *shard, size_t n,
+                                   mbedtls_ssl_cache_entry *entry)
+{
+    size_t mask = shard->table_size - 1;
+    size_t i = ssl_cache_home(shard, entry->hash, n);
+
+    while (shard->table[i] != entry) {
+        i = (i + 1) & mask;
     }
 
-    /* Last resort: The cache is full and doesn't contain any outdated
-     * elements. In this case, we evict the oldest one, judged by timestamp
-     * (if present) or cache-order. */
+    ssl_cache_remove_slot(shard, n, i);
+}
 
 #if defined(MBEDTLS_HAVE_TIME)
-    if (old == NULL) {
-        /* This should only happen on an ill-configured cache
-         * with max_entries == 0. */
-        return 1;
+static int ssl_cache_entry_expired(const mbedtls_ssl_cache_context *cache,
+                                   const mbedtls_ssl_cache_entry *entry,
+                                   mbedtls_time_t t)
+{
+    return cache->timeout != 0 &&
+           (int) (t - entry->timestamp) > cache->timeout;
+}
+
+/*
+ * Incremental expiry: rather than scanning the whole shard, free a few
+ * expired entries from the least recently used end on each access. Other
+ * expired entries are freed when they are looked up or reach that end.
+ */
+static void ssl_cache_expire(const mbedtls_ssl_cache_context *cache,
+                             mbedtls_ssl_cache_shard *shard, size_t n,
+                             mbedtls_time_t t)
+{
+    int steps;
+
+    for (steps = 0; steps < SSL_CACHE_EXPIRE_STEPS; steps++) {
+        if (shard->lru_tail == NULL ||
+            !ssl_cache_entry_expired(cache, shard->lru_tail, t)) {
+            break;
+        }
+
+        ssl_cache_remove_entry(shard, n, shard->lru_tail);
     }
-#else /* MBEDTLS_HAVE_TIME */
-    /* Reuse first entry in chain, but move to last place. */
-    if (cache->chain == NULL) {
-        return 1;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+/* Make sure the table stays at most half full with max entries */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_cache_reserve(mbedtls_ssl_cache_shard *shard, size_t n,
+                             size_t max)
+{
+    mbedtls_ssl_cache_entry **old_table = shard->table;
+    mbedtls_ssl_cache_entry *cur, *last;
+    size_t size = 4;
+
+    while (size < 2 * max) {
+        size <<= 1;
     }
 
-    old = cache->chain;
-    cache->chain = old->next;
-    old->next = NULL;
-    last->next = old;
-#endif /* MBEDTLS_HAVE_TIME */
+    if (size <= shard->table_size) {
+        return 0;
+    }
+
+    shard->table = mbedtls_calloc(size, sizeof(mbedtls_ssl_cache_entry *));
+    if (shard->table == NULL) {
+        shard->table = old_table;
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    shard->table_size = size;
+
+    /* Rehash from the least recently used entry so that the order of the
+     * LRU list is preserved by ssl_cache_insert(). */
+    last = shard->lru_tail;
+    shard->lru_head = NULL;
+    shard->lru_tail = NULL;
+    shard->count = 0;
+    while ((cur = last) != NULL) {
+        last = cur->prev;
+        ssl_cache_insert(shard, n, cur);
+    }
 
-    /* Now `old` points to the oldest entry to be overwritten. */
-    cur = old;
+    mbedtls_free(old_table);
 
-found:
+    return 0;
+}
 
-    /* If we're reusing an entry, free it first. */
-    if (cur->session != NULL) {
-        /* `ssl_cache_entry_zeroize` would break the chain,
-         * so we reuse `old` to record `next` temporarily. */
-        old = cur->next;
-        ssl_cache_entry_zeroize(cur);
-        cur->next = old;
+int mbedtls_ssl_cache_get(void *data,
+                          unsigned char const *session_id,
+                          size_t session_id_len,
+                          mbedtls_ssl_session *session)
+{
+    int ret = 1;
+    mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
+    uint32_t hash = ssl_cache_hash(session_id, session_id_len);
+    size_t n = ssl_cache_shards_in_use(cache->max_entries);
+    mbedtls_ssl_cache_shard *shard = &cache->shards[hash % n];
+    mbedtls_ssl_cache_entry *entry;
+    size_t slot;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
+
+#if defined(MBEDTLS_THREADING_C)
+    if ((ret = mbedtls_mutex_lock(&shard->mutex)) != 0) {
+        return ret;
     }
+#endif
 
 #if defined(MBEDTLS_HAVE_TIME)
-    cur->timestamp = t;
+    ssl_cache_expire(cache, shard, n, t);
 #endif
 
-    *dst = cur;
-    return 0;
+    slot = ssl_cache_find_slot(shard, n, hash, session_id, session_id_len);
+    if (slot == SIZE_MAX) {
+        ret = 1;
+        goto exit;
+    }
+    entry = shard->table[slot];
+
+#if defined(MBEDTLS_HAVE_TIME)
+    if (ssl_cache_entry_expired(cache, entry, t)) {
+        ssl_cache_remove_slot(shard, n, slot);
+        ret = 1;
+        goto exit;
+    }
+#endif
+
+    ret = mbedtls_ssl_session_load(session,
+                                   entry->session,
+                                   entry->session_len);
+    if (ret != 0) {
+        goto exit;
+    }
+
+    ssl_cache_lru_unlink(shard, entry);
+    ssl_cache_lru_push(shard, entry);
+
+    ret = 0;
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&shard->mutex) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+#endif
+
+    return ret;
 }
 
 int mbedtls_ssl_cache_set(void *data,
@@ -261,53 +375,91 @@ int mbedtls_ssl_cache_set(void *data,
 {
     int ret = 1;
     mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
+    uint32_t hash = ssl_cache_hash(session_id, session_id_len);
+    size_t n = ssl_cache_shards_in_use(cache->max_entries);
+    size_t idx = hash % n;
+    size_t max = ssl_cache_shard_max(cache, idx, n);
+    mbedtls_ssl_cache_shard *shard = &cache->shards[idx];
     mbedtls_ssl_cache_entry *cur;
+    size_t slot;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
 
     size_t session_serialized_len;
     unsigned char *session_serialized = NULL;
 
-#if defined(MBEDTLS_THREADING_C)
-    if ((ret = mbedtls_mutex_lock(&cache->mutex)) != 0) {
-        return ret;
-    }
-#endif
-
-    ret = ssl_cache_pick_writing_slot(cache,
-                                      session_id, session_id_len,
-                                      &cur);
-    if (ret != 0) {
-        goto exit;
+    if (session_id_len > sizeof(cur->session_id) || max == 0) {
+        return 1;
     }
 
-    /* Check how much space we need to serialize the session
-     * and allocate a sufficiently large buffer. */
+    /* Serialize the session before taking the lock: this is the most
+     * expensive part of storing it. */
     ret = mbedtls_ssl_session_save(session, NULL, 0, &session_serialized_len);
     if (ret != MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) {
-        ret = 1;
-        goto exit;
+        return 1;
     }
 
     session_serialized = mbedtls_calloc(1, session_serialized_len);
     if (session_serialized == NULL) {
-        ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
-        goto exit;
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
     }
 
-    /* Now serialize the session into the allocated buffer. */
     ret = mbedtls_ssl_session_save(session,
                                    session_serialized,
                                    session_serialized_len,
                                    &session_serialized_len);
     if (ret != 0) {
-        goto exit;
+        goto cleanup;
     }
 
-    if (session_id_len > sizeof(cur->session_id)) {
-        ret = 1;
+#if defined(MBEDTLS_THREADING_C)
+    if ((ret = mbedtls_mutex_lock(&shard->mutex)) != 0) {
+        goto cleanup;
+    }
+#endif
+
+    ret = ssl_cache_reserve(shard, n, max);
+    if (ret != 0) {
         goto exit;
     }
-    cur->session_id_len = session_id_len;
-    memcpy(cur->session_id, session_id, session_id_len);
+
+#if defined(MBEDTLS_HAVE_TIME)
+    ssl_cache_expire(cache, shard, n, t);
+#endif
+
+    slot = ssl_cache_find_slot(shard, n, hash, session_id, session_id_len);
+    if (slot != SIZE_MAX) {
+        /* Overwrite the existing entry for this session ID */
+        cur = shard->table[slot];
+        mbedtls_platform_zeroize(cur->session, cur->session_len);
+        mbedtls_free(cur->session);
+        cur->session = NULL;
+
+        ssl_cache_lru_unlink(shard, cur);
+        ssl_cache_lru_push(shard, cur);
+    } else {
+        /* Evict the least recently used entries to make room */
+        while (shard->count >= max) {
+            ssl_cache_remove_entry(shard, n, shard->lru_tail);
+        }
+
+        cur = mbedtls_calloc(1, sizeof(mbedtls_ssl_cache_entry));
+        if (cur == NULL) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            goto exit;
+        }
+
+        cur->hash = hash;
+        cur->session_id_len = session_id_len;
+        memcpy(cur->session_id, session_id, session_id_len);
+
+        ssl_cache_insert(shard, n, cur);
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    cur->timestamp = t;
+#endif
 
     cur->session = session_serialized;
     cur->session_len = session_serialized_len;
@@ -317,11 +469,12 @@ int mbedtls_ssl_cache_set(void *data,
 
 exit:
 #if defined(MBEDTLS_THREADING_C)
-    if (mbedtls_mutex_unlock(&cache->mutex) != 0) {
+    if (mbedtls_mutex_unlock(&shard->mutex) != 0) {
         ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
     }
 #endif
 
+cleanup:
     if (session_serialized != NULL) {
         mbedtls_platform_zeroize(session_serialized, session_serialized_len);
         mbedtls_free(session_serialized);
@@ -337,42 +490,27 @@ int mbedtls_ssl_cache_remove(void *data,
 {
     int ret = 1;
     mbedtls_ssl_cache_context *cache = (mbedtls_ssl_cache_context *) data;
-    mbedtls_ssl_cache_entry *entry;
-    mbedtls_ssl_cache_entry *prev;
+    uint32_t hash = ssl_cache_hash(session_id, session_id_len);
+    size_t n = ssl_cache_shards_in_use(cache->max_entries);
+    mbedtls_ssl_cache_shard *shard = &cache->shards[hash % n];
+    size_t slot;
 
 #if defined(MBEDTLS_THREADING_C)
-    if ((ret = mbedtls_mutex_lock(&cache->mutex)) != 0) {
+    if ((ret = mbedtls_mutex_lock(&shard->mutex)) != 0) {
         return ret;
     }
 #endif
 
-    ret = ssl_cache_find_entry(cache, session_id, session_id_len, &entry);
-    /* No valid entry found, exit with success */
-    if (ret != 0) {
-        ret = 0;
-        goto exit;
-    }
-
-    /* Now we remove the entry from the chain */
-    if (entry == cache->chain) {
-        cache->chain = entry->next;
-        goto free;
-    }
-    for (prev = cache->chain; prev->next != NULL; prev = prev->next) {
-        if (prev->next == entry) {
-            prev->next = entry->next;
-            break;
-        }
+    /* No entry found: nothing to do, exit with success */
+    slot = ssl_cache_find_slot(shard, n, hash, session_id, session_id_len);
+    if (slot != SIZE_MAX) {
+        ssl_cache_remove_slot(shard, n, slot);
     }
 
-free:
-    ssl_cache_entry_zeroize(entry);
-    mbedtls_free(entry);
     ret = 0;
 
-exit:
 #if defined(MBEDTLS_THREADING_C)
-    if (mbedtls_mutex_unlock(&cache->mutex) != 0) {
+    if (mbedtls_mutex_unlock(&shard->mutex) != 0) {
         ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
     }
 #endif
@@ -380,6 +518,34 @@ exit:
     return ret;
 }
 
+/* Free all entries and tables, keeping the mutexes */
+static void ssl_cache_flush(mbedtls_ssl_cache_context *cache)
+{
+    mbedtls_ssl_cache_shard *shard;
+    mbedtls_ssl_cache_entry *cur, *prv;
+    size_t i;
+
+    for (i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++) {
+        shard = &cache->shards[i];
+
+        cur = shard->lru_head;
+        while (cur != NULL) {
+            prv = cur;
+            cur = cur->next;
+
+            ssl_cache_entry_zeroize(prv);
+            mbedtls_free(prv);
+        }
+
+        mbedtls_free(shard->table);
+        shard->table = NULL;
+        shard->table_size = 0;
+        shard->count = 0;
+        shard->lru_head = NULL;
+        shard->lru_tail = NULL;
+    }
+}
+
 #if defined(MBEDTLS_HAVE_TIME)
 void mbedtls_ssl_cache_set_timeout(mbedtls_ssl_cache_context *cache, int timeout)
 {
@@ -397,27 +563,28 @@ void mbedtls_ssl_cache_set_max_entries(mbedtls_ssl_cache_context *cache, int max
         max = 0;
     }
 
+    /* Entries would no longer be found in their shard */
+    if (ssl_cache_shards_in_use(max) !=
+        ssl_cache_shards_in_use(cache->max_entries)) {
+        ssl_cache_flush(cache);
+    }
+
     cache->max_entries = max;
 }
 
 void mbedtls_ssl_cache_free(mbedtls_ssl_cache_context *cache)
 {
-    mbedtls_ssl_cache_entry *cur, *prv;
-
-    cur = cache->chain;
-
-    while (cur != NULL) {
-        prv = cur;
-        cur = cur->next;
+#if defined(MBEDTLS_THREADING_C)
+    size_t i;
+#endif
 
-        ssl_cache_entry_zeroize(prv);
-        mbedtls_free(prv);
-    }
+    ssl_cache_flush(cache);
 
 #if defined(MBEDTLS_THREADING_C)
-    mbedtls_mutex_free(&cache->mutex);
+    for (i = 0; i < MBEDTLS_SSL_CACHE_SHARDS; i++) {
+        mbedtls_mutex_free(&cache->shards[i].mutex);
+    }
 #endif
-    cache->chain = NULL;
 }
 
 #endif /* MBEDTLS_SSL_CACHE_C */
@@ -0,0 +1,634 @@
+/*
+ *  SSL session cache in memory shared between processes
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * The cache lives in one shared mapping, so it holds no pointers:
+ *
+ *  - a header with the geometry of the cache and the mutex that serializes
+ *    all accesses, which is process-shared and robust. Any process mapping
+ *    the cache can write the header, so the geometry is checked once by
+ *    mbedtls_ssl_cache_shm_setup() and then only read from the context;
+ *  - an index of fixed-size entries, grouped in sets of
+ *    MBEDTLS_SSL_CACHE_SHM_WAYS. A session ID can only be stored in the set
+ *    its hash points to, so that lookups read a single set;
+ *  - one slot of slot_size bytes per index entry, holding the session as
+ *    serialized by mbedtls_ssl_session_save().
+ */
+
+/* Enable definition of robust mutexes and ftruncate() even when compiling
+ * with -std=c99, and of MAP_ANONYMOUS on glibc. Must be set before
+ * mbedtls_config.h, which pulls in glibc's features.h indirectly. */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+#if defined(__linux__) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE
+#endif
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+
+#if !defined(unix) && !defined(__unix__) && !defined(__unix) && \
+    !defined(__APPLE__) && !defined(__QNXNTO__) && \
+    !defined(__HAIKU__) && !defined(__midipix__)
+#error "The shared SSL session cache only works on POSIX platforms, see MBEDTLS_SSL_CACHE_SHM_C in mbedtls_config.h"
+#endif
+
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/threading.h"
+
+#include "mbedtls/ssl_cache_shm.h"
+#include "ssl_misc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+#define SSL_CACHE_SHM_MAGIC     "MBTLSSC\0"
+#define SSL_CACHE_SHM_VERSION   1
+
+typedef struct {
+    unsigned char magic[8];
+    uint32_t version;
+    uint32_t sets;              /* number of sets of entries            */
+    uint32_t slot_size;         /* size of the slot of each entry       */
+    uint32_t header_size;       /* sizeof(ssl_cache_shm_header) rounded */
+    uint64_t clock;             /* last value of last_use handed out    */
+    pthread_mutex_t mutex;
+} ssl_cache_shm_header;
+
+typedef struct {
+    uint64_t last_use;          /* 0 for a free entry                   */
+    int64_t timestamp;          /* time the session was stored          */
+    uint32_t hash;
+    uint32_t session_len;
+    unsigned char writing;      /* set while the slot is being written  */
+    unsigned char session_id_len;
+    unsigned char session_id[32];
+    unsigned char reserved[6];
+} ssl_cache_shm_entry;
+
+/* Keep the index and the slots aligned for the fields above */
+#define SSL_CACHE_SHM_ALIGN(x)  (((x) + 63) & ~(size_t) 63)
+
+static ssl_cache_shm_header *ssl_cache_shm_hdr(
+    const mbedtls_ssl_cache_shm_context *cache)
+{
+    return (ssl_cache_shm_header *) cache->base;
+}
+
+static ssl_cache_shm_entry *ssl_cache_shm_index(
+    const mbedtls_ssl_cache_shm_context *cache)
+{
+    return (ssl_cache_shm_entry *) (cache->base +
+                                    SSL_CACHE_SHM_ALIGN(sizeof(ssl_cache_shm_header)));
+}
+
+static unsigned char *ssl_cache_shm_slot(
+    const mbedtls_ssl_cache_shm_context *cache, size_t i)
+{
+    size_t entries = cache->sets * MBEDTLS_SSL_CACHE_SHM_WAYS;
+
+    return (unsigned char *) ssl_cache_shm_index(cache) +
+           SSL_CACHE_SHM_ALIGN(entries * sizeof(ssl_cache_shm_entry)) +
+           i * cache->slot_size;
+}
+
+static size_t ssl_cache_shm_map_len(size_t sets, size_t slot_size)
+{
+    size_t entries = sets * MBEDTLS_SSL_CACHE_SHM_WAYS;
+
+    return SSL_CACHE_SHM_ALIGN(sizeof(ssl_cache_shm_header)) +
+           SSL_CACHE_SHM_ALIGN(entries * sizeof(ssl_cache_shm_entry)) +
+           entries * slot_size;
+}
+
+/* FNV-1a: session IDs are random, any cheap mix will do */
+static uint32_t ssl_cache_shm_hash(unsigned char const *session_id,
+                                   size_t session_id_len)
+{
+    uint32_t hash = 0x811c9dc5;
+    size_t i;
+
+    for (i = 0; i < session_id_len; i++) {
+        hash ^= session_id[i];
+        hash *= 0x01000193;
+    }
+
+    return hash;
+}
+
+static void ssl_cache_shm_clear(const mbedtls_ssl_cache_shm_context *cache,
+                                size_t i)
+{
+    ssl_cache_shm_entry *entry = &ssl_cache_shm_index(cache)[i];
+    size_t len = entry->session_len;
+
+    /* Any process mapping the cache can write the index: don't trust it */
+    if (len > cache->slot_size) {
+        len = cache->slot_size;
+    }
+
+    mbedtls_platform_zeroize(ssl_cache_shm_slot(cache, i), len);
+    mbedtls_platform_zeroize(entry, sizeof(ssl_cache_shm_entry));
+}
+
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_cache_shm_lock(const mbedtls_ssl_cache_shm_context *cache)
+{
+    ssl_cache_shm_header *hdr = ssl_cache_shm_hdr(cache);
+    size_t i, entries;
+    int ret;
+
+    ret = pthread_mutex_lock(&hdr->mutex);
+    if (ret == 0) {
+        return 0;
+    }
+    if (ret != EOWNERDEAD) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    /* The previous owner died while holding the lock: the only state it
+     * can have left half-updated is the entry it was writing. */
+    entries = cache->sets * MBEDTLS_SSL_CACHE_SHM_WAYS;
+    for (i = 0; i < entries; i++) {
+        if (ssl_cache_shm_index(cache)[i].writing) {
+            ssl_cache_shm_clear(cache, i);
+        }
+    }
+
+    if (pthread_mutex_consistent(&hdr->mutex) != 0) {
+        pthread_mutex_unlock(&hdr->mutex);
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    return 0;
+}
+
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_cache_shm_unlock(const mbedtls_ssl_cache_shm_context *cache)
+{
+    if (pthread_mutex_unlock(&ssl_cache_shm_hdr(cache)->mutex) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    return 0;
+}
+
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_cache_shm_format(mbedtls_ssl_cache_shm_context *cache,
+                                size_t sets, size_t slot_size)
+{
+    ssl_cache_shm_header *hdr = ssl_cache_shm_hdr(cache);
+    pthread_mutexattr_t attr;
+    int ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+
+    memset(cache->base, 0, cache->map_len);
+    hdr->version = SSL_CACHE_SHM_VERSION;
+    hdr->sets = (uint32_t) sets;
+    hdr->slot_size = (uint32_t) slot_size;
+    hdr->header_size = (uint32_t) SSL_CACHE_SHM_ALIGN(sizeof(ssl_cache_shm_header));
+
+    if (pthread_mutexattr_init(&attr) != 0) {
+        return ret;
+    }
+    if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0 &&
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0 &&
+        pthread_mutex_init(&hdr->mutex, &attr) == 0) {
+        ret = 0;
+    }
+    pthread_mutexattr_destroy(&attr);
+
+    /* Written last: other processes don't use a segment without it */
+    if (ret == 0) {
+        memcpy(hdr->magic, SSL_CACHE_SHM_MAGIC, sizeof(hdr->magic));
+    }
+
+    return ret;
+}
+
+static int ssl_cache_shm_check(const mbedtls_ssl_cache_shm_context *cache,
+                               size_t sets, size_t slot_size)
+{
+    const ssl_cache_shm_header *hdr = ssl_cache_shm_hdr(cache);
+
+    return memcmp(hdr->magic, SSL_CACHE_SHM_MAGIC, sizeof(hdr->magic)) == 0 &&
+           hdr->version == SSL_CACHE_SHM_VERSION &&
+           hdr->sets == sets &&
+           hdr->slot_size == slot_size &&
+           hdr->header_size == SSL_CACHE_SHM_ALIGN(sizeof(ssl_cache_shm_header));
+}
+
+/* Map the file at path, creating and formatting it if it is new or
+ * unformatted. The initialization is serialized by a lock on the file, so
+ * that processes starting together agree on a single formatted cache. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_cache_shm_map_file(mbedtls_ssl_cache_shm_context *cache,
+                                  const char *path,
+                                  size_t sets, size_t slot_size)
+{
+    int ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    struct flock lock;
+    struct stat st;
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    while (fcntl(fd, F_SETLKW, &lock) != 0) {
+        if (errno != EINTR) {
+            goto exit;
+        }
+    }
+
+    if (fstat(fd, &st) != 0) {
+        goto exit;
+    }
+    if (st.st_size != 0 && (size_t) st.st_size != cache->map_len) {
+        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        goto exit;
+    }
+    if (st.st_size == 0 && ftruncate(fd, (off_t) cache->map_len) != 0) {
+        goto exit;
+    }
+
+    base = mmap(NULL, cache->map_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+                fd, 0);
+    if (base == MAP_FAILED) {
+        goto exit;
+    }
+    cache->base = base;
+
+    /* The magic is written last: a file without it is new, or was left
+     * unformatted by a process that died during its setup */
+    if (st.st_size == 0 ||
+        memcmp(ssl_cache_shm_hdr(cache)->magic, SSL_CACHE_SHM_MAGIC,
+               sizeof(ssl_cache_shm_hdr(cache)->magic)) != 0) {
+        ret = ssl_cache_shm_format(cache, sets, slot_size);
+    } else if (ssl_cache_shm_check(cache, sets, slot_size)) {
+        ret = 0;
+    } else {
+        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+exit:
+    /* Closing the file releases the lock, the mapping stays valid */
+    close(fd);
+    return ret;
+}
+
+void mbedtls_ssl_cache_shm_init(mbedtls_ssl_cache_shm_context *cache)
+{
+    memset(cache, 0, sizeof(mbedtls_ssl_cache_shm_context));
+
+    cache->timeout = MBEDTLS_SSL_CACHE_SHM_DEFAULT_TIMEOUT;
+}
+
+int mbedtls_ssl_cache_shm_setup(mbedtls_ssl_cache_shm_context *cache,
+                                const char *path,
+                                size_t entries, size_t slot_size)
+{
+    int ret;
+    size_t sets;
+    void *base;
+
+    /* The header stores slot_size once rounded up to a multiple of 8 */
+    if (cache->base != NULL || entries == 0 || slot_size < 64 ||
+        slot_size > UINT32_MAX - 7) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    slot_size = (slot_size + 7) & ~(size_t) 7;
+
+    sets = (entries + MBEDTLS_SSL_CACHE_SHM_WAYS - 1) /
+           MBEDTLS_SSL_CACHE_SHM_WAYS;
+    /* Keep slot offsets within size_t, slot_size is less than 2^32 */
+    if (sets > UINT32_MAX ||
+        sets > (SIZE_MAX / 2 - 4096) / MBEDTLS_SSL_CACHE_SHM_WAYS /
+        (slot_size + sizeof(ssl_cache_shm_entry))) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    cache->map_len = ssl_cache_shm_map_len(sets, slot_size);
+
+    if (path != NULL) {
+        ret = ssl_cache_shm_map_file(cache, path, sets, slot_size);
+    } else {
+        base = mmap(NULL, cache->map_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        } else {
+            cache->base = base;
+            ret = ssl_cache_shm_format(cache, sets, slot_size);
+        }
+    }
+
+    if (ret != 0) {
+        mbedtls_ssl_cache_shm_free(cache);
+        return ret;
+    }
+
+    /* The geometry of the segment now matches these values: keep them
+     * here, where the other processes can't change them. */
+    cache->sets = sets;
+    cache->slot_size = slot_size;
+
+    return 0;
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+static int ssl_cache_shm_expired(const mbedtls_ssl_cache_shm_context *cache,
+                                 const ssl_cache_shm_entry *entry,
+                                 mbedtls_time_t t)
+{
+    return cache->timeout != 0 &&
+           (int64_t) t - entry->timestamp > cache->timeout;
+}
+#endif
+
+/* Return the index of the entry holding the given session ID, or SIZE_MAX */
+static size_t ssl_cache_shm_find(const mbedtls_ssl_cache_shm_context *cache,
+                                 uint32_t hash,
+                                 unsigned char const *session_id,
+                                 size_t session_id_len)
+{
+    const ssl_cache_shm_entry *index = ssl_cache_shm_index(cache);
+    size_t first = (size_t) (hash % cache->sets) *
+                   MBEDTLS_SSL_CACHE_SHM_WAYS;
+    size_t i;
+
+    for (i = first; i < first + MBEDTLS_SSL_CACHE_SHM_WAYS; i++) {
+        if (index[i].last_use != 0 && !index[i].writing &&
+            index[i].hash == hash &&
+            index[i].session_id_len == session_id_len &&
+            memcmp(index[i].session_id, session_id, session_id_len) == 0) {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+int mbedtls_ssl_cache_shm_get(void *data,
+                              unsigned char const *session_id,
+                              size_t session_id_len,
+                              mbedtls_ssl_session *session)
+{
+    int ret = 1;
+    mbedtls_ssl_cache_shm_context *cache = (mbedtls_ssl_cache_shm_context *) data;
+    uint32_t hash = ssl_cache_shm_hash(session_id, session_id_len);
+    ssl_cache_shm_entry *entry;
+    size_t i;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
+
+    if (cache->base == NULL ||
+        session_id_len > sizeof(entry->session_id)) {
+        return 1;
+    }
+
+    if ((ret = ssl_cache_shm_lock(cache)) != 0) {
+        return ret;
+    }
+
+    i = ssl_cache_shm_find(cache, hash, session_id, session_id_len);
+    if (i == SIZE_MAX) {
+        ret = 1;
+        goto exit;
+    }
+    entry = &ssl_cache_shm_index(cache)[i];
+
+    /* A length beyond the slot can only come from a corrupted index */
+    if (entry->session_len > cache->slot_size) {
+        ssl_cache_shm_clear(cache, i);
+        ret = 1;
+        goto exit;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    if (ssl_cache_shm_expired(cache, entry, t)) {
+        ssl_cache_shm_clear(cache, i);
+        ret = 1;
+        goto exit;
+    }
+#endif
+
+    ret = mbedtls_ssl_session_load(session, ssl_cache_shm_slot(cache, i),
+                                   entry->session_len);
+    if (ret != 0) {
+        goto exit;
+    }
+
+    entry->last_use = ++ssl_cache_shm_hdr(cache)->clock;
+
+exit:
+    if (ssl_cache_shm_unlock(cache) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    return ret;
+}
+
+/* Pick the entry to store a new session in: the entry already holding the
+ * session ID, a free one, an expired one, or the least recently used. */
+static size_t ssl_cache_shm_victim(const mbedtls_ssl_cache_shm_context *cache,
+                                   uint32_t hash,
+                                   unsigned char const *session_id,
+                                   size_t session_id_len)
+{
+    const ssl_cache_shm_entry *index = ssl_cache_shm_index(cache);
+    size_t first = (size_t) (hash % cache->sets) *
+                   MBEDTLS_SSL_CACHE_SHM_WAYS;
+    size_t i, victim;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
+
+    victim = ssl_cache_shm_find(cache, hash, session_id, session_id_len);
+    if (victim != SIZE_MAX) {
+        return victim;
+    }
+
+    victim = first;
+    for (i = first; i < first + MBEDTLS_SSL_CACHE_SHM_WAYS; i++) {
+        if (index[i].last_use == 0) {
+            return i;
+        }
+#if defined(MBEDTLS_HAVE_TIME)
+        if (ssl_cache_shm_expired(cache, &index[i], t)) {
+            return i;
+        }
+#endif
+        if (index[i].last_use < index[victim].last_use) {
+            victim = i;
+        }
+    }
+
+    return victim;
+}
+
+int mbedtls_ssl_cache_shm_set(void *data,
+                              unsigned char const *session_id,
+                              size_t session_id_len,
+                              const mbedtls_ssl_session *session)
+{
+    int ret = 1;
+    mbedtls_ssl_cache_shm_context *cache = (mbedtls_ssl_cache_shm_context *) data;
+    uint32_t hash = ssl_cache_shm_hash(session_id, session_id_len);
+    ssl_cache_shm_header *hdr;
+    ssl_cache_shm_entry *entry;
+    size_t i;
+
+    size_t session_serialized_len;
+    unsigned char *session_serialized = NULL;
+
+    if (cache->base == NULL ||
+        session_id_len > sizeof(entry->session_id)) {
+        return 1;
+    }
+    hdr = ssl_cache_shm_hdr(cache);
+
+    /* Serialize the session before taking the lock, which is shared by
+     * all the processes. */
+    ret = mbedtls_ssl_session_save(session, NULL, 0, &session_serialized_len);
+    if (ret != MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL) {
+        return 1;
+    }
+    if (session_serialized_len > cache->slot_size) {
+        return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+    }
+
+    session_serialized = mbedtls_calloc(1, session_serialized_len);
+    if (session_serialized == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    ret = mbedtls_ssl_session_save(session,
+                                   session_serialized,
+                                   session_serialized_len,
+                                   &session_serialized_len);
+    if (ret != 0) {
+        goto exit;
+    }
+
+    if ((ret = ssl_cache_shm_lock(cache)) != 0) {
+        goto exit;
+    }
+
+    i = ssl_cache_shm_victim(cache, hash, session_id, session_id_len);
+    ssl_cache_shm_clear(cache, i);
+    entry = &ssl_cache_shm_index(cache)[i];
+
+    /* If this process dies before clearing writing, the next process to
+     * take the lock discards the entry. */
+    entry->writing = 1;
+    entry->session_len = (uint32_t) session_serialized_len;
+    memcpy(ssl_cache_shm_slot(cache, i), session_serialized,
+           session_serialized_len);
+    entry->hash = hash;
+    entry->session_id_len = (unsigned char) session_id_len;
+    memcpy(entry->session_id, session_id, session_id_len);
+#if defined(MBEDTLS_HAVE_TIME)
+    entry->timestamp = (int64_t) mbedtls_time(NULL);
+#endif
+    entry->last_use = ++hdr->clock;
+    entry->writing = 0;
+
+    ret = ssl_cache_shm_unlock(cache);
+
+exit:
+    mbedtls_platform_zeroize(session_serialized, session_serialized_len);
+    mbedtls_free(session_serialized);
+
+    return ret;
+}
+
+int mbedtls_ssl_cache_shm_remove(void *data,
+                                 unsigned char const *session_id,
+                                 size_t session_id_len)
+{
+    int ret = 1;
+    mbedtls_ssl_cache_shm_context *cache = (mbedtls_ssl_cache_shm_context *) data;
+    uint32_t hash = ssl_cache_shm_hash(session_id, session_id_len);
+    size_t i;
+
+    if (cache->base == NULL ||
+        session_id_len > sizeof(((ssl_cache_shm_entry *) NULL)->session_id)) {
+        return 1;
+    }
+
+    if ((ret = ssl_cache_shm_lock(cache)) != 0) {
+        return ret;
+    }
+
+    i = ssl_cache_shm_find(cache, hash, session_id, session_id_len);
+    if (i != SIZE_MAX) {
+        ssl_cache_shm_clear(cache, i);
+    }
+
+    ret = ssl_cache_shm_unlock(cache);
+
+    return ret;
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+void mbedtls_ssl_cache_shm_set_timeout(mbedtls_ssl_cache_shm_context *cache,
+                                       int timeout)
+{
+    if (timeout < 0) {
+        timeout = 0;
+    }
+
+    cache->timeout = timeout;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+void mbedtls_ssl_cache_shm_free(mbedtls_ssl_cache_shm_context *cache)
+{
+    if (cache == NULL) {
+        return;
+    }
+
+    /* The mutex belongs to the segment and stays in use by the other
+     * processes: only the mapping of this process goes away. */
+    if (cache->base != NULL) {
+        munmap(cache->base, cache->map_len);
+    }
+
+    mbedtls_platform_zeroize(cache, sizeof(mbedtls_ssl_cache_shm_context));
+}
+
+#endif /* MBEDTLS_SSL_CACHE_SHM_C */
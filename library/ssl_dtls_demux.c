@@ -0,0 +1,541 @@
+/*
+ *  DTLS server demultiplexer: many connections on one UDP socket
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * Connections are found through two hash tables, one keyed by the peer
+ * address and one by the Connection ID the peer puts in its records. The
+ * ClientHello cookie exchange is done before anything is allocated, with a
+ * scratch context that only carries the configuration, so that spoofed
+ * ClientHello messages cost one HelloVerifyRequest and no memory.
+ *
+ * The SSL context of a connection is the first member of its structure,
+ * and its BIO context is the connection itself: the receive callback hands
+ * out the datagram being dispatched, the send callback sends to the
+ * current address of the peer.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_DTLS_DEMUX_C)
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_dtls_demux.h"
+#include "mbedtls/error.h"
+#include "mbedtls/debug.h"
+#include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
+#include "ssl_misc.h"
+
+#include <string.h>
+
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID) && \
+    defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY)
+#define SSL_DEMUX_MIGRATION
+#endif
+
+/* Offset of the Connection ID in a DTLS 1.2 record of type tls12_cid */
+#define SSL_DEMUX_CID_OFFSET    11
+
+struct mbedtls_ssl_dtls_demux_conn {
+    mbedtls_ssl_context ssl;            /* must be first                */
+    mbedtls_ssl_dtls_demux *demux;
+    mbedtls_ssl_dtls_demux_conn *next_addr;
+    unsigned char addr[MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN];
+    size_t addr_len;
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    mbedtls_ssl_dtls_demux_conn *next_cid;
+    unsigned char cid[MBEDTLS_SSL_CID_IN_LEN_MAX];
+#endif
+#if defined(SSL_DEMUX_MIGRATION)
+    /* A record carrying our CID came from new_addr, and in_window_top was
+     * window_top before it was processed. */
+    int migrating;
+    unsigned char new_addr[MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN];
+    size_t new_addr_len;
+    uint64_t window_top;
+#endif
+};
+
+/* FNV-1a, with the offset basis mixed with a random seed so that peers
+ * can't pick addresses that all fall in the same bucket. */
+static size_t ssl_demux_hash(const mbedtls_ssl_dtls_demux *demux,
+                             const unsigned char *buf, size_t len)
+{
+    uint32_t h = 2166136261u ^ demux->seed;
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        h ^= buf[i];
+        h *= 16777619u;
+    }
+
+    return (size_t) h & demux->bucket_mask;
+}
+
+static mbedtls_ssl_dtls_demux_conn *ssl_demux_find_addr(
+    const mbedtls_ssl_dtls_demux *demux,
+    const unsigned char *addr, size_t addr_len)
+{
+    mbedtls_ssl_dtls_demux_conn *conn;
+
+    for (conn = demux->by_addr[ssl_demux_hash(demux, addr, addr_len)];
+         conn != NULL; conn = conn->next_addr) {
+        if (conn->addr_len == addr_len &&
+            memcmp(conn->addr, addr, addr_len) == 0) {
+            return conn;
+        }
+    }
+
+    return NULL;
+}
+
+static void ssl_demux_link_addr(mbedtls_ssl_dtls_demux *demux,
+                                mbedtls_ssl_dtls_demux_conn *conn)
+{
+    size_t b = ssl_demux_hash(demux, conn->addr, conn->addr_len);
+
+    conn->next_addr = demux->by_addr[b];
+    demux->by_addr[b] = conn;
+}
+
+static void ssl_demux_unlink_addr(mbedtls_ssl_dtls_demux *demux,
+                                  mbedtls_ssl_dtls_demux_conn *conn)
+{
+    mbedtls_ssl_dtls_demux_conn **p;
+
+    for (p = &demux->by_addr[ssl_demux_hash(demux, conn->addr,
+                                            conn->addr_len)];
+         *p != NULL; p = &(*p)->next_addr) {
+        if (*p == conn) {
+            *p = conn->next_addr;
+            return;
+        }
+    }
+}
+
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+static mbedtls_ssl_dtls_demux_conn *ssl_demux_find_cid(
+    const mbedtls_ssl_dtls_demux *demux, const unsigned char *cid)
+{
+    size_t cid_len = demux->conf->cid_len;
+    mbedtls_ssl_dtls_demux_conn *conn;
+
+    for (conn = demux->by_cid[ssl_demux_hash(demux, cid, cid_len)];
+         conn != NULL; conn = conn->next_cid) {
+        if (memcmp(conn->cid, cid, cid_len) == 0) {
+            return conn;
+        }
+    }
+
+    return NULL;
+}
+
+static void ssl_demux_unlink_cid(mbedtls_ssl_dtls_demux *demux,
+                                 mbedtls_ssl_dtls_demux_conn *conn)
+{
+    mbedtls_ssl_dtls_demux_conn **p;
+
+    if (demux->conf->cid_len == 0) {
+        return;
+    }
+
+    for (p = &demux->by_cid[ssl_demux_hash(demux, conn->cid,
+                                           demux->conf->cid_len)];
+         *p != NULL; p = &(*p)->next_cid) {
+        if (*p == conn) {
+            *p = conn->next_cid;
+            return;
+        }
+    }
+}
+
+/* Give the connection a random CID that no other connection uses */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_demux_assign_cid(mbedtls_ssl_dtls_demux *demux,
+                                mbedtls_ssl_dtls_demux_conn *conn)
+{
+    const mbedtls_ssl_config *conf = demux->conf;
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    size_t b;
+
+    if (conf->cid_len == 0) {
+        return 0;
+    }
+
+    do {
+        if ((ret = conf->f_rng(conf->p_rng, conn->cid, conf->cid_len)) != 0) {
+            return ret;
+        }
+    } while (ssl_demux_find_cid(demux, conn->cid) != NULL);
+
+    ret = mbedtls_ssl_set_cid(&conn->ssl, MBEDTLS_SSL_CID_ENABLED,
+                              conn->cid, conf->cid_len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    b = ssl_demux_hash(demux, conn->cid, conf->cid_len);
+    conn->next_cid = demux->by_cid[b];
+    demux->by_cid[b] = conn;
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
+
+#if defined(SSL_DEMUX_MIGRATION)
+/*
+ * Move the connection to the address a CID record came from, if that
+ * record was authenticated and was the newest one so far (RFC 9146,
+ * Section 6). Both show as a move of the replay window, which only the
+ * datagram dispatched to this connection can have caused.
+ */
+static void ssl_demux_migrate(mbedtls_ssl_dtls_demux_conn *conn)
+{
+    mbedtls_ssl_dtls_demux *demux = conn->demux;
+    mbedtls_ssl_context *ssl = &conn->ssl;
+
+    if (!conn->migrating) {
+        return;
+    }
+    if (ssl->in_window_top == conn->window_top) {
+        return;
+    }
+    conn->migrating = 0;
+
+    if (ssl_demux_find_addr(demux, conn->new_addr,
+                            conn->new_addr_len) != NULL) {
+        return;
+    }
+
+    ssl_demux_unlink_addr(demux, conn);
+    memcpy(conn->addr, conn->new_addr, conn->new_addr_len);
+    conn->addr_len = conn->new_addr_len;
+    ssl_demux_link_addr(demux, conn);
+
+    /* Only used for cookies, but keep it accurate. If this fails the
+     * peer has to come back to its old address to reconnect. */
+    (void) mbedtls_ssl_set_client_transport_id(ssl, conn->addr,
+                                               conn->addr_len);
+
+    MBEDTLS_SSL_DEBUG_BUF(2, "peer address changed", conn->addr,
+                          conn->addr_len);
+}
+#endif /* SSL_DEMUX_MIGRATION */
+
+static int ssl_demux_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    mbedtls_ssl_dtls_demux_conn *conn = ctx;
+    mbedtls_ssl_dtls_demux *demux = conn->demux;
+
+#if defined(SSL_DEMUX_MIGRATION)
+    ssl_demux_migrate(conn);
+#endif
+
+    return demux->f_send(demux->p_send, conn->addr, conn->addr_len,
+                         buf, len);
+}
+
+static int ssl_demux_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    mbedtls_ssl_dtls_demux_conn *conn = ctx;
+    mbedtls_ssl_dtls_demux *demux = conn->demux;
+
+    if (demux->current != conn || demux->datagram == NULL) {
+        return MBEDTLS_ERR_SSL_WANT_READ;
+    }
+
+    /* Like recvfrom(), truncate datagrams that don't fit */
+    if (len > demux->datagram_len) {
+        len = demux->datagram_len;
+    }
+    memcpy(buf, demux->datagram, len);
+    demux->datagram = NULL;
+    demux->datagram_len = 0;
+
+    return (int) len;
+}
+
+void mbedtls_ssl_dtls_demux_init(mbedtls_ssl_dtls_demux *demux)
+{
+    memset(demux, 0, sizeof(mbedtls_ssl_dtls_demux));
+    mbedtls_ssl_init(&demux->hello);
+}
+
+int mbedtls_ssl_dtls_demux_setup(mbedtls_ssl_dtls_demux *demux,
+                                 const mbedtls_ssl_config *conf,
+                                 size_t max_conns,
+                                 mbedtls_ssl_dtls_demux_send_t *f_send,
+                                 void *p_send,
+                                 mbedtls_ssl_dtls_demux_new_conn_t *f_new_conn,
+                                 void *p_new_conn)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char seed[4];
+    size_t buckets = 1;
+
+    if (conf->endpoint != MBEDTLS_SSL_IS_SERVER ||
+        conf->transport != MBEDTLS_SSL_TRANSPORT_DATAGRAM ||
+        conf->f_cookie_write == NULL || conf->f_cookie_check == NULL ||
+        conf->f_rng == NULL || f_send == NULL || max_conns == 0) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    while (buckets < max_conns && buckets <= SIZE_MAX / 4) {
+        buckets <<= 1;
+    }
+
+    if ((ret = conf->f_rng(conf->p_rng, seed, sizeof(seed))) != 0) {
+        return ret;
+    }
+
+    demux->by_addr = mbedtls_calloc(buckets, sizeof(*demux->by_addr));
+    if (demux->by_addr == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    demux->by_cid = mbedtls_calloc(buckets, sizeof(*demux->by_cid));
+    if (demux->by_cid == NULL) {
+        mbedtls_free(demux->by_addr);
+        demux->by_addr = NULL;
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+#endif
+
+    demux->conf = conf;
+    demux->f_send = f_send;
+    demux->p_send = p_send;
+    demux->f_new_conn = f_new_conn;
+    demux->p_new_conn = p_new_conn;
+    demux->bucket_mask = buckets - 1;
+    demux->seed = MBEDTLS_GET_UINT32_BE(seed, 0);
+    demux->max_conns = max_conns;
+    demux->hello.conf = conf;
+
+    return 0;
+}
+
+/* Create a connection for a peer that returned a valid cookie */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_demux_accept(mbedtls_ssl_dtls_demux *demux,
+                            const unsigned char *addr, size_t addr_len,
+                            mbedtls_ssl_dtls_demux_conn **out)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_dtls_demux_conn *conn;
+
+    *out = NULL;
+
+    /* Like the listen backlog of a stream socket: drop, the peer will
+     * retry. */
+    if (demux->count >= demux->max_conns) {
+        return 0;
+    }
+
+    conn = mbedtls_calloc(1, sizeof(mbedtls_ssl_dtls_demux_conn));
+    if (conn == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    mbedtls_ssl_init(&conn->ssl);
+    conn->demux = demux;
+    memcpy(conn->addr, addr, addr_len);
+    conn->addr_len = addr_len;
+
+    if ((ret = mbedtls_ssl_setup(&conn->ssl, demux->conf)) != 0) {
+        goto cleanup;
+    }
+    mbedtls_ssl_set_bio(&conn->ssl, conn, ssl_demux_send, ssl_demux_recv,
+                        NULL);
+    if ((ret = mbedtls_ssl_set_client_transport_id(&conn->ssl,
+                                                   addr, addr_len)) != 0) {
+        goto cleanup;
+    }
+
+    if (demux->f_new_conn != NULL &&
+        demux->f_new_conn(demux->p_new_conn, &conn->ssl,
+                          addr, addr_len) != 0) {
+        ret = 0;
+        goto cleanup;
+    }
+
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    /* Last, as it links the connection in the CID table */
+    if ((ret = ssl_demux_assign_cid(demux, conn)) != 0) {
+        goto cleanup;
+    }
+#endif
+
+    ssl_demux_link_addr(demux, conn);
+    demux->count++;
+    *out = conn;
+
+    return 0;
+
+cleanup:
+    mbedtls_ssl_free(&conn->ssl);
+    mbedtls_free(conn);
+    return ret;
+}
+
+int mbedtls_ssl_dtls_demux_dispatch(mbedtls_ssl_dtls_demux *demux,
+                                    const unsigned char *addr,
+                                    size_t addr_len,
+                                    const unsigned char *buf, size_t len,
+                                    mbedtls_ssl_context **ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_dtls_demux_conn *conn = NULL;
+    size_t olen;
+
+    if (ssl == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    *ssl = NULL;
+
+    if (demux->conf == NULL || addr_len == 0 ||
+        addr_len > MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+#if defined(SSL_DEMUX_MIGRATION)
+    /* The previous datagram has been processed by now */
+    if (demux->current != NULL) {
+        ssl_demux_migrate(demux->current);
+    }
+#endif
+    demux->current = NULL;
+    demux->datagram = NULL;
+    demux->datagram_len = 0;
+
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    if (demux->conf->cid_len > 0 &&
+        len >= SSL_DEMUX_CID_OFFSET + demux->conf->cid_len &&
+        buf[0] == MBEDTLS_SSL_MSG_CID) {
+        conn = ssl_demux_find_cid(demux, buf + SSL_DEMUX_CID_OFFSET);
+#if defined(SSL_DEMUX_MIGRATION)
+        if (conn != NULL &&
+            (conn->addr_len != addr_len ||
+             memcmp(conn->addr, addr, addr_len) != 0)) {
+            conn->migrating = 1;
+            memcpy(conn->new_addr, addr, addr_len);
+            conn->new_addr_len = addr_len;
+            conn->window_top = conn->ssl.in_window_top;
+        } else if (conn != NULL) {
+            conn->migrating = 0;
+        }
+#endif
+    }
+#endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
+
+    if (conn == NULL) {
+        conn = ssl_demux_find_addr(demux, addr, addr_len);
+    }
+
+    if (conn == NULL) {
+        ret = mbedtls_ssl_dtls_demux_check_cookie(&demux->hello,
+                                                  addr, addr_len,
+                                                  buf, len,
+                                                  demux->hvr,
+                                                  sizeof(demux->hvr),
+                                                  &olen);
+        if (ret == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED) {
+            /* As in ssl_handle_possible_reconnect(), a lost
+             * HelloVerifyRequest is recovered by the peer. */
+            (void) demux->f_send(demux->p_send, addr, addr_len,
+                                 demux->hvr, olen);
+            return 0;
+        }
+        if (ret != 0) {
+            /* Not a ClientHello, or a bad cookie: drop */
+            return 0;
+        }
+
+        if ((ret = ssl_demux_accept(demux, addr, addr_len, &conn)) != 0) {
+            return ret;
+        }
+        if (conn == NULL) {
+            return 0;
+        }
+    }
+
+    demux->current = conn;
+    demux->datagram = buf;
+    demux->datagram_len = len;
+    *ssl = &conn->ssl;
+
+    return 0;
+}
+
+void mbedtls_ssl_dtls_demux_close(mbedtls_ssl_dtls_demux *demux,
+                                  mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_dtls_demux_conn *conn = (mbedtls_ssl_dtls_demux_conn *) ssl;
+
+    if (conn == NULL) {
+        return;
+    }
+
+    if (demux->current == conn) {
+        demux->current = NULL;
+        demux->datagram = NULL;
+        demux->datagram_len = 0;
+    }
+
+    ssl_demux_unlink_addr(demux, conn);
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    ssl_demux_unlink_cid(demux, conn);
+#endif
+    demux->count--;
+
+    mbedtls_ssl_free(&conn->ssl);
+    mbedtls_platform_zeroize(conn, sizeof(mbedtls_ssl_dtls_demux_conn));
+    mbedtls_free(conn);
+}
+
+size_t mbedtls_ssl_dtls_demux_count(const mbedtls_ssl_dtls_demux *demux)
+{
+    return demux->count;
+}
+
+void mbedtls_ssl_dtls_demux_free(mbedtls_ssl_dtls_demux *demux)
+{
+    size_t i;
+
+    if (demux == NULL) {
+        return;
+    }
+
+    if (demux->by_addr != NULL) {
+        for (i = 0; i <= demux->bucket_mask; i++) {
+            while (demux->by_addr[i] != NULL) {
+                mbedtls_ssl_dtls_demux_close(demux,
+                                             &demux->by_addr[i]->ssl);
+            }
+        }
+    }
+
+    mbedtls_free(demux->by_addr);
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    mbedtls_free(demux->by_cid);
+#endif
+
+    /* The scratch context was never set up and owns nothing */
+    mbedtls_platform_zeroize(demux, sizeof(mbedtls_ssl_dtls_demux));
+}
+
+#endif /* MBEDTLS_SSL_DTLS_DEMUX_C */
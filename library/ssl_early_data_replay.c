@@ -0,0 +1,242 @@
+/*
+ *  Anti-replay filter for TLS 1.3 early data
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * RFC 8446 section 8.2: the server records a unique value derived from the
+ * ClientHello of each connection that sends early data, and rejects the
+ * early data of a ClientHello it has already seen.
+ *
+ * The values are MACs, so they are spread over
+ * MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS independently locked shards by
+ * their first word, and looked up in Bloom filters indexed by the next
+ * ones. Each shard has two filters: values are recorded in the current one,
+ * and looked up in both. When a window has passed, the previous filter is
+ * cleared and becomes the current one.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+
+#include "mbedtls/platform.h"
+
+#include "mbedtls/ssl_early_data_replay.h"
+#include "mbedtls/platform_util.h"
+
+#include <string.h>
+
+/* Number of bits of a filter per expected entry */
+#define SSL_EARLY_DATA_REPLAY_BITS_PER_ENTRY    16
+
+/* Number of bits set for each entry */
+#define SSL_EARLY_DATA_REPLAY_PROBES            4
+
+/* Minimum size of a filter in bits */
+#define SSL_EARLY_DATA_REPLAY_MIN_BITS          64
+
+void mbedtls_ssl_early_data_replay_init(mbedtls_ssl_early_data_replay_context *ctx)
+{
+#if defined(MBEDTLS_THREADING_C)
+    size_t i;
+#endif
+
+    memset(ctx, 0, sizeof(mbedtls_ssl_early_data_replay_context));
+
+#if defined(MBEDTLS_THREADING_C)
+    for (i = 0; i < MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS; i++) {
+        mbedtls_mutex_init(&ctx->shards[i].mutex);
+    }
+#endif
+}
+
+static void ssl_early_data_replay_release(mbedtls_ssl_early_data_replay_context *ctx)
+{
+    size_t i;
+
+    for (i = 0; i < MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS; i++) {
+        mbedtls_free(ctx->shards[i].current);
+        mbedtls_free(ctx->shards[i].previous);
+        ctx->shards[i].current = NULL;
+        ctx->shards[i].previous = NULL;
+    }
+    ctx->filter_bits = 0;
+}
+
+int mbedtls_ssl_early_data_replay_setup(mbedtls_ssl_early_data_replay_context *ctx,
+                                        uint32_t window,
+                                        size_t expected_entries)
+{
+    size_t per_shard, bits = SSL_EARLY_DATA_REPLAY_MIN_BITS;
+    size_t i;
+
+    if (window == 0 || expected_entries == 0 ||
+        (uint64_t) window * 1000 < MBEDTLS_SSL_TLS1_3_TICKET_AGE_TOLERANCE) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    per_shard = expected_entries / MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS + 1;
+    if (per_shard > (SIZE_MAX / 2) / SSL_EARLY_DATA_REPLAY_BITS_PER_ENTRY) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    while (bits < per_shard * SSL_EARLY_DATA_REPLAY_BITS_PER_ENTRY) {
+        bits <<= 1;
+    }
+
+    ssl_early_data_replay_release(ctx);
+
+    for (i = 0; i < MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS; i++) {
+        ctx->shards[i].current = mbedtls_calloc(1, bits / 8);
+        ctx->shards[i].previous = mbedtls_calloc(1, bits / 8);
+        if (ctx->shards[i].current == NULL || ctx->shards[i].previous == NULL) {
+            ssl_early_data_replay_release(ctx);
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        ctx->shards[i].start = 0;
+    }
+
+    ctx->filter_bits = bits;
+    ctx->window = window;
+
+    return 0;
+}
+
+/* Move the shard to the window of now, forgetting what is older than the
+ * previous window. */
+static void ssl_early_data_replay_rotate(mbedtls_ssl_early_data_replay_context *ctx,
+                                         mbedtls_ssl_early_data_replay_shard *shard,
+                                         mbedtls_time_t now)
+{
+    size_t len = ctx->filter_bits / 8;
+    unsigned char *filter;
+
+    if (now >= shard->start && now - shard->start < (mbedtls_time_t) ctx->window) {
+        return;
+    }
+
+    if (now >= shard->start &&
+        now - shard->start < 2 * (mbedtls_time_t) ctx->window) {
+        /* The current window becomes the previous one */
+        filter = shard->previous;
+        shard->previous = shard->current;
+        shard->current = filter;
+        memset(shard->current, 0, len);
+        shard->start += ctx->window;
+        return;
+    }
+
+    /* Both windows are over, or the clock went back: start afresh. The
+     * filters are not cleared when the clock goes back, so that a replay
+     * is still noticed. */
+    if (now >= shard->start) {
+        memset(shard->previous, 0, len);
+        memset(shard->current, 0, len);
+    }
+    shard->start = now;
+}
+
+int mbedtls_ssl_early_data_replay_check_at(mbedtls_ssl_early_data_replay_context *ctx,
+                                           const unsigned char *id,
+                                           size_t id_len,
+                                           mbedtls_time_t now)
+{
+    int ret = 0;
+    mbedtls_ssl_early_data_replay_shard *shard;
+    uint32_t h1, h2;
+    size_t bit[SSL_EARLY_DATA_REPLAY_PROBES];
+    int in_current = 1, in_previous = 1;
+    size_t i;
+
+    if (ctx == NULL || ctx->filter_bits == 0 || id == NULL || id_len < 16) {
+        return -1;
+    }
+
+    /* The identifiers are MACs: their words are independent and
+     * uniformly distributed. */
+    shard = &ctx->shards[MBEDTLS_GET_UINT32_LE(id, 0) %
+                         MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS];
+    h1 = MBEDTLS_GET_UINT32_LE(id, 4) ^ MBEDTLS_GET_UINT32_LE(id, 12);
+    h2 = MBEDTLS_GET_UINT32_LE(id, 8) | 1;
+    for (i = 0; i < SSL_EARLY_DATA_REPLAY_PROBES; i++) {
+        bit[i] = (size_t) (h1 + (uint32_t) i * h2) & (ctx->filter_bits - 1);
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_lock(&shard->mutex) != 0) {
+        return -1;
+    }
+#endif
+
+    ssl_early_data_replay_rotate(ctx, shard, now);
+
+    for (i = 0; i < SSL_EARLY_DATA_REPLAY_PROBES; i++) {
+        unsigned char mask = (unsigned char) (1 << (bit[i] & 7));
+        if ((shard->current[bit[i] / 8] & mask) == 0) {
+            in_current = 0;
+        }
+        if ((shard->previous[bit[i] / 8] & mask) == 0) {
+            in_previous = 0;
+        }
+    }
+
+    if (in_current || in_previous) {
+        ret = -1;
+    } else {
+        for (i = 0; i < SSL_EARLY_DATA_REPLAY_PROBES; i++) {
+            shard->current[bit[i] / 8] |= (unsigned char) (1 << (bit[i] & 7));
+        }
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&shard->mutex) != 0) {
+        return -1;
+    }
+#endif
+
+    return ret;
+}
+
+int mbedtls_ssl_early_data_replay_check(void *p_ctx,
+                                        const unsigned char *id,
+                                        size_t id_len)
+{
+    return mbedtls_ssl_early_data_replay_check_at(p_ctx, id, id_len,
+                                                  mbedtls_time(NULL));
+}
+
+void mbedtls_ssl_early_data_replay_free(mbedtls_ssl_early_data_replay_context *ctx)
+{
+#if defined(MBEDTLS_THREADING_C)
+    size_t i;
+#endif
+
+    if (ctx == NULL) {
+        return;
+    }
+
+    ssl_early_data_replay_release(ctx);
+
+#if defined(MBEDTLS_THREADING_C)
+    for (i = 0; i < MBEDTLS_SSL_EARLY_DATA_REPLAY_SHARDS; i++) {
+        mbedtls_mutex_free(&ctx->shards[i].mutex);
+    }
+#endif
+
+    mbedtls_platform_zeroize(ctx, sizeof(mbedtls_ssl_early_data_replay_context));
+}
+
+#endif /* MBEDTLS_SSL_EARLY_DATA_REPLAY_C */
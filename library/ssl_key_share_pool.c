@@ -0,0 +1,423 @@
+/*
+ *  Pool of precomputed ephemeral key shares for TLS 1.3 handshakes
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * A refill thread generates key pairs with the ECP module and stores them
+ * as raw keys. A handshake takes one out under the mutex and imports the
+ * private key into PSA itself: the PSA key store is only used from the
+ * handshake threads, and the import costs no scalar multiplication.
+ *
+ * Each group keeps its key pairs in a stack: a key pair is copied out and
+ * wiped from the pool at once, so it can't be handed out twice. The
+ * mbedtls threading abstraction only provides mutexes, so this module uses
+ * pthreads directly.
+ *
+ * When a key pair can't be generated, for example because the RNG fails,
+ * the refill thread retries after a delay that doubles on each failure. A
+ * take that finds its group empty wakes it up at once.
+ */
+
+/* Enable definition of clock_gettime() even when compiling with -std=c99.
+ * Must be set before mbedtls_config.h, which pulls in glibc's features.h
+ * indirectly. */
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_KEY_SHARE_POOL_C)
+
+#include "mbedtls/platform.h"
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_key_share_pool.h"
+#include "mbedtls/ecp.h"
+#include "mbedtls/platform_util.h"
+#include "mbedtls/threading.h"
+
+#include "ssl_misc.h"
+
+#include <string.h>
+#include <time.h>
+
+/* Bounds of the delay before the refill thread retries a failed key pair
+ * generation, in milliseconds */
+#define SSL_KEY_SHARE_POOL_RETRY_MIN_MS     100
+#define SSL_KEY_SHARE_POOL_RETRY_MAX_MS     10000
+
+void mbedtls_ssl_key_share_pool_init(mbedtls_ssl_key_share_pool *pool)
+{
+    memset(pool, 0, sizeof(mbedtls_ssl_key_share_pool));
+}
+
+/* Generate a key pair of the group, in the formats of psa_import_key() and
+ * of the key_share extension. Called without the mutex. */
+static int ssl_key_share_pool_generate(mbedtls_ssl_key_share_pool *pool,
+                                       mbedtls_ecp_group_id grp_id,
+                                       mbedtls_ssl_key_share_pool_entry *entry)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ecp_keypair key;
+
+    mbedtls_ecp_keypair_init(&key);
+
+    ret = mbedtls_ecp_gen_key(grp_id, &key, pool->f_rng, pool->p_rng);
+    if (ret != 0) {
+        goto exit;
+    }
+
+    entry->priv_len = (key.MBEDTLS_PRIVATE(grp).pbits + 7) / 8;
+    ret = mbedtls_ecp_write_key(&key, entry->priv, entry->priv_len);
+    if (ret != 0) {
+        goto exit;
+    }
+
+    ret = mbedtls_ecp_point_write_binary(&key.MBEDTLS_PRIVATE(grp),
+                                         &key.MBEDTLS_PRIVATE(Q),
+                                         MBEDTLS_ECP_PF_UNCOMPRESSED,
+                                         &entry->pub_len, entry->pub,
+                                         sizeof(entry->pub));
+
+exit:
+    mbedtls_ecp_keypair_free(&key);
+    if (ret != 0) {
+        mbedtls_platform_zeroize(entry, sizeof(*entry));
+    }
+    return ret;
+}
+
+/* Return the first group that is not full, or NULL.
+ * Called with the mutex locked. */
+static mbedtls_ssl_key_share_pool_group *ssl_key_share_pool_next(
+    mbedtls_ssl_key_share_pool *pool)
+{
+    size_t i;
+
+    for (i = 0; i < pool->group_count; i++) {
+        if (pool->groups[i].count < pool->size) {
+            return &pool->groups[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Generate one key pair for the first group that is not full.
+ * Called and returns with the mutex locked. Sets *done if all groups are
+ * full. */
+static int ssl_key_share_pool_refill_one(mbedtls_ssl_key_share_pool *pool,
+                                         int *done)
+{
+    int ret;
+    mbedtls_ssl_key_share_pool_group *group;
+    mbedtls_ssl_key_share_pool_entry entry;
+
+    group = ssl_key_share_pool_next(pool);
+    if (group == NULL) {
+        *done = 1;
+        return 0;
+    }
+    *done = 0;
+
+    (void) pthread_mutex_unlock(&pool->mutex);
+    ret = ssl_key_share_pool_generate(pool, group->grp_id, &entry);
+    (void) pthread_mutex_lock(&pool->mutex);
+
+    /* Another thread may have filled the group meanwhile */
+    if (ret == 0 && group->count < pool->size) {
+        memcpy(&group->entries[group->count++], &entry, sizeof(entry));
+    }
+    mbedtls_platform_zeroize(&entry, sizeof(entry));
+
+    return ret;
+}
+
+/* Wait until a key pair is taken, the pool is shut down or delay_ms
+ * milliseconds have passed. Called and returns with the mutex locked. */
+static void ssl_key_share_pool_wait(mbedtls_ssl_key_share_pool *pool,
+                                    long delay_ms)
+{
+    struct timespec deadline;
+
+    if (clock_gettime(CLOCK_REALTIME, &deadline) != 0) {
+        (void) pthread_cond_wait(&pool->taken, &pool->mutex);
+        return;
+    }
+
+    deadline.tv_sec += delay_ms / 1000;
+    deadline.tv_nsec += (delay_ms % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    (void) pthread_cond_timedwait(&pool->taken, &pool->mutex, &deadline);
+}
+
+static void *ssl_key_share_pool_thread(void *arg)
+{
+    mbedtls_ssl_key_share_pool *pool = arg;
+    long retry_ms = 0;
+    int done;
+
+    (void) pthread_mutex_lock(&pool->mutex);
+    while (!pool->shutdown) {
+        if (ssl_key_share_pool_refill_one(pool, &done) != 0) {
+            /* Back off rather than spin, in case the failure persists */
+            if (retry_ms == 0) {
+                retry_ms = SSL_KEY_SHARE_POOL_RETRY_MIN_MS;
+            } else if (retry_ms < SSL_KEY_SHARE_POOL_RETRY_MAX_MS / 2) {
+                retry_ms *= 2;
+            } else {
+                retry_ms = SSL_KEY_SHARE_POOL_RETRY_MAX_MS;
+            }
+
+            if (!pool->shutdown) {
+                ssl_key_share_pool_wait(pool, retry_ms);
+            }
+            continue;
+        }
+
+        retry_ms = 0;
+        if (done && !pool->shutdown) {
+            (void) pthread_cond_wait(&pool->taken, &pool->mutex);
+        }
+    }
+    (void) pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+static mbedtls_ssl_key_share_pool_group *ssl_key_share_pool_find(
+    mbedtls_ssl_key_share_pool *pool, uint16_t tls_id)
+{
+    size_t i;
+
+    for (i = 0; i < pool->group_count; i++) {
+        if (pool->groups[i].tls_id == tls_id) {
+            return &pool->groups[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Wipe and free the key pairs */
+static void ssl_key_share_pool_release(mbedtls_ssl_key_share_pool *pool)
+{
+    size_t i;
+
+    for (i = 0; i < pool->group_count; i++) {
+        if (pool->groups[i].entries != NULL) {
+            mbedtls_platform_zeroize(pool->groups[i].entries,
+                                     pool->size *
+                                     sizeof(mbedtls_ssl_key_share_pool_entry));
+            mbedtls_free(pool->groups[i].entries);
+        }
+    }
+    memset(pool->groups, 0, sizeof(pool->groups));
+    pool->group_count = 0;
+}
+
+int mbedtls_ssl_key_share_pool_setup(mbedtls_ssl_key_share_pool *pool,
+                                     const uint16_t *groups,
+                                     size_t size,
+                                     int (*f_rng)(void *, unsigned char *, size_t),
+                                     void *p_rng)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_key_share_pool_group *group;
+    mbedtls_ecp_group_id grp_id;
+
+    if (pool->is_valid || groups == NULL || size == 0 || f_rng == NULL ||
+        size > SIZE_MAX / sizeof(mbedtls_ssl_key_share_pool_entry)) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    pool->size = size;
+    for (; *groups != 0; groups++) {
+        grp_id = mbedtls_ssl_get_ecp_group_id_from_tls_id(*groups);
+        if (pool->group_count == MBEDTLS_SSL_KEY_SHARE_POOL_MAX_GROUPS ||
+            grp_id == MBEDTLS_ECP_DP_NONE ||
+            mbedtls_ecp_curve_info_from_grp_id(grp_id) == NULL ||
+            ssl_key_share_pool_find(pool, *groups) != NULL) {
+            ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+            goto exit;
+        }
+
+        group = &pool->groups[pool->group_count++];
+        group->tls_id = *groups;
+        group->grp_id = grp_id;
+        group->entries = mbedtls_calloc(size,
+                                        sizeof(mbedtls_ssl_key_share_pool_entry));
+        if (group->entries == NULL) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            goto exit;
+        }
+    }
+    if (pool->group_count == 0) {
+        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        goto exit;
+    }
+
+    pool->f_rng = f_rng;
+    pool->p_rng = p_rng;
+
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+        goto exit;
+    }
+    if (pthread_cond_init(&pool->taken, NULL) != 0) {
+        (void) pthread_mutex_destroy(&pool->mutex);
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+        goto exit;
+    }
+    pool->is_valid = 1;
+
+    if (pthread_create(&pool->thread, NULL,
+                       ssl_key_share_pool_thread, pool) != 0) {
+        mbedtls_ssl_key_share_pool_free(pool);
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+    pool->has_thread = 1;
+
+    return 0;
+
+exit:
+    ssl_key_share_pool_release(pool);
+    pool->size = 0;
+    return ret;
+}
+
+int mbedtls_ssl_key_share_pool_refill(mbedtls_ssl_key_share_pool *pool)
+{
+    int ret = 0;
+    int done = 0;
+
+    if (pool == NULL || !pool->is_valid) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (pthread_mutex_lock(&pool->mutex) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+    while (ret == 0 && !done) {
+        ret = ssl_key_share_pool_refill_one(pool, &done);
+    }
+    (void) pthread_mutex_unlock(&pool->mutex);
+
+    return ret;
+}
+
+int mbedtls_ssl_key_share_pool_take(void *p_pool,
+                                    uint16_t group,
+                                    unsigned char *priv,
+                                    size_t priv_size,
+                                    size_t *priv_len,
+                                    unsigned char *pub,
+                                    size_t pub_size,
+                                    size_t *pub_len)
+{
+    mbedtls_ssl_key_share_pool *pool = p_pool;
+    mbedtls_ssl_key_share_pool_group *g;
+    mbedtls_ssl_key_share_pool_entry *entry;
+    int ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+
+    if (pool == NULL || !pool->is_valid) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (pthread_mutex_lock(&pool->mutex) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    g = ssl_key_share_pool_find(pool, group);
+    if (g == NULL) {
+        goto exit;
+    }
+    if (g->count == 0) {
+        /* Don't let the refill thread sleep through a backoff delay */
+        (void) pthread_cond_signal(&pool->taken);
+        goto exit;
+    }
+
+    entry = &g->entries[g->count - 1];
+    if (entry->priv_len > priv_size || entry->pub_len > pub_size) {
+        ret = MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+        goto exit;
+    }
+
+    memcpy(priv, entry->priv, entry->priv_len);
+    *priv_len = entry->priv_len;
+    memcpy(pub, entry->pub, entry->pub_len);
+    *pub_len = entry->pub_len;
+
+    mbedtls_platform_zeroize(entry, sizeof(*entry));
+    g->count--;
+    (void) pthread_cond_signal(&pool->taken);
+    ret = 0;
+
+exit:
+    (void) pthread_mutex_unlock(&pool->mutex);
+    return ret;
+}
+
+size_t mbedtls_ssl_key_share_pool_available(mbedtls_ssl_key_share_pool *pool,
+                                            uint16_t group)
+{
+    mbedtls_ssl_key_share_pool_group *g;
+    size_t count = 0;
+
+    if (pool == NULL || !pool->is_valid ||
+        pthread_mutex_lock(&pool->mutex) != 0) {
+        return 0;
+    }
+
+    g = ssl_key_share_pool_find(pool, group);
+    if (g != NULL) {
+        count = g->count;
+    }
+
+    (void) pthread_mutex_unlock(&pool->mutex);
+    return count;
+}
+
+void mbedtls_ssl_key_share_pool_free(mbedtls_ssl_key_share_pool *pool)
+{
+    if (pool == NULL || !pool->is_valid) {
+        return;
+    }
+
+    if (pool->has_thread) {
+        (void) pthread_mutex_lock(&pool->mutex);
+        pool->shutdown = 1;
+        (void) pthread_cond_signal(&pool->taken);
+        (void) pthread_mutex_unlock(&pool->mutex);
+        (void) pthread_join(pool->thread, NULL);
+    }
+
+    ssl_key_share_pool_release(pool);
+
+    (void) pthread_cond_destroy(&pool->taken);
+    (void) pthread_mutex_destroy(&pool->mutex);
+
+    mbedtls_platform_zeroize(pool, sizeof(mbedtls_ssl_key_share_pool));
+}
+
+#endif /* MBEDTLS_SSL_KEY_SHARE_POOL_C */
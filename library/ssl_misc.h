@@ -108,6 +108,7 @@
 #define MBEDTLS_SSL_EXT_ID_EXTENDED_MASTER_SECRET     26
 #define MBEDTLS_SSL_EXT_ID_SESSION_TICKET             27
 #define MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT          28
+#define MBEDTLS_SSL_EXT_ID_COMPRESS_CERTIFICATE       29
 
 /* Utility for translating IANA extension type. */
 uint32_t mbedtls_ssl_get_extension_id(unsigned int extension_type);
@@ -169,6 +170,7 @@ uint32_t mbedtls_ssl_get_extension_mask(unsigned int extension_type);
      MBEDTLS_SSL_EXT_MASK(POST_HANDSHAKE_AUTH)                    | \
      MBEDTLS_SSL_EXT_MASK(SIG_ALG_CERT)                           | \
      MBEDTLS_SSL_EXT_MASK(RECORD_SIZE_LIMIT)                      | \
+     MBEDTLS_SSL_EXT_MASK(COMPRESS_CERTIFICATE)                   | \
      MBEDTLS_SSL_TLS1_3_EXT_MASK_UNRECOGNIZED)
 
 /* RFC 8446 section 4.2. Allowed extensions for EncryptedExtensions */
@@ -192,6 +194,7 @@ uint32_t mbedtls_ssl_get_extension_mask(unsigned int extension_type);
      MBEDTLS_SSL_EXT_MASK(CERT_AUTH)                              | \
      MBEDTLS_SSL_EXT_MASK(OID_FILTERS)                            | \
      MBEDTLS_SSL_EXT_MASK(SIG_ALG_CERT)                           | \
+     MBEDTLS_SSL_EXT_MASK(COMPRESS_CERTIFICATE)                   | \
      MBEDTLS_SSL_TLS1_3_EXT_MASK_UNRECOGNIZED)
 
 /* RFC 8446 section 4.2. Allowed extensions for Certificate */
@@ -407,14 +410,29 @@ uint32_t mbedtls_ssl_get_extension_mask(unsigned int extension_type);
 #endif
 
 #if !defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
-#define MBEDTLS_SSL_OUT_BUFFER_LEN  \
+#define MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN  \
     ((MBEDTLS_SSL_HEADER_LEN) + (MBEDTLS_SSL_OUT_PAYLOAD_LEN))
 #else
-#define MBEDTLS_SSL_OUT_BUFFER_LEN                               \
+#define MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN                        \
     ((MBEDTLS_SSL_HEADER_LEN) + (MBEDTLS_SSL_OUT_PAYLOAD_LEN)    \
      + (MBEDTLS_SSL_CID_OUT_LEN_MAX))
 #endif
 
+/* With record batching, the output buffer holds several records, each of
+ * which fits in the space computed above for a single one. */
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+#if MBEDTLS_SSL_WRITE_BATCH_RECORDS < 1
+#error "Bad configuration - MBEDTLS_SSL_WRITE_BATCH_RECORDS must be at least 1."
+#endif
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION) && MBEDTLS_SSL_WRITE_BATCH_RECORDS < 2
+#error "Bad configuration - MBEDTLS_SSL_PARALLEL_ENCRYPTION needs MBEDTLS_SSL_WRITE_BATCH_RECORDS of at least 2."
+#endif
+#define MBEDTLS_SSL_OUT_BUFFER_LEN  \
+    ((MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN) * (MBEDTLS_SSL_WRITE_BATCH_RECORDS))
+#else
+#define MBEDTLS_SSL_OUT_BUFFER_LEN  (MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN)
+#endif
+
 #define MBEDTLS_CLIENT_HELLO_RANDOM_LEN 32
 #define MBEDTLS_SERVER_HELLO_RANDOM_LEN 32
 
@@ -843,6 +861,14 @@ struct mbedtls_ssl_handshake_params {
 
     } buffering;
 
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    struct {
+        unsigned char *buf;             /*!< Serves buffering           */
+        size_t in_use;                  /*!< Bytes in allocated blocks,
+                                         *   headers included.         */
+    } arena;
+#endif /* MBEDTLS_SSL_DTLS_BUFFERING_ARENA */
+
 #if defined(MBEDTLS_SSL_CLI_C) && \
     (defined(MBEDTLS_SSL_PROTO_DTLS) || \
     defined(MBEDTLS_SSL_PROTO_TLS1_3))
@@ -919,6 +945,13 @@ struct mbedtls_ssl_handshake_params {
     mbedtls_md_context_t fin_sha384;
 #endif
 #endif
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    unsigned char *transcript_buf;      /*!< messages not hashed yet, until
+                                         *   the hash is known */
+    size_t transcript_len;              /*!< length of the messages      */
+    size_t transcript_size;             /*!< size of transcript_buf      */
+#endif
 
 #if defined(MBEDTLS_SSL_PROTO_TLS1_3)
     uint16_t offered_group_id; /* The NamedGroup value for the group
@@ -983,6 +1016,12 @@ struct mbedtls_ssl_handshake_params {
     unsigned char *certificate_request_context;
 #endif
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    /** Bit \c i is set if the peer accepts certificates compressed with
+     *  the algorithm \c i of the configuration. */
+    uint32_t peer_cert_compression_algs;
+#endif
+
     /** TLS 1.3 transform for encrypted handshake messages. */
     mbedtls_ssl_transform *transform_handshake;
     union {
@@ -995,6 +1034,12 @@ struct mbedtls_ssl_handshake_params {
 #if defined(MBEDTLS_SSL_EARLY_DATA)
     /** TLS 1.3 transform for early data and handshake messages. */
     mbedtls_ssl_transform *transform_earlydata;
+#if defined(MBEDTLS_SSL_SRV_C)
+    /** Verified binder of the selected PSK: it identifies the ClientHello
+     *  for the early data anti-replay callback. */
+    unsigned char early_data_binder[MBEDTLS_TLS1_3_MD_MAX_SIZE];
+    size_t early_data_binder_len;
+#endif
 #endif
 #endif /* MBEDTLS_SSL_PROTO_TLS1_3 */
 
@@ -1110,6 +1155,13 @@ struct mbedtls_ssl_transform {
     unsigned char iv_enc[16];           /*!<  IV (encryption)         */
     unsigned char iv_dec[16];           /*!<  IV (decryption)         */
 
+#if defined(MBEDTLS_SSL_KTLS)
+    /* Copies of the traffic keys, for mbedtls_ssl_export_ktls_info() */
+    unsigned char ktls_key_enc[32];
+    unsigned char ktls_key_dec[32];
+    size_t ktls_keylen;                 /*!<  0 if not kept           */
+#endif
+
 #if defined(MBEDTLS_SSL_SOME_SUITES_USE_MAC)
 
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
@@ -1136,6 +1188,14 @@ struct mbedtls_ssl_transform {
 #else
     mbedtls_cipher_context_t cipher_ctx_enc;    /*!<  encryption context      */
     mbedtls_cipher_context_t cipher_ctx_dec;    /*!<  decryption context      */
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    /* Further encryption contexts with the same key, so that the records
+     * of a batch can be encrypted concurrently (AEAD only). Record i of a
+     * batch uses cipher_ctx_enc if i is 0, cipher_ctx_enc_lanes[i - 1]
+     * otherwise. */
+    mbedtls_cipher_context_t cipher_ctx_enc_lanes[MBEDTLS_SSL_WRITE_BATCH_RECORDS - 1];
+    unsigned char enc_lanes;                    /*!<  lanes set up, 0 or all  */
+#endif
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
 
 #if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
@@ -1223,6 +1283,18 @@ typedef struct {
 #endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
 } mbedtls_record;
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/*
+ * TLS 1.3 Certificate message compressed with one algorithm
+ */
+typedef struct {
+    unsigned char *data;                    /*!< compressed message, or NULL
+                                                 if it didn't compress    */
+    size_t len;                             /*!< length of data             */
+    size_t uncompressed_len;                /*!< length of the message      */
+} mbedtls_ssl_compressed_cert;
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 /*
  * List of certificate + private key pairs
@@ -1231,6 +1303,21 @@ struct mbedtls_ssl_key_cert {
     mbedtls_x509_crt *cert;                 /*!< cert                       */
     mbedtls_pk_context *key;                /*!< private key                */
     mbedtls_ssl_key_cert *next;             /*!< next key/cert pair         */
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+    unsigned char *chain_tls12;             /*!< TLS 1.2 certificate_list   */
+    size_t chain_tls12_len;                 /*!< length of chain_tls12      */
+#endif
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    unsigned char *chain_tls13;             /*!< TLS 1.3 certificate_list   */
+    size_t chain_tls13_len;                 /*!< length of chain_tls13      */
+#endif
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE */
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    mbedtls_ssl_compressed_cert *compressed; /*!< one per algorithm of the
+                                                  configuration, or NULL */
+    size_t compressed_count;                /*!< length of compressed       */
+#endif
 };
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
@@ -1420,6 +1507,12 @@ int mbedtls_ssl_read_record(mbedtls_ssl_context *ssl,
                             unsigned update_hs_digest);
 MBEDTLS_CHECK_RETURN_CRITICAL
 int mbedtls_ssl_fetch_input(mbedtls_ssl_context *ssl, size_t nb_want);
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+/* With TLS, remember the data read past the record of rec_len bytes at
+ * ssl->in_hdr, so that the next call to mbedtls_ssl_fetch_input() starts
+ * from it. To be called before ssl->in_left is reset. */
+void mbedtls_ssl_keep_read_ahead(mbedtls_ssl_context *ssl, size_t rec_len);
+#endif
 
 /*
  * Write handshake message header
@@ -1464,8 +1557,20 @@ int mbedtls_ssl_parse_finished(mbedtls_ssl_context *ssl);
 MBEDTLS_CHECK_RETURN_CRITICAL
 int mbedtls_ssl_write_finished(mbedtls_ssl_context *ssl);
 
-void mbedtls_ssl_optimize_checksum(mbedtls_ssl_context *ssl,
-                                   const mbedtls_ssl_ciphersuite_t *ciphersuite_info);
+/*
+ * Hash the handshake transcript with the hash of the ciphersuite only, from
+ * now on. The messages buffered until now are hashed at this point.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_optimize_checksum(mbedtls_ssl_context *ssl,
+                                  const mbedtls_ssl_ciphersuite_t *ciphersuite_info);
+
+/*
+ * Hash the handshake transcript with every hash from now on, for a TLS 1.2
+ * server that doesn't know yet which one the CertificateVerify will use.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_keep_all_checksums(mbedtls_ssl_context *ssl);
 
 /*
  * Update checksum of handshake messages.
@@ -1602,6 +1707,51 @@ mbedtls_ecp_group_id mbedtls_ssl_get_ecp_group_id_from_tls_id(uint16_t tls_id);
  */
 uint16_t mbedtls_ssl_get_tls_id_from_ecp_group_id(mbedtls_ecp_group_id grp_id);
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_ECDH_C)
+/**
+ * \brief Compute the ECDHE shared secret with the asynchronous key agreement
+ *        callback, or resume the operation in progress.
+ *
+ * \param ssl       The SSL context. The ephemeral key and the peer's public
+ *                  key must be set up in the handshake parameters.
+ * \param out       Buffer for the shared secret.
+ * \param out_size  Size of \p out in bytes.
+ * \param out_len   On success, the length of the shared secret.
+ *
+ * \return          0 on success.
+ * \return          #MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS if the caller must
+ *                  return and call this function again.
+ * \return          #MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH if no callback is
+ *                  set or if it declined the operation: the caller must
+ *                  compute the shared secret itself.
+ * \return          Another negative error code on failure.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_async_key_agreement(mbedtls_ssl_context *ssl,
+                                    unsigned char *out, size_t out_size,
+                                    size_t *out_len);
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_ECDH_C */
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+/**
+ * \brief Return the usage flags of a PSA ephemeral ECDH key: the key must
+ *        be exportable to be passed to the asynchronous key agreement
+ *        callback.
+ */
+static inline psa_key_usage_t mbedtls_ssl_ecdh_psa_key_usage(
+    const mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if (ssl->conf->f_async_key_agreement_start != NULL) {
+        return PSA_KEY_USAGE_DERIVE | PSA_KEY_USAGE_EXPORT;
+    }
+#else
+    (void) ssl;
+#endif
+    return PSA_KEY_USAGE_DERIVE;
+}
+#endif /* MBEDTLS_USE_PSA_CRYPTO || MBEDTLS_SSL_PROTO_TLS1_3 */
+
 #if defined(MBEDTLS_DEBUG_C)
 /**
  * \brief Return EC's name for the specified TLS ID.
@@ -1643,16 +1793,19 @@ static inline mbedtls_pk_context *mbedtls_ssl_own_key(mbedtls_ssl_context *ssl)
     return key_cert == NULL ? NULL : key_cert->key;
 }
 
-static inline mbedtls_x509_crt *mbedtls_ssl_own_cert(mbedtls_ssl_context *ssl)
+static inline mbedtls_ssl_key_cert *mbedtls_ssl_own_key_cert(mbedtls_ssl_context *ssl)
 {
-    mbedtls_ssl_key_cert *key_cert;
-
     if (ssl->handshake != NULL && ssl->handshake->key_cert != NULL) {
-        key_cert = ssl->handshake->key_cert;
-    } else {
-        key_cert = ssl->conf->key_cert;
+        return ssl->handshake->key_cert;
     }
 
+    return ssl->conf->key_cert;
+}
+
+static inline mbedtls_x509_crt *mbedtls_ssl_own_cert(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_key_cert *key_cert = mbedtls_ssl_own_key_cert(ssl);
+
     return key_cert == NULL ? NULL : key_cert->cert;
 }
 
@@ -1670,6 +1823,21 @@ int mbedtls_ssl_check_cert_usage(const mbedtls_x509_crt *cert,
                                  const mbedtls_ssl_ciphersuite_t *ciphersuite,
                                  int cert_endpoint,
                                  uint32_t *flags);
+
+/*
+ * Verify a peer certificate chain like mbedtls_x509_crt_verify_restartable(),
+ * unless the verified chain cache of the configuration knows it already.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_verify_peer_chain(mbedtls_ssl_context *ssl,
+                                  mbedtls_x509_crt *chain,
+                                  mbedtls_x509_crt *ca_chain,
+                                  mbedtls_x509_crl *ca_crl,
+                                  int (*f_vrfy)(void *, mbedtls_x509_crt *, int,
+                                                uint32_t *),
+                                  void *p_vrfy,
+                                  uint32_t *flags,
+                                  mbedtls_x509_crt_restart_ctx *rs_ctx);
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 void mbedtls_ssl_write_version(unsigned char version[2], int transport,
@@ -1744,6 +1912,14 @@ int mbedtls_ssl_get_key_exchange_md_tls1_2(mbedtls_ssl_context *ssl,
 #endif
 
 void mbedtls_ssl_transform_init(mbedtls_ssl_transform *transform);
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+/* Set up the additional encryption contexts of an AEAD transform, once
+ * cipher_ctx_enc is keyed. Does nothing for other transforms. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_transform_setup_enc_lanes(mbedtls_ssl_transform *transform,
+                                          const mbedtls_cipher_info_t *cipher_info,
+                                          const unsigned char *key);
+#endif
 MBEDTLS_CHECK_RETURN_CRITICAL
 int mbedtls_ssl_encrypt_buf(mbedtls_ssl_context *ssl,
                             mbedtls_ssl_transform *transform,
@@ -1782,6 +1958,24 @@ void mbedtls_ssl_update_out_pointers(mbedtls_ssl_context *ssl,
                                      mbedtls_ssl_transform *transform);
 void mbedtls_ssl_update_in_pointers(mbedtls_ssl_context *ssl);
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+/* Make sure that the record buffers are allocated, getting them from the
+ * configured buffer pool if they were released while the connection was
+ * idle. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_buffers_acquire(mbedtls_ssl_context *ssl);
+/* Give the record buffers back to the buffer pool if they don't hold any
+ * data that is still needed. */
+void mbedtls_ssl_buffers_release_idle(mbedtls_ssl_context *ssl);
+/* Give the record buffers back unconditionally. */
+void mbedtls_ssl_buffers_free(mbedtls_ssl_context *ssl);
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
+
+/* Run the handshake like mbedtls_ssl_handshake(), but don't give the record
+ * buffers back at the end: the caller goes on to use them. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_handshake_keep_buffers(mbedtls_ssl_context *ssl);
+
 MBEDTLS_CHECK_RETURN_CRITICAL
 int mbedtls_ssl_session_reset_int(mbedtls_ssl_context *ssl, int partial);
 void mbedtls_ssl_session_reset_msg_layer(mbedtls_ssl_context *ssl,
@@ -1819,6 +2013,11 @@ int mbedtls_ssl_start_renegotiation(mbedtls_ssl_context *ssl);
 size_t mbedtls_ssl_get_current_mtu(const mbedtls_ssl_context *ssl);
 void mbedtls_ssl_buffering_free(mbedtls_ssl_context *ssl);
 void mbedtls_ssl_flight_free(mbedtls_ssl_flight_item *flight);
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_dtls_arena_setup(mbedtls_ssl_context *ssl);
+void mbedtls_ssl_dtls_arena_free(mbedtls_ssl_context *ssl);
+#endif
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 
 /**
@@ -2105,6 +2304,34 @@ int mbedtls_ssl_tls13_write_early_data_ext(mbedtls_ssl_context *ssl,
                                            unsigned char *buf,
                                            const unsigned char *end,
                                            size_t *out_len);
+
+#if defined(MBEDTLS_SSL_SRV_C)
+/*
+ * Server-side status of accepted early data once the EndOfEarlyData message
+ * of the client has been received.
+ */
+#define MBEDTLS_SSL_EARLY_DATA_STATUS_END_OF_EARLY_DATA     3
+
+/*
+ * Values of ssl->discard_early_data_record: how the server skips the records
+ * of early data it rejected.
+ *   - TRY_TO_DEPROTECT_AND_DISCARD: the records that the handshake keys
+ *     fail to decrypt are early data.
+ *   - DISCARD: after a HelloRetryRequest, the application data records
+ *     received before the second ClientHello are early data.
+ */
+#define MBEDTLS_SSL_EARLY_DATA_NO_DISCARD                   0
+#define MBEDTLS_SSL_EARLY_DATA_TRY_TO_DEPROTECT_AND_DISCARD 1
+#define MBEDTLS_SSL_EARLY_DATA_DISCARD                      2
+
+/*
+ * Account for early data received by the server, accepted or not, and fail
+ * with an unexpected_message alert once the maximum is exceeded.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_tls13_check_early_data_len(mbedtls_ssl_context *ssl,
+                                           size_t early_data_len);
+#endif /* MBEDTLS_SSL_SRV_C */
 #endif /* MBEDTLS_SSL_EARLY_DATA */
 
 #endif /* MBEDTLS_SSL_PROTO_TLS1_3 */
@@ -2665,6 +2892,27 @@ int mbedtls_ssl_parse_server_name_ext(mbedtls_ssl_context *ssl,
                                       const unsigned char *end);
 #endif /* MBEDTLS_SSL_SERVER_NAME_INDICATION */
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/*
+ * Write the compress_certificate extension of a ClientHello or a
+ * CertificateRequest, if decompression is configured.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_tls13_write_compress_certificate_ext(mbedtls_ssl_context *ssl,
+                                                     unsigned char *buf,
+                                                     const unsigned char *end,
+                                                     size_t *out_len);
+
+/*
+ * Parse the compress_certificate extension of a ClientHello or a
+ * CertificateRequest: record which configured algorithms the peer accepts.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_tls13_parse_compress_certificate_ext(mbedtls_ssl_context *ssl,
+                                                     const unsigned char *buf,
+                                                     const unsigned char *end);
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_SSL_RECORD_SIZE_LIMIT)
 #define MBEDTLS_SSL_RECORD_SIZE_LIMIT_EXTENSION_DATA_LENGTH (2)
 #define MBEDTLS_SSL_RECORD_SIZE_LIMIT_MIN (64)
@@ -2697,6 +2945,20 @@ int mbedtls_ssl_check_dtls_clihlo_cookie(
     unsigned char *obuf, size_t buf_len, size_t *olen);
 #endif
 
+#if defined(MBEDTLS_SSL_DTLS_DEMUX_C) && defined(MBEDTLS_SSL_SRV_C)
+/*
+ * Check if a datagram looks like a ClientHello with a valid cookie,
+ * and if it doesn't, write a HelloVerifyRequest record to obuf.
+ * Only ssl->conf is used, so ssl does not need to be set up.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_dtls_demux_check_cookie(
+    mbedtls_ssl_context *ssl,
+    const unsigned char *cli_id, size_t cli_id_len,
+    const unsigned char *in, size_t in_len,
+    unsigned char *obuf, size_t buf_len, size_t *olen);
+#endif
+
 #if defined(MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_SOME_PSK_ENABLED)
 /**
  * \brief Given an SSL context and its associated configuration, write the TLS
@@ -2741,6 +3003,13 @@ int mbedtls_ssl_session_set_hostname(mbedtls_ssl_session *session,
                                      const char *hostname);
 #endif
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+MBEDTLS_CHECK_RETURN_CRITICAL
+int mbedtls_ssl_session_set_ticket_alpn(mbedtls_ssl_session *session,
+                                        const char *alpn);
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_SESSION_TICKETS)
 static inline unsigned int mbedtls_ssl_session_get_ticket_flags(
     mbedtls_ssl_session *session, unsigned int flags)
@@ -165,13 +165,219 @@ static int ssl_buffer_future_record(mbedtls_ssl_context *ssl,
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_next_record_is_in_datagram(mbedtls_ssl_context *ssl);
 
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+/*
+ * DTLS handshake buffering arena
+ *
+ * The arena is a sequence of blocks, each starting with a header giving
+ * the size of the block, header included, and whether it is in use.
+ * Allocation is first fit, merging adjacent free blocks on the way. There
+ * are never more than MBEDTLS_SSL_MAX_BUFFERED_HS messages and one future
+ * record. The outgoing flight stays on the heap, so that it doesn't compete
+ * with the peer's messages for the MBEDTLS_SSL_DTLS_MAX_BUFFERING budget.
+ */
+typedef union {
+    struct {
+        size_t size;
+        size_t used;
+    } h;
+    void *align_ptr;
+    uint64_t align_u64;
+} ssl_arena_block;
+
+#define SSL_ARENA_UNIT  sizeof(ssl_arena_block)
+
+/* The budget, plus for each block its header, its rounding to a whole
+ * number of units and a remainder too small to be split off. */
+#define SSL_ARENA_LEN                                                      \
+    ((MBEDTLS_SSL_DTLS_MAX_BUFFERING + SSL_ARENA_UNIT - 1) /               \
+     SSL_ARENA_UNIT * SSL_ARENA_UNIT +                                     \
+     (MBEDTLS_SSL_MAX_BUFFERED_HS + 1) * 4 * SSL_ARENA_UNIT)
+
+int mbedtls_ssl_dtls_arena_setup(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_handshake_params * const hs = ssl->handshake;
+    ssl_arena_block *first;
+
+    hs->arena.buf = mbedtls_calloc(1, SSL_ARENA_LEN);
+    if (hs->arena.buf == NULL) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("alloc %" MBEDTLS_PRINTF_SIZET " bytes failed",
+                                  (size_t) SSL_ARENA_LEN));
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    hs->arena.in_use = 0;
+
+    first = (ssl_arena_block *) hs->arena.buf;
+    first->h.size = SSL_ARENA_LEN;
+    first->h.used = 0;
+
+    return 0;
+}
+
+void mbedtls_ssl_dtls_arena_free(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_handshake_params * const hs = ssl->handshake;
+
+    if (hs == NULL || hs->arena.buf == NULL) {
+        return;
+    }
+
+    mbedtls_platform_zeroize(hs->arena.buf, SSL_ARENA_LEN);
+    mbedtls_free(hs->arena.buf);
+    hs->arena.buf = NULL;
+    hs->arena.in_use = 0;
+}
+
+int mbedtls_ssl_get_dtls_buffering_stats(const mbedtls_ssl_context *ssl,
+                                         mbedtls_ssl_dtls_buffering_stats *stats)
+{
+    if (ssl == NULL || ssl->conf == NULL || stats == NULL ||
+        ssl->conf->transport != MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    stats->capacity = SSL_ARENA_LEN;
+    stats->in_use = 0;
+    if (ssl->handshake != NULL && ssl->handshake->arena.buf != NULL) {
+        stats->in_use = ssl->handshake->arena.in_use;
+    }
+    stats->peak = ssl->dtls_arena_peak;
+    stats->failures = ssl->dtls_arena_failures;
+
+    return 0;
+}
+
+static void *ssl_arena_alloc(mbedtls_ssl_context *ssl, size_t len)
+{
+    mbedtls_ssl_handshake_params * const hs = ssl->handshake;
+    unsigned char *p;
+    unsigned char *end;
+    ssl_arena_block *block;
+    ssl_arena_block *next;
+    size_t size;
+
+    if (hs->arena.buf == NULL || len > SSL_ARENA_LEN - SSL_ARENA_UNIT) {
+        return NULL;
+    }
+    size = SSL_ARENA_UNIT +
+           (len + SSL_ARENA_UNIT - 1) / SSL_ARENA_UNIT * SSL_ARENA_UNIT;
+
+    end = hs->arena.buf + SSL_ARENA_LEN;
+    for (p = hs->arena.buf; p < end; p += block->h.size) {
+        block = (ssl_arena_block *) p;
+        if (block->h.used) {
+            continue;
+        }
+
+        while (p + block->h.size < end) {
+            next = (ssl_arena_block *) (p + block->h.size);
+            if (next->h.used) {
+                break;
+            }
+            block->h.size += next->h.size;
+        }
+
+        if (block->h.size < size) {
+            continue;
+        }
+
+        /* Split off the rest unless it can't hold anything */
+        if (block->h.size - size >= 2 * SSL_ARENA_UNIT) {
+            next = (ssl_arena_block *) (p + size);
+            next->h.size = block->h.size - size;
+            next->h.used = 0;
+            block->h.size = size;
+        }
+        block->h.used = 1;
+
+        hs->arena.in_use += block->h.size;
+        if (hs->arena.in_use > ssl->dtls_arena_peak) {
+            ssl->dtls_arena_peak = hs->arena.in_use;
+        }
+
+        memset(p + SSL_ARENA_UNIT, 0, block->h.size - SSL_ARENA_UNIT);
+        return p + SSL_ARENA_UNIT;
+    }
+
+    return NULL;
+}
+
+static void ssl_arena_release(mbedtls_ssl_context *ssl, void *ptr)
+{
+    ssl_arena_block *block;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    block = (ssl_arena_block *) ((unsigned char *) ptr - SSL_ARENA_UNIT);
+    ssl->handshake->arena.in_use -= block->h.size;
+    block->h.used = 0;
+}
+#endif /* MBEDTLS_SSL_DTLS_BUFFERING_ARENA */
+
+/*
+ * Allocate zeroed memory for handshake buffering.
+ *
+ * With the arena, an allocation can fail within the
+ * MBEDTLS_SSL_DTLS_MAX_BUFFERING budget when the free space is fragmented.
+ * If evict_from is not negative, the buffered future record, then the
+ * buffered messages from the most distant one down to slot evict_from are
+ * dropped until the allocation succeeds; the peer retransmits them.
+ */
+static void *ssl_buffering_alloc(mbedtls_ssl_context *ssl, size_t len,
+                                 int evict_from)
+{
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    void *p;
+    int offset;
+
+    p = ssl_arena_alloc(ssl, len);
+    if (p != NULL) {
+        return p;
+    }
+
+    ssl->dtls_arena_failures++;
+    if (evict_from < 0) {
+        return NULL;
+    }
+
+    ssl_free_buffered_record(ssl);
+    p = ssl_arena_alloc(ssl, len);
+
+    for (offset = MBEDTLS_SSL_MAX_BUFFERED_HS - 1;
+         p == NULL && offset >= evict_from; offset--) {
+        MBEDTLS_SSL_DEBUG_MSG(2, ("Free buffering slot %d to make room in arena",
+                                  offset));
+        ssl_buffering_free_slot(ssl, (uint8_t) offset);
+        p = ssl_arena_alloc(ssl, len);
+    }
+
+    return p;
+#else
+    (void) ssl;
+    (void) evict_from;
+    return mbedtls_calloc(1, len);
+#endif /* MBEDTLS_SSL_DTLS_BUFFERING_ARENA */
+}
+
+static void ssl_buffering_release(mbedtls_ssl_context *ssl, void *p)
+{
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    ssl_arena_release(ssl, p);
+#else
+    (void) ssl;
+    mbedtls_free(p);
+#endif
+}
+
 static size_t ssl_get_maximum_datagram_size(mbedtls_ssl_context const *ssl)
 {
     size_t mtu = mbedtls_ssl_get_current_mtu(ssl);
 #if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
     size_t out_buf_len = ssl->out_buf_len;
 #else
-    size_t out_buf_len = MBEDTLS_SSL_OUT_BUFFER_LEN;
+    size_t out_buf_len = MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN;
 #endif
 
     if (mtu != 0 && mtu < out_buf_len) {
@@ -678,11 +884,18 @@ static void ssl_build_record_nonce(unsigned char *dst_iv,
 }
 #endif /* MBEDTLS_GCM_C || MBEDTLS_CCM_C || MBEDTLS_CHACHAPOLY_C */
 
-int mbedtls_ssl_encrypt_buf(mbedtls_ssl_context *ssl,
-                            mbedtls_ssl_transform *transform,
-                            mbedtls_record *rec,
-                            int (*f_rng)(void *, unsigned char *, size_t),
-                            void *p_rng)
+/*
+ * Protect a record. For AEAD transforms, lane selects the encryption context
+ * to use, see mbedtls_ssl_transform::cipher_ctx_enc_lanes; it must be 0 for
+ * other transforms.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_encrypt_buf(mbedtls_ssl_context *ssl,
+                           mbedtls_ssl_transform *transform,
+                           mbedtls_record *rec,
+                           int (*f_rng)(void *, unsigned char *, size_t),
+                           void *p_rng,
+                           unsigned lane)
 {
     mbedtls_ssl_mode_t ssl_mode;
     int auth_done = 0;
@@ -712,6 +925,9 @@ int mbedtls_ssl_encrypt_buf(mbedtls_ssl_context *ssl,
     ((void) p_rng);
 #endif
 
+    /* Only used by AEAD transforms with parallel encryption. */
+    ((void) lane);
+
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> encrypt buf"));
 
     if (transform == NULL) {
@@ -923,9 +1139,21 @@ hmac_failed_etm_disabled:
             ssl_transform_aead_dynamic_iv_is_explicit(transform);
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
         psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+#else
+        mbedtls_cipher_context_t *cipher_ctx = &transform->cipher_ctx_enc;
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
         int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
 
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+        if (lane != 0) {
+            if (lane > transform->enc_lanes) {
+                MBEDTLS_SSL_DEBUG_MSG(1, ("should never happen"));
+                return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+            }
+            cipher_ctx = &transform->cipher_ctx_enc_lanes[lane - 1];
+        }
+#endif /* MBEDTLS_SSL_PARALLEL_ENCRYPTION */
+
         /* Check that there's space for the authentication tag. */
         if (post_avail < transform->taglen) {
             MBEDTLS_SSL_DEBUG_MSG(1, ("Buffer provided for encrypted record not large enough"));
@@ -990,7 +1218,7 @@ hmac_failed_etm_disabled:
             return ret;
         }
 #else
-        if ((ret = mbedtls_cipher_auth_encrypt_ext(&transform->cipher_ctx_enc,
+        if ((ret = mbedtls_cipher_auth_encrypt_ext(cipher_ctx,
                                                    iv, transform->ivlen,
                                                    add_data, add_data_len,
                                                    data, rec->data_len, /* src */
@@ -1258,6 +1486,15 @@ hmac_failed_etm_enabled:
     return 0;
 }
 
+int mbedtls_ssl_encrypt_buf(mbedtls_ssl_context *ssl,
+                            mbedtls_ssl_transform *transform,
+                            mbedtls_record *rec,
+                            int (*f_rng)(void *, unsigned char *, size_t),
+                            void *p_rng)
+{
+    return ssl_encrypt_buf(ssl, transform, rec, f_rng, p_rng, 0);
+}
+
 int mbedtls_ssl_decrypt_buf(mbedtls_ssl_context const *ssl,
                             mbedtls_ssl_transform *transform,
                             mbedtls_record *rec)
@@ -1908,7 +2145,8 @@ hmac_failed_etm_disabled:
  *
  * With stream transport (TLS) on success ssl->in_left == nb_want, but
  * with datagram transport (DTLS) on success ssl->in_left >= nb_want,
- * since we always read a whole datagram at once.
+ * since we always read a whole datagram at once. With read-ahead enabled,
+ * TLS also reads as much as fits, and ssl->in_left >= nb_want.
  *
  * For DTLS, it is up to the caller to set ssl->next_record_offset when
  * they're done reading a record.
@@ -1930,6 +2168,12 @@ int mbedtls_ssl_fetch_input(mbedtls_ssl_context *ssl, size_t nb_want)
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
     if (nb_want > in_buf_len - (size_t) (ssl->in_hdr - ssl->in_buf)) {
         MBEDTLS_SSL_DEBUG_MSG(1, ("requesting more data than fits"));
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
@@ -2063,12 +2307,34 @@ int mbedtls_ssl_fetch_input(mbedtls_ssl_context *ssl, size_t nb_want)
     } else
 #endif
     {
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        /*
+         * Move the data read past the previous record to the front.
+         */
+        if (ssl->in_ahead_len != 0 && ssl->in_left == 0) {
+            MBEDTLS_SSL_DEBUG_MSG(2, ("next record already read, offset: %"
+                                      MBEDTLS_PRINTF_SIZET,
+                                      ssl->in_ahead_offset));
+            memmove(ssl->in_hdr, ssl->in_hdr + ssl->in_ahead_offset,
+                    ssl->in_ahead_len);
+            ssl->in_left = ssl->in_ahead_len;
+            ssl->in_ahead_offset = 0;
+            ssl->in_ahead_len = 0;
+        }
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
         MBEDTLS_SSL_DEBUG_MSG(2, ("in_left: %" MBEDTLS_PRINTF_SIZET
                                   ", nb_want: %" MBEDTLS_PRINTF_SIZET,
                                   ssl->in_left, nb_want));
 
         while (ssl->in_left < nb_want) {
             len = nb_want - ssl->in_left;
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+            if (ssl->conf->read_ahead == MBEDTLS_SSL_READ_AHEAD_ENABLED) {
+                len = in_buf_len - (size_t) (ssl->in_hdr - ssl->in_buf) -
+                      ssl->in_left;
+            }
+#endif
 
             if (mbedtls_ssl_check_timer(ssl) != 0) {
                 ret = MBEDTLS_ERR_SSL_TIMEOUT;
@@ -2113,6 +2379,19 @@ int mbedtls_ssl_fetch_input(mbedtls_ssl_context *ssl, size_t nb_want)
     return 0;
 }
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+void mbedtls_ssl_keep_read_ahead(mbedtls_ssl_context *ssl, size_t rec_len)
+{
+    if (ssl->in_left > rec_len) {
+        MBEDTLS_SSL_DEBUG_MSG(3, ("%" MBEDTLS_PRINTF_SIZET
+                                  " bytes read past the current record",
+                                  ssl->in_left - rec_len));
+        ssl->in_ahead_offset = rec_len;
+        ssl->in_ahead_len = ssl->in_left - rec_len;
+    }
+}
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
 /*
  * Flush any data not yet written
  */
@@ -3125,18 +3404,21 @@ int mbedtls_ssl_update_handshake_status(mbedtls_ssl_context *ssl)
 /*
  * DTLS anti-replay: RFC 6347 4.1.2.6
  *
- * in_window is a field of bits numbered from 0 (lsb) to 63 (msb).
- * Bit n is set iff record number in_window_top - n has been seen.
+ * in_window is a field of MBEDTLS_SSL_DTLS_REPLAY_WINDOW bits, stored in
+ * 64-bit words: bit n is bit (n % 64) of in_window[n / 64], counting from
+ * the lsb. Bit n is set iff record number in_window_top - n has been seen.
  *
  * Usually, in_window_top is the last record number seen and the lsb of
- * in_window is set. The only exception is the initial state (record number 0
- * not seen yet).
+ * in_window[0] is set. The only exception is the initial state (record
+ * number 0 not seen yet).
  */
 #if defined(MBEDTLS_SSL_DTLS_ANTI_REPLAY)
+#define SSL_REPLAY_WORDS (MBEDTLS_SSL_DTLS_REPLAY_WINDOW / 64)
+
 void mbedtls_ssl_dtls_replay_reset(mbedtls_ssl_context *ssl)
 {
     ssl->in_window_top = 0;
-    ssl->in_window = 0;
+    memset(ssl->in_window, 0, sizeof(ssl->in_window));
 }
 
 static inline uint64_t ssl_load_six_bytes(unsigned char *buf)
@@ -3187,11 +3469,11 @@ int mbedtls_ssl_dtls_replay_check(mbedtls_ssl_context const *ssl)
 
     bit = ssl->in_window_top - rec_seqnum;
 
-    if (bit >= 64) {
+    if (bit >= MBEDTLS_SSL_DTLS_REPLAY_WINDOW) {
         return -1;
     }
 
-    if ((ssl->in_window & ((uint64_t) 1 << bit)) != 0) {
+    if ((ssl->in_window[bit / 64] & ((uint64_t) 1 << (bit % 64))) != 0) {
         return -1;
     }
 
@@ -3213,26 +3495,43 @@ void mbedtls_ssl_dtls_replay_update(mbedtls_ssl_context *ssl)
         /* Update window_top and the contents of the window */
         uint64_t shift = rec_seqnum - ssl->in_window_top;
 
-        if (shift >= 64) {
-            ssl->in_window = 1;
+        if (shift >= MBEDTLS_SSL_DTLS_REPLAY_WINDOW) {
+            memset(ssl->in_window, 0, sizeof(ssl->in_window));
         } else {
-            ssl->in_window <<= shift;
-            ssl->in_window |= 1;
+            /* Move whole words first, then bits across word boundaries,
+             * starting from the oldest word. */
+            size_t words = (size_t) (shift / 64);
+            unsigned bits = (unsigned) (shift % 64);
+            size_t i;
+
+            for (i = SSL_REPLAY_WORDS; i-- > words;) {
+                uint64_t w = ssl->in_window[i - words] << bits;
+
+                if (bits != 0 && i > words) {
+                    w |= ssl->in_window[i - words - 1] >> (64 - bits);
+                }
+                ssl->in_window[i] = w;
+            }
+            for (i = 0; i < words; i++) {
+                ssl->in_window[i] = 0;
+            }
         }
+        ssl->in_window[0] |= 1;
 
         ssl->in_window_top = rec_seqnum;
     } else {
         /* Mark that number as seen in the current window */
         uint64_t bit = ssl->in_window_top - rec_seqnum;
 
-        if (bit < 64) { /* Always true, but be extra sure */
-            ssl->in_window |= (uint64_t) 1 << bit;
+        if (bit < MBEDTLS_SSL_DTLS_REPLAY_WINDOW) { /* Always true, but be extra sure */
+            ssl->in_window[bit / 64] |= (uint64_t) 1 << (bit % 64);
         }
     }
 }
 #endif /* MBEDTLS_SSL_DTLS_ANTI_REPLAY */
 
-#if defined(MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE) && defined(MBEDTLS_SSL_SRV_C)
+#if (defined(MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE) || \
+    defined(MBEDTLS_SSL_DTLS_DEMUX_C)) && defined(MBEDTLS_SSL_SRV_C)
 /*
  * Check if a datagram looks like a ClientHello with a valid cookie,
  * and if it doesn't, generate a HelloVerifyRequest message.
@@ -3380,6 +3679,22 @@ int mbedtls_ssl_check_dtls_clihlo_cookie(
     return MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED;
 }
 
+#if defined(MBEDTLS_SSL_DTLS_DEMUX_C)
+int mbedtls_ssl_dtls_demux_check_cookie(
+    mbedtls_ssl_context *ssl,
+    const unsigned char *cli_id, size_t cli_id_len,
+    const unsigned char *in, size_t in_len,
+    unsigned char *obuf, size_t buf_len, size_t *olen)
+{
+    return mbedtls_ssl_check_dtls_clihlo_cookie(ssl, cli_id, cli_id_len,
+                                                in, in_len,
+                                                obuf, buf_len, olen);
+}
+#endif /* MBEDTLS_SSL_DTLS_DEMUX_C */
+#endif /* (MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE || MBEDTLS_SSL_DTLS_DEMUX_C) &&
+          MBEDTLS_SSL_SRV_C */
+
+#if defined(MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE) && defined(MBEDTLS_SSL_SRV_C)
 /*
  * Handle possible client reconnect with the same UDP quadruplet
  * (RFC 6347 Section 4.2.8).
@@ -3741,6 +4056,30 @@ static int ssl_prepare_record_content(mbedtls_ssl_context *ssl,
     MBEDTLS_SSL_DEBUG_BUF(4, "input record from network",
                           rec->buf, rec->buf_len);
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    /*
+     * After a HelloRetryRequest, the server skips the early data records
+     * the client may send before its second ClientHello, RFC 8446 section
+     * 4.2.10. They are protected with early keys the server does not have.
+     */
+    if (ssl->discard_early_data_record == MBEDTLS_SSL_EARLY_DATA_DISCARD) {
+        if (rec->type == MBEDTLS_SSL_MSG_APPLICATION_DATA) {
+            ret = mbedtls_ssl_tls13_check_early_data_len(ssl, rec->data_len);
+            if (ret != 0) {
+                return ret;
+            }
+            MBEDTLS_SSL_DEBUG_MSG(3, ("EarlyData: skip record before "
+                                      "the second ClientHello"));
+            return MBEDTLS_ERR_SSL_CONTINUE_PROCESSING;
+        } else if (rec->type == MBEDTLS_SSL_MSG_HANDSHAKE) {
+            ssl->discard_early_data_record =
+                MBEDTLS_SSL_EARLY_DATA_NO_DISCARD;
+        }
+    }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA &&
+          MBEDTLS_SSL_SRV_C */
+
     /*
      * In TLS 1.3, always treat ChangeCipherSpec records
      * as unencrypted. The only thing we do with them is
@@ -3771,9 +4110,40 @@ static int ssl_prepare_record_content(mbedtls_ssl_context *ssl,
             }
 #endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA) && \
+    defined(MBEDTLS_SSL_SRV_C)
+            /* The records of rejected early data fail to decrypt with the
+             * handshake keys: skip them, RFC 8446 section 4.2.10. */
+            if (ret == MBEDTLS_ERR_SSL_INVALID_MAC &&
+                old_msg_type == MBEDTLS_SSL_MSG_APPLICATION_DATA &&
+                ssl->discard_early_data_record ==
+                MBEDTLS_SSL_EARLY_DATA_TRY_TO_DEPROTECT_AND_DISCARD) {
+                ret = mbedtls_ssl_tls13_check_early_data_len(ssl,
+                                                             rec->data_len);
+                if (ret != 0) {
+                    return ret;
+                }
+                MBEDTLS_SSL_DEBUG_MSG(3, ("EarlyData: skip rejected record"));
+                return MBEDTLS_ERR_SSL_CONTINUE_PROCESSING;
+            }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA &&
+          MBEDTLS_SSL_SRV_C */
+
             return ret;
         }
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA) && \
+    defined(MBEDTLS_SSL_SRV_C)
+        /* The first record the handshake keys decrypt ends the early data:
+         * a decryption failure is fatal again. */
+        if (ssl->discard_early_data_record ==
+            MBEDTLS_SSL_EARLY_DATA_TRY_TO_DEPROTECT_AND_DISCARD) {
+            ssl->discard_early_data_record =
+                MBEDTLS_SSL_EARLY_DATA_NO_DISCARD;
+        }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA &&
+          MBEDTLS_SSL_SRV_C */
+
         if (old_msg_type != rec->type) {
             MBEDTLS_SSL_DEBUG_MSG(4, ("record type after decrypt (before %d): %d",
                                       old_msg_type, rec->type));
@@ -4234,8 +4604,18 @@ static int ssl_buffer_message(mbedtls_ssl_context *ssl)
                                        MBEDTLS_PRINTF_SIZET,
                                        msg_len));
 
-                hs_buf->data = mbedtls_calloc(1, reassembly_buf_sz);
+                /* Only the next expected message may displace the
+                 * buffered ones. */
+                hs_buf->data = ssl_buffering_alloc(ssl, reassembly_buf_sz,
+                                                   recv_msg_seq_offset == 0 ?
+                                                   1 : -1);
                 if (hs_buf->data == NULL) {
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+                    if (recv_msg_seq_offset > 0) {
+                        /* Same as running out of budget -- ignore */
+                        goto exit;
+                    }
+#endif
                     ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
                     goto exit;
                 }
@@ -4409,7 +4789,7 @@ static void ssl_free_buffered_record(mbedtls_ssl_context *ssl)
         hs->buffering.total_bytes_buffered -=
             hs->buffering.future_record.len;
 
-        mbedtls_free(hs->buffering.future_record.data);
+        ssl_buffering_release(ssl, hs->buffering.future_record.data);
         hs->buffering.future_record.data = NULL;
     }
 }
@@ -4519,7 +4899,7 @@ static int ssl_buffer_future_record(mbedtls_ssl_context *ssl,
     hs->buffering.future_record.len   = rec->buf_len;
 
     hs->buffering.future_record.data =
-        mbedtls_calloc(1, hs->buffering.future_record.len);
+        ssl_buffering_alloc(ssl, hs->buffering.future_record.len, -1);
     if (hs->buffering.future_record.data == NULL) {
         /* If we run out of RAM trying to buffer a
          * record from the next epoch, just ignore. */
@@ -4640,6 +5020,9 @@ static int ssl_get_next_record(mbedtls_ssl_context *ssl)
             return ret;
         }
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        mbedtls_ssl_keep_read_ahead(ssl, rec.buf_len);
+#endif
         ssl->in_left = 0;
     }
 
@@ -4861,6 +5244,12 @@ int mbedtls_ssl_send_alert_message(mbedtls_ssl_context *ssl,
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
     if (ssl->out_left != 0) {
         return mbedtls_ssl_flush_output(ssl);
     }
@@ -5061,26 +5450,188 @@ void mbedtls_ssl_update_in_pointers(mbedtls_ssl_context *ssl)
  * Setup an SSL context
  */
 
-void mbedtls_ssl_reset_in_out_pointers(mbedtls_ssl_context *ssl)
+static void ssl_reset_in_pointers(mbedtls_ssl_context *ssl)
 {
-    /* Set the incoming and outgoing record pointers. */
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
-        ssl->out_hdr = ssl->out_buf;
         ssl->in_hdr  = ssl->in_buf;
     } else
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
     {
-        ssl->out_ctr = ssl->out_buf;
-        ssl->out_hdr = ssl->out_buf + 8;
         ssl->in_hdr  = ssl->in_buf  + 8;
     }
 
-    /* Derive other internal pointers. */
-    mbedtls_ssl_update_out_pointers(ssl, NULL /* no transform enabled */);
     mbedtls_ssl_update_in_pointers(ssl);
 }
 
+static void ssl_reset_out_pointers(mbedtls_ssl_context *ssl,
+                                   mbedtls_ssl_transform *transform)
+{
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+    if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_DATAGRAM) {
+        ssl->out_hdr = ssl->out_buf;
+    } else
+#endif /* MBEDTLS_SSL_PROTO_DTLS */
+    {
+        ssl->out_ctr = ssl->out_buf;
+        ssl->out_hdr = ssl->out_buf + 8;
+    }
+
+    mbedtls_ssl_update_out_pointers(ssl, transform);
+}
+
+void mbedtls_ssl_reset_in_out_pointers(mbedtls_ssl_context *ssl)
+{
+    /* Set the incoming and outgoing record pointers and derive the other
+     * internal pointers. */
+    ssl_reset_out_pointers(ssl, NULL /* no transform enabled */);
+    ssl_reset_in_pointers(ssl);
+}
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+static unsigned char *ssl_buffer_get(mbedtls_ssl_context *ssl, size_t len)
+{
+    unsigned char *buf;
+
+    if (ssl->conf->f_buffer_acquire != NULL) {
+        buf = ssl->conf->f_buffer_acquire(ssl->conf->p_buffer_pool, len);
+    } else {
+        buf = mbedtls_calloc(1, len);
+    }
+
+    if (buf == NULL) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("alloc(%" MBEDTLS_PRINTF_SIZET " bytes) failed", len));
+    }
+    return buf;
+}
+
+static void ssl_buffer_put(mbedtls_ssl_context *ssl,
+                           unsigned char *buf, size_t len)
+{
+    if (ssl->conf->f_buffer_release != NULL) {
+        ssl->conf->f_buffer_release(ssl->conf->p_buffer_pool, buf, len);
+    } else {
+        mbedtls_platform_zeroize(buf, len);
+        mbedtls_free(buf);
+    }
+}
+
+static void ssl_clear_in_pointers(mbedtls_ssl_context *ssl)
+{
+    ssl->in_buf = NULL;
+    ssl->in_hdr = NULL;
+    ssl->in_ctr = NULL;
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    ssl->in_cid = NULL;
+#endif
+    ssl->in_len = NULL;
+    ssl->in_iv = NULL;
+    ssl->in_msg = NULL;
+}
+
+static void ssl_clear_out_pointers(mbedtls_ssl_context *ssl)
+{
+    ssl->out_buf = NULL;
+    ssl->out_hdr = NULL;
+    ssl->out_ctr = NULL;
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    ssl->out_cid = NULL;
+#endif
+    ssl->out_len = NULL;
+    ssl->out_iv = NULL;
+    ssl->out_msg = NULL;
+}
+
+int mbedtls_ssl_buffers_acquire(mbedtls_ssl_context *ssl)
+{
+    if (ssl->in_buf == NULL) {
+        ssl->in_buf = ssl_buffer_get(ssl, MBEDTLS_SSL_IN_BUFFER_LEN);
+        if (ssl->in_buf == NULL) {
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        ssl_reset_in_pointers(ssl);
+
+        /* For TLS, the implicit sequence number of the next record lives
+         * in front of the record header. */
+        if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM) {
+            memcpy(ssl->in_ctr, ssl->in_ctr_idle, MBEDTLS_SSL_SEQUENCE_NUMBER_LEN);
+        }
+    }
+
+    if (ssl->out_buf == NULL) {
+        ssl->out_buf = ssl_buffer_get(ssl, MBEDTLS_SSL_OUT_BUFFER_LEN);
+        if (ssl->out_buf == NULL) {
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        ssl_reset_out_pointers(ssl, ssl->transform_out);
+    }
+
+    return 0;
+}
+
+void mbedtls_ssl_buffers_release_idle(mbedtls_ssl_context *ssl)
+{
+    if (ssl->conf == NULL || ssl->conf->f_buffer_release == NULL ||
+        mbedtls_ssl_is_handshake_over(ssl) == 0) {
+        return;
+    }
+
+    /* The handshake parameters outlive the handshake while a DTLS flight
+     * may have to be resent. TLS 1.3 keeps them for post-handshake
+     * messages, which don't need the record buffers in between. */
+    if (ssl->handshake != NULL
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        && ssl->tls_version != MBEDTLS_SSL_VERSION_TLS1_3
+#endif
+        ) {
+        return;
+    }
+
+    /* Keep the input buffer while it holds any part of a record, or
+     * data or messages that haven't been consumed yet. */
+    if (ssl->in_buf != NULL &&
+        ssl->in_left == 0 &&
+        ssl->in_offt == NULL &&
+        ssl->in_msglen == 0 &&
+        ssl->in_hslen == 0 &&
+        ssl->keep_current_message == 0
+#if defined(MBEDTLS_SSL_PROTO_DTLS)
+        && ssl->next_record_offset == 0
+#endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        && ssl->in_ahead_len == 0
+#endif
+        ) {
+        if (ssl->conf->transport == MBEDTLS_SSL_TRANSPORT_STREAM) {
+            memcpy(ssl->in_ctr_idle, ssl->in_ctr, MBEDTLS_SSL_SEQUENCE_NUMBER_LEN);
+        }
+        MBEDTLS_SSL_DEBUG_MSG(3, ("release idle input buffer"));
+        ssl_buffer_put(ssl, ssl->in_buf, MBEDTLS_SSL_IN_BUFFER_LEN);
+        ssl_clear_in_pointers(ssl);
+    }
+
+    /* Keep the output buffer while it holds data that isn't flushed. */
+    if (ssl->out_buf != NULL && ssl->out_left == 0) {
+        MBEDTLS_SSL_DEBUG_MSG(3, ("release idle output buffer"));
+        ssl_buffer_put(ssl, ssl->out_buf, MBEDTLS_SSL_OUT_BUFFER_LEN);
+        ssl_clear_out_pointers(ssl);
+    }
+}
+
+void mbedtls_ssl_buffers_free(mbedtls_ssl_context *ssl)
+{
+    if (ssl->in_buf != NULL) {
+        ssl_buffer_put(ssl, ssl->in_buf, MBEDTLS_SSL_IN_BUFFER_LEN);
+    }
+    ssl_clear_in_pointers(ssl);
+
+    if (ssl->out_buf != NULL) {
+        ssl_buffer_put(ssl, ssl->out_buf, MBEDTLS_SSL_OUT_BUFFER_LEN);
+    }
+    ssl_clear_out_pointers(ssl);
+}
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
+
 /*
  * SSL get accessors
  */
@@ -5102,7 +5653,8 @@ int mbedtls_ssl_check_pending(const mbedtls_ssl_context *ssl)
     }
 
     /*
-     * Case B: Further records are pending in the current datagram.
+     * Case B: Further records are pending in the current datagram,
+     * or have been read ahead from the stream.
      */
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
@@ -5113,6 +5665,13 @@ int mbedtls_ssl_check_pending(const mbedtls_ssl_context *ssl)
     }
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    if (ssl->in_ahead_len != 0) {
+        MBEDTLS_SSL_DEBUG_MSG(3, ("ssl_check_pending: more records read ahead"));
+        return 1;
+    }
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
     /*
      * Case C: A handshake message is being processed.
      */
@@ -5427,16 +5986,14 @@ static int ssl_handle_hs_message_post_handshake(mbedtls_ssl_context *ssl)
 }
 
 /*
- * Receive application data decrypted from the SSL layer
+ * Process incoming records until application data is available at
+ * ssl->in_offt. Return 0 with ssl->in_offt set to NULL at the end of the
+ * stream.
  */
-int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_read_fill(mbedtls_ssl_context *ssl)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
-    size_t n;
-
-    if (ssl == NULL || ssl->conf == NULL) {
-        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
-    }
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> read"));
 
@@ -5477,10 +6034,10 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
 #endif
 
     if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
-        ret = mbedtls_ssl_handshake(ssl);
+        ret = mbedtls_ssl_handshake_keep_buffers(ssl);
         if (ret != MBEDTLS_ERR_SSL_WAITING_SERVER_HELLO_RENEGO &&
             ret != 0) {
-            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake", ret);
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake_keep_buffers", ret);
             return ret;
         }
     }
@@ -5596,13 +6153,16 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
     }
 
-    n = (len < ssl->in_msglen)
-        ? len : ssl->in_msglen;
+    return 0;
+}
 
-    if (len != 0) {
-        memcpy(buf, ssl->in_offt, n);
-        ssl->in_msglen -= n;
-    }
+/*
+ * Mark the first n bytes of the application data at ssl->in_offt as
+ * consumed.
+ */
+static void ssl_read_consume(mbedtls_ssl_context *ssl, size_t n)
+{
+    ssl->in_msglen -= n;
 
     /* Zeroising the plaintext buffer to erase unused application data
        from the memory. */
@@ -5616,12 +6176,415 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
         /* more data available */
         ssl->in_offt += n;
     }
+}
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_SRV_C)
+/*
+ * Return the amount of early data kept by the server and not read yet.
+ */
+static size_t ssl_early_data_unread(const mbedtls_ssl_context *ssl)
+{
+    return ssl->early_data_len - ssl->early_data_offt;
+}
+
+/*
+ * Mark the first n bytes of the unread early data as consumed, and release
+ * the buffer once all of it has been read.
+ */
+static void ssl_early_data_consume(mbedtls_ssl_context *ssl, size_t n)
+{
+    mbedtls_platform_zeroize(ssl->early_data_buf + ssl->early_data_offt, n);
+    ssl->early_data_offt += n;
+
+    if (ssl->early_data_offt == ssl->early_data_len) {
+        mbedtls_free(ssl->early_data_buf);
+        ssl->early_data_buf = NULL;
+        ssl->early_data_len = 0;
+        ssl->early_data_offt = 0;
+    }
+}
+
+/*
+ * Deliver the early data kept by the server before the application data
+ * received after the handshake.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_read_early_data_kept(mbedtls_ssl_context *ssl,
+                                    unsigned char *buf, size_t len)
+{
+    size_t n = ssl_early_data_unread(ssl);
+
+    if (n > len) {
+        n = len;
+    }
+
+    if (n > 0) {
+        memcpy(buf, ssl->early_data_buf + ssl->early_data_offt, n);
+        ssl_early_data_consume(ssl, n);
+    }
+
+    return (int) n;
+}
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_SRV_C */
+
+/*
+ * Receive application data decrypted from the SSL layer
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_read_real(mbedtls_ssl_context *ssl,
+                         unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    size_t n;
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_SRV_C)
+    if (ssl_early_data_unread(ssl) > 0) {
+        if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER &&
+            (ret = mbedtls_ssl_handshake_keep_buffers(ssl)) != 0) {
+            return ret;
+        }
+        return ssl_read_early_data_kept(ssl, buf, len);
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_SRV_C */
+
+    ret = ssl_read_fill(ssl);
+    if (ret != 0 || ssl->in_offt == NULL) {
+        return ret;
+    }
+
+    n = (len < ssl->in_msglen)
+        ? len : ssl->in_msglen;
+
+    if (len != 0) {
+        memcpy(buf, ssl->in_offt, n);
+    }
+
+    ssl_read_consume(ssl, n);
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= read"));
 
     return (int) n;
 }
 
+/*
+ * Receive application data (public-facing wrapper)
+ */
+int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (ssl == NULL || ssl->conf == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
+    ret = ssl_read_real(ssl, buf, len);
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    return ret;
+}
+
+/*
+ * Give access to decrypted application data without copying it
+ */
+int mbedtls_ssl_read_borrow(mbedtls_ssl_context *ssl,
+                            const unsigned char **buf, size_t *len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (ssl == NULL || ssl->conf == NULL || buf == NULL || len == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    *buf = NULL;
+    *len = 0;
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_SRV_C)
+    if (ssl_early_data_unread(ssl) > 0) {
+        ret = 0;
+        if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+            ret = mbedtls_ssl_handshake_keep_buffers(ssl);
+        }
+        if (ret == 0) {
+            *buf = ssl->early_data_buf + ssl->early_data_offt;
+            *len = ssl_early_data_unread(ssl);
+        }
+    } else
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_SRV_C */
+    {
+        ret = ssl_read_fill(ssl);
+        if (ret == 0 && ssl->in_offt != NULL) {
+            *buf = ssl->in_offt;
+            *len = ssl->in_msglen;
+            MBEDTLS_SSL_DEBUG_MSG(2, ("<= read"));
+        }
+    }
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    return ret;
+}
+
+int mbedtls_ssl_read_consume(mbedtls_ssl_context *ssl, size_t len)
+{
+    if (ssl == NULL || ssl->conf == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_SRV_C)
+    if (ssl_early_data_unread(ssl) > 0) {
+        if (len > ssl_early_data_unread(ssl)) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+        ssl_early_data_consume(ssl, len);
+        return 0;
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_SRV_C */
+
+    if (ssl->in_offt == NULL) {
+        return len == 0 ? 0 : MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (len > ssl->in_msglen) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    ssl_read_consume(ssl, len);
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    return 0;
+}
+
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+/*
+ * The records of a batch, encrypted as separate jobs.
+ */
+typedef struct {
+    mbedtls_ssl_context *ssl;
+    mbedtls_record rec[MBEDTLS_SSL_WRITE_BATCH_RECORDS];
+    int ret[MBEDTLS_SSL_WRITE_BATCH_RECORDS];
+} ssl_encrypt_jobs;
+
+/*
+ * Encrypt record index of the batch, with the encryption context of the
+ * same index so that jobs may run concurrently.
+ */
+static void ssl_encrypt_job(void *p_job, size_t index)
+{
+    ssl_encrypt_jobs *jobs = p_job;
+    mbedtls_ssl_context *ssl = jobs->ssl;
+
+    jobs->ret[index] = ssl_encrypt_buf(ssl, ssl->transform_out,
+                                       &jobs->rec[index],
+                                       ssl->conf->f_rng, ssl->conf->p_rng,
+                                       (unsigned) index);
+}
+
+/*
+ * Same as ssl_write_batch(), but encrypt the records with the job runner.
+ *
+ * Each record is first prepared in its own slot of
+ * MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN bytes of the output buffer, so that its
+ * encryption doesn't depend on the length of the previous ones. Once all
+ * are encrypted, the records are moved next to each other and sent with a
+ * single flush. The output buffer must be empty.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_write_batch_parallel(mbedtls_ssl_context *ssl,
+                                    const unsigned char *buf, size_t len,
+                                    size_t max_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    ssl_encrypt_jobs jobs;
+    const size_t hdr_len = (size_t) (ssl->out_iv - ssl->out_hdr);
+    const size_t data_offset = (size_t) (ssl->out_msg - ssl->out_iv);
+    unsigned char * const buf_end = ssl->out_buf + MBEDTLS_SSL_OUT_BUFFER_LEN;
+    mbedtls_ssl_protocol_version tls_ver = ssl->tls_version;
+    unsigned char *hdr;
+    unsigned char *out;
+    size_t written = 0;
+    size_t count = 0;
+    size_t chunk;
+    size_t i;
+    unsigned j;
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    /* TLS 1.3 still uses the TLS 1.2 version identifier
+     * for backwards compatibility. */
+    if (tls_ver == MBEDTLS_SSL_VERSION_TLS1_3) {
+        tls_ver = MBEDTLS_SSL_VERSION_TLS1_2;
+    }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 */
+
+    jobs.ssl = ssl;
+
+    while (written < len) {
+        mbedtls_record *rec = &jobs.rec[count];
+        unsigned char *slot_end;
+
+        chunk = len - written;
+        if (chunk > max_len) {
+            chunk = max_len;
+        }
+
+        hdr = ssl->out_hdr + count * MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN;
+        slot_end = hdr + MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN;
+        if (slot_end > buf_end) {
+            slot_end = buf_end;
+        }
+
+        rec->buf         = hdr + hdr_len;
+        rec->buf_len     = (size_t) (slot_end - rec->buf);
+        rec->data_offset = data_offset;
+        rec->data_len    = chunk;
+        memcpy(rec->buf + data_offset, buf + written, chunk);
+        written += chunk;
+
+        memcpy(rec->ctr, ssl->cur_out_ctr, sizeof(rec->ctr));
+        mbedtls_ssl_write_version(rec->ver, ssl->conf->transport, tls_ver);
+        rec->type = MBEDTLS_SSL_MSG_APPLICATION_DATA;
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+        rec->cid_len = 0;
+#endif /* MBEDTLS_SSL_DTLS_CONNECTION_ID */
+        count++;
+
+        for (j = 8; j > 0; j--) {
+            if (++ssl->cur_out_ctr[j - 1] != 0) {
+                break;
+            }
+        }
+
+        /* The loop goes to its end if the counter is wrapping */
+        if (j == 0) {
+            MBEDTLS_SSL_DEBUG_MSG(1, ("outgoing message counter would wrap"));
+            return MBEDTLS_ERR_SSL_COUNTER_WRAPPING;
+        }
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(3, ("encrypting %" MBEDTLS_PRINTF_SIZET
+                              " records in parallel", count));
+
+    if (ssl->conf->f_run_jobs(ssl->conf->p_workers, ssl_encrypt_job,
+                              &jobs, count) != 0) {
+        /* The runner didn't start any job: do them all here. */
+        MBEDTLS_SSL_DEBUG_MSG(2, ("job runner unavailable, "
+                                  "encrypting in the calling thread"));
+        for (i = 0; i < count; i++) {
+            ssl_encrypt_job(&jobs, i);
+        }
+    }
+
+    out = ssl->out_hdr;
+    for (i = 0; i < count; i++) {
+        mbedtls_record *rec = &jobs.rec[i];
+        size_t protected_record_size;
+
+        if ((ret = jobs.ret[i]) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "ssl_encrypt_buf", ret);
+            return ret;
+        }
+
+        if (rec->data_offset != 0) {
+            MBEDTLS_SSL_DEBUG_MSG(1, ("should never happen"));
+            return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+        }
+
+        hdr = ssl->out_hdr + i * MBEDTLS_SSL_OUT_RECORD_BUFFER_LEN;
+        hdr[0] = rec->type;
+        mbedtls_ssl_write_version(hdr + 1, ssl->conf->transport, tls_ver);
+        MBEDTLS_PUT_UINT16_BE(rec->data_len, hdr, 3);
+
+        protected_record_size = hdr_len + rec->data_len;
+        if (out != hdr) {
+            memmove(out, hdr, protected_record_size);
+        }
+
+        MBEDTLS_SSL_DEBUG_MSG(3, ("output record: msgtype = %u, "
+                                  "version = [%u:%u], msglen = %" MBEDTLS_PRINTF_SIZET,
+                                  out[0], out[1], out[2], rec->data_len));
+
+        MBEDTLS_SSL_DEBUG_BUF(4, "output record sent to network",
+                              out, protected_record_size);
+
+        out += protected_record_size;
+        ssl->out_left += protected_record_size;
+    }
+
+    ssl->out_hdr = out;
+    mbedtls_ssl_update_out_pointers(ssl, ssl->transform_out);
+
+    if ((ret = mbedtls_ssl_flush_output(ssl)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_flush_output", ret);
+        return ret;
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_PARALLEL_ENCRYPTION */
+
+/*
+ * Encrypt application data as consecutive records of at most max_len bytes
+ * in the output buffer, and send them with a single flush.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_write_batch(mbedtls_ssl_context *ssl,
+                           const unsigned char *buf, size_t len,
+                           size_t max_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    size_t written = 0;
+    size_t chunk;
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    if (ssl->conf->f_run_jobs != NULL && ssl->transform_out != NULL &&
+        ssl->transform_out->enc_lanes != 0 && ssl->out_left == 0) {
+        return ssl_write_batch_parallel(ssl, buf, len, max_len);
+    }
+#endif
+
+    while (written < len) {
+        chunk = len - written;
+        if (chunk > max_len) {
+            chunk = max_len;
+        }
+
+        ssl->out_msglen  = chunk;
+        ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
+        memcpy(ssl->out_msg, buf + written, chunk);
+        written += chunk;
+
+        if ((ret = mbedtls_ssl_write_record(ssl, written == len ?
+                                            SSL_FORCE_FLUSH :
+                                            SSL_DONT_FORCE_FLUSH)) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_write_record", ret);
+            return ret;
+        }
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_RECORD_BATCHING */
+
 /*
  * Send application data to be encrypted by the SSL layer, taking care of max
  * fragment length and buffer size.
@@ -5633,6 +6596,8 @@ int mbedtls_ssl_read(mbedtls_ssl_context *ssl, unsigned char *buf, size_t len)
  *
  * Therefore, it is possible that the input message length is 0 and the
  * corresponding return code is 0 on success.
+ *
+ * If buf is NULL, the caller has already written the data at ssl->out_msg.
  */
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_write_real(mbedtls_ssl_context *ssl,
@@ -5655,6 +6620,14 @@ static int ssl_write_real(mbedtls_ssl_context *ssl,
                                       len, max_len));
             return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
         } else
+#endif
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        if (buf != NULL) {
+            /* Split the data into several records, sent together. */
+            if (len > max_len * MBEDTLS_SSL_WRITE_BATCH_RECORDS) {
+                len = max_len * MBEDTLS_SSL_WRITE_BATCH_RECORDS;
+            }
+        } else
 #endif
         len = max_len;
     }
@@ -5676,9 +6649,18 @@ static int ssl_write_real(mbedtls_ssl_context *ssl,
          * copy the data into the internal buffers and setup the data structure
          * to keep track of partial writes
          */
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+        if (len > max_len) {
+            if ((ret = ssl_write_batch(ssl, buf, len, max_len)) != 0) {
+                return ret;
+            }
+            return (int) len;
+        }
+#endif
+
         ssl->out_msglen  = len;
         ssl->out_msgtype = MBEDTLS_SSL_MSG_APPLICATION_DATA;
-        if (len > 0) {
+        if (buf != NULL && len > 0) {
             memcpy(ssl->out_msg, buf, len);
         }
 
@@ -5704,6 +6686,12 @@ int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
     if ((ret = ssl_check_ctr_renegotiate(ssl)) != 0) {
         MBEDTLS_SSL_DEBUG_RET(1, "ssl_check_ctr_renegotiate", ret);
@@ -5712,19 +6700,267 @@ int mbedtls_ssl_write(mbedtls_ssl_context *ssl, const unsigned char *buf, size_t
 #endif
 
     if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
-        if ((ret = mbedtls_ssl_handshake(ssl)) != 0) {
-            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake", ret);
+        if ((ret = mbedtls_ssl_handshake_keep_buffers(ssl)) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake_keep_buffers", ret);
             return ret;
         }
     }
 
     ret = ssl_write_real(ssl, buf, len);
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= write"));
 
     return ret;
 }
 
+/*
+ * Give access to the plaintext area of the next outgoing record
+ */
+int mbedtls_ssl_write_borrow(mbedtls_ssl_context *ssl,
+                             unsigned char **buf, size_t *len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (ssl == NULL || ssl->conf == NULL || buf == NULL || len == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    *buf = NULL;
+    *len = 0;
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
+#if defined(MBEDTLS_SSL_RENEGOTIATION)
+    if ((ret = ssl_check_ctr_renegotiate(ssl)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "ssl_check_ctr_renegotiate", ret);
+        return ret;
+    }
+#endif
+
+    if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        if ((ret = mbedtls_ssl_handshake_keep_buffers(ssl)) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake_keep_buffers", ret);
+            return ret;
+        }
+    }
+
+    /* The output buffer must not hold a record that isn't sent yet. */
+    if ((ret = mbedtls_ssl_flush_output(ssl)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_flush_output", ret);
+        return ret;
+    }
+
+    ret = mbedtls_ssl_get_max_out_record_payload(ssl);
+    if (ret < 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_get_max_out_record_payload", ret);
+        return ret;
+    }
+
+    *buf = ssl->out_msg;
+    *len = (size_t) ret;
+
+    return 0;
+}
+
+/*
+ * Send the data written in the area given by mbedtls_ssl_write_borrow()
+ */
+int mbedtls_ssl_write_commit(mbedtls_ssl_context *ssl, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("=> write commit"));
+
+    if (ssl == NULL || ssl->conf == NULL || ssl->out_msg == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    /* Don't let ssl_write_real() truncate data the caller wrote past the
+     * end of the area. */
+    ret = mbedtls_ssl_get_max_out_record_payload(ssl);
+    if (ret < 0) {
+        return ret;
+    }
+    if (len > (size_t) ret) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    ret = ssl_write_real(ssl, NULL, len);
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("<= write commit"));
+
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+#if defined(MBEDTLS_SSL_SRV_C)
+/*
+ * Receive early data: run the handshake until the next early data record
+ */
+int mbedtls_ssl_read_early_data(mbedtls_ssl_context *ssl,
+                                unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if (ssl == NULL || ssl->conf == NULL ||
+        ssl->conf->endpoint != MBEDTLS_SSL_IS_SERVER) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("=> read early_data"));
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
+    while (ssl_early_data_unread(ssl) == 0) {
+        /* Early data is received until the EndOfEarlyData message, once the
+         * ClientHello has been processed and early data accepted. */
+        if (ssl->state != MBEDTLS_SSL_HELLO_REQUEST &&
+            ssl->state != MBEDTLS_SSL_CLIENT_HELLO &&
+            ssl->early_data_status != MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED) {
+            ret = MBEDTLS_ERR_SSL_CANNOT_READ_EARLY_DATA;
+            break;
+        }
+
+        if ((ret = mbedtls_ssl_handshake_step(ssl)) != 0) {
+            break;
+        }
+    }
+
+    if (ssl_early_data_unread(ssl) > 0) {
+        ret = ssl_read_early_data_kept(ssl, buf, len);
+    }
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("<= read early_data"));
+
+    return ret;
+}
+#endif /* MBEDTLS_SSL_SRV_C */
+
+#if defined(MBEDTLS_SSL_CLI_C)
+/*
+ * Send early data: start the handshake and write application data records
+ * protected with the early keys until the server Finished is received.
+ */
+int mbedtls_ssl_write_early_data(mbedtls_ssl_context *ssl,
+                                 const unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    uint32_t remaining;
+
+    if (ssl == NULL || ssl->conf == NULL ||
+        ssl->conf->endpoint != MBEDTLS_SSL_IS_CLIENT) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("=> write early_data"));
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
+    /* Send the ClientHello, and the compatibility ChangeCipherSpec that
+     * precedes the early data records. */
+    while (ssl->state == MBEDTLS_SSL_HELLO_REQUEST ||
+           ssl->state == MBEDTLS_SSL_CLIENT_HELLO ||
+           ssl->state == MBEDTLS_SSL_CLIENT_CCS_AFTER_CLIENT_HELLO) {
+        if ((ret = mbedtls_ssl_handshake_step(ssl)) != 0) {
+            goto exit;
+        }
+        /* Don't let ssl_write_real() take the pending ChangeCipherSpec for
+         * a partially written record of the caller's data. */
+        if ((ret = mbedtls_ssl_flush_output(ssl)) != 0) {
+            goto exit;
+        }
+    }
+
+    ret = MBEDTLS_ERR_SSL_CANNOT_WRITE_EARLY_DATA;
+    if (ssl->handshake == NULL ||
+        ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_NOT_SENT ||
+        ssl->handshake->transform_earlydata == NULL ||
+        ssl->transform_out != ssl->handshake->transform_earlydata) {
+        goto exit;
+    }
+
+    /* Until the EncryptedExtensions, early data is pending. Then it may be
+     * sent up to the EndOfEarlyData message if the server accepted it. */
+    switch (ssl->state) {
+        case MBEDTLS_SSL_SERVER_HELLO:
+        case MBEDTLS_SSL_ENCRYPTED_EXTENSIONS:
+            break;
+        case MBEDTLS_SSL_SERVER_FINISHED:
+        case MBEDTLS_SSL_END_OF_EARLY_DATA:
+            if (ssl->early_data_status ==
+                MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED) {
+                break;
+            }
+            goto exit;
+        default:
+            goto exit;
+    }
+
+    remaining = ssl->session_negotiate->max_early_data_size -
+                ssl->total_early_data_size;
+    if (remaining == 0) {
+        goto exit;
+    }
+    if (len > remaining) {
+        len = remaining;
+    }
+
+    ret = ssl_write_real(ssl, buf, len);
+    if (ret > 0) {
+        ssl->total_early_data_size += (uint32_t) ret;
+    }
+
+exit:
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("<= write early_data"));
+
+    return ret;
+}
+
+int mbedtls_ssl_get_early_data_status(mbedtls_ssl_context *ssl)
+{
+    if (ssl == NULL || ssl->conf == NULL ||
+        ssl->conf->endpoint != MBEDTLS_SSL_IS_CLIENT ||
+        !mbedtls_ssl_is_handshake_over(ssl)) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    return ssl->early_data_status;
+}
+#endif /* MBEDTLS_SSL_CLI_C */
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA */
+
 /*
  * Notify the peer that the connection is being closed
  */
@@ -5747,6 +6983,10 @@ int mbedtls_ssl_close_notify(mbedtls_ssl_context *ssl)
         }
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_release_idle(ssl);
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= write close notify"));
 
     return 0;
@@ -5764,6 +7004,14 @@ void mbedtls_ssl_transform_free(mbedtls_ssl_transform *transform)
 #else
     mbedtls_cipher_free(&transform->cipher_ctx_enc);
     mbedtls_cipher_free(&transform->cipher_ctx_dec);
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    {
+        unsigned i;
+        for (i = 0; i < transform->enc_lanes; i++) {
+            mbedtls_cipher_free(&transform->cipher_ctx_enc_lanes[i]);
+        }
+    }
+#endif
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
 
 #if defined(MBEDTLS_SSL_SOME_SUITES_USE_MAC)
@@ -5824,7 +7072,7 @@ static void ssl_buffering_free_slot(mbedtls_ssl_context *ssl,
     if (hs_buf->is_valid == 1) {
         hs->buffering.total_bytes_buffered -= hs_buf->data_len;
         mbedtls_platform_zeroize(hs_buf->data, hs_buf->data_len);
-        mbedtls_free(hs_buf->data);
+        ssl_buffering_release(ssl, hs_buf->data);
         memset(hs_buf, 0, sizeof(mbedtls_ssl_hs_buffer));
     }
 }
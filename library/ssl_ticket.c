@@ -27,6 +27,7 @@
 #include "mbedtls/ssl_ticket.h"
 #include "mbedtls/error.h"
 #include "mbedtls/platform_util.h"
+#include "mbedtls/threading.h"
 
 #include <string.h>
 
@@ -36,6 +37,24 @@
                                                            psa_generic_status_to_mbedtls)
 #endif
 
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+/* Cipher contexts are modified by each operation: each operation in
+ * progress has its own, and idle ones are kept with their key. */
+struct mbedtls_ssl_ticket_cipher {
+    mbedtls_cipher_context_t ctx;
+    struct mbedtls_ssl_ticket_cipher *next;
+};
+#endif
+
+/* A reference to a key held by a ticket operation */
+typedef struct {
+    mbedtls_ssl_ticket_key *key;
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    struct mbedtls_ssl_ticket_cipher *cipher;
+#endif
+    uint32_t lifetime;
+} ssl_ticket_ref;
+
 /*
  * Initialize context
  */
@@ -63,92 +82,363 @@ void mbedtls_ssl_ticket_init(mbedtls_ssl_ticket_context *ctx)
                              TICKET_IV_BYTES        +        \
                              TICKET_CRYPT_LEN_BYTES)
 
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_ticket_lock(mbedtls_ssl_ticket_context *ctx)
+{
+#if defined(MBEDTLS_THREADING_C)
+    return mbedtls_mutex_lock(&ctx->mutex);
+#else
+    ((void) ctx);
+    return 0;
+#endif
+}
+
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_ticket_unlock(mbedtls_ssl_ticket_context *ctx)
+{
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&ctx->mutex) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+#else
+    ((void) ctx);
+#endif
+    return 0;
+}
+
+static size_t ssl_ticket_key_bytes(const mbedtls_ssl_ticket_context *ctx)
+{
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    return PSA_BITS_TO_BYTES(ctx->key_bits);
+#else
+    return mbedtls_cipher_info_get_key_bitlen(ctx->cipher_info) / 8;
+#endif
+}
+
+/*
+ * Free a key, once no context or operation refers to it
+ */
+static void ssl_ticket_key_free(mbedtls_ssl_ticket_key *key)
+{
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    struct mbedtls_ssl_ticket_cipher *cipher;
+#endif
+
+    if (key == NULL) {
+        return;
+    }
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    psa_destroy_key(key->key);
+#else
+    while ((cipher = key->spare) != NULL) {
+        key->spare = cipher->next;
+        mbedtls_cipher_free(&cipher->ctx);
+        mbedtls_free(cipher);
+    }
+#endif /* MBEDTLS_USE_PSA_CRYPTO */
+
+    mbedtls_platform_zeroize(key, sizeof(mbedtls_ssl_ticket_key));
+    mbedtls_free(key);
+}
+
 /*
- * Generate/update a key
+ * Generate a key, or make one from the given name and key material
  */
 MBEDTLS_CHECK_RETURN_CRITICAL
-static int ssl_ticket_gen_key(mbedtls_ssl_ticket_context *ctx,
-                              unsigned char index)
+static int ssl_ticket_key_new(mbedtls_ssl_ticket_context *ctx,
+                              const unsigned char *name,
+                              const unsigned char *k,
+                              mbedtls_ssl_ticket_key **out)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     unsigned char buf[MAX_KEY_BYTES] = { 0 };
-    mbedtls_ssl_ticket_key *key = ctx->keys + index;
+    mbedtls_ssl_ticket_key *key;
 
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
     psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
 #endif
 
+    *out = NULL;
+
+    key = mbedtls_calloc(1, sizeof(mbedtls_ssl_ticket_key));
+    if (key == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    key->refs = 1;
+
 #if defined(MBEDTLS_HAVE_TIME)
     key->generation_time = mbedtls_time(NULL);
 #endif
 
-    if ((ret = ctx->f_rng(ctx->p_rng, key->name, sizeof(key->name))) != 0) {
-        return ret;
+    /* The RNG is only called with the lock held: it may not be
+     * thread-safe. */
+    if (name == NULL || k == NULL) {
+        if ((ret = ssl_ticket_lock(ctx)) != 0) {
+            goto exit;
+        }
+        if (name == NULL) {
+            ret = ctx->f_rng(ctx->p_rng, key->name, sizeof(key->name));
+        }
+        if (ret == 0 && k == NULL) {
+            ret = ctx->f_rng(ctx->p_rng, buf, sizeof(buf));
+        }
+        if (ssl_ticket_unlock(ctx) != 0 && ret == 0) {
+            ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+        }
+        if (ret != 0) {
+            goto exit;
+        }
     }
 
-    if ((ret = ctx->f_rng(ctx->p_rng, buf, sizeof(buf))) != 0) {
-        return ret;
+    if (name != NULL) {
+        memcpy(key->name, name, TICKET_KEY_NAME_BYTES);
+    }
+    if (k != NULL) {
+        memcpy(buf, k, ssl_ticket_key_bytes(ctx));
     }
 
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
     psa_set_key_usage_flags(&attributes,
                             PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT);
-    psa_set_key_algorithm(&attributes, key->alg);
-    psa_set_key_type(&attributes, key->key_type);
-    psa_set_key_bits(&attributes, key->key_bits);
+    psa_set_key_algorithm(&attributes, ctx->alg);
+    psa_set_key_type(&attributes, ctx->key_type);
+    psa_set_key_bits(&attributes, ctx->key_bits);
 
     ret = PSA_TO_MBEDTLS_ERR(
         psa_import_key(&attributes, buf,
-                       PSA_BITS_TO_BYTES(key->key_bits),
+                       PSA_BITS_TO_BYTES(ctx->key_bits),
                        &key->key));
 #else
-    /* With GCM and CCM, same context can encrypt & decrypt */
-    ret = mbedtls_cipher_setkey(&key->ctx, buf,
-                                mbedtls_cipher_get_key_bitlen(&key->ctx),
-                                MBEDTLS_ENCRYPT);
+    /* Cipher contexts are set up from the key material when needed */
+    memcpy(key->raw, buf, sizeof(key->raw));
+    ret = 0;
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
 
+exit:
     mbedtls_platform_zeroize(buf, sizeof(buf));
 
-    return ret;
+    if (ret != 0) {
+        ssl_ticket_key_free(key);
+        return ret;
+    }
+
+    *out = key;
+    return 0;
+}
+
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_ticket_cipher_new(const mbedtls_ssl_ticket_context *ctx,
+                                 const mbedtls_ssl_ticket_key *key,
+                                 struct mbedtls_ssl_ticket_cipher **out)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    struct mbedtls_ssl_ticket_cipher *cipher;
+
+    cipher = mbedtls_calloc(1, sizeof(struct mbedtls_ssl_ticket_cipher));
+    if (cipher == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    mbedtls_cipher_init(&cipher->ctx);
+
+    /* With GCM and CCM, same context can encrypt & decrypt */
+    if ((ret = mbedtls_cipher_setup(&cipher->ctx, ctx->cipher_info)) != 0 ||
+        (ret = mbedtls_cipher_setkey(&cipher->ctx, key->raw,
+                                     mbedtls_cipher_info_get_key_bitlen(
+                                         ctx->cipher_info),
+                                     MBEDTLS_ENCRYPT)) != 0) {
+        mbedtls_cipher_free(&cipher->ctx);
+        mbedtls_free(cipher);
+        return ret;
+    }
+
+    *out = cipher;
+    return 0;
 }
+#endif /* !MBEDTLS_USE_PSA_CRYPTO */
 
 /*
- * Rotate/generate keys if necessary
+ * Make key the active key, with the lock held. The previously active key
+ * stays available to parse tickets. Return the key that this retires if
+ * nothing refers to it anymore, for the caller to free once the lock is
+ * released.
+ */
+static mbedtls_ssl_ticket_key *ssl_ticket_swap(mbedtls_ssl_ticket_context *ctx,
+                                               mbedtls_ssl_ticket_key *key)
+{
+    const unsigned char idx = 1 - ctx->active;
+    mbedtls_ssl_ticket_key *retired = ctx->keys[idx];
+
+    ctx->keys[idx] = key;
+    ctx->active = idx;
+
+    if (retired != NULL && --retired->refs == 0) {
+        return retired;
+    }
+
+    return NULL;
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+/*
+ * Generate a new active key. The caller has set ctx->rotating, so that a
+ * single thread does this while the others go on with the current keys.
  */
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_ticket_update_keys(mbedtls_ssl_ticket_context *ctx)
 {
-#if !defined(MBEDTLS_HAVE_TIME)
-    ((void) ctx);
-#else
-    if (ctx->ticket_lifetime != 0) {
-        mbedtls_time_t current_time = mbedtls_time(NULL);
-        mbedtls_time_t key_time = ctx->keys[ctx->active].generation_time;
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    int lock_ret;
+    mbedtls_ssl_ticket_key *key, *retired = NULL;
 
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-        psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
+    ret = ssl_ticket_key_new(ctx, NULL, NULL, &key);
+
+    if ((lock_ret = ssl_ticket_lock(ctx)) != 0) {
+        /* Let a later call try again, or no key would ever rotate */
+        ctx->rotating = 0;
+        ssl_ticket_key_free(key);
+        return lock_ret;
+    }
+
+    ctx->rotating = 0;
+    if (ret == 0) {
+        retired = ssl_ticket_swap(ctx, key);
+    }
+
+    if (ssl_ticket_unlock(ctx) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    ssl_ticket_key_free(retired);
+
+    return ret;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+/*
+ * Pick up a reference to the key with the given name, or to the active key
+ * if name is NULL, rotating the keys first if necessary. If iv is not NULL,
+ * also fill it with random bytes while the lock is held.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_ticket_acquire(mbedtls_ssl_ticket_context *ctx,
+                              const unsigned char *name,
+                              unsigned char *iv,
+                              ssl_ticket_ref *ref)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char i;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t current_time = mbedtls_time(NULL);
+    mbedtls_time_t key_time;
 #endif
 
-        if (current_time >= key_time &&
-            (uint64_t) (current_time - key_time) < ctx->ticket_lifetime) {
-            return 0;
+    memset(ref, 0, sizeof(ssl_ticket_ref));
+
+    if ((ret = ssl_ticket_lock(ctx)) != 0) {
+        return ret;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    key_time = ctx->keys[ctx->active]->generation_time;
+    if (ctx->ticket_lifetime != 0 && !ctx->rotating &&
+        (current_time < key_time ||
+         (uint64_t) (current_time - key_time) >= ctx->ticket_lifetime)) {
+        ctx->rotating = 1;
+
+        if ((ret = ssl_ticket_unlock(ctx)) != 0) {
+            return ret;
+        }
+        if ((ret = ssl_ticket_update_keys(ctx)) != 0) {
+            return ret;
         }
+        if ((ret = ssl_ticket_lock(ctx)) != 0) {
+            return ret;
+        }
+    }
+#endif /* MBEDTLS_HAVE_TIME */
 
-        ctx->active = 1 - ctx->active;
+    if (iv != NULL &&
+        (ret = ctx->f_rng(ctx->p_rng, iv, TICKET_IV_BYTES)) != 0) {
+        if (ssl_ticket_unlock(ctx) != 0) {
+            return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+        }
+        return ret;
+    }
 
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-        if ((status = psa_destroy_key(ctx->keys[ctx->active].key)) != PSA_SUCCESS) {
-            return PSA_TO_MBEDTLS_ERR(status);
+    if (name == NULL) {
+        ref->key = ctx->keys[ctx->active];
+    } else {
+        for (i = 0; i < sizeof(ctx->keys) / sizeof(*ctx->keys); i++) {
+            if (memcmp(name, ctx->keys[i]->name, TICKET_KEY_NAME_BYTES) == 0) {
+                ref->key = ctx->keys[i];
+                break;
+            }
         }
-#endif /* MBEDTLS_USE_PSA_CRYPTO */
+    }
+
+    if (ref->key != NULL) {
+        ref->key->refs++;
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+        if ((ref->cipher = ref->key->spare) != NULL) {
+            ref->key->spare = ref->cipher->next;
+        }
+#endif
+    }
+    ref->lifetime = ctx->ticket_lifetime;
+
+    if ((ret = ssl_ticket_unlock(ctx)) != 0) {
+        return ret;
+    }
+
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    /* All the idle contexts of the key are in use by other operations */
+    if (ref->key != NULL && ref->cipher == NULL) {
+        return ssl_ticket_cipher_new(ctx, ref->key, &ref->cipher);
+    }
+#endif
 
-        return ssl_ticket_gen_key(ctx, ctx->active);
-    } else
-#endif /* MBEDTLS_HAVE_TIME */
     return 0;
 }
 
+/*
+ * Drop a reference picked up by ssl_ticket_acquire()
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_ticket_release(mbedtls_ssl_ticket_context *ctx,
+                              ssl_ticket_ref *ref)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_ticket_key *retired = NULL;
+
+    if (ref->key == NULL) {
+        return 0;
+    }
+
+    if ((ret = ssl_ticket_lock(ctx)) != 0) {
+        return ret;
+    }
+
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    if (ref->cipher != NULL) {
+        ref->cipher->next = ref->key->spare;
+        ref->key->spare = ref->cipher;
+    }
+#endif
+
+    if (--ref->key->refs == 0) {
+        retired = ref->key;
+    }
+
+    ret = ssl_ticket_unlock(ctx);
+
+    ssl_ticket_key_free(retired);
+    memset(ref, 0, sizeof(ssl_ticket_ref));
+
+    return ret;
+}
+
 /*
  * Rotate active session ticket encryption key
  */
@@ -157,54 +447,32 @@ int mbedtls_ssl_ticket_rotate(mbedtls_ssl_ticket_context *ctx,
                               const unsigned char *k, size_t klength,
                               uint32_t lifetime)
 {
-    const unsigned char idx = 1 - ctx->active;
-    mbedtls_ssl_ticket_key * const key = ctx->keys + idx;
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_ticket_key *key, *retired;
 
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    psa_status_t status = PSA_ERROR_CORRUPTION_DETECTED;
-    psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
-    const size_t bitlen = key->key_bits;
-#else
-    const int bitlen = mbedtls_cipher_get_key_bitlen(&key->ctx);
-#endif
-
-    if (nlength < TICKET_KEY_NAME_BYTES || klength * 8 < (size_t) bitlen) {
+    if (nlength < TICKET_KEY_NAME_BYTES || klength < ssl_ticket_key_bytes(ctx)) {
         return MBEDTLS_ERR_CIPHER_BAD_INPUT_DATA;
     }
 
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    if ((status = psa_destroy_key(key->key)) != PSA_SUCCESS) {
-        ret = PSA_TO_MBEDTLS_ERR(status);
+    /* Prepare the new key first: tickets are still written and parsed with
+     * the current keys meanwhile. */
+    if ((ret = ssl_ticket_key_new(ctx, name, k, &key)) != 0) {
         return ret;
     }
 
-    psa_set_key_usage_flags(&attributes,
-                            PSA_KEY_USAGE_ENCRYPT | PSA_KEY_USAGE_DECRYPT);
-    psa_set_key_algorithm(&attributes, key->alg);
-    psa_set_key_type(&attributes, key->key_type);
-    psa_set_key_bits(&attributes, key->key_bits);
-
-    if ((status = psa_import_key(&attributes, k,
-                                 PSA_BITS_TO_BYTES(key->key_bits),
-                                 &key->key)) != PSA_SUCCESS) {
-        ret = PSA_TO_MBEDTLS_ERR(status);
-        return ret;
-    }
-#else
-    ret = mbedtls_cipher_setkey(&key->ctx, k, bitlen, MBEDTLS_ENCRYPT);
-    if (ret != 0) {
+    if ((ret = ssl_ticket_lock(ctx)) != 0) {
+        ssl_ticket_key_free(key);
         return ret;
     }
-#endif /* MBEDTLS_USE_PSA_CRYPTO */
 
-    ctx->active = idx;
+    retired = ssl_ticket_swap(ctx, key);
     ctx->ticket_lifetime = lifetime;
-    memcpy(key->name, name, TICKET_KEY_NAME_BYTES);
-#if defined(MBEDTLS_HAVE_TIME)
-    key->generation_time = mbedtls_time(NULL);
-#endif
-    return 0;
+
+    ret = ssl_ticket_unlock(ctx);
+
+    ssl_ticket_key_free(retired);
+
+    return ret;
 }
 
 /*
@@ -256,25 +524,15 @@ int mbedtls_ssl_ticket_setup(mbedtls_ssl_ticket_context *ctx,
     ctx->ticket_lifetime = lifetime;
 
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
-    ctx->keys[0].alg = alg;
-    ctx->keys[0].key_type = key_type;
-    ctx->keys[0].key_bits = key_bits;
-
-    ctx->keys[1].alg = alg;
-    ctx->keys[1].key_type = key_type;
-    ctx->keys[1].key_bits = key_bits;
+    ctx->alg = alg;
+    ctx->key_type = key_type;
+    ctx->key_bits = key_bits;
 #else
-    if ((ret = mbedtls_cipher_setup(&ctx->keys[0].ctx, cipher_info)) != 0) {
-        return ret;
-    }
-
-    if ((ret = mbedtls_cipher_setup(&ctx->keys[1].ctx, cipher_info)) != 0) {
-        return ret;
-    }
+    ctx->cipher_info = cipher_info;
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
 
-    if ((ret = ssl_ticket_gen_key(ctx, 0)) != 0 ||
-        (ret = ssl_ticket_gen_key(ctx, 1)) != 0) {
+    if ((ret = ssl_ticket_key_new(ctx, NULL, NULL, &ctx->keys[0])) != 0 ||
+        (ret = ssl_ticket_key_new(ctx, NULL, NULL, &ctx->keys[1])) != 0) {
         return ret;
     }
 
@@ -304,7 +562,7 @@ int mbedtls_ssl_ticket_write(void *p_ticket,
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     mbedtls_ssl_ticket_context *ctx = p_ticket;
-    mbedtls_ssl_ticket_key *key;
+    ssl_ticket_ref ref;
     unsigned char *key_name = start;
     unsigned char *iv = start + TICKET_KEY_NAME_BYTES;
     unsigned char *state_len_bytes = iv + TICKET_IV_BYTES;
@@ -325,25 +583,13 @@ int mbedtls_ssl_ticket_write(void *p_ticket,
      * in addition to session itself, that will be checked when writing it. */
     MBEDTLS_SSL_CHK_BUF_PTR(start, end, TICKET_MIN_LEN);
 
-#if defined(MBEDTLS_THREADING_C)
-    if ((ret = mbedtls_mutex_lock(&ctx->mutex)) != 0) {
-        return ret;
-    }
-#endif
-
-    if ((ret = ssl_ticket_update_keys(ctx)) != 0) {
+    if ((ret = ssl_ticket_acquire(ctx, NULL, iv, &ref)) != 0) {
         goto cleanup;
     }
 
-    key = &ctx->keys[ctx->active];
-
-    *ticket_lifetime = ctx->ticket_lifetime;
+    *ticket_lifetime = ref.lifetime;
 
-    memcpy(key_name, key->name, TICKET_KEY_NAME_BYTES);
-
-    if ((ret = ctx->f_rng(ctx->p_rng, iv, TICKET_IV_BYTES)) != 0) {
-        goto cleanup;
-    }
+    memcpy(key_name, ref.key->name, TICKET_KEY_NAME_BYTES);
 
     /* Dump session state */
     if ((ret = mbedtls_ssl_session_save(session,
@@ -356,7 +602,7 @@ int mbedtls_ssl_ticket_write(void *p_ticket,
 
     /* Encrypt and authenticate */
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
-    if ((status = psa_aead_encrypt(key->key, key->alg, iv, TICKET_IV_BYTES,
+    if ((status = psa_aead_encrypt(ref.key->key, ctx->alg, iv, TICKET_IV_BYTES,
                                    key_name, TICKET_ADD_DATA_LEN,
                                    state, clear_len,
                                    state, end - state,
@@ -365,7 +611,7 @@ int mbedtls_ssl_ticket_write(void *p_ticket,
         goto cleanup;
     }
 #else
-    if ((ret = mbedtls_cipher_auth_encrypt_ext(&key->ctx,
+    if ((ret = mbedtls_cipher_auth_encrypt_ext(&ref.cipher->ctx,
                                                iv, TICKET_IV_BYTES,
                                                /* Additional data: key name, IV and length */
                                                key_name, TICKET_ADD_DATA_LEN,
@@ -384,33 +630,13 @@ int mbedtls_ssl_ticket_write(void *p_ticket,
     *tlen = TICKET_MIN_LEN + ciph_len - TICKET_AUTH_TAG_BYTES;
 
 cleanup:
-#if defined(MBEDTLS_THREADING_C)
-    if (mbedtls_mutex_unlock(&ctx->mutex) != 0) {
+    if (ssl_ticket_release(ctx, &ref) != 0) {
         return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
     }
-#endif
 
     return ret;
 }
 
-/*
- * Select key based on name
- */
-static mbedtls_ssl_ticket_key *ssl_ticket_select_key(
-    mbedtls_ssl_ticket_context *ctx,
-    const unsigned char name[4])
-{
-    unsigned char i;
-
-    for (i = 0; i < sizeof(ctx->keys) / sizeof(*ctx->keys); i++) {
-        if (memcmp(name, ctx->keys[i].name, 4) == 0) {
-            return &ctx->keys[i];
-        }
-    }
-
-    return NULL;
-}
-
 /*
  * Load session ticket (see mbedtls_ssl_ticket_write for structure)
  */
@@ -421,7 +647,7 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     mbedtls_ssl_ticket_context *ctx = p_ticket;
-    mbedtls_ssl_ticket_key *key;
+    ssl_ticket_ref ref;
     unsigned char *key_name = buf;
     unsigned char *iv = buf + TICKET_KEY_NAME_BYTES;
     unsigned char *enc_len_p = iv + TICKET_IV_BYTES;
@@ -440,25 +666,17 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
-#if defined(MBEDTLS_THREADING_C)
-    if ((ret = mbedtls_mutex_lock(&ctx->mutex)) != 0) {
-        return ret;
-    }
-#endif
-
-    if ((ret = ssl_ticket_update_keys(ctx)) != 0) {
-        goto cleanup;
-    }
-
     enc_len = (enc_len_p[0] << 8) | enc_len_p[1];
 
     if (len != TICKET_MIN_LEN + enc_len) {
-        ret = MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
-        goto cleanup;
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
     /* Select key */
-    if ((key = ssl_ticket_select_key(ctx, key_name)) == NULL) {
+    if ((ret = ssl_ticket_acquire(ctx, key_name, NULL, &ref)) != 0) {
+        goto cleanup;
+    }
+    if (ref.key == NULL) {
         /* We can't know for sure but this is a likely option unless we're
          * under attack - this is only informative anyway */
         ret = MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED;
@@ -467,7 +685,7 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
 
     /* Decrypt and authenticate */
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
-    if ((status = psa_aead_decrypt(key->key, key->alg, iv, TICKET_IV_BYTES,
+    if ((status = psa_aead_decrypt(ref.key->key, ctx->alg, iv, TICKET_IV_BYTES,
                                    key_name, TICKET_ADD_DATA_LEN,
                                    ticket, enc_len + TICKET_AUTH_TAG_BYTES,
                                    ticket, enc_len, &clear_len)) != PSA_SUCCESS) {
@@ -475,7 +693,7 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
         goto cleanup;
     }
 #else
-    if ((ret = mbedtls_cipher_auth_decrypt_ext(&key->ctx,
+    if ((ret = mbedtls_cipher_auth_decrypt_ext(&ref.cipher->ctx,
                                                iv, TICKET_IV_BYTES,
                                                /* Additional data: key name, IV and length */
                                                key_name, TICKET_ADD_DATA_LEN,
@@ -506,7 +724,7 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
         mbedtls_time_t current_time = mbedtls_time(NULL);
 
         if (current_time < session->start ||
-            (uint32_t) (current_time - session->start) > ctx->ticket_lifetime) {
+            (uint32_t) (current_time - session->start) > ref.lifetime) {
             ret = MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED;
             goto cleanup;
         }
@@ -514,11 +732,9 @@ int mbedtls_ssl_ticket_parse(void *p_ticket,
 #endif
 
 cleanup:
-#if defined(MBEDTLS_THREADING_C)
-    if (mbedtls_mutex_unlock(&ctx->mutex) != 0) {
+    if (ssl_ticket_release(ctx, &ref) != 0) {
         return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
     }
-#endif
 
     return ret;
 }
@@ -528,13 +744,8 @@ cleanup:
  */
 void mbedtls_ssl_ticket_free(mbedtls_ssl_ticket_context *ctx)
 {
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    psa_destroy_key(ctx->keys[0].key);
-    psa_destroy_key(ctx->keys[1].key);
-#else
-    mbedtls_cipher_free(&ctx->keys[0].ctx);
-    mbedtls_cipher_free(&ctx->keys[1].ctx);
-#endif /* MBEDTLS_USE_PSA_CRYPTO */
+    ssl_ticket_key_free(ctx->keys[0]);
+    ssl_ticket_key_free(ctx->keys[1]);
 
 #if defined(MBEDTLS_THREADING_C)
     mbedtls_mutex_free(&ctx->mutex);
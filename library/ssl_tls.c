@@ -50,10 +50,12 @@
 #include "mbedtls/oid.h"
 #endif
 
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
 #define PSA_TO_MBEDTLS_ERR(status) PSA_TO_MBEDTLS_ERR_LIST(status, \
                                                            psa_to_ssl_errors, \
                                                            psa_generic_status_to_mbedtls)
+#endif
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
 #define PSA_TO_MD_ERR(status) PSA_TO_MBEDTLS_ERR_LIST(status, \
                                                       psa_to_md_errors, \
                                                       psa_generic_status_to_mbedtls)
@@ -246,6 +248,11 @@ int mbedtls_ssl_session_copy(mbedtls_ssl_session *dst,
 #endif
 #endif /* MBEDTLS_SSL_SESSION_TICKETS && MBEDTLS_SSL_CLI_C */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    dst->ticket_alpn = NULL;
+#endif
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 
 #if defined(MBEDTLS_SSL_KEEP_PEER_CERTIFICATE)
@@ -306,6 +313,17 @@ int mbedtls_ssl_session_copy(mbedtls_ssl_session *dst,
           MBEDTLS_SSL_SERVER_NAME_INDICATION */
 #endif /* MBEDTLS_SSL_SESSION_TICKETS && MBEDTLS_SSL_CLI_C */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    if (src->endpoint == MBEDTLS_SSL_IS_SERVER) {
+        int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+        ret = mbedtls_ssl_session_set_ticket_alpn(dst, src->ticket_alpn);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_ALPN && MBEDTLS_SSL_SRV_C */
+
     return 0;
 }
 
@@ -453,6 +471,11 @@ static int ssl_tls12_session_load(mbedtls_ssl_session *session,
 
 static int ssl_update_checksum_start(mbedtls_ssl_context *, const unsigned char *, size_t);
 
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+static int ssl_update_checksum_all(mbedtls_ssl_context *, const unsigned char *, size_t);
+#endif /* SHA-256 or SHA-384 */
+
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
 static int ssl_update_checksum_sha256(mbedtls_ssl_context *, const unsigned char *, size_t);
 #endif /* MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA*/
@@ -594,6 +617,9 @@ uint32_t mbedtls_ssl_get_extension_id(unsigned int extension_type)
         case MBEDTLS_TLS_EXT_RECORD_SIZE_LIMIT:
             return MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT;
 
+        case MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE:
+            return MBEDTLS_SSL_EXT_ID_COMPRESS_CERTIFICATE;
+
         case MBEDTLS_TLS_EXT_SESSION_TICKET:
             return MBEDTLS_SSL_EXT_ID_SESSION_TICKET;
 
@@ -637,7 +663,8 @@ static const char *extension_name_table[] = {
     [MBEDTLS_SSL_EXT_ID_ENCRYPT_THEN_MAC] = "encrypt_then_mac",
     [MBEDTLS_SSL_EXT_ID_EXTENDED_MASTER_SECRET] = "extended_master_secret",
     [MBEDTLS_SSL_EXT_ID_SESSION_TICKET] = "session_ticket",
-    [MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT] = "record_size_limit"
+    [MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT] = "record_size_limit",
+    [MBEDTLS_SSL_EXT_ID_COMPRESS_CERTIFICATE] = "compress_certificate"
 };
 
 static unsigned int extension_type_table[] = {
@@ -669,7 +696,8 @@ static unsigned int extension_type_table[] = {
     [MBEDTLS_SSL_EXT_ID_ENCRYPT_THEN_MAC] = MBEDTLS_TLS_EXT_ENCRYPT_THEN_MAC,
     [MBEDTLS_SSL_EXT_ID_EXTENDED_MASTER_SECRET] = MBEDTLS_TLS_EXT_EXTENDED_MASTER_SECRET,
     [MBEDTLS_SSL_EXT_ID_SESSION_TICKET] = MBEDTLS_TLS_EXT_SESSION_TICKET,
-    [MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT] = MBEDTLS_TLS_EXT_RECORD_SIZE_LIMIT
+    [MBEDTLS_SSL_EXT_ID_RECORD_SIZE_LIMIT] = MBEDTLS_TLS_EXT_RECORD_SIZE_LIMIT,
+    [MBEDTLS_SSL_EXT_ID_COMPRESS_CERTIFICATE] = MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE
 };
 
 const char *mbedtls_ssl_get_extension_name(unsigned int extension_type)
@@ -695,6 +723,8 @@ static const char *ssl_tls13_get_hs_msg_name(int hs_msg_type)
             return "Certificate";
         case MBEDTLS_SSL_HS_CERTIFICATE_REQUEST:
             return "CertificateRequest";
+        case MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE:
+            return "CompressedCertificate";
     }
     return "Unknown";
 }
@@ -779,27 +809,157 @@ void mbedtls_ssl_print_ticket_flags(const mbedtls_ssl_context *ssl,
 
 #endif /* MBEDTLS_DEBUG_C */
 
-void mbedtls_ssl_optimize_checksum(mbedtls_ssl_context *ssl,
-                                   const mbedtls_ssl_ciphersuite_t *ciphersuite_info)
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+/*
+ * Until the ciphersuite is known, update_checksum is
+ * ssl_update_checksum_start(), which only buffers the handshake messages.
+ * mbedtls_ssl_optimize_checksum() then hashes them with the hash of the
+ * ciphersuite. When they don't fit in the buffer, or a TLS 1.2 server may
+ * need another hash, every hash is computed (ssl_update_checksum_all()).
+ */
+
+/* Start the hash of the transcript, or every hash for MBEDTLS_MD_NONE */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_start_checksum(mbedtls_ssl_context *ssl, mbedtls_md_type_t md)
+{
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    psa_status_t status;
+#else
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+#endif
+
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    if (md == MBEDTLS_MD_SHA256 || md == MBEDTLS_MD_NONE) {
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+        status = psa_hash_abort(&ssl->handshake->fin_sha256_psa);
+        if (status != PSA_SUCCESS) {
+            return PSA_TO_MD_ERR(status);
+        }
+        status = psa_hash_setup(&ssl->handshake->fin_sha256_psa, PSA_ALG_SHA_256);
+        if (status != PSA_SUCCESS) {
+            return PSA_TO_MD_ERR(status);
+        }
+#else
+        mbedtls_md_free(&ssl->handshake->fin_sha256);
+        mbedtls_md_init(&ssl->handshake->fin_sha256);
+        ret = mbedtls_md_setup(&ssl->handshake->fin_sha256,
+                               mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
+                               0);
+        if (ret != 0) {
+            return ret;
+        }
+        ret = mbedtls_md_starts(&ssl->handshake->fin_sha256);
+        if (ret != 0) {
+            return ret;
+        }
+#endif
+    }
+#endif
+#if defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    if (md == MBEDTLS_MD_SHA384 || md == MBEDTLS_MD_NONE) {
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+        status = psa_hash_abort(&ssl->handshake->fin_sha384_psa);
+        if (status != PSA_SUCCESS) {
+            return PSA_TO_MD_ERR(status);
+        }
+        status = psa_hash_setup(&ssl->handshake->fin_sha384_psa, PSA_ALG_SHA_384);
+        if (status != PSA_SUCCESS) {
+            return PSA_TO_MD_ERR(status);
+        }
+#else
+        mbedtls_md_free(&ssl->handshake->fin_sha384);
+        mbedtls_md_init(&ssl->handshake->fin_sha384);
+        ret = mbedtls_md_setup(&ssl->handshake->fin_sha384,
+                               mbedtls_md_info_from_type(MBEDTLS_MD_SHA384), 0);
+        if (ret != 0) {
+            return ret;
+        }
+        ret = mbedtls_md_starts(&ssl->handshake->fin_sha384);
+        if (ret != 0) {
+            return ret;
+        }
+#endif
+    }
+#endif
+    return 0;
+}
+
+static void ssl_free_transcript_buf(mbedtls_ssl_handshake_params *handshake)
+{
+    mbedtls_free(handshake->transcript_buf);
+    handshake->transcript_buf = NULL;
+    handshake->transcript_len = 0;
+    handshake->transcript_size = 0;
+}
+
+/* Start the hash(es) that update_checksum feeds, and hash the buffered
+ * messages with them. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_commit_checksum(mbedtls_ssl_context *ssl,
+                               mbedtls_md_type_t md,
+                               int (*update_checksum)(mbedtls_ssl_context *,
+                                                      const unsigned char *,
+                                                      size_t))
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+
+    /* Already hashing, for instance after a HelloRetryRequest */
+    if (handshake->update_checksum != ssl_update_checksum_start) {
+        handshake->update_checksum = update_checksum;
+        return 0;
+    }
+
+    ret = ssl_start_checksum(ssl, md);
+    if (ret == 0 && handshake->transcript_len > 0) {
+        ret = update_checksum(ssl, handshake->transcript_buf,
+                              handshake->transcript_len);
+    }
+    ssl_free_transcript_buf(handshake);
+    if (ret != 0) {
+        return ret;
+    }
+
+    handshake->update_checksum = update_checksum;
+    return 0;
+}
+#endif /* SHA-256 or SHA-384 */
+
+int mbedtls_ssl_optimize_checksum(mbedtls_ssl_context *ssl,
+                                  const mbedtls_ssl_ciphersuite_t *ciphersuite_info)
 {
     ((void) ciphersuite_info);
 
 #if defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
     if (ciphersuite_info->mac == MBEDTLS_MD_SHA384) {
-        ssl->handshake->update_checksum = ssl_update_checksum_sha384;
+        return ssl_commit_checksum(ssl, MBEDTLS_MD_SHA384,
+                                   ssl_update_checksum_sha384);
     } else
 #endif
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
     if (ciphersuite_info->mac != MBEDTLS_MD_SHA384) {
-        ssl->handshake->update_checksum = ssl_update_checksum_sha256;
+        return ssl_commit_checksum(ssl, MBEDTLS_MD_SHA256,
+                                   ssl_update_checksum_sha256);
     } else
 #endif
     {
         MBEDTLS_SSL_DEBUG_MSG(1, ("should never happen"));
-        return;
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
 }
 
+int mbedtls_ssl_keep_all_checksums(mbedtls_ssl_context *ssl)
+{
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    return ssl_commit_checksum(ssl, MBEDTLS_MD_NONE, ssl_update_checksum_all);
+#else
+    ((void) ssl);
+    return 0;
+#endif
+}
+
 int mbedtls_ssl_add_hs_hdr_to_checksum(mbedtls_ssl_context *ssl,
                                        unsigned hs_type,
                                        size_t total_hs_len)
@@ -832,64 +992,18 @@ int mbedtls_ssl_reset_checksum(mbedtls_ssl_context *ssl)
 {
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
     defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    psa_status_t status;
-#else
-    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
-#endif
+    ssl->handshake->transcript_len = 0;
+
+    /* The hashes start when the ciphersuite is known */
+    if (ssl->handshake->update_checksum == ssl_update_checksum_start) {
+        return 0;
+    }
+
+    return ssl_start_checksum(ssl, MBEDTLS_MD_NONE);
 #else /* SHA-256 or SHA-384 */
     ((void) ssl);
-#endif /* SHA-256 or SHA-384 */
-#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    status = psa_hash_abort(&ssl->handshake->fin_sha256_psa);
-    if (status != PSA_SUCCESS) {
-        return PSA_TO_MD_ERR(status);
-    }
-    status = psa_hash_setup(&ssl->handshake->fin_sha256_psa, PSA_ALG_SHA_256);
-    if (status != PSA_SUCCESS) {
-        return PSA_TO_MD_ERR(status);
-    }
-#else
-    mbedtls_md_free(&ssl->handshake->fin_sha256);
-    mbedtls_md_init(&ssl->handshake->fin_sha256);
-    ret = mbedtls_md_setup(&ssl->handshake->fin_sha256,
-                           mbedtls_md_info_from_type(MBEDTLS_MD_SHA256),
-                           0);
-    if (ret != 0) {
-        return ret;
-    }
-    ret = mbedtls_md_starts(&ssl->handshake->fin_sha256);
-    if (ret != 0) {
-        return ret;
-    }
-#endif
-#endif
-#if defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    status = psa_hash_abort(&ssl->handshake->fin_sha384_psa);
-    if (status != PSA_SUCCESS) {
-        return PSA_TO_MD_ERR(status);
-    }
-    status = psa_hash_setup(&ssl->handshake->fin_sha384_psa, PSA_ALG_SHA_384);
-    if (status != PSA_SUCCESS) {
-        return PSA_TO_MD_ERR(status);
-    }
-#else
-    mbedtls_md_free(&ssl->handshake->fin_sha384);
-    mbedtls_md_init(&ssl->handshake->fin_sha384);
-    ret = mbedtls_md_setup(&ssl->handshake->fin_sha384,
-                           mbedtls_md_info_from_type(MBEDTLS_MD_SHA384), 0);
-    if (ret != 0) {
-        return ret;
-    }
-    ret = mbedtls_md_starts(&ssl->handshake->fin_sha384);
-    if (ret != 0) {
-        return ret;
-    }
-#endif
-#endif
     return 0;
+#endif /* SHA-256 or SHA-384 */
 }
 
 static int ssl_update_checksum_start(mbedtls_ssl_context *ssl,
@@ -897,16 +1011,69 @@ static int ssl_update_checksum_start(mbedtls_ssl_context *ssl,
 {
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
     defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
-#if defined(MBEDTLS_USE_PSA_CRYPTO)
-    psa_status_t status;
-#else
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
-#endif
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+    unsigned char *transcript_buf;
+    size_t size;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    if (len > MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN - handshake->transcript_len) {
+        /* Too long to wait for the ciphersuite */
+        ret = mbedtls_ssl_keep_all_checksums(ssl);
+        if (ret != 0) {
+            return ret;
+        }
+        return ssl_update_checksum_all(ssl, buf, len);
+    }
+
+    if (len > handshake->transcript_size - handshake->transcript_len) {
+        size = handshake->transcript_size * 2;
+        if (size < 512) {
+            size = 512;
+        }
+        if (size < handshake->transcript_len + len) {
+            size = handshake->transcript_len + len;
+        }
+        if (size > MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN) {
+            size = MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN;
+        }
+
+        transcript_buf = mbedtls_calloc(1, size);
+        if (transcript_buf == NULL) {
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        if (handshake->transcript_len > 0) {
+            memcpy(transcript_buf, handshake->transcript_buf,
+                   handshake->transcript_len);
+        }
+        mbedtls_free(handshake->transcript_buf);
+        handshake->transcript_buf = transcript_buf;
+        handshake->transcript_size = size;
+    }
+
+    memcpy(handshake->transcript_buf + handshake->transcript_len, buf, len);
+    handshake->transcript_len += len;
 #else /* SHA-256 or SHA-384 */
     ((void) ssl);
     (void) buf;
     (void) len;
 #endif /* SHA-256 or SHA-384 */
+    return 0;
+}
+
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+static int ssl_update_checksum_all(mbedtls_ssl_context *ssl,
+                                   const unsigned char *buf, size_t len)
+{
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    psa_status_t status;
+#else
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+#endif
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
     status = psa_hash_update(&ssl->handshake->fin_sha256_psa, buf, len);
@@ -935,6 +1102,7 @@ static int ssl_update_checksum_start(mbedtls_ssl_context *ssl,
 #endif
     return 0;
 }
+#endif /* SHA-256 or SHA-384 */
 
 #if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
 static int ssl_update_checksum_sha256(mbedtls_ssl_context *ssl,
@@ -1039,6 +1207,43 @@ void mbedtls_ssl_transform_init(mbedtls_ssl_transform *transform)
 #endif
 }
 
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+int mbedtls_ssl_transform_setup_enc_lanes(mbedtls_ssl_transform *transform,
+                                          const mbedtls_cipher_info_t *cipher_info,
+                                          const unsigned char *key)
+{
+    int ret;
+    unsigned i;
+    mbedtls_cipher_mode_t mode = mbedtls_cipher_info_get_mode(cipher_info);
+
+    /* Other modes chain records (CBC) or are cheap enough (NULL). */
+    if (mode != MBEDTLS_MODE_GCM && mode != MBEDTLS_MODE_CCM &&
+        mode != MBEDTLS_MODE_CHACHAPOLY) {
+        return 0;
+    }
+
+    for (i = 0; i < MBEDTLS_SSL_WRITE_BATCH_RECORDS - 1; i++) {
+        mbedtls_cipher_context_t *ctx = &transform->cipher_ctx_enc_lanes[i];
+
+        mbedtls_cipher_init(ctx);
+        if ((ret = mbedtls_cipher_setup(ctx, cipher_info)) != 0 ||
+            (ret = mbedtls_cipher_setkey(ctx, key,
+                                         (int) mbedtls_cipher_info_get_key_bitlen(cipher_info),
+                                         MBEDTLS_ENCRYPT)) != 0) {
+            mbedtls_cipher_free(ctx);
+            while (i-- > 0) {
+                mbedtls_cipher_free(&transform->cipher_ctx_enc_lanes[i]);
+            }
+            return ret;
+        }
+    }
+
+    transform->enc_lanes = MBEDTLS_SSL_WRITE_BATCH_RECORDS - 1;
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_PARALLEL_ENCRYPTION */
+
 void mbedtls_ssl_session_init(mbedtls_ssl_session *session)
 {
     memset(session, 0, sizeof(mbedtls_ssl_session));
@@ -1141,6 +1346,13 @@ static int ssl_handshake_init(mbedtls_ssl_context *ssl)
         }
 
         mbedtls_ssl_set_timer(ssl, 0);
+
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+        ret = mbedtls_ssl_dtls_arena_setup(ssl);
+        if (ret != 0) {
+            return ret;
+        }
+#endif
     }
 #endif
 
@@ -1386,8 +1598,10 @@ int mbedtls_ssl_setup(mbedtls_ssl_context *ssl,
                       const mbedtls_ssl_config *conf)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+#if !defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
     size_t in_buf_len = MBEDTLS_SSL_IN_BUFFER_LEN;
     size_t out_buf_len = MBEDTLS_SSL_OUT_BUFFER_LEN;
+#endif
 
     ssl->conf = conf;
 
@@ -1402,6 +1616,12 @@ int mbedtls_ssl_setup(mbedtls_ssl_context *ssl,
     /* Set to NULL in case of an error condition */
     ssl->out_buf = NULL;
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    ssl->in_buf = NULL;
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        goto error;
+    }
+#else /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
 #if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
     ssl->in_buf_len = in_buf_len;
 #endif
@@ -1423,6 +1643,7 @@ int mbedtls_ssl_setup(mbedtls_ssl_context *ssl,
     }
 
     mbedtls_ssl_reset_in_out_pointers(ssl);
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
 
 #if defined(MBEDTLS_SSL_DTLS_SRTP)
     memset(&ssl->dtls_srtp_info, 0, sizeof(ssl->dtls_srtp_info));
@@ -1435,8 +1656,12 @@ int mbedtls_ssl_setup(mbedtls_ssl_context *ssl,
     return 0;
 
 error:
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_free(ssl);
+#else
     mbedtls_free(ssl->in_buf);
     mbedtls_free(ssl->out_buf);
+#endif
 
     ssl->conf = NULL;
 
@@ -1503,6 +1728,11 @@ void mbedtls_ssl_session_reset_msg_layer(mbedtls_ssl_context *ssl,
     ssl->in_epoch = 0;
 #endif
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+    ssl->in_ahead_offset = 0;
+    ssl->in_ahead_len = 0;
+#endif
+
     /* Keep current datagram if partial == 1 */
     if (partial == 0) {
         ssl->in_left = 0;
@@ -1523,6 +1753,11 @@ void mbedtls_ssl_session_reset_msg_layer(mbedtls_ssl_context *ssl,
     mbedtls_ssl_dtls_replay_reset(ssl);
 #endif
 
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    ssl->dtls_arena_peak = 0;
+    ssl->dtls_arena_failures = 0;
+#endif
+
 #if defined(MBEDTLS_SSL_PROTO_TLS1_2)
     if (ssl->transform) {
         mbedtls_ssl_transform_free(ssl->transform);
@@ -1557,6 +1792,12 @@ int mbedtls_ssl_session_reset_int(mbedtls_ssl_context *ssl, int partial)
 
     ssl->state = MBEDTLS_SSL_HELLO_REQUEST;
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
     mbedtls_ssl_session_reset_msg_layer(ssl, partial);
 
     /* Reset renegotiation state */
@@ -1582,6 +1823,21 @@ int mbedtls_ssl_session_reset_int(mbedtls_ssl_context *ssl, int partial)
     ssl->alpn_chosen = NULL;
 #endif
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+    ssl->early_data_status = MBEDTLS_SSL_EARLY_DATA_STATUS_NOT_SENT;
+    ssl->total_early_data_size = 0;
+#if defined(MBEDTLS_SSL_SRV_C)
+    ssl->discard_early_data_record = MBEDTLS_SSL_EARLY_DATA_NO_DISCARD;
+    if (ssl->early_data_buf != NULL) {
+        mbedtls_platform_zeroize(ssl->early_data_buf, ssl->early_data_len);
+        mbedtls_free(ssl->early_data_buf);
+        ssl->early_data_buf = NULL;
+    }
+    ssl->early_data_len = 0;
+    ssl->early_data_offt = 0;
+#endif /* MBEDTLS_SSL_SRV_C */
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA */
+
 #if defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY) && defined(MBEDTLS_SSL_SRV_C)
     int free_cli_id = 1;
 #if defined(MBEDTLS_SSL_DTLS_CLIENT_PORT_REUSE)
@@ -1731,6 +1987,18 @@ void mbedtls_ssl_conf_session_cache(mbedtls_ssl_config *conf,
 }
 #endif /* MBEDTLS_SSL_SRV_C */
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+void mbedtls_ssl_conf_buffer_pool(mbedtls_ssl_config *conf,
+                                  void *p_pool,
+                                  mbedtls_ssl_buffer_acquire_t *f_acquire,
+                                  mbedtls_ssl_buffer_release_t *f_release)
+{
+    conf->p_buffer_pool = p_pool;
+    conf->f_buffer_acquire = f_acquire;
+    conf->f_buffer_release = f_release;
+}
+#endif /* MBEDTLS_SSL_IDLE_BUFFER_RELEASE */
+
 #if defined(MBEDTLS_SSL_CLI_C)
 int mbedtls_ssl_set_session(mbedtls_ssl_context *ssl, const mbedtls_ssl_session *session)
 {
@@ -1799,6 +2067,15 @@ void mbedtls_ssl_tls13_conf_max_early_data_size(
 {
     conf->max_early_data_size = max_early_data_size;
 }
+
+void mbedtls_ssl_tls13_conf_early_data_replay(
+    mbedtls_ssl_config *conf,
+    mbedtls_ssl_early_data_replay_t *f_replay,
+    void *p_replay)
+{
+    conf->f_early_data_replay = f_replay;
+    conf->p_early_data_replay = p_replay;
+}
 #endif /* MBEDTLS_SSL_SRV_C */
 
 #endif /* MBEDTLS_SSL_EARLY_DATA */
@@ -1811,17 +2088,184 @@ void mbedtls_ssl_conf_cert_profile(mbedtls_ssl_config *conf,
     conf->cert_profile = profile;
 }
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+static void ssl_key_cert_free_compressed(mbedtls_ssl_key_cert *key_cert)
+{
+    size_t i;
+
+    for (i = 0; i < key_cert->compressed_count; i++) {
+        mbedtls_free(key_cert->compressed[i].data);
+    }
+
+    mbedtls_free(key_cert->compressed);
+    key_cert->compressed = NULL;
+    key_cert->compressed_count = 0;
+}
+
+/*
+ * Compress the TLS 1.3 Certificate message of a key_cert with each
+ * algorithm of the configuration. The certificate_request_context is
+ * empty, as in the Certificate messages of the handshake.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_key_cert_compress(const mbedtls_ssl_config *conf,
+                                 mbedtls_ssl_key_cert *key_cert)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    const mbedtls_x509_crt *crt;
+    unsigned char *msg = NULL, *out = NULL, *p;
+    size_t msg_len = 4, out_len, count = 0, i;
+
+    ssl_key_cert_free_compressed(key_cert);
+
+    if (conf->f_cert_compress == NULL || conf->cert_compression_algs == NULL) {
+        return 0;
+    }
+
+    while (conf->cert_compression_algs[count] != 0) {
+        count++;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        msg_len += 3 + crt->raw.len + 2;
+    }
+
+    msg = mbedtls_calloc(1, msg_len);
+    out = mbedtls_calloc(1, msg_len);
+    key_cert->compressed = mbedtls_calloc(count,
+                                          sizeof(mbedtls_ssl_compressed_cert));
+    if (msg == NULL || out == NULL || key_cert->compressed == NULL) {
+        ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        goto cleanup;
+    }
+    key_cert->compressed_count = count;
+
+    p = msg;
+    *p++ = 0; /* certificate_request_context */
+    MBEDTLS_PUT_UINT24_BE(msg_len - 4, p, 0);
+    p += 3;
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        MBEDTLS_PUT_UINT24_BE(crt->raw.len, p, 0);
+        memcpy(p + 3, crt->raw.p, crt->raw.len);
+        MBEDTLS_PUT_UINT16_BE(0, p, 3 + crt->raw.len);
+        p += 3 + crt->raw.len + 2;
+    }
+
+    for (i = 0; i < count; i++) {
+        mbedtls_ssl_compressed_cert *compressed = &key_cert->compressed[i];
+
+        /* A certificate that doesn't compress is sent as it is */
+        if (conf->f_cert_compress(conf->p_cert_compression,
+                                  conf->cert_compression_algs[i],
+                                  msg, msg_len, out, msg_len,
+                                  &out_len) != 0 ||
+            out_len == 0 || out_len >= msg_len) {
+            continue;
+        }
+
+        compressed->data = mbedtls_calloc(1, out_len);
+        if (compressed->data == NULL) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            goto cleanup;
+        }
+        memcpy(compressed->data, out, out_len);
+        compressed->len = out_len;
+        compressed->uncompressed_len = msg_len;
+    }
+
+    ret = 0;
+
+cleanup:
+    mbedtls_free(msg);
+    mbedtls_free(out);
+    if (ret != 0) {
+        ssl_key_cert_free_compressed(key_cert);
+    }
+
+    return ret;
+}
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 static void ssl_key_cert_free(mbedtls_ssl_key_cert *key_cert)
 {
     mbedtls_ssl_key_cert *cur = key_cert, *next;
 
     while (cur != NULL) {
         next = cur->next;
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+        mbedtls_free(cur->chain_tls12);
+#endif
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        mbedtls_free(cur->chain_tls13);
+#endif
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE */
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+        ssl_key_cert_free_compressed(cur);
+#endif
         mbedtls_free(cur);
         cur = next;
     }
 }
 
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+/*
+ * Serialize the certificate_list of the Certificate message for each
+ * protocol version: every certificate is preceded by its 24-bit length,
+ * and followed by an empty extension block in TLS 1.3.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_key_cert_serialize_chain(mbedtls_ssl_key_cert *key_cert)
+{
+    const mbedtls_x509_crt *crt;
+    unsigned char *p;
+    size_t len = 0;
+
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        len += 3 + crt->raw.len;
+    }
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+    p = key_cert->chain_tls12 = mbedtls_calloc(1, len);
+    if (p == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        MBEDTLS_PUT_UINT24_BE(crt->raw.len, p, 0);
+        memcpy(p + 3, crt->raw.p, crt->raw.len);
+        p += 3 + crt->raw.len;
+    }
+    key_cert->chain_tls12_len = len;
+#endif /* MBEDTLS_SSL_PROTO_TLS1_2 */
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        len += 2;
+    }
+
+    p = key_cert->chain_tls13 = mbedtls_calloc(1, len);
+    if (p == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    for (crt = key_cert->cert; crt != NULL; crt = crt->next) {
+        MBEDTLS_PUT_UINT24_BE(crt->raw.len, p, 0);
+        memcpy(p + 3, crt->raw.p, crt->raw.len);
+        MBEDTLS_PUT_UINT16_BE(0, p, 3 + crt->raw.len);
+        p += 3 + crt->raw.len + 2;
+    }
+    key_cert->chain_tls13_len = len;
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 */
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE */
+
 /* Append a new keycert entry to a (possibly empty) list */
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_append_key_cert(mbedtls_ssl_key_cert **head,
@@ -1864,8 +2308,78 @@ int mbedtls_ssl_conf_own_cert(mbedtls_ssl_config *conf,
                               mbedtls_x509_crt *own_cert,
                               mbedtls_pk_context *pk_key)
 {
-    return ssl_append_key_cert(&conf->key_cert, own_cert, pk_key);
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE) || \
+    defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    mbedtls_ssl_key_cert **last;
+#endif
+
+    ret = ssl_append_key_cert(&conf->key_cert, own_cert, pk_key);
+    if (ret != 0 || own_cert == NULL) {
+        return ret;
+    }
+
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE) || \
+    defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    last = &conf->key_cert;
+    while ((*last)->next != NULL) {
+        last = &(*last)->next;
+    }
+
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+    ret = ssl_key_cert_serialize_chain(*last);
+#endif
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    if (ret == 0) {
+        ret = ssl_key_cert_compress(conf, *last);
+    }
+#endif
+    if (ret != 0) {
+        ssl_key_cert_free(*last);
+        *last = NULL;
+    }
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE || MBEDTLS_SSL_CERT_COMPRESSION */
+
+    return ret;
+}
+
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+int mbedtls_ssl_conf_cert_compression(mbedtls_ssl_config *conf,
+                                      const uint16_t *algorithms,
+                                      mbedtls_ssl_cert_compress_t *f_compress,
+                                      mbedtls_ssl_cert_decompress_t *f_decompress,
+                                      void *p_ctx)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_key_cert *cur;
+    size_t count = 0;
+
+    while (algorithms != NULL && algorithms[count] != 0) {
+        if (++count > MBEDTLS_SSL_CERT_COMPRESSION_MAX_ALGS) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+    }
+
+    conf->cert_compression_algs = algorithms;
+    conf->f_cert_compress = f_compress;
+    conf->f_cert_decompress = f_decompress;
+    conf->p_cert_compression = p_ctx;
+
+    for (cur = conf->key_cert; cur != NULL; cur = cur->next) {
+        ret = ssl_key_cert_compress(conf, cur);
+        if (ret != 0) {
+            /* The chains not compressed yet still have the messages of the
+             * previous algorithms: send every chain uncompressed instead. */
+            for (cur = conf->key_cert; cur != NULL; cur = cur->next) {
+                ssl_key_cert_free_compressed(cur);
+            }
+            return ret;
+        }
+    }
+
+    return 0;
 }
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
 
 void mbedtls_ssl_conf_ca_chain(mbedtls_ssl_config *conf,
                                mbedtls_x509_crt *ca_chain,
@@ -1896,6 +2410,16 @@ void mbedtls_ssl_conf_ca_cb(mbedtls_ssl_config *conf,
     conf->ca_crl     = NULL;
 }
 #endif /* MBEDTLS_X509_TRUSTED_CERTIFICATE_CALLBACK */
+
+void mbedtls_ssl_conf_verify_cache(mbedtls_ssl_config *conf,
+                                   void *p_cache,
+                                   mbedtls_ssl_verify_cache_get_t *f_get_cache,
+                                   mbedtls_ssl_verify_cache_set_t *f_set_cache)
+{
+    conf->p_verify_cache = p_cache;
+    conf->f_get_verify_cache = f_get_cache;
+    conf->f_set_verify_cache = f_set_cache;
+}
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
@@ -2468,14 +2992,21 @@ mbedtls_ssl_mode_t mbedtls_ssl_get_mode_from_ciphersuite(
  *     } ClientOnlyData;
  *
  *     struct {
+ *       uint64 start_time;
+ *       opaque ticket_alpn<0..256>; // if MBEDTLS_SSL_EARLY_DATA and
+ *                                   // MBEDTLS_SSL_ALPN are defined
+ *     } ServerOnlyData;
+ *
+ *     struct {
  *       uint8 endpoint;
  *       uint8 ciphersuite[2];
  *       uint32 ticket_age_add;
  *       uint8 ticket_flags;
  *       opaque resumption_key<0..255>;
+ *       uint32 max_early_data_size; // if MBEDTLS_SSL_EARLY_DATA is defined
  *       select ( endpoint ) {
  *            case client: ClientOnlyData;
- *            case server: uint64 start_time;
+ *            case server: ServerOnlyData;
  *        };
  *     } serialized_session_tls13;
  *
@@ -2492,6 +3023,11 @@ static int ssl_tls13_session_save(const mbedtls_ssl_session *session,
     defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
     size_t hostname_len = (session->hostname == NULL) ?
                           0 : strlen(session->hostname) + 1;
+#endif
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    size_t alpn_len = (session->ticket_alpn == NULL) ?
+                      0 : strlen(session->ticket_alpn) + 1;
 #endif
     size_t needed =   1                             /* endpoint */
                     + 2                             /* ciphersuite */
@@ -2505,10 +3041,22 @@ static int ssl_tls13_session_save(const mbedtls_ssl_session *session,
     }
     needed += session->resumption_key_len;  /* resumption_key */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    needed += 4;                            /* max_early_data_size */
+#endif
+
 #if defined(MBEDTLS_HAVE_TIME)
     needed += 8; /* start_time or ticket_received */
 #endif
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    if (session->endpoint == MBEDTLS_SSL_IS_SERVER) {
+        needed +=  2                        /* alpn_len */
+                  + alpn_len;               /* ticket_alpn */
+    }
+#endif
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if (session->endpoint == MBEDTLS_SSL_IS_CLIENT) {
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
@@ -2544,6 +3092,11 @@ static int ssl_tls13_session_save(const mbedtls_ssl_session *session,
     memcpy(p, session->resumption_key, session->resumption_key_len);
     p += session->resumption_key_len;
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    MBEDTLS_PUT_UINT32_BE(session->max_early_data_size, p, 0);
+    p += 4;
+#endif
+
 #if defined(MBEDTLS_HAVE_TIME) && defined(MBEDTLS_SSL_SRV_C)
     if (session->endpoint == MBEDTLS_SSL_IS_SERVER) {
         MBEDTLS_PUT_UINT64_BE((uint64_t) session->start, p, 0);
@@ -2551,6 +3104,19 @@ static int ssl_tls13_session_save(const mbedtls_ssl_session *session,
     }
 #endif /* MBEDTLS_HAVE_TIME */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    if (session->endpoint == MBEDTLS_SSL_IS_SERVER) {
+        MBEDTLS_PUT_UINT16_BE(alpn_len, p, 0);
+        p += 2;
+        if (alpn_len > 0) {
+            /* save chosen alpn */
+            memcpy(p, session->ticket_alpn, alpn_len);
+            p += alpn_len;
+        }
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_ALPN && MBEDTLS_SSL_SRV_C */
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if (session->endpoint == MBEDTLS_SSL_IS_CLIENT) {
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
@@ -2589,6 +3155,10 @@ static int ssl_tls13_session_load(mbedtls_ssl_session *session,
 {
     const unsigned char *p = buf;
     const unsigned char *end = buf + len;
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+#endif
 
     if (end - p < 9) {
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
@@ -2612,6 +3182,14 @@ static int ssl_tls13_session_load(mbedtls_ssl_session *session,
     memcpy(session->resumption_key, p, session->resumption_key_len);
     p += session->resumption_key_len;
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (end - p < 4) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+    session->max_early_data_size = MBEDTLS_GET_UINT32_BE(p, 0);
+    p += 4;
+#endif
+
 #if defined(MBEDTLS_HAVE_TIME) && defined(MBEDTLS_SSL_SRV_C)
     if (session->endpoint == MBEDTLS_SSL_IS_SERVER) {
         if (end - p < 8) {
@@ -2622,6 +3200,35 @@ static int ssl_tls13_session_load(mbedtls_ssl_session *session,
     }
 #endif /* MBEDTLS_HAVE_TIME */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    if (session->endpoint == MBEDTLS_SSL_IS_SERVER) {
+        size_t alpn_len;
+
+        if (end - p < 2) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+        alpn_len = MBEDTLS_GET_UINT16_BE(p, 0);
+        p += 2;
+
+        if (end - p < (long int) alpn_len ||
+            alpn_len > MBEDTLS_SSL_MAX_ALPN_NAME_LEN + 1) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+        if (alpn_len > 0) {
+            if (p[alpn_len - 1] != '\0') {
+                return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+            }
+            ret = mbedtls_ssl_session_set_ticket_alpn(session,
+                                                      (const char *) p);
+            if (ret != 0) {
+                return ret;
+            }
+            p += alpn_len;
+        }
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_ALPN && MBEDTLS_SSL_SRV_C */
+
 #if defined(MBEDTLS_SSL_CLI_C)
     if (session->endpoint == MBEDTLS_SSL_IS_CLIENT) {
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION) && \
@@ -2960,6 +3567,16 @@ void mbedtls_ssl_conf_groups(mbedtls_ssl_config *conf,
     conf->group_list = group_list;
 }
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_ECDH_C)
+void mbedtls_ssl_tls13_conf_key_share_pool(mbedtls_ssl_config *conf,
+                                           mbedtls_ssl_key_share_take_t *f_take,
+                                           void *p_pool)
+{
+    conf->f_key_share_take = f_take;
+    conf->p_key_share = p_pool;
+}
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_ECDH_C */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 int mbedtls_ssl_set_hostname(mbedtls_ssl_context *ssl, const char *hostname)
 {
@@ -3152,6 +3769,23 @@ void mbedtls_ssl_conf_extended_master_secret(mbedtls_ssl_config *conf, char ems)
 }
 #endif
 
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+void mbedtls_ssl_conf_read_ahead(mbedtls_ssl_config *conf, char read_ahead)
+{
+    conf->read_ahead = read_ahead;
+}
+#endif
+
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+void mbedtls_ssl_conf_record_workers(mbedtls_ssl_config *conf,
+                                     mbedtls_ssl_run_jobs_t *f_run_jobs,
+                                     void *p_workers)
+{
+    conf->f_run_jobs = f_run_jobs;
+    conf->p_workers  = p_workers;
+}
+#endif
+
 #if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH)
 int mbedtls_ssl_conf_max_frag_len(mbedtls_ssl_config *conf, unsigned char mfl_code)
 {
@@ -3243,6 +3877,13 @@ void mbedtls_ssl_conf_async_private_cb(
     conf->p_async_config_data = async_config_data;
 }
 
+void mbedtls_ssl_conf_async_key_agreement_cb(
+    mbedtls_ssl_config *conf,
+    mbedtls_ssl_async_key_agreement_t *f_async_key_agreement)
+{
+    conf->f_async_key_agreement_start = f_async_key_agreement;
+}
+
 void *mbedtls_ssl_conf_get_async_config_data(const mbedtls_ssl_config *conf)
 {
     return conf->p_async_config_data;
@@ -3469,6 +4110,76 @@ int mbedtls_ssl_get_max_in_record_payload(const mbedtls_ssl_context *ssl)
     return (int) max_len;
 }
 
+#if defined(MBEDTLS_SSL_KTLS)
+int mbedtls_ssl_export_ktls_info(const mbedtls_ssl_context *ssl,
+                                 int direction,
+                                 mbedtls_ssl_ktls_info *info)
+{
+    const mbedtls_ssl_ciphersuite_t *ciphersuite_info;
+    const mbedtls_ssl_transform *transform;
+
+    if (ssl == NULL || ssl->conf == NULL || info == NULL ||
+        ssl->state != MBEDTLS_SSL_HANDSHAKE_OVER || ssl->session == NULL) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (ssl->conf->transport != MBEDTLS_SSL_TRANSPORT_STREAM) {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    if (direction == MBEDTLS_SSL_KTLS_TX) {
+        transform = ssl->transform_out;
+        /* Records already protected would be sent after newer ones. */
+        if (ssl->out_left != 0) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+    } else if (direction == MBEDTLS_SSL_KTLS_RX) {
+        transform = ssl->transform_in;
+        /* Data taken from the transport would never reach the new owner. */
+        if (ssl->in_left != 0 || mbedtls_ssl_check_pending(ssl) != 0) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+    } else {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    ciphersuite_info = mbedtls_ssl_ciphersuite_from_id(ssl->session->ciphersuite);
+    if (transform == NULL || ciphersuite_info == NULL ||
+        transform->ktls_keylen == 0 ||
+        transform->taglen != 16 ||
+        (ciphersuite_info->cipher != MBEDTLS_CIPHER_AES_128_GCM &&
+         ciphersuite_info->cipher != MBEDTLS_CIPHER_AES_256_GCM &&
+         ciphersuite_info->cipher != MBEDTLS_CIPHER_CHACHA20_POLY1305)) {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    memset(info, 0, sizeof(mbedtls_ssl_ktls_info));
+    info->tls_version = transform->tls_version;
+    info->cipher = (mbedtls_cipher_type_t) ciphersuite_info->cipher;
+    info->key_len = transform->ktls_keylen;
+    info->iv_len = transform->fixed_ivlen;
+
+    if (direction == MBEDTLS_SSL_KTLS_TX) {
+        memcpy(info->key, transform->ktls_key_enc, info->key_len);
+        memcpy(info->iv, transform->iv_enc, info->iv_len);
+        memcpy(info->rec_seq, ssl->cur_out_ctr, sizeof(info->rec_seq));
+    } else {
+        memcpy(info->key, transform->ktls_key_dec, info->key_len);
+        memcpy(info->iv, transform->iv_dec, info->iv_len);
+        /* For TLS, in_ctr is the implicit sequence number of the next
+         * record, saved aside while an idle buffer is released. */
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+        if (ssl->in_buf == NULL) {
+            memcpy(info->rec_seq, ssl->in_ctr_idle, sizeof(info->rec_seq));
+        } else
+#endif
+        memcpy(info->rec_seq, ssl->in_ctr, sizeof(info->rec_seq));
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_KTLS */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 const mbedtls_x509_crt *mbedtls_ssl_get_peer_cert(const mbedtls_ssl_context *ssl)
 {
@@ -3569,12 +4280,27 @@ int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl,
 #define SSL_SERIALIZED_SESSION_CONFIG_TICKET 0
 #endif /* MBEDTLS_SSL_SESSION_TICKETS */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+#define SSL_SERIALIZED_SESSION_CONFIG_EARLY_DATA 1
+#else
+#define SSL_SERIALIZED_SESSION_CONFIG_EARLY_DATA 0
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+#define SSL_SERIALIZED_SESSION_CONFIG_ALPN 1
+#else
+#define SSL_SERIALIZED_SESSION_CONFIG_ALPN 0
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_ALPN && MBEDTLS_SSL_SRV_C */
+
 #define SSL_SERIALIZED_SESSION_CONFIG_TIME_BIT          0
 #define SSL_SERIALIZED_SESSION_CONFIG_CRT_BIT           1
 #define SSL_SERIALIZED_SESSION_CONFIG_CLIENT_TICKET_BIT 2
 #define SSL_SERIALIZED_SESSION_CONFIG_MFL_BIT           3
 #define SSL_SERIALIZED_SESSION_CONFIG_ETM_BIT           4
 #define SSL_SERIALIZED_SESSION_CONFIG_TICKET_BIT        5
+#define SSL_SERIALIZED_SESSION_CONFIG_EARLY_DATA_BIT    6
+#define SSL_SERIALIZED_SESSION_CONFIG_ALPN_BIT          7
 
 #define SSL_SERIALIZED_SESSION_CONFIG_BITFLAG                           \
     ((uint16_t) (                                                      \
@@ -3584,7 +4310,11 @@ int mbedtls_ssl_get_session(const mbedtls_ssl_context *ssl,
              SSL_SERIALIZED_SESSION_CONFIG_CLIENT_TICKET_BIT) | \
          (SSL_SERIALIZED_SESSION_CONFIG_MFL << SSL_SERIALIZED_SESSION_CONFIG_MFL_BIT) | \
          (SSL_SERIALIZED_SESSION_CONFIG_ETM << SSL_SERIALIZED_SESSION_CONFIG_ETM_BIT) | \
-         (SSL_SERIALIZED_SESSION_CONFIG_TICKET << SSL_SERIALIZED_SESSION_CONFIG_TICKET_BIT)))
+         (SSL_SERIALIZED_SESSION_CONFIG_TICKET << SSL_SERIALIZED_SESSION_CONFIG_TICKET_BIT) | \
+         (SSL_SERIALIZED_SESSION_CONFIG_EARLY_DATA << \
+             SSL_SERIALIZED_SESSION_CONFIG_EARLY_DATA_BIT) | \
+         (SSL_SERIALIZED_SESSION_CONFIG_ALPN << \
+             SSL_SERIALIZED_SESSION_CONFIG_ALPN_BIT)))
 
 static unsigned char ssl_serialized_session_header[] = {
     MBEDTLS_VERSION_MAJOR,
@@ -3840,6 +4570,12 @@ int mbedtls_ssl_handshake_step(mbedtls_ssl_context *ssl)
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+#endif
+
     ret = ssl_prepare_handshake_step(ssl);
     if (ret != 0) {
         return ret;
@@ -3915,9 +4651,9 @@ cleanup:
 }
 
 /*
- * Perform the SSL handshake
+ * Perform the SSL handshake, keeping the record buffers for the caller
  */
-int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+int mbedtls_ssl_handshake_keep_buffers(mbedtls_ssl_context *ssl)
 {
     int ret = 0;
 
@@ -3952,6 +4688,22 @@ int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
     return ret;
 }
 
+/*
+ * Perform the SSL handshake
+ */
+int mbedtls_ssl_handshake(mbedtls_ssl_context *ssl)
+{
+    int ret = mbedtls_ssl_handshake_keep_buffers(ssl);
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if (ssl != NULL) {
+        mbedtls_ssl_buffers_release_idle(ssl);
+    }
+#endif
+
+    return ret;
+}
+
 #if defined(MBEDTLS_SSL_RENEGOTIATION)
 #if defined(MBEDTLS_SSL_SRV_C)
 /*
@@ -4014,8 +4766,8 @@ int mbedtls_ssl_start_renegotiation(mbedtls_ssl_context *ssl)
     ssl->state = MBEDTLS_SSL_HELLO_REQUEST;
     ssl->renego_status = MBEDTLS_SSL_RENEGOTIATION_IN_PROGRESS;
 
-    if ((ret = mbedtls_ssl_handshake(ssl)) != 0) {
-        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake", ret);
+    if ((ret = mbedtls_ssl_handshake_keep_buffers(ssl)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_handshake_keep_buffers", ret);
         return ret;
     }
 
@@ -4036,6 +4788,13 @@ int mbedtls_ssl_renegotiate(mbedtls_ssl_context *ssl)
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if ((ret = mbedtls_ssl_buffers_acquire(ssl)) != 0) {
+        return ret;
+    }
+    ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+#endif
+
 #if defined(MBEDTLS_SSL_SRV_C)
     /* On server, just send the request */
     if (ssl->conf->endpoint == MBEDTLS_SSL_IS_SERVER) {
@@ -4132,6 +4891,10 @@ void mbedtls_ssl_handshake_free(mbedtls_ssl_context *ssl)
     mbedtls_md_free(&handshake->fin_sha384);
 #endif
 #endif
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    ssl_free_transcript_buf(handshake);
+#endif
 
 #if defined(MBEDTLS_DHM_C)
     mbedtls_dhm_free(&handshake->dhm_ctx);
@@ -4218,6 +4981,9 @@ void mbedtls_ssl_handshake_free(mbedtls_ssl_context *ssl)
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
     mbedtls_ssl_flight_free(handshake->flight);
     mbedtls_ssl_buffering_free(ssl);
+#if defined(MBEDTLS_SSL_DTLS_BUFFERING_ARENA)
+    mbedtls_ssl_dtls_arena_free(ssl);
+#endif
 #endif /* MBEDTLS_SSL_PROTO_DTLS */
 
 #if defined(MBEDTLS_ECDH_C) && \
@@ -4269,6 +5035,11 @@ void mbedtls_ssl_session_free(mbedtls_ssl_session *session)
     mbedtls_free(session->ticket);
 #endif
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+    mbedtls_free(session->ticket_alpn);
+#endif
+
     mbedtls_platform_zeroize(session, sizeof(mbedtls_ssl_session));
 }
 
@@ -4344,7 +5115,8 @@ static unsigned char ssl_serialized_context_header[] = {
  *  // fields from ssl_context
  *  uint32 badmac_seen;         // DTLS: number of records with failing MAC
  *  uint64 in_window_top;       // DTLS: last validated record seq_num
- *  uint64 in_window;           // DTLS: bitmask for replay protection
+ *  uint64 in_window;           // DTLS: bitmask for replay protection,
+ *                              //       64 most recent records
  *  uint8 disable_datagram_packing; // DTLS: only one record per datagram
  *  uint64 cur_out_ctr;         // Record layer: outgoing sequence number
  *  uint16 mtu;                 // DTLS: path mtu (max outgoing fragment size)
@@ -4494,7 +5266,7 @@ int mbedtls_ssl_context_save(mbedtls_ssl_context *ssl,
         MBEDTLS_PUT_UINT64_BE(ssl->in_window_top, p, 0);
         p += 8;
 
-        MBEDTLS_PUT_UINT64_BE(ssl->in_window, p, 0);
+        MBEDTLS_PUT_UINT64_BE(ssl->in_window[0], p, 0);
         p += 8;
     }
 #endif /* MBEDTLS_SSL_DTLS_ANTI_REPLAY */
@@ -4737,15 +5509,21 @@ static int ssl_context_load(mbedtls_ssl_context *ssl,
                          ((uint64_t) p[7]);
     p += 8;
 
-    ssl->in_window = ((uint64_t) p[0] << 56) |
-                     ((uint64_t) p[1] << 48) |
-                     ((uint64_t) p[2] << 40) |
-                     ((uint64_t) p[3] << 32) |
-                     ((uint64_t) p[4] << 24) |
-                     ((uint64_t) p[5] << 16) |
-                     ((uint64_t) p[6] <<  8) |
-                     ((uint64_t) p[7]);
+    ssl->in_window[0] = ((uint64_t) p[0] << 56) |
+                        ((uint64_t) p[1] << 48) |
+                        ((uint64_t) p[2] << 40) |
+                        ((uint64_t) p[3] << 32) |
+                        ((uint64_t) p[4] << 24) |
+                        ((uint64_t) p[5] << 16) |
+                        ((uint64_t) p[6] <<  8) |
+                        ((uint64_t) p[7]);
     p += 8;
+
+    /* Older records weren't saved: don't accept them as new */
+    if (sizeof(ssl->in_window) > 8) {
+        memset((unsigned char *) ssl->in_window + 8, 0xff,
+               sizeof(ssl->in_window) - 8);
+    }
 #endif /* MBEDTLS_SSL_DTLS_ANTI_REPLAY */
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
@@ -4846,7 +5624,17 @@ int mbedtls_ssl_context_load(mbedtls_ssl_context *context,
                              const unsigned char *buf,
                              size_t len)
 {
-    int ret = ssl_context_load(context, buf, len);
+    int ret;
+
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    if (context->conf != NULL &&
+        (ret = mbedtls_ssl_buffers_acquire(context)) != 0) {
+        mbedtls_ssl_free(context);
+        return ret;
+    }
+#endif
+
+    ret = ssl_context_load(context, buf, len);
 
     if (ret != 0) {
         mbedtls_ssl_free(context);
@@ -4867,6 +5655,10 @@ void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> free"));
 
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE)
+    mbedtls_ssl_buffers_free(ssl);
+#endif
+
     if (ssl->out_buf != NULL) {
 #if defined(MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH)
         size_t out_buf_len = ssl->out_buf_len;
@@ -4930,6 +5722,13 @@ void mbedtls_ssl_free(mbedtls_ssl_context *ssl)
     mbedtls_free(ssl->cli_id);
 #endif
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_SRV_C)
+    if (ssl->early_data_buf != NULL) {
+        mbedtls_platform_zeroize(ssl->early_data_buf, ssl->early_data_len);
+        mbedtls_free(ssl->early_data_buf);
+    }
+#endif
+
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= free"));
 
     /* Actually clear after last debug message */
@@ -5693,6 +6492,210 @@ const char *mbedtls_ssl_get_curve_name_from_tls_id(uint16_t tls_id)
 }
 #endif
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && defined(MBEDTLS_ECDH_C)
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_async_resume_key_agreement(mbedtls_ssl_context *ssl,
+                                          unsigned char *out,
+                                          size_t out_size,
+                                          size_t *out_len)
+{
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+    int ret = ssl->conf->f_async_resume(ssl, out, out_len, out_size);
+
+    if (ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+        handshake->async_in_progress = 0;
+        mbedtls_ssl_set_async_operation_data(ssl, NULL);
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        /* The ephemeral key is not needed anymore, whatever the outcome. */
+        if (!handshake->ecdh_psa_privkey_is_external) {
+            psa_destroy_key(handshake->ecdh_psa_privkey);
+        }
+        handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
+#endif
+    }
+    MBEDTLS_SSL_DEBUG_RET(2, "ssl_async_resume_key_agreement", ret);
+    return ret;
+}
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+static uint16_t ssl_get_tls_id_from_psa_curve_info(psa_ecc_family_t family,
+                                                   size_t bits)
+{
+    for (int i = 0; tls_id_match_table[i].tls_id != 0; i++) {
+        if (tls_id_match_table[i].psa_family == family &&
+            tls_id_match_table[i].bits == bits) {
+            return tls_id_match_table[i].tls_id;
+        }
+    }
+
+    return 0;
+}
+
+/* Start the key agreement with the PSA ephemeral key: TLS 1.3, or TLS 1.2
+ * with MBEDTLS_USE_PSA_CRYPTO. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_async_start_key_agreement_psa(mbedtls_ssl_context *ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+    psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_status_t status;
+    unsigned char own_key[PSA_BITS_TO_BYTES(PSA_VENDOR_ECC_MAX_CURVE_BITS)];
+    size_t own_key_len = 0;
+    uint16_t group;
+    int exportable;
+
+    if (handshake->ecdh_psa_privkey_is_external) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    status = psa_get_key_attributes(handshake->ecdh_psa_privkey,
+                                    &key_attributes);
+    if (status != PSA_SUCCESS) {
+        return PSA_TO_MBEDTLS_ERR(status);
+    }
+    group = ssl_get_tls_id_from_psa_curve_info(
+        PSA_KEY_TYPE_ECC_GET_FAMILY(psa_get_key_type(&key_attributes)),
+        psa_get_key_bits(&key_attributes));
+    exportable = (psa_get_key_usage_flags(&key_attributes) &
+                  PSA_KEY_USAGE_EXPORT) != 0;
+    psa_reset_key_attributes(&key_attributes);
+
+    if (group == 0 || !exportable) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    status = psa_export_key(handshake->ecdh_psa_privkey,
+                            own_key, sizeof(own_key), &own_key_len);
+    if (status != PSA_SUCCESS) {
+        ret = PSA_TO_MBEDTLS_ERR(status);
+        goto exit;
+    }
+
+    ret = ssl->conf->f_async_key_agreement_start(
+        ssl, group, own_key, own_key_len,
+        handshake->ecdh_psa_peerkey, handshake->ecdh_psa_peerkey_len);
+
+exit:
+    mbedtls_platform_zeroize(own_key, sizeof(own_key));
+    return ret;
+}
+#endif /* MBEDTLS_USE_PSA_CRYPTO || MBEDTLS_SSL_PROTO_TLS1_3 */
+
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+/* Start the key agreement with the legacy ECDH context: TLS 1.2 without
+ * MBEDTLS_USE_PSA_CRYPTO. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_async_start_key_agreement_ecdh(mbedtls_ssl_context *ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    const mbedtls_ecdh_context *ctx = &ssl->handshake->ecdh_ctx;
+    const mbedtls_ecp_group *grp;
+    const mbedtls_mpi *d;
+    const mbedtls_ecp_point *Qp;
+    unsigned char own_key[MBEDTLS_ECP_MAX_BYTES];
+    unsigned char peer_key[MBEDTLS_ECP_MAX_PT_LEN];
+    size_t own_key_len, peer_key_len;
+    uint16_t group;
+
+#if defined(MBEDTLS_ECDH_LEGACY_CONTEXT)
+    grp = &ctx->grp;
+    d = &ctx->d;
+    Qp = &ctx->Qp;
+#else
+    if (ctx->var != MBEDTLS_ECDH_VARIANT_MBEDTLS_2_0) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+    grp = &ctx->ctx.mbed_ecdh.grp;
+    d = &ctx->ctx.mbed_ecdh.d;
+    Qp = &ctx->ctx.mbed_ecdh.Qp;
+#endif
+
+    group = mbedtls_ssl_get_tls_id_from_ecp_group_id(grp->id);
+    if (group == 0) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+    /* Same formats as psa_export_key() and psa_export_public_key() */
+    if (mbedtls_ecp_get_type(grp) == MBEDTLS_ECP_TYPE_MONTGOMERY) {
+        own_key_len = (grp->pbits + 7) / 8;
+        MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary_le(d, own_key, own_key_len));
+    } else {
+        own_key_len = (grp->nbits + 7) / 8;
+        MBEDTLS_MPI_CHK(mbedtls_mpi_write_binary(d, own_key, own_key_len));
+    }
+    MBEDTLS_MPI_CHK(mbedtls_ecp_point_write_binary(grp, Qp,
+                                                   MBEDTLS_ECP_PF_UNCOMPRESSED,
+                                                   &peer_key_len, peer_key,
+                                                   sizeof(peer_key)));
+
+    ret = ssl->conf->f_async_key_agreement_start(ssl, group,
+                                                 own_key, own_key_len,
+                                                 peer_key, peer_key_len);
+
+cleanup:
+    mbedtls_platform_zeroize(own_key, sizeof(own_key));
+    return ret;
+}
+#endif /* !MBEDTLS_USE_PSA_CRYPTO */
+
+int mbedtls_ssl_async_key_agreement(mbedtls_ssl_context *ssl,
+                                    unsigned char *out, size_t out_size,
+                                    size_t *out_len)
+{
+    int ret = MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+
+    if (ssl->handshake->async_in_progress != 0) {
+        return ssl_async_resume_key_agreement(ssl, out, out_size, out_len);
+    }
+
+    if (ssl->conf->f_async_key_agreement_start == NULL ||
+        ssl->conf->f_async_resume == NULL) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+
+#if defined(MBEDTLS_SSL_PROTO_TLS1_2)
+    /* Static ECDH uses the key of the certificate, and ECDHE-PSK mixes the
+     * shared secret with the PSK: only offload ECDHE-RSA and ECDHE-ECDSA. */
+    if (ssl->tls_version == MBEDTLS_SSL_VERSION_TLS1_2 &&
+        ssl->handshake->ciphersuite_info->key_exchange !=
+        MBEDTLS_KEY_EXCHANGE_ECDHE_RSA &&
+        ssl->handshake->ciphersuite_info->key_exchange !=
+        MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA) {
+        return MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+    }
+#endif
+
+#if !defined(MBEDTLS_USE_PSA_CRYPTO)
+    if (ssl->tls_version != MBEDTLS_SSL_VERSION_TLS1_3) {
+        ret = ssl_async_start_key_agreement_ecdh(ssl);
+    } else
+#endif
+    {
+#if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
+        ret = ssl_async_start_key_agreement_psa(ssl);
+#endif
+    }
+
+    switch (ret) {
+        case MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH:
+            MBEDTLS_SSL_DEBUG_MSG(2, ("async key agreement: not applicable"));
+            return ret;
+        case 0:
+            ssl->handshake->async_in_progress = 1;
+            return ssl_async_resume_key_agreement(ssl, out, out_size, out_len);
+        case MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS:
+            ssl->handshake->async_in_progress = 1;
+            MBEDTLS_SSL_DEBUG_MSG(2, ("async key agreement: in progress"));
+            return ret;
+        default:
+            MBEDTLS_SSL_DEBUG_RET(1, "f_async_key_agreement_start", ret);
+            return ret;
+    }
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE && MBEDTLS_ECDH_C */
+
 #if defined(MBEDTLS_X509_CRT_PARSE_C)
 int mbedtls_ssl_check_cert_usage(const mbedtls_x509_crt *cert,
                                  const mbedtls_ssl_ciphersuite_t *ciphersuite,
@@ -5756,8 +6759,265 @@ int mbedtls_ssl_check_cert_usage(const mbedtls_x509_crt *cert,
 
     return ret;
 }
+
+/* Add a tagged, length-prefixed item to the verified chain cache key */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_verify_cache_key_add(mbedtls_md_context_t *md, unsigned char tag,
+                                    const unsigned char *buf, size_t len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char hdr[5];
+
+    hdr[0] = tag;
+    MBEDTLS_PUT_UINT32_BE(len, hdr, 1);
+
+    if ((ret = mbedtls_md_update(md, hdr, sizeof(hdr))) != 0) {
+        return ret;
+    }
+
+    return mbedtls_md_update(md, buf, len);
+}
+
+/*
+ * The key of a chain in the verified chain cache: a digest of everything
+ * mbedtls_x509_crt_verify_restartable() looks at, apart from the time.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_verify_cache_key(const mbedtls_ssl_context *ssl,
+                                const mbedtls_x509_crt *chain,
+                                const mbedtls_x509_crt *ca_chain,
+                                const mbedtls_x509_crl *ca_crl,
+                                unsigned char *key)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    const mbedtls_x509_crt_profile *profile = ssl->conf->cert_profile;
+    const mbedtls_x509_crt *crt;
+    const mbedtls_x509_crl *crl;
+    mbedtls_md_context_t md;
+    unsigned char buf[16];
+
+    if (md_info == NULL ||
+        mbedtls_md_get_size(md_info) != MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN) {
+        return MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
+    }
+
+    mbedtls_md_init(&md);
+    MBEDTLS_SSL_PROC_CHK(mbedtls_md_setup(&md, md_info, 0));
+    MBEDTLS_SSL_PROC_CHK(mbedtls_md_starts(&md));
+
+    MBEDTLS_PUT_UINT32_BE(profile->allowed_mds, buf, 0);
+    MBEDTLS_PUT_UINT32_BE(profile->allowed_pks, buf, 4);
+    MBEDTLS_PUT_UINT32_BE(profile->allowed_curves, buf, 8);
+    MBEDTLS_PUT_UINT32_BE(profile->rsa_min_bitlen, buf, 12);
+    MBEDTLS_SSL_PROC_CHK(ssl_verify_cache_key_add(&md, 'p', buf, sizeof(buf)));
+
+    if (ssl->hostname != NULL) {
+        MBEDTLS_SSL_PROC_CHK(ssl_verify_cache_key_add(
+                                 &md, 'h', (const unsigned char *) ssl->hostname,
+                                 strlen(ssl->hostname)));
+    }
+
+    for (crt = chain; crt != NULL; crt = crt->next) {
+        MBEDTLS_SSL_PROC_CHK(ssl_verify_cache_key_add(&md, 'c', crt->raw.p,
+                                                      crt->raw.len));
+    }
+
+    /* Trusted CAs and CRLs are identified by their signatures */
+    for (crt = ca_chain; crt != NULL; crt = crt->next) {
+        MBEDTLS_SSL_PROC_CHK(ssl_verify_cache_key_add(&md, 'a', crt->sig.p,
+                                                      crt->sig.len));
+    }
+
+    for (crl = ca_crl; crl != NULL; crl = crl->next) {
+        MBEDTLS_SSL_PROC_CHK(ssl_verify_cache_key_add(&md, 'r', crl->sig.p,
+                                                      crl->sig.len));
+    }
+
+    MBEDTLS_SSL_PROC_CHK(mbedtls_md_finish(&md, key));
+
+cleanup:
+    mbedtls_md_free(&md);
+    mbedtls_platform_zeroize(buf, sizeof(buf));
+
+    return ret;
+}
+
+/* The validity window of a verified path: the intersection of the
+ * validity periods of its certificates, trusted CA included */
+typedef struct {
+    mbedtls_x509_time valid_from;
+    mbedtls_x509_time valid_to;
+    int is_set;
+} ssl_verify_cache_window;
+
+/* Return a negative value, 0 or a positive value if a is before, equal to
+ * or after b */
+static int ssl_verify_cache_time_cmp(const mbedtls_x509_time *a,
+                                     const mbedtls_x509_time *b)
+{
+    if (a->year != b->year) {
+        return a->year - b->year;
+    }
+    if (a->mon != b->mon) {
+        return a->mon - b->mon;
+    }
+    if (a->day != b->day) {
+        return a->day - b->day;
+    }
+    if (a->hour != b->hour) {
+        return a->hour - b->hour;
+    }
+    if (a->min != b->min) {
+        return a->min - b->min;
+    }
+    return a->sec - b->sec;
+}
+
+/* Verification callback narrowing the window to each certificate on the
+ * verified path. It leaves the flags alone. */
+static int ssl_verify_cache_window_cb(void *data, mbedtls_x509_crt *crt,
+                                      int depth, uint32_t *flags)
+{
+    ssl_verify_cache_window *window = data;
+
+    (void) depth;
+    (void) flags;
+
+    if (!window->is_set ||
+        ssl_verify_cache_time_cmp(&crt->valid_from, &window->valid_from) > 0) {
+        window->valid_from = crt->valid_from;
+    }
+    if (!window->is_set ||
+        ssl_verify_cache_time_cmp(&crt->valid_to, &window->valid_to) < 0) {
+        window->valid_to = crt->valid_to;
+    }
+    window->is_set = 1;
+
+    return 0;
+}
+
+#if defined(MBEDTLS_HAVE_TIME_DATE)
+/* The cache doesn't know the time: check the validity periods again */
+static int ssl_verify_cache_hit_in_time(const ssl_verify_cache_window *window,
+                                        const mbedtls_x509_crl *ca_crl)
+{
+    const mbedtls_x509_crl *crl;
+
+    if (mbedtls_x509_time_is_past(&window->valid_to) ||
+        mbedtls_x509_time_is_future(&window->valid_from)) {
+        return 0;
+    }
+
+    for (crl = ca_crl; crl != NULL && crl->version != 0; crl = crl->next) {
+        if (mbedtls_x509_time_is_past(&crl->next_update)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+#endif /* MBEDTLS_HAVE_TIME_DATE */
+
+int mbedtls_ssl_verify_peer_chain(mbedtls_ssl_context *ssl,
+                                  mbedtls_x509_crt *chain,
+                                  mbedtls_x509_crt *ca_chain,
+                                  mbedtls_x509_crl *ca_crl,
+                                  int (*f_vrfy)(void *, mbedtls_x509_crt *, int,
+                                                uint32_t *),
+                                  void *p_vrfy,
+                                  uint32_t *flags,
+                                  mbedtls_x509_crt_restart_ctx *rs_ctx)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char key[MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN];
+    ssl_verify_cache_window window;
+    int use_cache = 0;
+
+    memset(&window, 0, sizeof(window));
+
+    /* A verification callback must see every chain */
+    if (ssl->conf->f_get_verify_cache != NULL && f_vrfy == NULL &&
+        ssl_verify_cache_key(ssl, chain, ca_chain, ca_crl, key) == 0) {
+        use_cache = 1;
+
+        if (ssl->conf->f_get_verify_cache(ssl->conf->p_verify_cache,
+                                          key, sizeof(key),
+                                          &window.valid_from,
+                                          &window.valid_to) == 0
+#if defined(MBEDTLS_HAVE_TIME_DATE)
+            && ssl_verify_cache_hit_in_time(&window, ca_crl)
+#endif
+            ) {
+            MBEDTLS_SSL_DEBUG_MSG(3, ("peer certificate chain found in verify cache"));
+            *flags = 0;
+            return 0;
+        }
+
+        /* Collect the validity window of the path that gets verified */
+        memset(&window, 0, sizeof(window));
+        f_vrfy = ssl_verify_cache_window_cb;
+        p_vrfy = &window;
+    }
+
+    ret = mbedtls_x509_crt_verify_restartable(chain, ca_chain, ca_crl,
+                                              ssl->conf->cert_profile,
+                                              ssl->hostname, flags,
+                                              f_vrfy, p_vrfy, rs_ctx);
+
+    if (use_cache && ret == 0 && *flags == 0 && window.is_set &&
+        ssl->conf->f_set_verify_cache != NULL) {
+        if (ssl->conf->f_set_verify_cache(ssl->conf->p_verify_cache,
+                                          key, sizeof(key),
+                                          &window.valid_from,
+                                          &window.valid_to) != 0) {
+            MBEDTLS_SSL_DEBUG_MSG(1, ("cannot add peer certificate chain to verify cache"));
+        }
+    }
+
+    return ret;
+}
 #endif /* MBEDTLS_X509_CRT_PARSE_C */
 
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+/* Hash the buffered messages, before the ciphersuite is known: for TLS 1.3
+ * PSK binders and early secrets. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_get_buffered_transcript(mbedtls_ssl_context *ssl,
+                                       const mbedtls_md_type_t md,
+                                       unsigned char *dst,
+                                       size_t dst_len,
+                                       size_t *olen)
+{
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    psa_status_t status;
+
+    status = psa_hash_compute(mbedtls_hash_info_psa_from_md(md),
+                              ssl->handshake->transcript_buf,
+                              ssl->handshake->transcript_len,
+                              dst, dst_len, olen);
+    return PSA_TO_MBEDTLS_ERR(status);
+#else
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(md);
+
+    if (md_info == NULL || dst_len < mbedtls_md_get_size(md_info)) {
+        return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
+    }
+
+    ret = mbedtls_md(md_info, ssl->handshake->transcript_buf,
+                     ssl->handshake->transcript_len, dst);
+    if (ret != 0) {
+        return ret;
+    }
+
+    *olen = mbedtls_md_get_size(md_info);
+    return 0;
+#endif /* MBEDTLS_USE_PSA_CRYPTO */
+}
+#endif /* SHA-256 or SHA-384 */
+
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
 int mbedtls_ssl_get_handshake_transcript(mbedtls_ssl_context *ssl,
                                          const mbedtls_md_type_t md,
@@ -5771,6 +7031,13 @@ int mbedtls_ssl_get_handshake_transcript(mbedtls_ssl_context *ssl,
 
     *olen = 0;
 
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    if (ssl->handshake->update_checksum == ssl_update_checksum_start) {
+        return ssl_get_buffered_transcript(ssl, md, dst, dst_len, olen);
+    }
+#endif
+
     switch (md) {
 #if defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
         case MBEDTLS_MD_SHA384:
@@ -5889,6 +7156,13 @@ int mbedtls_ssl_get_handshake_transcript(mbedtls_ssl_context *ssl,
                                          size_t dst_len,
                                          size_t *olen)
 {
+#if defined(MBEDTLS_HAS_ALG_SHA_256_VIA_MD_OR_PSA_BASED_ON_USE_PSA) || \
+    defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
+    if (ssl->handshake->update_checksum == ssl_update_checksum_start) {
+        return ssl_get_buffered_transcript(ssl, md, dst, dst_len, olen);
+    }
+#endif
+
     switch (md) {
 
 #if defined(MBEDTLS_HAS_ALG_SHA_384_VIA_MD_OR_PSA_BASED_ON_USE_PSA)
@@ -6957,6 +8231,9 @@ int mbedtls_ssl_write_certificate(mbedtls_ssl_context *ssl)
     int ret = MBEDTLS_ERR_SSL_FEATURE_UNAVAILABLE;
     size_t i, n;
     const mbedtls_x509_crt *crt;
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+    const mbedtls_ssl_key_cert *key_cert;
+#endif
     const mbedtls_ssl_ciphersuite_t *ciphersuite_info =
         ssl->handshake->ciphersuite_info;
 
@@ -7001,6 +8278,24 @@ int mbedtls_ssl_write_certificate(mbedtls_ssl_context *ssl)
     i = 7;
     crt = mbedtls_ssl_own_cert(ssl);
 
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+    key_cert = mbedtls_ssl_own_key_cert(ssl);
+    if (key_cert != NULL && key_cert->chain_tls12 != NULL) {
+        /* Serialized by mbedtls_ssl_conf_own_cert() */
+        n = key_cert->chain_tls12_len;
+        if (n > MBEDTLS_SSL_OUT_CONTENT_LEN - i) {
+            MBEDTLS_SSL_DEBUG_MSG(1, ("certificate too large, %" MBEDTLS_PRINTF_SIZET
+                                      " > %" MBEDTLS_PRINTF_SIZET,
+                                      i + n, (size_t) MBEDTLS_SSL_OUT_CONTENT_LEN));
+            return MBEDTLS_ERR_SSL_BUFFER_TOO_SMALL;
+        }
+
+        memcpy(ssl->out_msg + i, key_cert->chain_tls12, n);
+        i += n;
+        crt = NULL;
+    }
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE */
+
     while (crt != NULL) {
         n = crt->raw.len;
         if (n > MBEDTLS_SSL_OUT_CONTENT_LEN - 3 - i) {
@@ -7365,13 +8660,12 @@ static int ssl_parse_certificate_verify(mbedtls_ssl_context *ssl,
             have_ca_chain = 1;
         }
 
-        ret = mbedtls_x509_crt_verify_restartable(
-            chain,
+        ret = mbedtls_ssl_verify_peer_chain(
+            ssl, chain,
             ca_chain, ca_crl,
-            ssl->conf->cert_profile,
-            ssl->hostname,
+            f_vrfy, p_vrfy,
             &ssl->session_negotiate->verify_result,
-            f_vrfy, p_vrfy, rs_ctx);
+            rs_ctx);
     }
 
     if (ret != 0) {
@@ -8537,6 +9831,14 @@ static int ssl_tls12_populate_transform(mbedtls_ssl_transform *transform,
         goto end;
     }
 
+#if defined(MBEDTLS_SSL_KTLS)
+    if (keylen <= sizeof(transform->ktls_key_enc)) {
+        memcpy(transform->ktls_key_enc, key1, keylen);
+        memcpy(transform->ktls_key_dec, key2, keylen);
+        transform->ktls_keylen = keylen;
+    }
+#endif
+
     if (ssl != NULL && ssl->f_export_keys != NULL) {
         ssl->f_export_keys(ssl->p_export_keys,
                            MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET,
@@ -8595,6 +9897,14 @@ static int ssl_tls12_populate_transform(mbedtls_ssl_transform *transform,
         goto end;
     }
 
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    if ((ret = mbedtls_ssl_transform_setup_enc_lanes(transform, cipher_info,
+                                                     key1)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_transform_setup_enc_lanes", ret);
+        goto end;
+    }
+#endif
+
     if ((ret = mbedtls_cipher_setkey(&transform->cipher_ctx_dec, key2,
                                      (int) mbedtls_cipher_info_get_key_bitlen(cipher_info),
                                      MBEDTLS_DECRYPT)) != 0) {
@@ -9692,4 +11002,34 @@ int mbedtls_ssl_session_set_hostname(mbedtls_ssl_session *session,
           MBEDTLS_SSL_SERVER_NAME_INDICATION &&
           MBEDTLS_SSL_CLI_C */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA) && defined(MBEDTLS_SSL_ALPN) && \
+    defined(MBEDTLS_SSL_SRV_C)
+int mbedtls_ssl_session_set_ticket_alpn(mbedtls_ssl_session *session,
+                                        const char *alpn)
+{
+    size_t alpn_len = 0;
+
+    if (alpn != NULL) {
+        alpn_len = strlen(alpn);
+
+        if (alpn_len > MBEDTLS_SSL_MAX_ALPN_NAME_LEN) {
+            return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+        }
+    }
+
+    mbedtls_free(session->ticket_alpn);
+    session->ticket_alpn = NULL;
+
+    if (alpn != NULL) {
+        session->ticket_alpn = mbedtls_calloc(alpn_len + 1, 1);
+        if (session->ticket_alpn == NULL) {
+            return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+        }
+        memcpy(session->ticket_alpn, alpn, alpn_len);
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_EARLY_DATA && MBEDTLS_SSL_ALPN && MBEDTLS_SSL_SRV_C */
+
 #endif /* MBEDTLS_SSL_TLS_C */
@@ -1356,7 +1356,11 @@ static int ssl_parse_server_hello(mbedtls_ssl_context *ssl)
         return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
     }
 
-    mbedtls_ssl_optimize_checksum(ssl, ssl->handshake->ciphersuite_info);
+    ret = mbedtls_ssl_optimize_checksum(ssl, ssl->handshake->ciphersuite_info);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_optimize_checksum", ret);
+        return ret;
+    }
 
     MBEDTLS_SSL_DEBUG_MSG(3, ("server hello, session id len.: %" MBEDTLS_PRINTF_SIZET, n));
     MBEDTLS_SSL_DEBUG_BUF(3,   "server hello, session id", buf + 35, n);
@@ -2708,6 +2712,25 @@ static int ssl_write_client_key_exchange(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> write client key exchange"));
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) &&                \
+    (defined(MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED) ||  \
+    defined(MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED))
+    if (ssl->handshake->async_in_progress != 0) {
+        /* The message is already written and the ECDHE shared secret is
+         * being computed asynchronously: resume the computation. */
+        header_len = 4;
+        content_len = ssl->out_msglen - header_len;
+
+        ret = mbedtls_ssl_async_key_agreement(ssl, ssl->handshake->premaster,
+                                              sizeof(ssl->handshake->premaster),
+                                              &ssl->handshake->pmslen);
+        if (ret != 0) {
+            return ret;
+        }
+        goto write_msg;
+    }
+#endif
+
 #if defined(MBEDTLS_KEY_EXCHANGE_DHE_RSA_ENABLED)
     if (ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_DHE_RSA) {
         /*
@@ -2773,7 +2796,8 @@ static int ssl_write_client_key_exchange(mbedtls_ssl_context *ssl)
          * For the time being, we therefore need to split the computation
          * of the ECDH secret and the application of the TLS 1.2 PRF. */
         key_attributes = psa_key_attributes_init();
-        psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+        psa_set_key_usage_flags(&key_attributes,
+                                mbedtls_ssl_ecdh_psa_key_usage(ssl));
         psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
         psa_set_key_type(&key_attributes, handshake->ecdh_psa_type);
         psa_set_key_bits(&key_attributes, handshake->ecdh_bits);
@@ -2807,20 +2831,36 @@ static int ssl_write_client_key_exchange(mbedtls_ssl_context *ssl)
 
         /* The ECDH secret is the premaster secret used for key derivation. */
 
-        /* Compute ECDH shared secret. */
-        status = psa_raw_key_agreement(PSA_ALG_ECDH,
-                                       handshake->ecdh_psa_privkey,
-                                       handshake->ecdh_psa_peerkey,
-                                       handshake->ecdh_psa_peerkey_len,
-                                       ssl->handshake->premaster,
-                                       sizeof(ssl->handshake->premaster),
-                                       &ssl->handshake->pmslen);
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        ret = mbedtls_ssl_async_key_agreement(ssl, ssl->handshake->premaster,
+                                              sizeof(ssl->handshake->premaster),
+                                              &ssl->handshake->pmslen);
+        if (ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+            /* Keep the message until the operation is resumed. */
+            ssl->out_msglen = header_len + content_len;
+            return ret;
+        }
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
+            return ret;
+        }
+        if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH)
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+        {
+            /* Compute ECDH shared secret. */
+            status = psa_raw_key_agreement(PSA_ALG_ECDH,
+                                           handshake->ecdh_psa_privkey,
+                                           handshake->ecdh_psa_peerkey,
+                                           handshake->ecdh_psa_peerkey_len,
+                                           ssl->handshake->premaster,
+                                           sizeof(ssl->handshake->premaster),
+                                           &ssl->handshake->pmslen);
 
-        destruction_status = psa_destroy_key(handshake->ecdh_psa_privkey);
-        handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
+            destruction_status = psa_destroy_key(handshake->ecdh_psa_privkey);
+            handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
 
-        if (status != PSA_SUCCESS || destruction_status != PSA_SUCCESS) {
-            return MBEDTLS_ERR_SSL_HW_ACCEL_FAILED;
+            if (status != PSA_SUCCESS || destruction_status != PSA_SUCCESS) {
+                return MBEDTLS_ERR_SSL_HW_ACCEL_FAILED;
+            }
         }
 #else
         /*
@@ -2866,22 +2906,38 @@ ecdh_calc_secret:
             content_len = ssl->handshake->ecrs_n;
         }
 #endif
-        if ((ret = mbedtls_ecdh_calc_secret(&ssl->handshake->ecdh_ctx,
-                                            &ssl->handshake->pmslen,
-                                            ssl->handshake->premaster,
-                                            MBEDTLS_MPI_MAX_SIZE,
-                                            ssl->conf->f_rng, ssl->conf->p_rng)) != 0) {
-            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ecdh_calc_secret", ret);
-#if defined(MBEDTLS_SSL_ECP_RESTARTABLE_ENABLED)
-            if (ret == MBEDTLS_ERR_ECP_IN_PROGRESS) {
-                ret = MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS;
-            }
-#endif
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        ret = mbedtls_ssl_async_key_agreement(ssl, ssl->handshake->premaster,
+                                              sizeof(ssl->handshake->premaster),
+                                              &ssl->handshake->pmslen);
+        if (ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+            /* Keep the message until the operation is resumed. */
+            ssl->out_msglen = header_len + content_len;
             return ret;
         }
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
+            return ret;
+        }
+        if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH)
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+        {
+            if ((ret = mbedtls_ecdh_calc_secret(&ssl->handshake->ecdh_ctx,
+                                                &ssl->handshake->pmslen,
+                                                ssl->handshake->premaster,
+                                                MBEDTLS_MPI_MAX_SIZE,
+                                                ssl->conf->f_rng, ssl->conf->p_rng)) != 0) {
+                MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ecdh_calc_secret", ret);
+    #if defined(MBEDTLS_SSL_ECP_RESTARTABLE_ENABLED)
+                if (ret == MBEDTLS_ERR_ECP_IN_PROGRESS) {
+                    ret = MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS;
+                }
+    #endif
+                return ret;
+            }
 
-        MBEDTLS_SSL_DEBUG_ECDH(3, &ssl->handshake->ecdh_ctx,
-                               MBEDTLS_DEBUG_ECDH_Z);
+            MBEDTLS_SSL_DEBUG_ECDH(3, &ssl->handshake->ecdh_ctx,
+                                   MBEDTLS_DEBUG_ECDH_Z);
+        }
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
     } else
 #endif /* MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED ||
@@ -3189,6 +3245,11 @@ ecdh_calc_secret:
         return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) &&                \
+    (defined(MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED) ||  \
+    defined(MBEDTLS_KEY_EXCHANGE_ECDHE_ECDSA_ENABLED))
+write_msg:
+#endif
     ssl->out_msglen  = header_len + content_len;
     ssl->out_msgtype = MBEDTLS_SSL_MSG_HANDSHAKE;
     ssl->out_msg[0]  = MBEDTLS_SSL_HS_CLIENT_KEY_EXCHANGE;
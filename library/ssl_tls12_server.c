@@ -889,7 +889,7 @@ static int ssl_ciphersuite_match(mbedtls_ssl_context *ssl, int suite_id,
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_parse_client_hello(mbedtls_ssl_context *ssl)
 {
-    int ret, got_common_suite;
+    int ret, got_common_suite, authmode;
     size_t i, j;
     size_t ciph_offset, comp_offset, ext_offset;
     size_t msg_len, ciph_len, sess_len, comp_len, ext_len;
@@ -1019,7 +1019,13 @@ read_record_header:
             ssl->next_record_offset = msg_len + mbedtls_ssl_in_hdr_len(ssl);
         } else
 #endif
-        ssl->in_left = 0;
+        {
+#if defined(MBEDTLS_SSL_RECORD_BATCHING)
+            mbedtls_ssl_keep_read_ahead(ssl,
+                                        mbedtls_ssl_in_hdr_len(ssl) + msg_len);
+#endif
+            ssl->in_left = 0;
+        }
     }
 
     buf = ssl->in_msg;
@@ -1653,6 +1659,26 @@ have_ciphersuite:
     ssl->session_negotiate->ciphersuite = ciphersuites[i];
     ssl->handshake->ciphersuite_info = ciphersuite_info;
 
+    /* The client may sign its CertificateVerify with another hash than the
+     * one of the ciphersuite: compute them all if we may request it. */
+#if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION)
+    if (ssl->handshake->sni_authmode != MBEDTLS_SSL_VERIFY_UNSET) {
+        authmode = ssl->handshake->sni_authmode;
+    } else
+#endif
+    authmode = ssl->conf->authmode;
+
+    if (authmode != MBEDTLS_SSL_VERIFY_NONE &&
+        mbedtls_ssl_ciphersuite_cert_req_allowed(ciphersuite_info)) {
+        ret = mbedtls_ssl_keep_all_checksums(ssl);
+    } else {
+        ret = mbedtls_ssl_optimize_checksum(ssl, ciphersuite_info);
+    }
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_optimize_checksum", ret);
+        return ret;
+    }
+
     ssl->state++;
 
 #if defined(MBEDTLS_SSL_PROTO_DTLS)
@@ -2939,7 +2965,8 @@ curve_matching_done:
         handshake->ecdh_bits = ec_bits;
 
         key_attributes = psa_key_attributes_init();
-        psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+        psa_set_key_usage_flags(&key_attributes,
+                                mbedtls_ssl_ecdh_psa_key_usage(ssl));
         psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
         psa_set_key_type(&key_attributes, handshake->ecdh_psa_type);
         psa_set_key_bits(&key_attributes, handshake->ecdh_bits);
@@ -3599,16 +3626,12 @@ static int ssl_parse_client_key_exchange(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> parse client key exchange"));
 
-#if defined(MBEDTLS_SSL_ASYNC_PRIVATE) && \
-    (defined(MBEDTLS_KEY_EXCHANGE_RSA_ENABLED) || \
-    defined(MBEDTLS_KEY_EXCHANGE_RSA_PSK_ENABLED))
-    if ((ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_RSA_PSK ||
-         ciphersuite_info->key_exchange == MBEDTLS_KEY_EXCHANGE_RSA) &&
-        (ssl->handshake->async_in_progress != 0)) {
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if (ssl->handshake->async_in_progress != 0) {
         /* We've already read a record and there is an asynchronous
-         * operation in progress to decrypt it. So skip reading the
-         * record. */
-        MBEDTLS_SSL_DEBUG_MSG(3, ("will resume decryption of previously-read record"));
+         * operation in progress to decrypt it (RSA, RSA-PSK) or to
+         * compute the ECDHE shared secret. So skip reading the record. */
+        MBEDTLS_SSL_DEBUG_MSG(3, ("will resume processing of previously-read record"));
     } else
 #endif
     if ((ret = mbedtls_ssl_read_record(ssl, 1)) != 0) {
@@ -3686,32 +3709,43 @@ static int ssl_parse_client_key_exchange(mbedtls_ssl_context *ssl)
         memcpy(handshake->ecdh_psa_peerkey, p, data_len);
         handshake->ecdh_psa_peerkey_len = data_len;
 
-        /* Compute ECDH shared secret. */
-        status = psa_raw_key_agreement(
-            PSA_ALG_ECDH, handshake->ecdh_psa_privkey,
-            handshake->ecdh_psa_peerkey, handshake->ecdh_psa_peerkey_len,
-            handshake->premaster, sizeof(handshake->premaster),
-            &handshake->pmslen);
-        if (status != PSA_SUCCESS) {
-            ret = PSA_TO_MBEDTLS_ERR(status);
-            MBEDTLS_SSL_DEBUG_RET(1, "psa_raw_key_agreement", ret);
-            if (handshake->ecdh_psa_privkey_is_external == 0) {
-                (void) psa_destroy_key(handshake->ecdh_psa_privkey);
-            }
-            handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        ret = mbedtls_ssl_async_key_agreement(ssl, handshake->premaster,
+                                              sizeof(handshake->premaster),
+                                              &handshake->pmslen);
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
             return ret;
         }
-
-        if (handshake->ecdh_psa_privkey_is_external == 0) {
-            status = psa_destroy_key(handshake->ecdh_psa_privkey);
-
+        if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH)
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+        {
+            /* Compute ECDH shared secret. */
+            status = psa_raw_key_agreement(
+                PSA_ALG_ECDH, handshake->ecdh_psa_privkey,
+                handshake->ecdh_psa_peerkey, handshake->ecdh_psa_peerkey_len,
+                handshake->premaster, sizeof(handshake->premaster),
+                &handshake->pmslen);
             if (status != PSA_SUCCESS) {
                 ret = PSA_TO_MBEDTLS_ERR(status);
-                MBEDTLS_SSL_DEBUG_RET(1, "psa_destroy_key", ret);
+                MBEDTLS_SSL_DEBUG_RET(1, "psa_raw_key_agreement", ret);
+                if (handshake->ecdh_psa_privkey_is_external == 0) {
+                    (void) psa_destroy_key(handshake->ecdh_psa_privkey);
+                }
+                handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
                 return ret;
             }
+
+            if (handshake->ecdh_psa_privkey_is_external == 0) {
+                status = psa_destroy_key(handshake->ecdh_psa_privkey);
+
+                if (status != PSA_SUCCESS) {
+                    ret = PSA_TO_MBEDTLS_ERR(status);
+                    MBEDTLS_SSL_DEBUG_RET(1, "psa_destroy_key", ret);
+                    return ret;
+                }
+            }
+            handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
         }
-        handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
 #else
         if ((ret = mbedtls_ecdh_read_public(&ssl->handshake->ecdh_ctx,
                                             p, end - p)) != 0) {
@@ -3722,17 +3756,28 @@ static int ssl_parse_client_key_exchange(mbedtls_ssl_context *ssl)
         MBEDTLS_SSL_DEBUG_ECDH(3, &ssl->handshake->ecdh_ctx,
                                MBEDTLS_DEBUG_ECDH_QP);
 
-        if ((ret = mbedtls_ecdh_calc_secret(&ssl->handshake->ecdh_ctx,
-                                            &ssl->handshake->pmslen,
-                                            ssl->handshake->premaster,
-                                            MBEDTLS_MPI_MAX_SIZE,
-                                            ssl->conf->f_rng, ssl->conf->p_rng)) != 0) {
-            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ecdh_calc_secret", ret);
-            return MBEDTLS_ERR_SSL_DECODE_ERROR;
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        ret = mbedtls_ssl_async_key_agreement(ssl, ssl->handshake->premaster,
+                                              sizeof(ssl->handshake->premaster),
+                                              &ssl->handshake->pmslen);
+        if (ret != 0 && ret != MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
+            return ret;
         }
+        if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH)
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+        {
+            if ((ret = mbedtls_ecdh_calc_secret(&ssl->handshake->ecdh_ctx,
+                                                &ssl->handshake->pmslen,
+                                                ssl->handshake->premaster,
+                                                MBEDTLS_MPI_MAX_SIZE,
+                                                ssl->conf->f_rng, ssl->conf->p_rng)) != 0) {
+                MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ecdh_calc_secret", ret);
+                return MBEDTLS_ERR_SSL_DECODE_ERROR;
+            }
 
-        MBEDTLS_SSL_DEBUG_ECDH(3, &ssl->handshake->ecdh_ctx,
-                               MBEDTLS_DEBUG_ECDH_Z);
+            MBEDTLS_SSL_DEBUG_ECDH(3, &ssl->handshake->ecdh_ctx,
+                                   MBEDTLS_DEBUG_ECDH_Z);
+        }
 #endif /* MBEDTLS_USE_PSA_CRYPTO */
     } else
 #endif /* MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED ||
@@ -694,6 +694,7 @@ static int ssl_tls13_early_data_has_valid_ticket(mbedtls_ssl_context *ssl)
            session->tls_version == MBEDTLS_SSL_VERSION_TLS1_3 &&
            (session->ticket_flags &
             MBEDTLS_SSL_TLS1_3_TICKET_ALLOW_EARLY_DATA) &&
+           session->max_early_data_size > 0 &&
            mbedtls_ssl_tls13_cipher_suite_is_offered(
         ssl, session->ciphersuite);
 }
@@ -1183,10 +1184,23 @@ int mbedtls_ssl_tls13_write_client_hello_exts(mbedtls_ssl_context *ssl,
     }
 #endif
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    ret = mbedtls_ssl_tls13_write_compress_certificate_ext(ssl, p, end,
+                                                           &ext_len);
+    if (ret != 0) {
+        return ret;
+    }
+    p += ext_len;
+#endif
+
 #if defined(MBEDTLS_SSL_EARLY_DATA)
-    if (mbedtls_ssl_conf_tls13_some_psk_enabled(ssl) &&
-        ssl_tls13_early_data_has_valid_ticket(ssl) &&
-        ssl->conf->early_data_enabled == MBEDTLS_SSL_EARLY_DATA_ENABLED) {
+    /* The second ClientHello, after a HelloRetryRequest, must not offer
+     * early data: the status of the first one is kept. */
+    if (ssl->handshake->hello_retry_request_count > 0) {
+        MBEDTLS_SSL_DEBUG_MSG(2, ("<= skip write early_data extension"));
+    } else if (mbedtls_ssl_conf_tls13_some_psk_enabled(ssl) &&
+               ssl_tls13_early_data_has_valid_ticket(ssl) &&
+               ssl->conf->early_data_enabled == MBEDTLS_SSL_EARLY_DATA_ENABLED) {
         ret = mbedtls_ssl_tls13_write_early_data_ext(ssl, p, end, &ext_len);
         if (ret != 0) {
             return ret;
@@ -1237,7 +1251,8 @@ int mbedtls_ssl_tls13_finalize_client_hello(mbedtls_ssl_context *ssl)
     size_t psk_len;
     const mbedtls_ssl_ciphersuite_t *ciphersuite_info;
 
-    if (ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_REJECTED) {
+    if (ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_REJECTED &&
+        ssl->handshake->hello_retry_request_count == 0) {
 #if defined(MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE)
         mbedtls_ssl_handshake_set_state(
             ssl, MBEDTLS_SSL_CLIENT_CCS_AFTER_CLIENT_HELLO);
@@ -1296,6 +1311,14 @@ int mbedtls_ssl_tls13_finalize_client_hello(mbedtls_ssl_context *ssl)
             return ret;
         }
 
+#if !defined(MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE)
+        /* Otherwise done after the ChangeCipherSpec that follows the
+         * ClientHello. */
+        MBEDTLS_SSL_DEBUG_MSG(
+            1, ("Switch to early data keys for outbound traffic"));
+        mbedtls_ssl_set_outbound_transform(
+            ssl, ssl->handshake->transform_earlydata);
+#endif
     }
 #endif /* MBEDTLS_SSL_EARLY_DATA */
     return 0;
@@ -1714,7 +1737,11 @@ static int ssl_tls13_parse_server_hello(mbedtls_ssl_context *ssl,
     }
 
     /* Configure ciphersuites */
-    mbedtls_ssl_optimize_checksum(ssl, ciphersuite_info);
+    ret = mbedtls_ssl_optimize_checksum(ssl, ciphersuite_info);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_optimize_checksum", ret);
+        goto cleanup;
+    }
 
     handshake->ciphersuite_info = ciphersuite_info;
     MBEDTLS_SSL_DEBUG_MSG(3, ("server hello, chosen ciphersuite: ( %04x ) - %s",
@@ -1875,6 +1902,32 @@ static const char *ssl_tls13_get_kex_mode_str(int mode)
 }
 #endif /* MBEDTLS_DEBUG_C */
 
+/* Compute the handshake keys and switch to them for inbound traffic.
+ * This may return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS when the shared secret
+ * is computed by the asynchronous key agreement callback: the caller then
+ * calls this function again. */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_finalize_server_hello(mbedtls_ssl_context *ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+
+    ret = mbedtls_ssl_tls13_compute_handshake_transform(ssl);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1,
+                              "mbedtls_ssl_tls13_compute_handshake_transform",
+                              ret);
+        return ret;
+    }
+
+    mbedtls_ssl_set_inbound_transform(ssl, handshake->transform_handshake);
+    MBEDTLS_SSL_DEBUG_MSG(1, ("Switch to handshake keys for inbound traffic"));
+    ssl->session_negotiate->ciphersuite = handshake->ciphersuite_info->id;
+    ssl->session_in = ssl->session_negotiate;
+
+    return 0;
+}
+
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_tls13_postprocess_server_hello(mbedtls_ssl_context *ssl)
 {
@@ -1979,21 +2032,10 @@ static int ssl_tls13_postprocess_server_hello(mbedtls_ssl_context *ssl)
         }
     }
 
-    ret = mbedtls_ssl_tls13_compute_handshake_transform(ssl);
-    if (ret != 0) {
-        MBEDTLS_SSL_DEBUG_RET(1,
-                              "mbedtls_ssl_tls13_compute_handshake_transform",
-                              ret);
-        goto cleanup;
-    }
-
-    mbedtls_ssl_set_inbound_transform(ssl, handshake->transform_handshake);
-    MBEDTLS_SSL_DEBUG_MSG(1, ("Switch to handshake keys for inbound traffic"));
-    ssl->session_negotiate->ciphersuite = handshake->ciphersuite_info->id;
-    ssl->session_in = ssl->session_negotiate;
+    ret = ssl_tls13_finalize_server_hello(ssl);
 
 cleanup:
-    if (ret != 0) {
+    if (ret != 0 && ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
         MBEDTLS_SSL_PEND_FATAL_ALERT(
             MBEDTLS_SSL_ALERT_MSG_HANDSHAKE_FAILURE,
             MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE);
@@ -2038,6 +2080,23 @@ static int ssl_tls13_process_server_hello(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> %s", __func__));
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    /* The ServerHello is already processed: resume the key agreement. */
+    if (ssl->handshake->async_in_progress != 0) {
+        ret = ssl_tls13_finalize_server_hello(ssl);
+        if (ret != 0) {
+            if (ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+                MBEDTLS_SSL_PEND_FATAL_ALERT(
+                    MBEDTLS_SSL_ALERT_MSG_HANDSHAKE_FAILURE,
+                    MBEDTLS_ERR_SSL_HANDSHAKE_FAILURE);
+            }
+            goto cleanup;
+        }
+        mbedtls_ssl_handshake_set_state(ssl, MBEDTLS_SSL_ENCRYPTED_EXTENSIONS);
+        goto cleanup;
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_tls13_fetch_handshake_msg(ssl,
                                                                MBEDTLS_SSL_HS_SERVER_HELLO,
                                                                &buf, &buf_len));
@@ -2417,6 +2476,19 @@ static int ssl_tls13_parse_certificate_request(mbedtls_ssl_context *ssl,
 
                 break;
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+            case MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE:
+                MBEDTLS_SSL_DEBUG_MSG(3,
+                                      ("found compress_certificate extension"));
+                ret = mbedtls_ssl_tls13_parse_compress_certificate_ext(
+                    ssl, p, p + extension_data_len);
+                if (ret != 0) {
+                    return ret;
+                }
+
+                break;
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
             default:
                 MBEDTLS_SSL_PRINT_EXT(
                     3, MBEDTLS_SSL_HS_CERTIFICATE_REQUEST,
@@ -2720,6 +2792,8 @@ static int ssl_tls13_parse_new_session_ticket_exts(mbedtls_ssl_context *ssl,
                 if (ssl->session != NULL) {
                     ssl->session->ticket_flags |=
                         MBEDTLS_SSL_TLS1_3_TICKET_ALLOW_EARLY_DATA;
+                    ssl->session->max_early_data_size =
+                        MBEDTLS_GET_UINT32_BE(p, 0);
                 }
                 break;
 #endif /* MBEDTLS_SSL_EARLY_DATA */
@@ -27,6 +27,7 @@
 #include "mbedtls/debug.h"
 #include "mbedtls/oid.h"
 #include "mbedtls/platform.h"
+#include "mbedtls/platform_util.h"
 #include "mbedtls/constant_time.h"
 #include "psa/crypto.h"
 #include "mbedtls/psa_util.h"
@@ -641,13 +642,11 @@ static int ssl_tls13_validate_certificate(mbedtls_ssl_context *ssl)
     /*
      * Main check: verify certificate
      */
-    ret = mbedtls_x509_crt_verify_with_profile(
-        ssl->session_negotiate->peer_cert,
+    ret = mbedtls_ssl_verify_peer_chain(
+        ssl, ssl->session_negotiate->peer_cert,
         ca_chain, ca_crl,
-        ssl->conf->cert_profile,
-        ssl->hostname,
-        &verify_result,
-        ssl->conf->f_vrfy, ssl->conf->p_vrfy);
+        ssl->conf->f_vrfy, ssl->conf->p_vrfy,
+        &verify_result, NULL);
 
     if (ret != 0) {
         MBEDTLS_SSL_DEBUG_RET(1, "x509_verify_cert", ret);
@@ -741,6 +740,89 @@ static int ssl_tls13_validate_certificate(mbedtls_ssl_context *ssl)
 #endif /* MBEDTLS_SSL_KEEP_PEER_CERTIFICATE */
 #endif /* MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED */
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/* mbedtls_ssl_tls13_parse_certificate() accepts up to 64K of certificates */
+#define SSL_TLS13_CERTIFICATE_MAX_LEN   (4 + 0xFFFF)
+
+/*
+ * struct {
+ *     CertificateCompressionAlgorithm algorithm;
+ *     uint24 uncompressed_length;
+ *     opaque compressed_certificate_message<1..2^24-1>;
+ * } CompressedCertificate;
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_decompress_certificate(mbedtls_ssl_context *ssl,
+                                            const unsigned char *buf,
+                                            const unsigned char *end,
+                                            unsigned char **msg,
+                                            size_t *msg_len)
+{
+    const unsigned char *p = buf;
+    const uint16_t *algs = ssl->conf->cert_compression_algs;
+    uint16_t algorithm;
+    size_t uncompressed_len, compressed_len, i;
+
+    MBEDTLS_SSL_CHK_BUF_READ_PTR(p, end, 8);
+    algorithm = MBEDTLS_GET_UINT16_BE(p, 0);
+    uncompressed_len = MBEDTLS_GET_UINT24_BE(p, 2);
+    compressed_len = MBEDTLS_GET_UINT24_BE(p, 5);
+    p += 8;
+
+    if (compressed_len == 0 || compressed_len != (size_t) (end - p)) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("bad CompressedCertificate message"));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_DECODE_ERROR,
+                                     MBEDTLS_ERR_SSL_DECODE_ERROR);
+        return MBEDTLS_ERR_SSL_DECODE_ERROR;
+    }
+
+    /* The algorithm must be one we offered */
+    for (i = 0; algs[i] != 0 && algs[i] != algorithm; i++) {
+        ;
+    }
+    if (algs[i] == 0) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("certificate compression algorithm %u not offered",
+                                  (unsigned) algorithm));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_ILLEGAL_PARAMETER,
+                                     MBEDTLS_ERR_SSL_ILLEGAL_PARAMETER);
+        return MBEDTLS_ERR_SSL_ILLEGAL_PARAMETER;
+    }
+
+    if (uncompressed_len == 0 ||
+        uncompressed_len > SSL_TLS13_CERTIFICATE_MAX_LEN) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("bad uncompressed certificate length %" MBEDTLS_PRINTF_SIZET,
+                                  uncompressed_len));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_BAD_CERT,
+                                     MBEDTLS_ERR_SSL_BAD_CERTIFICATE);
+        return MBEDTLS_ERR_SSL_BAD_CERTIFICATE;
+    }
+
+    *msg = mbedtls_calloc(1, uncompressed_len);
+    if (*msg == NULL) {
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_INTERNAL_ERROR,
+                                     MBEDTLS_ERR_SSL_ALLOC_FAILED);
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+
+    if (ssl->conf->f_cert_decompress(ssl->conf->p_cert_compression,
+                                     algorithm, p, compressed_len,
+                                     *msg, uncompressed_len) != 0) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("certificate decompression failed"));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_BAD_CERT,
+                                     MBEDTLS_ERR_SSL_BAD_CERTIFICATE);
+        return MBEDTLS_ERR_SSL_BAD_CERTIFICATE;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(3, ("certificate decompressed with algorithm %u: %"
+                              MBEDTLS_PRINTF_SIZET " -> %" MBEDTLS_PRINTF_SIZET " bytes",
+                              (unsigned) algorithm, compressed_len, uncompressed_len));
+
+    *msg_len = uncompressed_len;
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 int mbedtls_ssl_tls13_process_certificate(mbedtls_ssl_context *ssl)
 {
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
@@ -749,22 +831,53 @@ int mbedtls_ssl_tls13_process_certificate(mbedtls_ssl_context *ssl)
 #if defined(MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED)
     unsigned char *buf;
     size_t buf_len;
+    unsigned hs_type = MBEDTLS_SSL_HS_CERTIFICATE;
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    unsigned char *msg = NULL;
+    size_t msg_len = 0;
+
+    /* After our compress_certificate extension, the peer may send a
+     * CompressedCertificate instead of the Certificate. */
+    if (ssl->handshake->sent_extensions &
+        MBEDTLS_SSL_EXT_MASK(COMPRESS_CERTIFICATE)) {
+        if ((ret = mbedtls_ssl_read_record(ssl, 0)) != 0) {
+            MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_read_record", ret);
+            goto cleanup;
+        }
+        ssl->keep_current_message = 1;
+
+        if (ssl->in_msgtype == MBEDTLS_SSL_MSG_HANDSHAKE &&
+            ssl->in_msg[0] == MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE) {
+            hs_type = MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE;
+        }
+    }
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
 
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_tls13_fetch_handshake_msg(
-                             ssl, MBEDTLS_SSL_HS_CERTIFICATE,
-                             &buf, &buf_len));
+                             ssl, hs_type, &buf, &buf_len));
 
     /* Parse the certificate chain sent by the peer. */
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    if (hs_type == MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE) {
+        MBEDTLS_SSL_PROC_CHK(ssl_tls13_decompress_certificate(ssl, buf,
+                                                              buf + buf_len,
+                                                              &msg, &msg_len));
+        MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_tls13_parse_certificate(ssl, msg,
+                                                                 msg + msg_len));
+    } else
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_tls13_parse_certificate(ssl, buf,
                                                              buf + buf_len));
     /* Validate the certificate chain and set the verification results. */
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_validate_certificate(ssl));
 
-    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_add_hs_msg_to_checksum(ssl,
-                                                            MBEDTLS_SSL_HS_CERTIFICATE, buf,
-                                                            buf_len));
+    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_add_hs_msg_to_checksum(ssl, hs_type,
+                                                            buf, buf_len));
 
 cleanup:
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    mbedtls_free(msg);
+#endif
 #endif /* MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED */
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= parse certificate"));
@@ -808,6 +921,9 @@ static int ssl_tls13_write_certificate_body(mbedtls_ssl_context *ssl,
     unsigned char certificate_request_context_len =
         ssl->handshake->certificate_request_context_len;
     unsigned char *p_certificate_list_len;
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+    const mbedtls_ssl_key_cert *key_cert;
+#endif
 
 
     /* ...
@@ -831,6 +947,17 @@ static int ssl_tls13_write_certificate_body(mbedtls_ssl_context *ssl,
 
     MBEDTLS_SSL_DEBUG_CRT(3, "own certificate", crt);
 
+#if defined(MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE)
+    key_cert = mbedtls_ssl_own_key_cert(ssl);
+    if (key_cert != NULL && key_cert->chain_tls13 != NULL) {
+        /* Serialized by mbedtls_ssl_conf_own_cert() */
+        MBEDTLS_SSL_CHK_BUF_PTR(p, end, key_cert->chain_tls13_len);
+        memcpy(p, key_cert->chain_tls13, key_cert->chain_tls13_len);
+        p += key_cert->chain_tls13_len;
+        crt = NULL;
+    }
+#endif /* MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE */
+
     while (crt != NULL) {
         size_t cert_data_len = crt->raw.len;
 
@@ -860,26 +987,109 @@ static int ssl_tls13_write_certificate_body(mbedtls_ssl_context *ssl,
     return 0;
 }
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/*
+ * Find the Certificate message compressed by mbedtls_ssl_conf_own_cert() or
+ * mbedtls_ssl_conf_cert_compression() with the first configured algorithm
+ * the peer accepts, if any.
+ */
+static const mbedtls_ssl_compressed_cert *ssl_tls13_get_compressed_cert(
+    mbedtls_ssl_context *ssl, uint16_t *algorithm)
+{
+    const mbedtls_ssl_key_cert *key_cert = mbedtls_ssl_own_key_cert(ssl);
+    size_t i;
+
+    /* The messages were compressed with an empty request context */
+    if (key_cert == NULL ||
+        ssl->handshake->certificate_request_context_len != 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < key_cert->compressed_count; i++) {
+        if ((ssl->handshake->peer_cert_compression_algs & (1u << i)) != 0 &&
+            key_cert->compressed[i].data != NULL) {
+            *algorithm = ssl->conf->cert_compression_algs[i];
+            return &key_cert->compressed[i];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * struct {
+ *     CertificateCompressionAlgorithm algorithm;
+ *     uint24 uncompressed_length;
+ *     opaque compressed_certificate_message<1..2^24-1>;
+ * } CompressedCertificate;
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_write_compressed_certificate_body(
+    mbedtls_ssl_context *ssl,
+    const mbedtls_ssl_compressed_cert *compressed,
+    uint16_t algorithm,
+    unsigned char *buf,
+    unsigned char *end,
+    size_t *out_len)
+{
+    unsigned char *p = buf;
+
+    MBEDTLS_SSL_DEBUG_CRT(3, "own certificate", mbedtls_ssl_own_cert(ssl));
+
+    MBEDTLS_SSL_CHK_BUF_PTR(p, end, 8 + compressed->len);
+    MBEDTLS_PUT_UINT16_BE(algorithm, p, 0);
+    MBEDTLS_PUT_UINT24_BE(compressed->uncompressed_len, p, 2);
+    MBEDTLS_PUT_UINT24_BE(compressed->len, p, 5);
+    memcpy(p + 8, compressed->data, compressed->len);
+
+    *out_len = 8 + compressed->len;
+
+    MBEDTLS_SSL_DEBUG_MSG(3, ("certificate compressed with algorithm %u: %"
+                              MBEDTLS_PRINTF_SIZET " -> %" MBEDTLS_PRINTF_SIZET " bytes",
+                              (unsigned) algorithm, compressed->uncompressed_len,
+                              compressed->len));
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 int mbedtls_ssl_tls13_write_certificate(mbedtls_ssl_context *ssl)
 {
     int ret;
     unsigned char *buf;
     size_t buf_len, msg_len;
+    unsigned hs_type = MBEDTLS_SSL_HS_CERTIFICATE;
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    const mbedtls_ssl_compressed_cert *compressed;
+    uint16_t algorithm = 0;
+#endif
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> write certificate"));
 
-    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_start_handshake_msg(ssl,
-                                                         MBEDTLS_SSL_HS_CERTIFICATE, &buf,
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    compressed = ssl_tls13_get_compressed_cert(ssl, &algorithm);
+    if (compressed != NULL) {
+        hs_type = MBEDTLS_SSL_HS_COMPRESSED_CERTIFICATE;
+    }
+#endif
+
+    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_start_handshake_msg(ssl, hs_type, &buf,
                                                          &buf_len));
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    if (compressed != NULL) {
+        MBEDTLS_SSL_PROC_CHK(ssl_tls13_write_compressed_certificate_body(
+                                 ssl, compressed, algorithm,
+                                 buf, buf + buf_len, &msg_len));
+    } else
+#endif
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_write_certificate_body(ssl,
                                                           buf,
                                                           buf + buf_len,
                                                           &msg_len));
 
-    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_add_hs_msg_to_checksum(ssl,
-                                                            MBEDTLS_SSL_HS_CERTIFICATE, buf,
-                                                            msg_len));
+    MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_add_hs_msg_to_checksum(ssl, hs_type,
+                                                            buf, msg_len));
 
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_finish_handshake_msg(
                              ssl, buf_len, msg_len));
@@ -936,6 +1146,43 @@ int mbedtls_ssl_tls13_check_sig_alg_cert_key_match(uint16_t sig_alg,
     return 0;
 }
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_resume_certificate_verify(mbedtls_ssl_context *ssl,
+                                               unsigned char *buf,
+                                               unsigned char *end,
+                                               size_t *out_len)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    unsigned char *p = buf;
+    size_t signature_len = 0;
+
+    /* The signature algorithm was written at the start of the message
+     * body when the operation was started: append the signature after
+     * it, leaving 2 bytes for the signature length. */
+    ret = ssl->conf->f_async_resume(ssl, p + 4, &signature_len,
+                                    (size_t) (end - (p + 4)));
+    if (ret != MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+        ssl->handshake->async_in_progress = 0;
+        mbedtls_ssl_set_async_operation_data(ssl, NULL);
+    }
+    MBEDTLS_SSL_DEBUG_RET(2, "ssl_tls13_resume_certificate_verify", ret);
+    if (ret != 0) {
+        return ret;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("CertificateVerify signature with %s",
+                              mbedtls_ssl_sig_alg_to_str(
+                                  MBEDTLS_GET_UINT16_BE(p, 0))));
+
+    MBEDTLS_PUT_UINT16_BE(signature_len, p, 2);
+
+    *out_len = 4 + signature_len;
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
 MBEDTLS_CHECK_RETURN_CRITICAL
 static int ssl_tls13_write_certificate_verify_body(mbedtls_ssl_context *ssl,
                                                    unsigned char *buf,
@@ -945,6 +1192,7 @@ static int ssl_tls13_write_certificate_verify_body(mbedtls_ssl_context *ssl,
     int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
     unsigned char *p = buf;
     mbedtls_pk_context *own_key;
+    mbedtls_pk_context *own_pk;
 
     unsigned char handshake_hash[MBEDTLS_TLS1_3_MD_MAX_SIZE];
     size_t handshake_hash_len;
@@ -956,8 +1204,18 @@ static int ssl_tls13_write_certificate_verify_body(mbedtls_ssl_context *ssl,
 
     *out_len = 0;
 
+    /* With an asynchronous signature callback, the private key may be held
+     * outside the library: select the signature algorithm from the public
+     * key in the certificate then. */
     own_key = mbedtls_ssl_own_key(ssl);
-    if (own_key == NULL) {
+    own_pk = own_key;
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if (own_pk == NULL && ssl->conf->f_async_sign_start != NULL &&
+        mbedtls_ssl_own_cert(ssl) != NULL) {
+        own_pk = &mbedtls_ssl_own_cert(ssl)->pk;
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+    if (own_pk == NULL) {
         MBEDTLS_SSL_DEBUG_MSG(1, ("should never happen"));
         return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
@@ -1006,7 +1264,7 @@ static int ssl_tls13_write_certificate_verify_body(mbedtls_ssl_context *ssl,
             continue;
         }
 
-        if (!mbedtls_ssl_tls13_check_sig_alg_cert_key_match(*sig_alg, own_key)) {
+        if (!mbedtls_ssl_tls13_check_sig_alg_cert_key_match(*sig_alg, own_pk)) {
             continue;
         }
 
@@ -1028,6 +1286,37 @@ static int ssl_tls13_write_certificate_verify_body(mbedtls_ssl_context *ssl,
 
         MBEDTLS_SSL_DEBUG_BUF(3, "verify hash", verify_hash, verify_hash_len);
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+        if (ssl->conf->f_async_sign_start != NULL) {
+            ret = ssl->conf->f_async_sign_start(ssl,
+                                                mbedtls_ssl_own_cert(ssl),
+                                                md_alg, verify_hash,
+                                                verify_hash_len);
+            switch (ret) {
+                case MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH:
+                    /* act as if f_async_sign was null */
+                    break;
+                case 0:
+                    MBEDTLS_PUT_UINT16_BE(*sig_alg, p, 0);
+                    ssl->handshake->async_in_progress = 1;
+                    return ssl_tls13_resume_certificate_verify(ssl, buf, end,
+                                                               out_len);
+                case MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS:
+                    MBEDTLS_PUT_UINT16_BE(*sig_alg, p, 0);
+                    ssl->handshake->async_in_progress = 1;
+                    return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+                default:
+                    MBEDTLS_SSL_DEBUG_RET(1, "f_async_sign_start", ret);
+                    return ret;
+            }
+        }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+        if (own_key == NULL) {
+            MBEDTLS_SSL_DEBUG_MSG(1, ("got no private key"));
+            return MBEDTLS_ERR_SSL_PRIVATE_KEY_REQUIRED;
+        }
+
         if ((ret = mbedtls_pk_sign_ext(pk_type, own_key,
                                        md_alg, verify_hash, verify_hash_len,
                                        p + 4, (size_t) (end - (p + 4)), &signature_len,
@@ -1077,6 +1366,15 @@ int mbedtls_ssl_tls13_write_certificate_verify(mbedtls_ssl_context *ssl)
                                                          MBEDTLS_SSL_HS_CERTIFICATE_VERIFY, &buf,
                                                          &buf_len));
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    if (ssl->handshake->async_in_progress != 0) {
+        /* The message body up to the signature is still in the output
+         * buffer: just finish the signature. */
+        MBEDTLS_SSL_DEBUG_MSG(2, ("resuming signature operation"));
+        MBEDTLS_SSL_PROC_CHK(ssl_tls13_resume_certificate_verify(
+                                 ssl, buf, buf + buf_len, &msg_len));
+    } else
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_write_certificate_verify_body(
                              ssl, buf, buf + buf_len, &msg_len));
 
@@ -1480,11 +1778,36 @@ int mbedtls_ssl_tls13_generate_and_write_ecdh_key_exchange(
     ssl->handshake->ecdh_bits = ec_bits;
 
     key_attributes = psa_key_attributes_init();
-    psa_set_key_usage_flags(&key_attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_usage_flags(&key_attributes,
+                            mbedtls_ssl_ecdh_psa_key_usage(ssl));
     psa_set_key_algorithm(&key_attributes, PSA_ALG_ECDH);
     psa_set_key_type(&key_attributes, handshake->ecdh_psa_type);
     psa_set_key_bits(&key_attributes, handshake->ecdh_bits);
 
+    /* Take a precomputed key pair if one is available. */
+    if (ssl->conf->f_key_share_take != NULL) {
+        unsigned char priv[PSA_BITS_TO_BYTES(PSA_VENDOR_ECC_MAX_CURVE_BITS)];
+        size_t priv_len;
+
+        if (ssl->conf->f_key_share_take(ssl->conf->p_key_share, named_group,
+                                        priv, sizeof(priv), &priv_len,
+                                        buf, (size_t) (end - buf),
+                                        &own_pubkey_len) == 0) {
+            status = psa_import_key(&key_attributes, priv, priv_len,
+                                    &handshake->ecdh_psa_privkey);
+            mbedtls_platform_zeroize(priv, sizeof(priv));
+            if (status != PSA_SUCCESS) {
+                ret = PSA_TO_MBEDTLS_ERR(status);
+                MBEDTLS_SSL_DEBUG_RET(1, "psa_import_key", ret);
+                return ret;
+            }
+
+            MBEDTLS_SSL_DEBUG_MSG(3, ("precomputed key share"));
+            *out_len = own_pubkey_len;
+            return 0;
+        }
+    }
+
     /* Generate ECDH private key. */
     status = psa_generate_key(&key_attributes,
                               &handshake->ecdh_psa_privkey);
@@ -1567,6 +1890,98 @@ int mbedtls_ssl_tls13_check_received_extension(
     return MBEDTLS_ERR_SSL_UNSUPPORTED_EXTENSION;
 }
 
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+/* RFC 8879, section 3:
+ *
+ * struct {
+ *     CertificateCompressionAlgorithm algorithms<2..2^8-2>;
+ * } CertificateCompressionAlgorithms;
+ */
+int mbedtls_ssl_tls13_write_compress_certificate_ext(mbedtls_ssl_context *ssl,
+                                                     unsigned char *buf,
+                                                     const unsigned char *end,
+                                                     size_t *out_len)
+{
+    unsigned char *p = buf;
+    const uint16_t *algs = ssl->conf->cert_compression_algs;
+    size_t count = 0;
+
+    *out_len = 0;
+
+    if (ssl->conf->f_cert_decompress == NULL || algs == NULL) {
+        return 0;
+    }
+
+    while (algs[count] != 0) {
+        count++;
+    }
+
+    if (count == 0) {
+        return 0;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(3, ("adding compress_certificate extension"));
+
+    MBEDTLS_SSL_CHK_BUF_PTR(p, end, 5 + 2 * count);
+    MBEDTLS_PUT_UINT16_BE(MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE, p, 0);
+    MBEDTLS_PUT_UINT16_BE(1 + 2 * count, p, 2);
+    p[4] = (unsigned char) (2 * count);
+    p += 5;
+
+    for (; *algs != 0; algs++) {
+        MBEDTLS_PUT_UINT16_BE(*algs, p, 0);
+        p += 2;
+    }
+
+    *out_len = p - buf;
+
+    mbedtls_ssl_tls13_set_hs_sent_ext_mask(ssl, MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE);
+
+    return 0;
+}
+
+int mbedtls_ssl_tls13_parse_compress_certificate_ext(mbedtls_ssl_context *ssl,
+                                                     const unsigned char *buf,
+                                                     const unsigned char *end)
+{
+    const unsigned char *p = buf;
+    const uint16_t *algs = ssl->conf->cert_compression_algs;
+    size_t list_len, i;
+    uint16_t algorithm;
+
+    MBEDTLS_SSL_CHK_BUF_READ_PTR(p, end, 1);
+    list_len = p[0];
+    p += 1;
+
+    if (list_len < 2 || list_len % 2 != 0 || list_len != (size_t) (end - p)) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("bad compress_certificate extension"));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_DECODE_ERROR,
+                                     MBEDTLS_ERR_SSL_DECODE_ERROR);
+        return MBEDTLS_ERR_SSL_DECODE_ERROR;
+    }
+
+    ssl->handshake->peer_cert_compression_algs = 0;
+
+    if (ssl->conf->f_cert_compress == NULL || algs == NULL) {
+        return 0;
+    }
+
+    for (; p < end; p += 2) {
+        algorithm = MBEDTLS_GET_UINT16_BE(p, 0);
+        MBEDTLS_SSL_DEBUG_MSG(3, ("peer accepts certificate compression algorithm %u",
+                                  (unsigned) algorithm));
+
+        for (i = 0; algs[i] != 0; i++) {
+            if (algs[i] == algorithm) {
+                ssl->handshake->peer_cert_compression_algs |= 1u << i;
+            }
+        }
+    }
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_SSL_RECORD_SIZE_LIMIT)
 /* RFC 8449, section 4:
  *
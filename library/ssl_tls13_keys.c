@@ -997,6 +997,14 @@ int mbedtls_ssl_tls13_populate_transform(mbedtls_ssl_transform *transform,
     memcpy(transform->iv_enc, iv_enc, traffic_keys->iv_len);
     memcpy(transform->iv_dec, iv_dec, traffic_keys->iv_len);
 
+#if defined(MBEDTLS_SSL_KTLS)
+    if (traffic_keys->key_len <= sizeof(transform->ktls_key_enc)) {
+        memcpy(transform->ktls_key_enc, key_enc, traffic_keys->key_len);
+        memcpy(transform->ktls_key_dec, key_dec, traffic_keys->key_len);
+        transform->ktls_keylen = traffic_keys->key_len;
+    }
+#endif
+
 #if !defined(MBEDTLS_USE_PSA_CRYPTO)
     if ((ret = mbedtls_cipher_setkey(&transform->cipher_ctx_enc,
                                      key_enc, cipher_info->key_bitlen,
@@ -1005,6 +1013,14 @@ int mbedtls_ssl_tls13_populate_transform(mbedtls_ssl_transform *transform,
         return ret;
     }
 
+#if defined(MBEDTLS_SSL_PARALLEL_ENCRYPTION)
+    if ((ret = mbedtls_ssl_transform_setup_enc_lanes(transform, cipher_info,
+                                                     key_enc)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_transform_setup_enc_lanes", ret);
+        return ret;
+    }
+#endif
+
     if ((ret = mbedtls_cipher_setkey(&transform->cipher_ctx_dec,
                                      key_dec, cipher_info->key_bitlen,
                                      MBEDTLS_DECRYPT)) != 0) {
@@ -1224,6 +1240,10 @@ int mbedtls_ssl_tls13_compute_early_transform(mbedtls_ssl_context *ssl)
     mbedtls_ssl_transform *transform_earlydata = NULL;
     mbedtls_ssl_handshake_params *handshake = ssl->handshake;
 
+    /* Only the client write key is derived: clear the server one that
+     * mbedtls_ssl_tls13_populate_transform() also reads. */
+    memset(&traffic_keys, 0, sizeof(traffic_keys));
+
     /* Next evolution in key schedule: Establish early_data secret and
      * key material. */
     ret = ssl_tls13_generate_early_key(ssl, &traffic_keys);
@@ -1468,37 +1488,63 @@ static int ssl_tls13_key_schedule_stage_handshake(mbedtls_ssl_context *ssl)
             psa_status_t status = PSA_ERROR_GENERIC_ERROR;
             psa_key_attributes_t key_attributes = PSA_KEY_ATTRIBUTES_INIT;
 
-            status = psa_get_key_attributes(handshake->ecdh_psa_privkey,
-                                            &key_attributes);
-            if (status != PSA_SUCCESS) {
-                ret = PSA_TO_MBEDTLS_ERR(status);
-            }
-
-            shared_secret_len = PSA_BITS_TO_BYTES(
-                psa_get_key_bits(&key_attributes));
-            shared_secret = mbedtls_calloc(1, shared_secret_len);
-            if (shared_secret == NULL) {
-                return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            ret = MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH;
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+            if (handshake->async_in_progress != 0 ||
+                ssl->conf->f_async_key_agreement_start != NULL) {
+                shared_secret = mbedtls_calloc(
+                    1, PSA_RAW_KEY_AGREEMENT_OUTPUT_MAX_SIZE);
+                if (shared_secret == NULL) {
+                    return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+                }
+
+                ret = mbedtls_ssl_async_key_agreement(
+                    ssl, shared_secret, PSA_RAW_KEY_AGREEMENT_OUTPUT_MAX_SIZE,
+                    &shared_secret_len);
+                if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
+                    mbedtls_free(shared_secret);
+                    shared_secret = NULL;
+                } else if (ret != 0) {
+                    /* In progress or failed: wipe whatever was written. */
+                    shared_secret_len = PSA_RAW_KEY_AGREEMENT_OUTPUT_MAX_SIZE;
+                    goto cleanup;
+                }
             }
-
-            status = psa_raw_key_agreement(
-                PSA_ALG_ECDH, handshake->ecdh_psa_privkey,
-                handshake->ecdh_psa_peerkey, handshake->ecdh_psa_peerkey_len,
-                shared_secret, shared_secret_len, &shared_secret_len);
-            if (status != PSA_SUCCESS) {
-                ret = PSA_TO_MBEDTLS_ERR(status);
-                MBEDTLS_SSL_DEBUG_RET(1, "psa_raw_key_agreement", ret);
-                goto cleanup;
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
+            if (ret == MBEDTLS_ERR_SSL_HW_ACCEL_FALLTHROUGH) {
+                status = psa_get_key_attributes(handshake->ecdh_psa_privkey,
+                                                &key_attributes);
+                if (status != PSA_SUCCESS) {
+                    ret = PSA_TO_MBEDTLS_ERR(status);
+                }
+
+                shared_secret_len = PSA_BITS_TO_BYTES(
+                    psa_get_key_bits(&key_attributes));
+                shared_secret = mbedtls_calloc(1, shared_secret_len);
+                if (shared_secret == NULL) {
+                    return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+                }
+
+                status = psa_raw_key_agreement(
+                    PSA_ALG_ECDH, handshake->ecdh_psa_privkey,
+                    handshake->ecdh_psa_peerkey, handshake->ecdh_psa_peerkey_len,
+                    shared_secret, shared_secret_len, &shared_secret_len);
+                if (status != PSA_SUCCESS) {
+                    ret = PSA_TO_MBEDTLS_ERR(status);
+                    MBEDTLS_SSL_DEBUG_RET(1, "psa_raw_key_agreement", ret);
+                    goto cleanup;
+                }
+
+                status = psa_destroy_key(handshake->ecdh_psa_privkey);
+                if (status != PSA_SUCCESS) {
+                    ret = PSA_TO_MBEDTLS_ERR(status);
+                    MBEDTLS_SSL_DEBUG_RET(1, "psa_destroy_key", ret);
+                    goto cleanup;
+                }
+
+                handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
             }
-
-            status = psa_destroy_key(handshake->ecdh_psa_privkey);
-            if (status != PSA_SUCCESS) {
-                ret = PSA_TO_MBEDTLS_ERR(status);
-                MBEDTLS_SSL_DEBUG_RET(1, "psa_destroy_key", ret);
-                goto cleanup;
-            }
-
-            handshake->ecdh_psa_privkey = MBEDTLS_SVC_KEY_ID_INIT;
 #endif /* MBEDTLS_ECDH_C */
         } else {
             MBEDTLS_SSL_DEBUG_MSG(1, ("Group not supported."));
@@ -360,7 +360,8 @@ static int ssl_tls13_offered_psks_check_binder_match(mbedtls_ssl_context *ssl,
                           server_computed_binder, transcript_len);
     MBEDTLS_SSL_DEBUG_BUF(3, "psk binder ( received ): ", binder, binder_len);
 
-    if (mbedtls_ct_memcmp(server_computed_binder, binder, binder_len) == 0) {
+    if (binder_len == transcript_len &&
+        mbedtls_ct_memcmp(server_computed_binder, binder, binder_len) == 0) {
         return SSL_TLS1_3_OFFERED_PSK_MATCH;
     }
 
@@ -464,6 +465,16 @@ static int ssl_tls13_session_copy_ticket(mbedtls_ssl_session *dst,
         return MBEDTLS_ERR_SSL_INTERNAL_ERROR;
     }
     memcpy(dst->resumption_key, src->resumption_key, src->resumption_key_len);
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    dst->max_early_data_size = src->max_early_data_size;
+
+#if defined(MBEDTLS_SSL_ALPN)
+    int ret = mbedtls_ssl_session_set_ticket_alpn(dst, src->ticket_alpn);
+    if (ret != 0) {
+        return ret;
+    }
+#endif /* MBEDTLS_SSL_ALPN */
+#endif /* MBEDTLS_SSL_EARLY_DATA */
 
     return 0;
 }
@@ -630,6 +641,14 @@ static int ssl_tls13_parse_pre_shared_key_ext(mbedtls_ssl_context *ssl,
         }
 
         matched_identity = identity_id;
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+        /* Only the binder of the selected identity is verified: the other
+         * binders can be changed without the server noticing. */
+        if (binder_len <= sizeof(ssl->handshake->early_data_binder)) {
+            memcpy(ssl->handshake->early_data_binder, binder, binder_len);
+            ssl->handshake->early_data_binder_len = binder_len;
+        }
+#endif
 
         /* Update handshake parameters */
         ssl->handshake->ciphersuite_info = ciphersuite_info;
@@ -1609,6 +1628,32 @@ static int ssl_tls13_parse_client_hello(mbedtls_ssl_context *ssl,
                 break;
 #endif /* MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+            case MBEDTLS_TLS_EXT_EARLY_DATA:
+                MBEDTLS_SSL_DEBUG_MSG(3, ("found early_data extension"));
+
+                /* The early data indication of a ClientHello is empty. */
+                if (extension_data_len != 0) {
+                    MBEDTLS_SSL_PEND_FATAL_ALERT(
+                        MBEDTLS_SSL_ALERT_MSG_DECODE_ERROR,
+                        MBEDTLS_ERR_SSL_DECODE_ERROR);
+                    return MBEDTLS_ERR_SSL_DECODE_ERROR;
+                }
+                break;
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+            case MBEDTLS_TLS_EXT_COMPRESS_CERTIFICATE:
+                MBEDTLS_SSL_DEBUG_MSG(3, ("found compress_certificate extension"));
+
+                ret = mbedtls_ssl_tls13_parse_compress_certificate_ext(
+                    ssl, p, extension_data_end);
+                if (ret != 0) {
+                    return ret;
+                }
+                break;
+#endif /* MBEDTLS_SSL_CERT_COMPRESSION */
+
 #if defined(MBEDTLS_SSL_RECORD_SIZE_LIMIT)
             case MBEDTLS_TLS_EXT_RECORD_SIZE_LIMIT:
                 MBEDTLS_SSL_DEBUG_MSG(3, ("found record_size_limit extension"));
@@ -1685,7 +1730,11 @@ static int ssl_tls13_parse_client_hello(mbedtls_ssl_context *ssl,
         return ret;
     }
 
-    mbedtls_ssl_optimize_checksum(ssl, handshake->ciphersuite_info);
+    ret = mbedtls_ssl_optimize_checksum(ssl, handshake->ciphersuite_info);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_optimize_checksum", ret);
+        return ret;
+    }
 
     return hrr_required ? SSL_CLIENT_HELLO_HRR_REQUIRED : SSL_CLIENT_HELLO_OK;
 }
@@ -1720,6 +1769,124 @@ static int ssl_tls13_postprocess_client_hello(mbedtls_ssl_context *ssl)
 
 }
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+/*
+ * Check the conditions of RFC 8446 section 4.2.10 for accepting the early
+ * data offered by the client. Returns 0 if they are met.
+ */
+static int ssl_tls13_check_early_data_requirements(mbedtls_ssl_context *ssl)
+{
+    mbedtls_ssl_handshake_params *handshake = ssl->handshake;
+
+    if (ssl->conf->early_data_enabled == MBEDTLS_SSL_EARLY_DATA_DISABLED) {
+        MBEDTLS_SSL_DEBUG_MSG(2, ("EarlyData: rejected, feature disabled."));
+        return -1;
+    }
+
+    if (handshake->hello_retry_request_count > 0) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, HelloRetryRequest sent."));
+        return -1;
+    }
+
+    /* The PSK must be a ticket, the first one offered, and the
+     * ciphersuite of the ticket must have been selected: this is done
+     * by ssl_tls13_select_ciphersuite_for_resumption(). */
+    if (!mbedtls_ssl_tls13_key_exchange_mode_with_psk(ssl) ||
+        handshake->resume == 0 || handshake->selected_identity != 0) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, not resuming with the first ticket."));
+        return -1;
+    }
+
+    if ((ssl->session_negotiate->ticket_flags &
+         MBEDTLS_SSL_TLS1_3_TICKET_ALLOW_EARLY_DATA) == 0 ||
+        ssl->session_negotiate->max_early_data_size == 0) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, the ticket does not allow it."));
+        return -1;
+    }
+
+#if defined(MBEDTLS_SSL_ALPN)
+    const char *alpn = ssl->alpn_chosen;
+    const char *ticket_alpn = ssl->session_negotiate->ticket_alpn;
+    if ((alpn == NULL) != (ticket_alpn == NULL) ||
+        (alpn != NULL && strcmp(alpn, ticket_alpn) != 0)) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, ALPN differs from the ticket's."));
+        return -1;
+    }
+#endif /* MBEDTLS_SSL_ALPN */
+
+    if (ssl->conf->f_early_data_replay == NULL) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, no anti-replay callback."));
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Accept or reject the early data offered in the ClientHello.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_process_early_data_offer(mbedtls_ssl_context *ssl,
+                                              int hrr_required)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    ssl->early_data_status = MBEDTLS_SSL_EARLY_DATA_STATUS_REJECTED;
+
+    /* The early data records preceding the second ClientHello are sent
+     * with the early keys the server will not compute. */
+    if (hrr_required) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            2, ("EarlyData: rejected, HelloRetryRequest required."));
+        ssl->discard_early_data_record = MBEDTLS_SSL_EARLY_DATA_DISCARD;
+        return 0;
+    }
+
+    ssl->discard_early_data_record =
+        MBEDTLS_SSL_EARLY_DATA_TRY_TO_DEPROTECT_AND_DISCARD;
+    if (ssl_tls13_check_early_data_requirements(ssl) != 0) {
+        return 0;
+    }
+
+    /* RFC 8446 section 8.2: record the ClientHello, so that a replay of
+     * it is not accepted with early data again. A hash of the whole message
+     * would not do: it covers the binders of the identities the server
+     * did not select, which an attacker can change freely. The binder of
+     * the selected identity is verified, and is a MAC of the ClientHello
+     * up to the binders. */
+    if (ssl->handshake->early_data_binder_len == 0) {
+        MBEDTLS_SSL_DEBUG_MSG(2, ("EarlyData: rejected, no verified binder."));
+        return 0;
+    }
+
+    ret = ssl->conf->f_early_data_replay(ssl->conf->p_early_data_replay,
+                                         ssl->handshake->early_data_binder,
+                                         ssl->handshake->early_data_binder_len);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(2, "EarlyData: rejected, possible replay", ret);
+        return 0;
+    }
+
+    ret = mbedtls_ssl_tls13_compute_early_transform(ssl);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(
+            1, "mbedtls_ssl_tls13_compute_early_transform", ret);
+        return ret;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("EarlyData: accepted."));
+    ssl->early_data_status = MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED;
+    ssl->discard_early_data_record = MBEDTLS_SSL_EARLY_DATA_NO_DISCARD;
+
+    return 0;
+}
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
 /*
  * Main entry point from the state machine; orchestrates the otherfunctions.
  */
@@ -1749,6 +1916,14 @@ static int ssl_tls13_process_client_hello(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_postprocess_client_hello(ssl));
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (ssl->handshake->received_extensions & MBEDTLS_SSL_EXT_MASK(EARLY_DATA)) {
+        MBEDTLS_SSL_PROC_CHK(ssl_tls13_process_early_data_offer(
+                                 ssl, parse_client_hello_ret ==
+                                 SSL_CLIENT_HELLO_HRR_REQUIRED));
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
     if (parse_client_hello_ret == SSL_CLIENT_HELLO_OK) {
         mbedtls_ssl_handshake_set_state(ssl, MBEDTLS_SSL_SERVER_HELLO);
     } else {
@@ -2180,6 +2355,13 @@ static int ssl_tls13_write_server_hello(mbedtls_ssl_context *ssl)
 
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> write server hello"));
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+    /* The ServerHello is already written: resume the key agreement. */
+    if (ssl->handshake->async_in_progress != 0) {
+        goto finalize;
+    }
+#endif /* MBEDTLS_SSL_ASYNC_PRIVATE */
+
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_prepare_server_hello(ssl));
 
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_start_handshake_msg(ssl,
@@ -2197,6 +2379,9 @@ static int ssl_tls13_write_server_hello(mbedtls_ssl_context *ssl)
     MBEDTLS_SSL_PROC_CHK(mbedtls_ssl_finish_handshake_msg(
                              ssl, buf_len, msg_len));
 
+#if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+finalize:
+#endif
     MBEDTLS_SSL_PROC_CHK(ssl_tls13_finalize_server_hello(ssl));
 
 #if defined(MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE)
@@ -2329,6 +2514,16 @@ static int ssl_tls13_write_encrypted_extensions_body(mbedtls_ssl_context *ssl,
     p += output_len;
 #endif /* MBEDTLS_SSL_ALPN */
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED) {
+        ret = mbedtls_ssl_tls13_write_early_data_ext(ssl, p, end, &output_len);
+        if (ret != 0) {
+            return ret;
+        }
+        p += output_len;
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
     extensions_len = (p - p_extensions_len) - 2;
     MBEDTLS_PUT_UINT16_BE(extensions_len, p_extensions_len, 0);
 
@@ -2466,6 +2661,17 @@ static int ssl_tls13_write_certificate_request_body(mbedtls_ssl_context *ssl,
     }
 
     p += output_len;
+
+#if defined(MBEDTLS_SSL_CERT_COMPRESSION)
+    ret = mbedtls_ssl_tls13_write_compress_certificate_ext(ssl, p, end,
+                                                           &output_len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    p += output_len;
+#endif
+
     MBEDTLS_PUT_UINT16_BE(p - p_extensions_len - 2, p_extensions_len, 0);
 
     *out_len = p - buf;
@@ -2579,6 +2785,18 @@ static int ssl_tls13_write_server_finished(mbedtls_ssl_context *ssl)
         return ret;
     }
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED) {
+        /* The client protects its early data and EndOfEarlyData message
+         * with the early keys, RFC 8446 section 2.3. */
+        MBEDTLS_SSL_DEBUG_MSG(1, ("Switch to early keys for inbound traffic"));
+        mbedtls_ssl_set_inbound_transform(ssl,
+                                          ssl->handshake->transform_earlydata);
+        mbedtls_ssl_handshake_set_state(ssl, MBEDTLS_SSL_END_OF_EARLY_DATA);
+        return 0;
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
     MBEDTLS_SSL_DEBUG_MSG(1, ("Switch to handshake keys for inbound traffic"));
     mbedtls_ssl_set_inbound_transform(ssl, ssl->handshake->transform_handshake);
 
@@ -2593,6 +2811,142 @@ static int ssl_tls13_write_server_finished(mbedtls_ssl_context *ssl)
     return 0;
 }
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+/*
+ * RFC 8446 section 4.2.10: if the server receives more than
+ * max_early_data_size bytes of early data, accepted or skipped, it MUST
+ * terminate the connection with an "unexpected_message" alert.
+ */
+int mbedtls_ssl_tls13_check_early_data_len(mbedtls_ssl_context *ssl,
+                                           size_t early_data_len)
+{
+    /* The limit of a rejected ticket is unknown: use the configured one. */
+    uint32_t max_early_data_size =
+        ssl->early_data_status == MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED ?
+        ssl->session_negotiate->max_early_data_size :
+        ssl->conf->max_early_data_size;
+
+    if (early_data_len > max_early_data_size - ssl->total_early_data_size) {
+        MBEDTLS_SSL_DEBUG_MSG(
+            1, ("EarlyData: more than %u bytes received",
+                (unsigned) max_early_data_size));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_UNEXPECTED_MESSAGE,
+                                     MBEDTLS_ERR_SSL_UNEXPECTED_MESSAGE);
+        return MBEDTLS_ERR_SSL_UNEXPECTED_MESSAGE;
+    }
+    ssl->total_early_data_size += (uint32_t) early_data_len;
+
+    return 0;
+}
+
+/*
+ * Keep the early data of the record just read for
+ * mbedtls_ssl_read_early_data() or mbedtls_ssl_read().
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_store_early_data(mbedtls_ssl_context *ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+    size_t len = ssl->in_msglen;
+    size_t unread = ssl->early_data_len - ssl->early_data_offt;
+    unsigned char *buf;
+
+    ret = mbedtls_ssl_tls13_check_early_data_len(ssl, len);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (len == 0) {
+        return 0;
+    }
+
+    /* Drop the data already read and append the new record. */
+    buf = mbedtls_calloc(1, unread + len);
+    if (buf == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    if (unread > 0) {
+        memcpy(buf, ssl->early_data_buf + ssl->early_data_offt, unread);
+    }
+    memcpy(buf + unread, ssl->in_msg, len);
+
+    if (ssl->early_data_buf != NULL) {
+        mbedtls_platform_zeroize(ssl->early_data_buf, ssl->early_data_len);
+        mbedtls_free(ssl->early_data_buf);
+    }
+    ssl->early_data_buf = buf;
+    ssl->early_data_len = unread + len;
+    ssl->early_data_offt = 0;
+
+    MBEDTLS_SSL_DEBUG_MSG(3, ("EarlyData: %" MBEDTLS_PRINTF_SIZET
+                              " bytes received", len));
+    return 0;
+}
+
+/*
+ * Handler for MBEDTLS_SSL_END_OF_EARLY_DATA
+ *
+ * RFC 8446 section 4.5
+ *
+ * struct {} EndOfEarlyData;
+ *
+ * Receive the early data records up to the EndOfEarlyData message.
+ */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_tls13_process_end_of_early_data(mbedtls_ssl_context *ssl)
+{
+    int ret = MBEDTLS_ERR_ERROR_CORRUPTION_DETECTED;
+
+    if ((ret = mbedtls_ssl_read_record(ssl, 0)) != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_read_record", ret);
+        return ret;
+    }
+
+    if (ssl->in_msgtype == MBEDTLS_SSL_MSG_APPLICATION_DATA) {
+        return ssl_tls13_store_early_data(ssl);
+    }
+
+    if (ssl->in_msgtype != MBEDTLS_SSL_MSG_HANDSHAKE ||
+        ssl->in_msg[0] != MBEDTLS_SSL_HS_END_OF_EARLY_DATA) {
+        MBEDTLS_SSL_DEBUG_MSG(1, ("Receive unexpected handshake message."));
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_UNEXPECTED_MESSAGE,
+                                     MBEDTLS_ERR_SSL_UNEXPECTED_MESSAGE);
+        return MBEDTLS_ERR_SSL_UNEXPECTED_MESSAGE;
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("=> parse end_of_early_data"));
+
+    if (ssl->in_hslen != 4) {
+        MBEDTLS_SSL_PEND_FATAL_ALERT(MBEDTLS_SSL_ALERT_MSG_DECODE_ERROR,
+                                     MBEDTLS_ERR_SSL_DECODE_ERROR);
+        return MBEDTLS_ERR_SSL_DECODE_ERROR;
+    }
+
+    ret = mbedtls_ssl_add_hs_msg_to_checksum(
+        ssl, MBEDTLS_SSL_HS_END_OF_EARLY_DATA, ssl->in_msg + 4, 0);
+    if (ret != 0) {
+        MBEDTLS_SSL_DEBUG_RET(1, "mbedtls_ssl_add_hs_msg_to_checksum", ret);
+        return ret;
+    }
+
+    ssl->early_data_status = MBEDTLS_SSL_EARLY_DATA_STATUS_END_OF_EARLY_DATA;
+
+    MBEDTLS_SSL_DEBUG_MSG(1, ("Switch to handshake keys for inbound traffic"));
+    mbedtls_ssl_set_inbound_transform(ssl, ssl->handshake->transform_handshake);
+
+    if (ssl->handshake->certificate_request_sent) {
+        mbedtls_ssl_handshake_set_state(ssl, MBEDTLS_SSL_CLIENT_CERTIFICATE);
+    } else {
+        MBEDTLS_SSL_DEBUG_MSG(2, ("skip parse certificate"));
+        MBEDTLS_SSL_DEBUG_MSG(2, ("skip parse certificate verify"));
+        mbedtls_ssl_handshake_set_state(ssl, MBEDTLS_SSL_CLIENT_FINISHED);
+    }
+
+    MBEDTLS_SSL_DEBUG_MSG(2, ("<= parse end_of_early_data"));
+    return 0;
+}
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
 /*
  * Handler for MBEDTLS_SSL_CLIENT_FINISHED
  */
@@ -2697,6 +3051,25 @@ static int ssl_tls13_prepare_new_session_ticket(mbedtls_ssl_context *ssl,
     mbedtls_ssl_session_set_ticket_flags(
         session, ssl->handshake->tls13_kex_modes);
 #endif
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (ssl->conf->early_data_enabled == MBEDTLS_SSL_EARLY_DATA_ENABLED &&
+        ssl->conf->max_early_data_size > 0) {
+        mbedtls_ssl_session_set_ticket_flags(
+            session, MBEDTLS_SSL_TLS1_3_TICKET_ALLOW_EARLY_DATA);
+        session->max_early_data_size = ssl->conf->max_early_data_size;
+    } else {
+        session->max_early_data_size = 0;
+    }
+
+#if defined(MBEDTLS_SSL_ALPN)
+    /* RFC 8446 section 4.2.10: early data sent with the ticket is only
+     * accepted if the same ALPN protocol is selected then. */
+    ret = mbedtls_ssl_session_set_ticket_alpn(session, ssl->alpn_chosen);
+    if (ret != 0) {
+        return ret;
+    }
+#endif /* MBEDTLS_SSL_ALPN */
+#endif /* MBEDTLS_SSL_EARLY_DATA */
     MBEDTLS_SSL_PRINT_TICKET_FLAGS(4, session->ticket_flags);
 
     /* Generate ticket_age_add */
@@ -2800,6 +3173,7 @@ static int ssl_tls13_write_new_session_ticket_body(mbedtls_ssl_context *ssl,
     mbedtls_ssl_session *session = ssl->session;
     size_t ticket_len;
     uint32_t ticket_lifetime;
+    unsigned char *p_extensions_len;
 
     *out_len = 0;
     MBEDTLS_SSL_DEBUG_MSG(2, ("=> write NewSessionTicket msg"));
@@ -2861,15 +3235,33 @@ static int ssl_tls13_write_new_session_ticket_body(mbedtls_ssl_context *ssl,
 
     /* Ticket Extensions
      *
-     * Note: We currently don't have any extensions.
-     * Set length to zero.
+     * struct {
+     *     select (Handshake.msg_type) {
+     *         case new_session_ticket:   uint32 max_early_data_size;
+     *         ...
+     *     };
+     * } EarlyDataIndication;
      */
     ssl->handshake->sent_extensions = MBEDTLS_SSL_EXT_MASK_NONE;
 
     MBEDTLS_SSL_CHK_BUF_PTR(p, end, 2);
-    MBEDTLS_PUT_UINT16_BE(0, p, 0);
+    p_extensions_len = p;
     p += 2;
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+    if (mbedtls_ssl_session_get_ticket_flags(
+            session, MBEDTLS_SSL_TLS1_3_TICKET_ALLOW_EARLY_DATA)) {
+        MBEDTLS_SSL_CHK_BUF_PTR(p, end, 8);
+        MBEDTLS_PUT_UINT16_BE(MBEDTLS_TLS_EXT_EARLY_DATA, p, 0);
+        MBEDTLS_PUT_UINT16_BE(4, p, 2);
+        MBEDTLS_PUT_UINT32_BE(session->max_early_data_size, p, 4);
+        p += 8;
+        mbedtls_ssl_tls13_set_hs_sent_ext_mask(ssl, MBEDTLS_TLS_EXT_EARLY_DATA);
+    }
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
+    MBEDTLS_PUT_UINT16_BE(p - p_extensions_len - 2, p_extensions_len, 0);
+
     *out_len = p - buf;
     MBEDTLS_SSL_DEBUG_BUF(4, "ticket", buf, *out_len);
     MBEDTLS_SSL_DEBUG_MSG(2, ("<= write new session ticket"));
@@ -3016,6 +3408,12 @@ int mbedtls_ssl_tls13_handshake_server_step(mbedtls_ssl_context *ssl)
             ret = ssl_tls13_write_server_finished(ssl);
             break;
 
+#if defined(MBEDTLS_SSL_EARLY_DATA)
+        case MBEDTLS_SSL_END_OF_EARLY_DATA:
+            ret = ssl_tls13_process_end_of_early_data(ssl);
+            break;
+#endif /* MBEDTLS_SSL_EARLY_DATA */
+
         case MBEDTLS_SSL_CLIENT_FINISHED:
             ret = ssl_tls13_process_client_finished(ssl);
             break;
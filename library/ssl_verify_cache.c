@@ -0,0 +1,374 @@
+/*
+ *  Cache of verified peer certificate chains
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * The keys are SHA-256 digests computed by the handshake, so their first
+ * bytes pick a bucket of the hash table directly. Each bucket is a singly
+ * linked list, and all entries are also on a doubly linked list from the
+ * most to the least recently used.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_VERIFY_CACHE_C)
+
+#include "mbedtls/platform.h"
+
+#include "mbedtls/ssl_verify_cache.h"
+#include "ssl_misc.h"
+
+#include <string.h>
+
+/* Maximum number of expired entries freed by each cache access */
+#define SSL_VERIFY_CACHE_EXPIRE_STEPS   4
+
+void mbedtls_ssl_verify_cache_init(mbedtls_ssl_verify_cache_context *cache)
+{
+    memset(cache, 0, sizeof(mbedtls_ssl_verify_cache_context));
+
+    cache->timeout = MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_TIMEOUT;
+    cache->max_entries = MBEDTLS_SSL_VERIFY_CACHE_DEFAULT_MAX_ENTRIES;
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_init(&cache->mutex);
+#endif
+}
+
+static mbedtls_ssl_verify_cache_entry **ssl_verify_cache_bucket(
+    const mbedtls_ssl_verify_cache_context *cache, unsigned char const *key)
+{
+    return &cache->buckets[MBEDTLS_GET_UINT32_BE(key, 0) &
+                           (cache->bucket_count - 1)];
+}
+
+static mbedtls_ssl_verify_cache_entry *ssl_verify_cache_find(
+    const mbedtls_ssl_verify_cache_context *cache, unsigned char const *key)
+{
+    mbedtls_ssl_verify_cache_entry *cur;
+
+    if (cache->bucket_count == 0) {
+        return NULL;
+    }
+
+    for (cur = *ssl_verify_cache_bucket(cache, key); cur != NULL;
+         cur = cur->chain) {
+        if (memcmp(cur->key, key, MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN) == 0) {
+            return cur;
+        }
+    }
+
+    return NULL;
+}
+
+static void ssl_verify_cache_lru_unlink(mbedtls_ssl_verify_cache_context *cache,
+                                        mbedtls_ssl_verify_cache_entry *entry)
+{
+    if (entry->prev != NULL) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->lru_head = entry->next;
+    }
+
+    if (entry->next != NULL) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->lru_tail = entry->prev;
+    }
+
+    entry->prev = NULL;
+    entry->next = NULL;
+}
+
+static void ssl_verify_cache_lru_push(mbedtls_ssl_verify_cache_context *cache,
+                                      mbedtls_ssl_verify_cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cache->lru_head;
+
+    if (cache->lru_head != NULL) {
+        cache->lru_head->prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+static void ssl_verify_cache_remove(mbedtls_ssl_verify_cache_context *cache,
+                                    mbedtls_ssl_verify_cache_entry *entry)
+{
+    mbedtls_ssl_verify_cache_entry **cur = ssl_verify_cache_bucket(cache,
+                                                                   entry->key);
+
+    while (*cur != entry) {
+        cur = &(*cur)->chain;
+    }
+    *cur = entry->chain;
+
+    ssl_verify_cache_lru_unlink(cache, entry);
+    mbedtls_platform_zeroize(entry, sizeof(mbedtls_ssl_verify_cache_entry));
+    mbedtls_free(entry);
+    cache->count--;
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+static int ssl_verify_cache_expired(const mbedtls_ssl_verify_cache_context *cache,
+                                    const mbedtls_ssl_verify_cache_entry *entry,
+                                    mbedtls_time_t t)
+{
+    return cache->timeout != 0 &&
+           (int) (t - entry->timestamp) > cache->timeout;
+}
+
+/* Free a few expired entries from the least recently used end */
+static void ssl_verify_cache_expire(mbedtls_ssl_verify_cache_context *cache,
+                                    mbedtls_time_t t)
+{
+    int steps;
+
+    for (steps = 0; steps < SSL_VERIFY_CACHE_EXPIRE_STEPS; steps++) {
+        if (cache->lru_tail == NULL ||
+            !ssl_verify_cache_expired(cache, cache->lru_tail, t)) {
+            break;
+        }
+
+        ssl_verify_cache_remove(cache, cache->lru_tail);
+    }
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+/* Keep at least as many buckets as entries */
+MBEDTLS_CHECK_RETURN_CRITICAL
+static int ssl_verify_cache_reserve(mbedtls_ssl_verify_cache_context *cache,
+                                    size_t count)
+{
+    mbedtls_ssl_verify_cache_entry **old_buckets = cache->buckets;
+    mbedtls_ssl_verify_cache_entry **bucket, *cur;
+    size_t size = 4;
+
+    while (size < count) {
+        size <<= 1;
+    }
+
+    if (size <= cache->bucket_count) {
+        return 0;
+    }
+
+    cache->buckets = mbedtls_calloc(size, sizeof(mbedtls_ssl_verify_cache_entry *));
+    if (cache->buckets == NULL) {
+        cache->buckets = old_buckets;
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    cache->bucket_count = size;
+
+    for (cur = cache->lru_head; cur != NULL; cur = cur->next) {
+        bucket = ssl_verify_cache_bucket(cache, cur->key);
+        cur->chain = *bucket;
+        *bucket = cur;
+    }
+
+    mbedtls_free(old_buckets);
+
+    return 0;
+}
+
+int mbedtls_ssl_verify_cache_get(void *data,
+                                 unsigned char const *key,
+                                 size_t key_len,
+                                 mbedtls_x509_time *valid_from,
+                                 mbedtls_x509_time *valid_to)
+{
+    int ret = 1;
+    mbedtls_ssl_verify_cache_context *cache =
+        (mbedtls_ssl_verify_cache_context *) data;
+    mbedtls_ssl_verify_cache_entry *entry;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
+
+    if (key_len != MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN) {
+        return 1;
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    if ((ret = mbedtls_mutex_lock(&cache->mutex)) != 0) {
+        return ret;
+    }
+#endif
+
+#if defined(MBEDTLS_HAVE_TIME)
+    ssl_verify_cache_expire(cache, t);
+#endif
+
+    entry = ssl_verify_cache_find(cache, key);
+    if (entry == NULL) {
+        ret = 1;
+        goto exit;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    if (ssl_verify_cache_expired(cache, entry, t)) {
+        ssl_verify_cache_remove(cache, entry);
+        ret = 1;
+        goto exit;
+    }
+#endif
+
+    ssl_verify_cache_lru_unlink(cache, entry);
+    ssl_verify_cache_lru_push(cache, entry);
+
+    *valid_from = entry->valid_from;
+    *valid_to = entry->valid_to;
+    ret = 0;
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&cache->mutex) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+#endif
+
+    return ret;
+}
+
+int mbedtls_ssl_verify_cache_set(void *data,
+                                 unsigned char const *key,
+                                 size_t key_len,
+                                 const mbedtls_x509_time *valid_from,
+                                 const mbedtls_x509_time *valid_to)
+{
+    int ret = 1;
+    mbedtls_ssl_verify_cache_context *cache =
+        (mbedtls_ssl_verify_cache_context *) data;
+    mbedtls_ssl_verify_cache_entry *cur, **bucket;
+#if defined(MBEDTLS_HAVE_TIME)
+    mbedtls_time_t t = mbedtls_time(NULL);
+#endif
+
+    if (key_len != MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN) {
+        return 1;
+    }
+
+#if defined(MBEDTLS_THREADING_C)
+    if ((ret = mbedtls_mutex_lock(&cache->mutex)) != 0) {
+        return ret;
+    }
+#endif
+
+    if (cache->max_entries <= 0) {
+        ret = 1;
+        goto exit;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    ssl_verify_cache_expire(cache, t);
+#endif
+
+    cur = ssl_verify_cache_find(cache, key);
+    if (cur != NULL) {
+        ssl_verify_cache_lru_unlink(cache, cur);
+        ssl_verify_cache_lru_push(cache, cur);
+    } else {
+        /* Evict the least recently used entries to make room */
+        while (cache->count >= (size_t) cache->max_entries) {
+            ssl_verify_cache_remove(cache, cache->lru_tail);
+        }
+
+        ret = ssl_verify_cache_reserve(cache, cache->count + 1);
+        if (ret != 0) {
+            goto exit;
+        }
+
+        cur = mbedtls_calloc(1, sizeof(mbedtls_ssl_verify_cache_entry));
+        if (cur == NULL) {
+            ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+            goto exit;
+        }
+
+        memcpy(cur->key, key, MBEDTLS_SSL_VERIFY_CACHE_KEY_LEN);
+
+        bucket = ssl_verify_cache_bucket(cache, key);
+        cur->chain = *bucket;
+        *bucket = cur;
+        ssl_verify_cache_lru_push(cache, cur);
+        cache->count++;
+    }
+
+#if defined(MBEDTLS_HAVE_TIME)
+    cur->timestamp = t;
+#endif
+    cur->valid_from = *valid_from;
+    cur->valid_to = *valid_to;
+
+    ret = 0;
+
+exit:
+#if defined(MBEDTLS_THREADING_C)
+    if (mbedtls_mutex_unlock(&cache->mutex) != 0) {
+        ret = MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+#endif
+
+    return ret;
+}
+
+#if defined(MBEDTLS_HAVE_TIME)
+void mbedtls_ssl_verify_cache_set_timeout(mbedtls_ssl_verify_cache_context *cache,
+                                          int timeout)
+{
+    if (timeout < 0) {
+        timeout = 0;
+    }
+
+    cache->timeout = timeout;
+}
+#endif /* MBEDTLS_HAVE_TIME */
+
+void mbedtls_ssl_verify_cache_set_max_entries(mbedtls_ssl_verify_cache_context *cache,
+                                              int max)
+{
+    if (max < 0) {
+        max = 0;
+    }
+
+    /* Entries beyond the new maximum are evicted by the next set */
+    cache->max_entries = max;
+}
+
+void mbedtls_ssl_verify_cache_free(mbedtls_ssl_verify_cache_context *cache)
+{
+    mbedtls_ssl_verify_cache_entry *cur, *prv;
+
+    cur = cache->lru_head;
+    while (cur != NULL) {
+        prv = cur;
+        cur = cur->next;
+
+        mbedtls_platform_zeroize(prv, sizeof(mbedtls_ssl_verify_cache_entry));
+        mbedtls_free(prv);
+    }
+
+    mbedtls_free(cache->buckets);
+
+#if defined(MBEDTLS_THREADING_C)
+    mbedtls_mutex_free(&cache->mutex);
+#endif
+
+    mbedtls_platform_zeroize(cache, sizeof(mbedtls_ssl_verify_cache_context));
+}
+
+#endif /* MBEDTLS_SSL_VERIFY_CACHE_C */
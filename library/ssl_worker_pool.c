@@ -0,0 +1,188 @@
+/*
+ *  Pool of worker threads running batches of SSL jobs
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+/*
+ * The pool runs one batch at a time. The caller of
+ * mbedtls_ssl_worker_pool_run() publishes the batch, then takes jobs like
+ * the worker threads do until none is left, and waits for the last running
+ * job to finish. The mbedtls threading abstraction only provides mutexes,
+ * so this module uses pthreads directly.
+ */
+
+#include "common.h"
+
+#if defined(MBEDTLS_SSL_WORKER_POOL_C)
+
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_worker_pool.h"
+#include "mbedtls/threading.h"
+
+#include <string.h>
+
+void mbedtls_ssl_worker_pool_init(mbedtls_ssl_worker_pool *pool)
+{
+    memset(pool, 0, sizeof(mbedtls_ssl_worker_pool));
+}
+
+/* Run jobs of the current batch until none is left to start.
+ * Called and returns with the mutex locked. */
+static void ssl_worker_pool_take_jobs(mbedtls_ssl_worker_pool *pool)
+{
+    while (pool->f_job != NULL && pool->next < pool->count) {
+        void (*f_job)(void *, size_t) = pool->f_job;
+        void *p_job = pool->p_job;
+        size_t index = pool->next++;
+
+        (void) pthread_mutex_unlock(&pool->mutex);
+        f_job(p_job, index);
+        (void) pthread_mutex_lock(&pool->mutex);
+
+        if (--pool->pending == 0) {
+            (void) pthread_cond_broadcast(&pool->done);
+        }
+    }
+}
+
+static void *ssl_worker_pool_thread(void *arg)
+{
+    mbedtls_ssl_worker_pool *pool = arg;
+
+    (void) pthread_mutex_lock(&pool->mutex);
+    while (!pool->shutdown) {
+        if (pool->f_job == NULL || pool->next >= pool->count) {
+            (void) pthread_cond_wait(&pool->work, &pool->mutex);
+            continue;
+        }
+        ssl_worker_pool_take_jobs(pool);
+    }
+    (void) pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+/* Stop and join the threads started so far. */
+static void ssl_worker_pool_stop(mbedtls_ssl_worker_pool *pool)
+{
+    size_t i;
+
+    (void) pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = 1;
+    (void) pthread_cond_broadcast(&pool->work);
+    (void) pthread_mutex_unlock(&pool->mutex);
+
+    for (i = 0; i < pool->thread_count; i++) {
+        (void) pthread_join(pool->threads[i], NULL);
+    }
+    pool->thread_count = 0;
+}
+
+int mbedtls_ssl_worker_pool_setup(mbedtls_ssl_worker_pool *pool,
+                                  size_t threads)
+{
+    if (pool->is_valid || threads > MBEDTLS_SSL_WORKER_POOL_MAX_THREADS) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+    if (pthread_cond_init(&pool->work, NULL) != 0) {
+        (void) pthread_mutex_destroy(&pool->mutex);
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+    if (pthread_cond_init(&pool->done, NULL) != 0) {
+        (void) pthread_cond_destroy(&pool->work);
+        (void) pthread_mutex_destroy(&pool->mutex);
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+    pool->is_valid = 1;
+
+    while (pool->thread_count < threads) {
+        if (pthread_create(&pool->threads[pool->thread_count], NULL,
+                           ssl_worker_pool_thread, pool) != 0) {
+            mbedtls_ssl_worker_pool_free(pool);
+            return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+        }
+        pool->thread_count++;
+    }
+
+    return 0;
+}
+
+int mbedtls_ssl_worker_pool_run(void *p_pool,
+                                void (*f_job)(void *p_job, size_t index),
+                                void *p_job, size_t count)
+{
+    mbedtls_ssl_worker_pool *pool = p_pool;
+    size_t i;
+
+    if (pool == NULL || !pool->is_valid) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    if (pthread_mutex_lock(&pool->mutex) != 0) {
+        return MBEDTLS_ERR_THREADING_MUTEX_ERROR;
+    }
+
+    if (pool->f_job != NULL) {
+        /* Busy with the batch of another caller: don't wait for it. */
+        (void) pthread_mutex_unlock(&pool->mutex);
+        for (i = 0; i < count; i++) {
+            f_job(p_job, i);
+        }
+        return 0;
+    }
+
+    pool->f_job = f_job;
+    pool->p_job = p_job;
+    pool->count = count;
+    pool->next = 0;
+    pool->pending = count;
+    (void) pthread_cond_broadcast(&pool->work);
+
+    ssl_worker_pool_take_jobs(pool);
+
+    while (pool->pending != 0) {
+        (void) pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+
+    pool->f_job = NULL;
+    pool->p_job = NULL;
+    pool->count = 0;
+    pool->next = 0;
+    (void) pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+void mbedtls_ssl_worker_pool_free(mbedtls_ssl_worker_pool *pool)
+{
+    if (pool == NULL || !pool->is_valid) {
+        return;
+    }
+
+    ssl_worker_pool_stop(pool);
+
+    (void) pthread_cond_destroy(&pool->done);
+    (void) pthread_cond_destroy(&pool->work);
+    (void) pthread_mutex_destroy(&pool->mutex);
+
+    memset(pool, 0, sizeof(mbedtls_ssl_worker_pool));
+}
+
+#endif /* MBEDTLS_SSL_WORKER_POOL_C */
@@ -0,0 +1,504 @@
+/*
+ *  DTLS echo server serving many clients on one UDP socket
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/platform.h"
+
+/* Uncomment out the following line to default to IPv4 and disable IPv6 */
+//#define FORCE_IPV4
+
+#ifdef FORCE_IPV4
+#define BIND_IP     "0.0.0.0"     /* Forces IPv4 */
+#else
+#define BIND_IP     "::"
+#endif
+
+#if !defined(MBEDTLS_SSL_DTLS_DEMUX_C) || !defined(MBEDTLS_SSL_COOKIE_C) || \
+    !defined(MBEDTLS_NET_C) || !defined(MBEDTLS_ENTROPY_C) ||              \
+    !defined(MBEDTLS_CTR_DRBG_C) || !defined(MBEDTLS_X509_CRT_PARSE_C) ||  \
+    !defined(MBEDTLS_RSA_C) || !defined(MBEDTLS_PEM_PARSE_C) ||            \
+    !defined(MBEDTLS_TIMING_C)
+
+int main(void)
+{
+    printf("MBEDTLS_SSL_DTLS_DEMUX_C and/or MBEDTLS_SSL_COOKIE_C and/or "
+           "MBEDTLS_NET_C and/or MBEDTLS_ENTROPY_C and/or "
+           "MBEDTLS_CTR_DRBG_C and/or MBEDTLS_X509_CRT_PARSE_C and/or "
+           "MBEDTLS_RSA_C and/or MBEDTLS_PEM_PARSE_C and/or "
+           "MBEDTLS_TIMING_C not defined.\n");
+    mbedtls_exit(0);
+}
+#else
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/x509.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/ssl_cookie.h"
+#include "mbedtls/ssl_dtls_demux.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/error.h"
+#include "mbedtls/debug.h"
+#include "mbedtls/timing.h"
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+#include "mbedtls/ssl_async_batch.h"
+#endif
+
+#include "test/certs.h"
+
+#define DFL_SERVER_PORT "4433"
+#define MAX_CONNS       256     /* connections served at a time */
+#define POLL_MS         100     /* period of the timer checks */
+#define IDLE_TIMEOUT_MS 30000   /* 30 seconds */
+#define DEBUG_LEVEL     0
+#define BATCH_OPS       16      /* private key operations run together */
+#define BATCH_DELAY_MS  2       /* maximum wait for a batch to fill up */
+
+/* A record of maximum size with room for the expansion of encryption */
+#define DATAGRAM_LEN    (MBEDTLS_SSL_IN_CONTENT_LEN + 1024)
+
+#define USAGE \
+    "\n usage: dtls_demux_server [port]\n"                              \
+    "\n Echoes back what each client sends, and serves up to %d\n"      \
+    " clients at a time on one socket (default port: %s).\n\n"
+
+/*
+ * The demultiplexer owns the SSL contexts; the application keeps what it
+ * needs next to them: a timer for retransmissions and the time of the
+ * last activity.
+ */
+typedef struct {
+    mbedtls_ssl_context *ssl;
+    mbedtls_timing_delay_context timer;
+    struct mbedtls_timing_hr_time last;
+} conn_slot;
+
+static conn_slot slots[MAX_CONNS];
+static unsigned long served = 0;
+
+static void my_debug(void *ctx, int level,
+                     const char *file, int line,
+                     const char *str)
+{
+    ((void) level);
+
+    mbedtls_fprintf((FILE *) ctx, "%s:%04d: %s", file, line, str);
+    fflush((FILE *) ctx);
+}
+
+/* Called by the demultiplexer for each client that passed the cookie
+ * exchange */
+static int new_conn(void *ctx, mbedtls_ssl_context *ssl,
+                    const unsigned char *addr, size_t addr_len)
+{
+    size_t i;
+
+    ((void) ctx);
+    ((void) addr);
+    ((void) addr_len);
+
+    for (i = 0; i < MAX_CONNS; i++) {
+        if (slots[i].ssl == NULL) {
+            slots[i].ssl = ssl;
+            mbedtls_ssl_set_timer_cb(ssl, &slots[i].timer,
+                                     mbedtls_timing_set_delay,
+                                     mbedtls_timing_get_delay);
+            mbedtls_ssl_set_user_data_p(ssl, &slots[i]);
+            (void) mbedtls_timing_get_timer(&slots[i].last, 1);
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+static void close_conn(mbedtls_ssl_dtls_demux *demux,
+                       mbedtls_ssl_context *ssl, int ret)
+{
+    conn_slot *slot = mbedtls_ssl_get_user_data_p(ssl);
+
+    if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || ret == 0) {
+        /* No error checking, the connection might be closed already */
+        (void) mbedtls_ssl_close_notify(ssl);
+    } else {
+        mbedtls_printf("  ! connection closed: -0x%x\n", (unsigned int) -ret);
+    }
+
+    slot->ssl = NULL;
+    mbedtls_ssl_dtls_demux_close(demux, ssl);
+
+    served++;
+    mbedtls_printf("  . %lu served, %u active\n", served,
+                   (unsigned int) mbedtls_ssl_dtls_demux_count(demux));
+    fflush(stdout);
+}
+
+/*
+ * Make progress on a connection: a datagram was dispatched to it, or its
+ * retransmission timer may have expired. Returns 0 while the connection
+ * goes on, or the code to close it with.
+ */
+static int serve(mbedtls_ssl_context *ssl)
+{
+    unsigned char buf[1024];
+    int ret;
+
+    if (!mbedtls_ssl_is_handshake_over(ssl)) {
+        ret = mbedtls_ssl_handshake(ssl);
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+            ret == MBEDTLS_ERR_SSL_WANT_WRITE ||
+            ret == MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS) {
+            return 0;
+        }
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    ret = mbedtls_ssl_read(ssl, buf, sizeof(buf));
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+        ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return 0;
+    }
+    if (ret <= 0) {
+        return ret;
+    }
+
+    /* With DTLS, a write either sends the whole record or fails */
+    ret = mbedtls_ssl_write(ssl, buf, (size_t) ret);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+        return ret;
+    }
+
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret, len, timeout;
+    size_t i;
+    mbedtls_net_context listen_fd;
+    unsigned char datagram[DATAGRAM_LEN];
+    unsigned char addr[MBEDTLS_SSL_DTLS_DEMUX_MAX_ADDR_LEN];
+    size_t addr_len;
+    const char *port = DFL_SERVER_PORT;
+    const char *pers = "dtls_demux_server";
+    mbedtls_ssl_cookie_ctx cookie_ctx;
+    mbedtls_ssl_dtls_demux demux;
+    mbedtls_ssl_context *ssl;
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+    mbedtls_ssl_async_batch batch;
+    struct mbedtls_timing_hr_time epoch;
+#endif
+
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ssl_config conf;
+    mbedtls_x509_crt srvcert;
+    mbedtls_pk_context pkey;
+
+    mbedtls_net_init(&listen_fd);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_ssl_cookie_init(&cookie_ctx);
+    mbedtls_ssl_dtls_demux_init(&demux);
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+    mbedtls_ssl_async_batch_init(&batch);
+#endif
+    mbedtls_x509_crt_init(&srvcert);
+    mbedtls_pk_init(&pkey);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+
+#if defined(MBEDTLS_DEBUG_C)
+    mbedtls_debug_set_threshold(DEBUG_LEVEL);
+#endif
+
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "help") == 0)) {
+        mbedtls_printf(USAGE, MAX_CONNS, DFL_SERVER_PORT);
+        ret = 1;
+        goto exit;
+    }
+    if (argc == 2) {
+        port = argv[1];
+    }
+
+    /*
+     * 1. Seed the RNG
+     */
+    mbedtls_printf("  . Seeding the random number generator...");
+    fflush(stdout);
+
+    if ((ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                     (const unsigned char *) pers,
+                                     strlen(pers))) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ctr_drbg_seed returned %d\n", ret);
+        goto exit;
+    }
+
+    mbedtls_printf(" ok\n");
+
+    /*
+     * 2. Load the certificates and private RSA key
+     */
+    mbedtls_printf("  . Loading the server cert. and key...");
+    fflush(stdout);
+
+    ret = mbedtls_x509_crt_parse(&srvcert, (const unsigned char *) mbedtls_test_srv_crt,
+                                 mbedtls_test_srv_crt_len);
+    if (ret != 0) {
+        mbedtls_printf(" failed\n  !  mbedtls_x509_crt_parse returned %d\n\n", ret);
+        goto exit;
+    }
+
+    ret = mbedtls_x509_crt_parse(&srvcert, (const unsigned char *) mbedtls_test_cas_pem,
+                                 mbedtls_test_cas_pem_len);
+    if (ret != 0) {
+        mbedtls_printf(" failed\n  !  mbedtls_x509_crt_parse returned %d\n\n", ret);
+        goto exit;
+    }
+
+    ret =  mbedtls_pk_parse_key(&pkey,
+                                (const unsigned char *) mbedtls_test_srv_key,
+                                mbedtls_test_srv_key_len,
+                                NULL,
+                                0,
+                                mbedtls_ctr_drbg_random,
+                                &ctr_drbg);
+    if (ret != 0) {
+        mbedtls_printf(" failed\n  !  mbedtls_pk_parse_key returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_printf(" ok\n");
+
+    /*
+     * 3. Setup the UDP socket shared by all clients
+     */
+    mbedtls_printf("  . Bind on udp/*/%s ...", port);
+    fflush(stdout);
+
+    if ((ret = mbedtls_net_bind(&listen_fd, BIND_IP, port,
+                                MBEDTLS_NET_PROTO_UDP)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_net_bind returned %d\n\n", ret);
+        goto exit;
+    }
+
+    if ((ret = mbedtls_net_set_nonblock(&listen_fd)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_net_set_nonblock returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_printf(" ok\n");
+
+    /*
+     * 4. Setup stuff
+     */
+    mbedtls_printf("  . Setting up the DTLS data...");
+    fflush(stdout);
+
+    if ((ret = mbedtls_ssl_config_defaults(&conf,
+                                           MBEDTLS_SSL_IS_SERVER,
+                                           MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_config_defaults returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    mbedtls_ssl_conf_dbg(&conf, my_debug, stdout);
+
+    mbedtls_ssl_conf_ca_chain(&conf, srvcert.next, NULL);
+    if ((ret = mbedtls_ssl_conf_own_cert(&conf, &srvcert, &pkey)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_conf_own_cert returned %d\n\n", ret);
+        goto exit;
+    }
+
+    if ((ret = mbedtls_ssl_cookie_setup(&cookie_ctx,
+                                        mbedtls_ctr_drbg_random, &ctr_drbg)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_cookie_setup returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_ssl_conf_dtls_cookies(&conf, mbedtls_ssl_cookie_write, mbedtls_ssl_cookie_check,
+                                  &cookie_ctx);
+
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+    /* Queue the ECDHE computations (and the ECDSA signatures, with an EC
+     * key) of the handshakes, to run them together */
+    if ((ret = mbedtls_ssl_async_batch_setup(&batch, BATCH_OPS,
+                                             BATCH_DELAY_MS * 1000,
+                                             mbedtls_ctr_drbg_random,
+                                             &ctr_drbg)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_async_batch_setup returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_ssl_conf_async_private_cb(&conf, mbedtls_ssl_async_batch_sign, NULL,
+                                      mbedtls_ssl_async_batch_resume,
+                                      mbedtls_ssl_async_batch_cancel, &batch);
+    mbedtls_ssl_conf_async_key_agreement_cb(&conf,
+                                            mbedtls_ssl_async_batch_key_agreement);
+    (void) mbedtls_timing_get_timer(&epoch, 1);
+#endif
+
+#if defined(MBEDTLS_SSL_DTLS_CONNECTION_ID)
+    /* Let clients that support it keep their connection across address
+     * changes */
+    if ((ret = mbedtls_ssl_conf_cid(&conf, 8,
+                                    MBEDTLS_SSL_UNEXPECTED_CID_IGNORE)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_conf_cid returned %d\n\n", ret);
+        goto exit;
+    }
+#endif
+
+    if ((ret = mbedtls_ssl_dtls_demux_setup(&demux, &conf, MAX_CONNS,
+                                            mbedtls_net_send_to, &listen_fd,
+                                            new_conn, NULL)) != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_dtls_demux_setup returned %d\n\n", ret);
+        goto exit;
+    }
+
+    mbedtls_printf(" ok\n");
+
+    /*
+     * 5. Serve datagrams as they come, and retransmissions as they're due
+     */
+    mbedtls_printf("  . Waiting for datagrams...\n");
+    fflush(stdout);
+
+    for (;;) {
+        timeout = POLL_MS;
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+        if (mbedtls_ssl_async_batch_queued(&batch) > 0) {
+            timeout = 1;
+        }
+#endif
+        ret = mbedtls_net_poll(&listen_fd, MBEDTLS_NET_POLL_READ, timeout);
+        if (ret < 0) {
+            mbedtls_printf("  ! mbedtls_net_poll returned %d\n\n", ret);
+            goto exit;
+        }
+
+        while (ret > 0) {
+            ret = mbedtls_net_recv_from(&listen_fd, datagram, sizeof(datagram),
+                                        addr, sizeof(addr), &addr_len);
+            if (ret == MBEDTLS_ERR_SSL_WANT_READ) {
+                break;
+            }
+            if (ret == MBEDTLS_ERR_NET_BUFFER_TOO_SMALL) {
+                /* Not an address family we serve */
+                ret = 1;
+                continue;
+            }
+            if (ret < 0) {
+                mbedtls_printf("  ! mbedtls_net_recv_from returned %d\n\n", ret);
+                goto exit;
+            }
+            len = ret;
+
+            ret = mbedtls_ssl_dtls_demux_dispatch(&demux, addr, addr_len,
+                                                  datagram, (size_t) len,
+                                                  &ssl);
+            if (ret != 0) {
+                mbedtls_printf("  ! mbedtls_ssl_dtls_demux_dispatch returned -0x%x\n",
+                               (unsigned int) -ret);
+            } else if (ssl != NULL) {
+                conn_slot *slot = mbedtls_ssl_get_user_data_p(ssl);
+
+                (void) mbedtls_timing_get_timer(&slot->last, 1);
+                if ((ret = serve(ssl)) != 0) {
+                    close_conn(&demux, ssl, ret);
+                }
+            }
+
+            ret = 1;
+        }
+
+        len = 0;
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+        /* Resume the handshakes when some of their operations are done */
+        len = mbedtls_ssl_async_batch_poll(&batch,
+                                           (uint64_t) mbedtls_timing_get_timer(&epoch, 0)
+                                           * 1000);
+        if (len < 0) {
+            mbedtls_printf("  ! mbedtls_ssl_async_batch_poll returned %d\n\n", len);
+            ret = len;
+            goto exit;
+        }
+#endif
+
+        for (i = 0; i < MAX_CONNS; i++) {
+            ssl = slots[i].ssl;
+            if (ssl == NULL) {
+                continue;
+            }
+
+            if (mbedtls_timing_get_timer(&slots[i].last, 0) > IDLE_TIMEOUT_MS) {
+                close_conn(&demux, ssl, MBEDTLS_ERR_SSL_TIMEOUT);
+            } else if (!mbedtls_ssl_is_handshake_over(ssl) &&
+                       (len > 0 || mbedtls_timing_get_delay(&slots[i].timer) == 2)) {
+                if ((ret = serve(ssl)) != 0) {
+                    close_conn(&demux, ssl, ret);
+                }
+            }
+        }
+    }
+
+    /*
+     * Final clean-ups and exit
+     */
+exit:
+
+#ifdef MBEDTLS_ERROR_C
+    if (ret != 0) {
+        char error_buf[100];
+        mbedtls_strerror(ret, error_buf, 100);
+        mbedtls_printf("Last error was: %d - %s\n\n", ret, error_buf);
+    }
+#endif
+
+    mbedtls_ssl_dtls_demux_free(&demux);
+#if defined(MBEDTLS_SSL_ASYNC_BATCH_C)
+    mbedtls_ssl_async_batch_free(&batch);
+#endif
+    mbedtls_net_free(&listen_fd);
+
+    mbedtls_x509_crt_free(&srvcert);
+    mbedtls_pk_free(&pkey);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ssl_cookie_free(&cookie_ctx);
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+
+    /* Shell can not handle large exit numbers -> 1 for errors */
+    if (ret < 0) {
+        ret = 1;
+    }
+
+    mbedtls_exit(ret);
+}
+#endif /* MBEDTLS_SSL_DTLS_DEMUX_C && MBEDTLS_SSL_COOKIE_C &&
+          MBEDTLS_NET_C && MBEDTLS_ENTROPY_C && MBEDTLS_CTR_DRBG_C &&
+          MBEDTLS_X509_CRT_PARSE_C && MBEDTLS_RSA_C && MBEDTLS_PEM_PARSE_C &&
+          MBEDTLS_TIMING_C */
@@ -727,9 +727,47 @@ exit:
     return ret;
 }
 
+/*
+ * Write the HTTP request to send in buf, and return its length
+ */
+static int build_http_request(unsigned char *buf, size_t buf_size)
+{
+    int len, tail_len;
+
+    len = mbedtls_snprintf((char *) buf, buf_size - 1, GET_REQUEST,
+                           opt.request_page);
+    tail_len = (int) strlen(GET_REQUEST_END);
+
+    /* Add padding to GET request to reach opt.request_size in length */
+    if (opt.request_size != DFL_REQUEST_SIZE &&
+        len + tail_len < opt.request_size) {
+        memset(buf + len, 'A', opt.request_size - len - tail_len);
+        len += opt.request_size - len - tail_len;
+    }
+
+    strncpy((char *) buf + len, GET_REQUEST_END, buf_size - len - 1);
+    len += tail_len;
+
+    /* Truncate if request size is smaller than the "natural" size */
+    if (opt.request_size != DFL_REQUEST_SIZE &&
+        len > opt.request_size) {
+        len = opt.request_size;
+
+        /* Still end with \r\n unless that's really not possible */
+        if (len >= 2) {
+            buf[len - 2] = '\r';
+        }
+        if (len >= 1) {
+            buf[len - 1] = '\n';
+        }
+    }
+
+    return len;
+}
+
 int main(int argc, char *argv[])
 {
-    int ret = 0, len, tail_len, i, written, frags, retry_left;
+    int ret = 0, len, i, written, frags, retry_left;
     int query_config_ret = 0;
     mbedtls_net_context server_fd;
     io_ctx_t io_ctx;
@@ -739,6 +777,9 @@ int main(int argc, char *argv[])
 #endif
 
     unsigned char buf[MAX_REQUEST_SIZE + 1];
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+    int early_data_written = 0;
+#endif
 
 #if defined(MBEDTLS_SSL_HANDSHAKE_WITH_PSK_ENABLED)
     unsigned char psk[MBEDTLS_PSK_MAX_LEN];
@@ -2473,39 +2514,24 @@ send_request:
     mbedtls_printf("  > Write to server:");
     fflush(stdout);
 
-    len = mbedtls_snprintf((char *) buf, sizeof(buf) - 1, GET_REQUEST,
-                           opt.request_page);
-    tail_len = (int) strlen(GET_REQUEST_END);
-
-    /* Add padding to GET request to reach opt.request_size in length */
-    if (opt.request_size != DFL_REQUEST_SIZE &&
-        len + tail_len < opt.request_size) {
-        memset(buf + len, 'A', opt.request_size - len - tail_len);
-        len += opt.request_size - len - tail_len;
-    }
-
-    strncpy((char *) buf + len, GET_REQUEST_END, sizeof(buf) - len - 1);
-    len += tail_len;
-
-    /* Truncate if request size is smaller than the "natural" size */
-    if (opt.request_size != DFL_REQUEST_SIZE &&
-        len > opt.request_size) {
-        len = opt.request_size;
-
-        /* Still end with \r\n unless that's really not possible */
-        if (len >= 2) {
-            buf[len - 2] = '\r';
-        }
-        if (len >= 1) {
-            buf[len - 1] = '\n';
-        }
-    }
+    len = build_http_request(buf, sizeof(buf));
 
     if (opt.transport == MBEDTLS_SSL_TRANSPORT_STREAM) {
         written = 0;
         frags = 0;
 
-        do {
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+        /* The start of the request was sent as early data */
+        if (early_data_written > 0 &&
+            mbedtls_ssl_get_early_data_status(&ssl) ==
+            MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED) {
+            written = early_data_written;
+            frags = 1;
+        }
+        early_data_written = 0;
+#endif
+
+        while (frags == 0 || written < len) {
             while ((ret = mbedtls_ssl_write(&ssl, buf + written,
                                             len - written)) < 0) {
                 if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
@@ -2528,7 +2554,7 @@ send_request:
 
             frags++;
             written += ret;
-        } while (written < len);
+        }
     } else { /* Not stream, so datagram */
         while (1) {
             ret = mbedtls_ssl_write(&ssl, buf, len);
@@ -3027,6 +3053,28 @@ reconnect:
             goto exit;
         }
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+        /* Send the request as early data, the rest of it is sent once the
+         * handshake is over. */
+        if (opt.early_data == MBEDTLS_SSL_EARLY_DATA_ENABLED &&
+            opt.transport == MBEDTLS_SSL_TRANSPORT_STREAM) {
+            len = build_http_request(buf, sizeof(buf));
+            while ((ret = mbedtls_ssl_write_early_data(&ssl, buf, len)) < 0) {
+                if (ret == MBEDTLS_ERR_SSL_CANNOT_WRITE_EARLY_DATA) {
+                    break;
+                }
+                if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
+                    ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
+                    ret != MBEDTLS_ERR_SSL_CRYPTO_IN_PROGRESS) {
+                    mbedtls_printf(" failed\n  ! mbedtls_ssl_write_early_data returned -0x%x\n\n",
+                                   (unsigned int) -ret);
+                    goto exit;
+                }
+            }
+            early_data_written = ret > 0 ? ret : 0;
+        }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 && MBEDTLS_SSL_EARLY_DATA */
+
         while ((ret = mbedtls_ssl_handshake(&ssl)) != 0) {
             if (ret != MBEDTLS_ERR_SSL_WANT_READ &&
                 ret != MBEDTLS_ERR_SSL_WANT_WRITE &&
@@ -3039,6 +3087,16 @@ reconnect:
 
         mbedtls_printf(" ok\n");
 
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3) && defined(MBEDTLS_SSL_EARLY_DATA)
+        if (early_data_written > 0) {
+            mbedtls_printf("    [ %d bytes of early data %s ]\n",
+                           early_data_written,
+                           mbedtls_ssl_get_early_data_status(&ssl) ==
+                           MBEDTLS_SSL_EARLY_DATA_STATUS_ACCEPTED ?
+                           "accepted" : "rejected");
+        }
+#endif
+
         goto send_request;
     }
 
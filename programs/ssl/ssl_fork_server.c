@@ -56,6 +56,10 @@ int main(void)
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/timing.h"
 
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+#include "mbedtls/ssl_cache_shm.h"
+#endif
+
 #include <string.h>
 #include <signal.h>
 
@@ -95,6 +99,9 @@ int main(void)
     mbedtls_ssl_config conf;
     mbedtls_x509_crt srvcert;
     mbedtls_pk_context pkey;
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+    mbedtls_ssl_cache_shm_context cache;
+#endif
 
     mbedtls_net_init(&listen_fd);
     mbedtls_net_init(&client_fd);
@@ -104,6 +111,9 @@ int main(void)
     mbedtls_pk_init(&pkey);
     mbedtls_x509_crt_init(&srvcert);
     mbedtls_ctr_drbg_init(&ctr_drbg);
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+    mbedtls_ssl_cache_shm_init(&cache);
+#endif
 
     signal(SIGCHLD, SIG_IGN);
 
@@ -180,6 +190,18 @@ int main(void)
         goto exit;
     }
 
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+    /* Mapped before forking: the child processes share the cache, so that
+     * a client can resume its session with any of them. */
+    if ((ret = mbedtls_ssl_cache_shm_setup(&cache, NULL, 1024, 4096)) != 0) {
+        mbedtls_printf(" failed!  mbedtls_ssl_cache_shm_setup returned %d\n\n", ret);
+        goto exit;
+    }
+    mbedtls_ssl_conf_session_cache(&conf, &cache,
+                                   mbedtls_ssl_cache_shm_get,
+                                   mbedtls_ssl_cache_shm_set);
+#endif
+
     mbedtls_printf(" ok\n");
 
     /*
@@ -371,6 +393,9 @@ exit:
     mbedtls_pk_free(&pkey);
     mbedtls_ssl_free(&ssl);
     mbedtls_ssl_config_free(&conf);
+#if defined(MBEDTLS_SSL_CACHE_SHM_C)
+    mbedtls_ssl_cache_shm_free(&cache);
+#endif
     mbedtls_ctr_drbg_free(&ctr_drbg);
     mbedtls_entropy_free(&entropy);
 
@@ -57,6 +57,10 @@ int main(void)
 #include "mbedtls/ssl_cookie.h"
 #endif
 
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+#include "mbedtls/ssl_early_data_replay.h"
+#endif
+
 #if defined(MBEDTLS_SSL_SERVER_NAME_INDICATION) && defined(MBEDTLS_FS_IO)
 #define SNI_OPTION
 #endif
@@ -93,6 +97,7 @@ int main(void)
 #define DFL_KEY_PWD2            ""
 #define DFL_ASYNC_OPERATIONS    "-"
 #define DFL_ASYNC_PRIVATE_DELAY1 (-1)
+#define DFL_ASYNC_KEY_AGREEMENT_DELAY 0
 #define DFL_ASYNC_PRIVATE_DELAY2 (-1)
 #define DFL_ASYNC_PRIVATE_ERROR  (0)
 #define DFL_PSK                 ""
@@ -222,10 +227,13 @@ int main(void)
 
 #if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
 #define USAGE_SSL_ASYNC \
-    "    async_operations=%%c...   d=decrypt, s=sign (default: -=off)\n" \
+    "    async_operations=%%c...   d=decrypt, s=sign, k=ECDHE key agreement\n" \
+    "                              (default: -=off)\n" \
     "    async_private_delay1=%%d  Asynchronous delay for key_file or preloaded key\n" \
     "    async_private_delay2=%%d  Asynchronous delay for key_file2 and sni\n" \
     "                              default: -1 (not asynchronous)\n" \
+    "    async_key_agreement_delay=%%d Asynchronous delay for the key agreement\n" \
+    "                              default: 0\n" \
     "    async_private_error=%%d   Async callback error injection (default=0=none,\n" \
     "                              1=start, 2=cancel, 3=resume, negative=first time only)"
 #else
@@ -628,6 +636,7 @@ struct options {
     const char *key_pwd2;       /* the password for the 2nd server key      */
     const char *async_operations; /* supported SSL asynchronous operations  */
     int async_private_delay1;   /* number of times f_async_resume needs to be called for key 1, or -1 for no async */
+    int async_key_agreement_delay; /* number of times f_async_resume needs to be called for key agreement */
     int async_private_delay2;   /* number of times f_async_resume needs to be called for key 2, or -1 for no async */
     int async_private_error;    /* inject error in async private callback */
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
@@ -1084,6 +1093,11 @@ static int mbedtls_status_is_ssl_in_progress(int ret)
 }
 
 #if defined(MBEDTLS_SSL_ASYNC_PRIVATE)
+#if defined(MBEDTLS_ECDH_C) && \
+    (defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3))
+#define SSL_ASYNC_KEY_AGREEMENT
+#endif
+
 typedef struct {
     mbedtls_x509_crt *cert; /*!< Certificate corresponding to the key */
     mbedtls_pk_context *pk; /*!< Private key */
@@ -1103,6 +1117,7 @@ typedef struct {
     ssl_async_key_slot_t slots[4]; /* key, key2, sni1, sni2 */
     size_t slots_used;
     ssl_async_inject_error_t inject_error;
+    unsigned key_agreement_delay; /*!< Resume steps for key agreement */
     int (*f_rng)(void *, unsigned char *, size_t);
     void *p_rng;
 } ssl_async_key_context_t;
@@ -1129,6 +1144,7 @@ int ssl_async_set_key(ssl_async_key_context_t *ctx,
 typedef enum {
     ASYNC_OP_SIGN,
     ASYNC_OP_DECRYPT,
+    ASYNC_OP_KEY_AGREEMENT,
 } ssl_async_operation_type_t;
 
 typedef struct {
@@ -1137,6 +1153,8 @@ typedef struct {
     mbedtls_md_type_t md_alg;
     unsigned char input[SSL_ASYNC_INPUT_MAX_SIZE];
     size_t input_len;
+    uint16_t group; /*!< Key agreement: group of the keys */
+    size_t own_key_len; /*!< Key agreement: the input is own key || peer key */
     unsigned remaining_delay;
 } ssl_async_operation_context_t;
 
@@ -1149,6 +1167,7 @@ static const char *const ssl_async_operation_names[] =
 {
     "sign",
     "decrypt",
+    "key agreement",
 };
 
 static int ssl_async_start(mbedtls_ssl_context *ssl,
@@ -1240,6 +1259,87 @@ static int ssl_async_decrypt(mbedtls_ssl_context *ssl,
                            input, input_len);
 }
 
+#if defined(SSL_ASYNC_KEY_AGREEMENT)
+static int ssl_async_key_agreement(mbedtls_ssl_context *ssl,
+                                   uint16_t group,
+                                   const unsigned char *own_key,
+                                   size_t own_key_len,
+                                   const unsigned char *peer_key,
+                                   size_t peer_key_len)
+{
+    ssl_async_key_context_t *config_data =
+        mbedtls_ssl_conf_get_async_config_data(ssl->conf);
+    ssl_async_operation_context_t *ctx = NULL;
+
+    mbedtls_printf("Async key agreement callback: group 0x%04x, delay=%u.\n",
+                   (unsigned) group, config_data->key_agreement_delay);
+
+    if (config_data->inject_error == SSL_ASYNC_INJECT_ERROR_START) {
+        mbedtls_printf("Async key agreement callback: injected error\n");
+        return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+    }
+
+    if (own_key_len + peer_key_len > SSL_ASYNC_INPUT_MAX_SIZE) {
+        return MBEDTLS_ERR_SSL_BAD_INPUT_DATA;
+    }
+
+    ctx = mbedtls_calloc(1, sizeof(*ctx));
+    if (ctx == NULL) {
+        return MBEDTLS_ERR_SSL_ALLOC_FAILED;
+    }
+    ctx->operation_type = ASYNC_OP_KEY_AGREEMENT;
+    ctx->group = group;
+    memcpy(ctx->input, own_key, own_key_len);
+    memcpy(ctx->input + own_key_len, peer_key, peer_key_len);
+    ctx->own_key_len = own_key_len;
+    ctx->input_len = own_key_len + peer_key_len;
+    ctx->remaining_delay = config_data->key_agreement_delay;
+    mbedtls_ssl_set_async_operation_data(ssl, ctx);
+
+    if (ctx->remaining_delay == 0) {
+        return 0;
+    } else {
+        return MBEDTLS_ERR_SSL_ASYNC_IN_PROGRESS;
+    }
+}
+
+/* The "external processor" is PSA here, with a copy of the ephemeral key */
+static int ssl_async_compute_shared_secret(ssl_async_operation_context_t *ctx,
+                                           unsigned char *output,
+                                           size_t *output_len,
+                                           size_t output_size)
+{
+    psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+    mbedtls_svc_key_id_t key = MBEDTLS_SVC_KEY_ID_INIT;
+    const mbedtls_ecp_curve_info *curve_info;
+    psa_ecc_family_t family;
+    size_t bits;
+    psa_status_t status;
+
+    curve_info = mbedtls_ecp_curve_info_from_tls_id(ctx->group);
+    if (curve_info == NULL) {
+        return MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+    }
+    family = mbedtls_ecc_group_to_psa(curve_info->grp_id, &bits);
+    psa_set_key_usage_flags(&attributes, PSA_KEY_USAGE_DERIVE);
+    psa_set_key_algorithm(&attributes, PSA_ALG_ECDH);
+    psa_set_key_type(&attributes, PSA_KEY_TYPE_ECC_KEY_PAIR(family));
+    psa_set_key_bits(&attributes, bits);
+
+    status = psa_import_key(&attributes, ctx->input, ctx->own_key_len, &key);
+    if (status == PSA_SUCCESS) {
+        status = psa_raw_key_agreement(PSA_ALG_ECDH, key,
+                                       ctx->input + ctx->own_key_len,
+                                       ctx->input_len - ctx->own_key_len,
+                                       output, output_size, output_len);
+        psa_destroy_key(key);
+    }
+    mbedtls_platform_zeroize(ctx->input, sizeof(ctx->input));
+
+    return status == PSA_SUCCESS ? 0 : MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+}
+#endif /* SSL_ASYNC_KEY_AGREEMENT */
+
 static int ssl_async_resume(mbedtls_ssl_context *ssl,
                             unsigned char *output,
                             size_t *output_len,
@@ -1267,12 +1367,33 @@ static int ssl_async_resume(mbedtls_ssl_context *ssl,
                                      config_data->f_rng, config_data->p_rng);
             break;
         case ASYNC_OP_SIGN:
+#if defined(MBEDTLS_SSL_PROTO_TLS1_3)
+            /* TLS 1.3 only signs with RSA-PSS */
+            if (mbedtls_ssl_get_version_number(ssl) ==
+                MBEDTLS_SSL_VERSION_TLS1_3 &&
+                mbedtls_pk_can_do(key_slot->pk, MBEDTLS_PK_RSA)) {
+                ret = mbedtls_pk_sign_ext(MBEDTLS_PK_RSASSA_PSS,
+                                          key_slot->pk,
+                                          ctx->md_alg,
+                                          ctx->input, ctx->input_len,
+                                          output, output_size, output_len,
+                                          config_data->f_rng,
+                                          config_data->p_rng);
+                break;
+            }
+#endif /* MBEDTLS_SSL_PROTO_TLS1_3 */
             ret = mbedtls_pk_sign(key_slot->pk,
                                   ctx->md_alg,
                                   ctx->input, ctx->input_len,
                                   output, output_size, output_len,
                                   config_data->f_rng, config_data->p_rng);
             break;
+#if defined(SSL_ASYNC_KEY_AGREEMENT)
+        case ASYNC_OP_KEY_AGREEMENT:
+            ret = ssl_async_compute_shared_secret(ctx, output, output_len,
+                                                  output_size);
+            break;
+#endif
         default:
             mbedtls_printf(
                 "Async resume (slot %u): unknown operation type %ld. This shouldn't happen.\n",
@@ -1485,6 +1606,9 @@ int main(int argc, char *argv[])
 #if defined(MBEDTLS_SSL_COOKIE_C)
     mbedtls_ssl_cookie_ctx cookie_ctx;
 #endif
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+    mbedtls_ssl_early_data_replay_context early_data_replay;
+#endif
 
     mbedtls_ssl_context ssl;
     mbedtls_ssl_config conf;
@@ -1623,6 +1747,9 @@ int main(int argc, char *argv[])
 #if defined(MBEDTLS_SSL_COOKIE_C)
     mbedtls_ssl_cookie_init(&cookie_ctx);
 #endif
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+    mbedtls_ssl_early_data_replay_init(&early_data_replay);
+#endif
 
 #if defined(MBEDTLS_USE_PSA_CRYPTO) || defined(MBEDTLS_SSL_PROTO_TLS1_3)
     status = psa_crypto_init();
@@ -1691,6 +1818,7 @@ usage:
     opt.key_pwd2            = DFL_KEY_PWD2;
     opt.async_operations    = DFL_ASYNC_OPERATIONS;
     opt.async_private_delay1 = DFL_ASYNC_PRIVATE_DELAY1;
+    opt.async_key_agreement_delay = DFL_ASYNC_KEY_AGREEMENT_DELAY;
     opt.async_private_delay2 = DFL_ASYNC_PRIVATE_DELAY2;
     opt.async_private_error = DFL_ASYNC_PRIVATE_ERROR;
     opt.psk                 = DFL_PSK;
@@ -1853,6 +1981,11 @@ usage:
             opt.async_operations = q;
         } else if (strcmp(p, "async_private_delay1") == 0) {
             opt.async_private_delay1 = atoi(q);
+        } else if (strcmp(p, "async_key_agreement_delay") == 0) {
+            opt.async_key_agreement_delay = atoi(q);
+            if (opt.async_key_agreement_delay < 0) {
+                goto usage;
+            }
         } else if (strcmp(p, "async_private_delay2") == 0) {
             opt.async_private_delay2 = atoi(q);
         } else if (strcmp(p, "async_private_error") == 0) {
@@ -2798,6 +2931,19 @@ usage:
     if (tls13_early_data_enabled == MBEDTLS_SSL_EARLY_DATA_ENABLED) {
         mbedtls_ssl_tls13_conf_max_early_data_size(
             &conf, opt.max_early_data_size);
+
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+        /* Early data is only accepted with an anti-replay filter */
+        if ((ret = mbedtls_ssl_early_data_replay_setup(&early_data_replay,
+                                                       60, 1000)) != 0) {
+            mbedtls_printf(" failed\n  ! mbedtls_ssl_early_data_replay_setup returned %d\n\n",
+                           ret);
+            goto exit;
+        }
+        mbedtls_ssl_tls13_conf_early_data_replay(&conf,
+                                                 mbedtls_ssl_early_data_replay_check,
+                                                 &early_data_replay);
+#endif /* MBEDTLS_SSL_EARLY_DATA_REPLAY_C */
     }
 #endif /* MBEDTLS_SSL_EARLY_DATA */
 
@@ -3098,11 +3244,18 @@ usage:
                 case 's':
                     sign = ssl_async_sign;
                     break;
+#if defined(SSL_ASYNC_KEY_AGREEMENT)
+                case 'k':
+                    mbedtls_ssl_conf_async_key_agreement_cb(
+                        &conf, ssl_async_key_agreement);
+                    break;
+#endif
             }
         }
         ssl_async_keys.inject_error = (opt.async_private_error < 0 ?
                                        -opt.async_private_error :
                                        opt.async_private_error);
+        ssl_async_keys.key_agreement_delay = opt.async_key_agreement_delay;
         ssl_async_keys.f_rng = rng_get;
         ssl_async_keys.p_rng = &rng;
         mbedtls_ssl_conf_async_private_cb(&conf,
@@ -4176,6 +4329,9 @@ exit:
 #if defined(MBEDTLS_SSL_COOKIE_C)
     mbedtls_ssl_cookie_free(&cookie_ctx);
 #endif
+#if defined(MBEDTLS_SSL_EARLY_DATA_REPLAY_C)
+    mbedtls_ssl_early_data_replay_free(&early_data_replay);
+#endif
 
 #if defined(MBEDTLS_SSL_CONTEXT_SERIALIZATION)
     if (context_buf != NULL) {
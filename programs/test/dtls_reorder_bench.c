@@ -0,0 +1,453 @@
+/*
+ *  Measure how DTLS anti-replay copes with reordered application data
+ *
+ *  Copyright The Mbed TLS Contributors
+ *  SPDX-License-Identifier: Apache-2.0
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ */
+
+/*
+ * The client sends a stream of numbered ApplicationData records and no
+ * other traffic; the server counts how many distinct records it delivers
+ * and how much CPU time it spends doing so. Run the two ends through
+ * udp_proxy with the reorder option to see how many records a given
+ * MBEDTLS_SSL_DTLS_REPLAY_WINDOW rejects as too old.
+ */
+
+#include "mbedtls/build_info.h"
+
+#include "mbedtls/platform.h"
+
+#if !defined(MBEDTLS_SSL_SRV_C) || !defined(MBEDTLS_SSL_CLI_C) ||          \
+    !defined(MBEDTLS_SSL_PROTO_DTLS) || !defined(MBEDTLS_NET_C) ||         \
+    !defined(MBEDTLS_ENTROPY_C) || !defined(MBEDTLS_CTR_DRBG_C) ||         \
+    !defined(MBEDTLS_TIMING_C) ||                                          \
+    !defined(MBEDTLS_KEY_EXCHANGE_PSK_ENABLED)
+
+int main(void)
+{
+    mbedtls_printf("MBEDTLS_SSL_SRV_C and/or MBEDTLS_SSL_CLI_C and/or "
+                   "MBEDTLS_SSL_PROTO_DTLS and/or MBEDTLS_NET_C and/or "
+                   "MBEDTLS_ENTROPY_C and/or MBEDTLS_CTR_DRBG_C and/or "
+                   "MBEDTLS_TIMING_C and/or "
+                   "MBEDTLS_KEY_EXCHANGE_PSK_ENABLED not defined.\n");
+    mbedtls_exit(0);
+}
+#else
+
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "mbedtls/entropy.h"
+#include "mbedtls/ctr_drbg.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/timing.h"
+
+#define DFL_SERVER_ADDR         "localhost"
+#define DFL_SERVER_PORT         "4433"
+#define DFL_RECORDS             10000
+#define DFL_SIZE                64
+#define DFL_GAP                 50
+
+#define MAX_SIZE                1024
+#define HANDSHAKE_TIMEOUT_MS    10000
+#define IDLE_TIMEOUT_MS         1000
+
+#define USAGE                                                               \
+    "\n usage: dtls_reorder_bench mode=<client|server> param=<>...\n"       \
+    "\n acceptable parameters:\n"                                           \
+    "    server_addr=%%s      default: localhost\n"                         \
+    "    server_port=%%d      default: 4433\n"                              \
+    "    records=%%d          default: 10000 (client only)\n"               \
+    "                        number of records to send\n"                   \
+    "    size=%%d             default: 64 (client only)\n"                  \
+    "                        payload of each record, 8 to 1024 bytes\n"     \
+    "    gap=%%d              default: 50 (client only)\n"                  \
+    "                        microseconds to wait after each record\n"      \
+    "\n"
+
+static const unsigned char psk[16] = {
+    0x6d, 0x62, 0x65, 0x64, 0x74, 0x6c, 0x73, 0x2d,
+    0x72, 0x65, 0x6f, 0x72, 0x64, 0x65, 0x72, 0x21
+};
+static const char psk_identity[] = "dtls_reorder_bench";
+
+static const int ciphersuites[] = {
+    MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_PSK_WITH_AES_128_CCM_8,
+    MBEDTLS_TLS_PSK_WITH_AES_128_CBC_SHA256,
+    0
+};
+
+static struct options {
+    int is_server;              /* run the receiving end                    */
+    const char *server_addr;    /* address of the server or of the proxy    */
+    const char *server_port;    /* port of the server or of the proxy       */
+    unsigned records;           /* number of records to send                */
+    unsigned size;              /* payload length of each record            */
+    unsigned gap;               /* pause after each record, in microseconds */
+} opt;
+
+static void put_u32(unsigned char *p, uint32_t n)
+{
+    p[0] = (unsigned char) (n >> 24);
+    p[1] = (unsigned char) (n >> 16);
+    p[2] = (unsigned char) (n >>  8);
+    p[3] = (unsigned char) (n);
+}
+
+static uint32_t get_u32(const unsigned char *p)
+{
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+           ((uint32_t) p[2] <<  8) | ((uint32_t) p[3]);
+}
+
+static void exit_usage(const char *name, const char *value)
+{
+    if (value == NULL) {
+        mbedtls_printf(" unknown option or missing value: %s\n", name);
+    } else {
+        mbedtls_printf(" option %s: illegal value: %s\n", name, value);
+    }
+
+    mbedtls_printf(USAGE);
+    mbedtls_exit(1);
+}
+
+static void get_options(int argc, char *argv[])
+{
+    int i;
+    char *p, *q;
+
+    opt.is_server   = -1;
+    opt.server_addr = DFL_SERVER_ADDR;
+    opt.server_port = DFL_SERVER_PORT;
+    opt.records     = DFL_RECORDS;
+    opt.size        = DFL_SIZE;
+    opt.gap         = DFL_GAP;
+
+    for (i = 1; i < argc; i++) {
+        p = argv[i];
+        if ((q = strchr(p, '=')) == NULL) {
+            exit_usage(p, NULL);
+        }
+        *q++ = '\0';
+
+        if (strcmp(p, "mode") == 0) {
+            if (strcmp(q, "client") == 0) {
+                opt.is_server = 0;
+            } else if (strcmp(q, "server") == 0) {
+                opt.is_server = 1;
+            } else {
+                exit_usage(p, q);
+            }
+        } else if (strcmp(p, "server_addr") == 0) {
+            opt.server_addr = q;
+        } else if (strcmp(p, "server_port") == 0) {
+            opt.server_port = q;
+        } else if (strcmp(p, "records") == 0) {
+            opt.records = (unsigned) atoi(q);
+            if (atoi(q) < 1) {
+                exit_usage(p, q);
+            }
+        } else if (strcmp(p, "size") == 0) {
+            opt.size = (unsigned) atoi(q);
+            if (atoi(q) < 8 || opt.size > MAX_SIZE) {
+                exit_usage(p, q);
+            }
+        } else if (strcmp(p, "gap") == 0) {
+            opt.gap = (unsigned) atoi(q);
+            if (atoi(q) < 0) {
+                exit_usage(p, q);
+            }
+        } else {
+            exit_usage(p, NULL);
+        }
+    }
+
+    if (opt.is_server == -1) {
+        exit_usage("mode", NULL);
+    }
+}
+
+/*
+ * Each record starts with its index and the total number of records, so that
+ * the server needs no other information to tell how many went missing.
+ */
+static int send_records(mbedtls_ssl_context *ssl)
+{
+    int ret;
+    unsigned i;
+    unsigned char buf[MAX_SIZE];
+
+    memset(buf, 'R', sizeof(buf));
+    put_u32(buf + 4, opt.records);
+
+    for (i = 0; i < opt.records; i++) {
+        put_u32(buf, i);
+
+        do {
+            ret = mbedtls_ssl_write(ssl, buf, opt.size);
+        } while (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+                 ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+        if (ret < 0) {
+            mbedtls_printf(" failed\n  ! mbedtls_ssl_write returned -0x%x\n\n",
+                           (unsigned int) -ret);
+            return ret;
+        }
+
+        if (opt.gap != 0) {
+            mbedtls_net_usleep(opt.gap);
+        }
+    }
+
+    mbedtls_printf("  > Sent %u records of %u bytes\n", opt.records, opt.size);
+
+    return 0;
+}
+
+static int receive_records(mbedtls_ssl_context *ssl, mbedtls_ssl_config *conf)
+{
+    int ret;
+    unsigned char buf[MAX_SIZE];
+    unsigned char *seen = NULL;
+    uint32_t idx, total = 0;
+    unsigned received = 0, duplicates = 0;
+    clock_t start = 0, cpu;
+
+    /* The stream ends with close_notify, or when the proxy withholds it */
+    mbedtls_ssl_conf_read_timeout(conf, IDLE_TIMEOUT_MS);
+
+    while (1) {
+        ret = mbedtls_ssl_read(ssl, buf, sizeof(buf));
+
+        if (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+            ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+            continue;
+        }
+        if (ret == MBEDTLS_ERR_SSL_TIMEOUT ||
+            ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY) {
+            break;
+        }
+        if (ret < 0) {
+            mbedtls_printf("  ! mbedtls_ssl_read returned -0x%x\n\n",
+                           (unsigned int) -ret);
+            goto exit;
+        }
+        if (ret < 8) {
+            continue;
+        }
+
+        if (seen == NULL) {
+            total = get_u32(buf + 4);
+            if (total == 0 || (seen = mbedtls_calloc(1, total)) == NULL) {
+                mbedtls_printf("  ! cannot track %u records\n\n",
+                               (unsigned) total);
+                ret = MBEDTLS_ERR_SSL_ALLOC_FAILED;
+                goto exit;
+            }
+            start = clock();
+        }
+
+        idx = get_u32(buf);
+        if (idx >= total) {
+            continue;
+        }
+        if (seen[idx]) {
+            duplicates++;
+        } else {
+            seen[idx] = 1;
+            received++;
+        }
+    }
+
+    cpu = clock() - start;
+
+    if (total == 0) {
+        mbedtls_printf("  ! no record received\n\n");
+        ret = -1;
+        goto exit;
+    }
+
+    mbedtls_printf("  < Received %u of %u records, %u dropped (%.2f%%), "
+                   "%u duplicates\n",
+                   received, (unsigned) total, (unsigned) total - received,
+                   100.0 * (total - received) / total, duplicates);
+    mbedtls_printf("  < CPU time %.1f ms, %.2f us per received record "
+                   "(window %d)\n",
+                   1000.0 * cpu / CLOCKS_PER_SEC,
+                   received == 0 ? 0.0 :
+                   1e6 * cpu / CLOCKS_PER_SEC / received,
+                   MBEDTLS_SSL_DTLS_REPLAY_WINDOW);
+
+    ret = 0;
+
+exit:
+    mbedtls_free(seen);
+    return ret;
+}
+
+int main(int argc, char *argv[])
+{
+    int ret = 1;
+    int exit_code = MBEDTLS_EXIT_FAILURE;
+    const char *pers = "dtls_reorder_bench";
+    unsigned char client_ip[16] = { 0 };
+    size_t cliip_len;
+    mbedtls_net_context listen_fd, fd;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+    mbedtls_timing_delay_context timer;
+
+    mbedtls_net_init(&listen_fd);
+    mbedtls_net_init(&fd);
+    mbedtls_ssl_init(&ssl);
+    mbedtls_ssl_config_init(&conf);
+    mbedtls_entropy_init(&entropy);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        mbedtls_printf("  ! psa_crypto_init failed\n");
+        goto exit;
+    }
+#endif /* MBEDTLS_USE_PSA_CRYPTO */
+
+    get_options(argc, argv);
+
+    if ((ret = mbedtls_ctr_drbg_seed(&ctr_drbg, mbedtls_entropy_func, &entropy,
+                                     (const unsigned char *) pers,
+                                     strlen(pers))) != 0) {
+        mbedtls_printf("  ! mbedtls_ctr_drbg_seed returned -0x%x\n",
+                       (unsigned int) -ret);
+        goto exit;
+    }
+
+    if ((ret = mbedtls_ssl_config_defaults(&conf,
+                                           opt.is_server ?
+                                           MBEDTLS_SSL_IS_SERVER :
+                                           MBEDTLS_SSL_IS_CLIENT,
+                                           MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
+        mbedtls_printf("  ! mbedtls_ssl_config_defaults returned -0x%x\n",
+                       (unsigned int) -ret);
+        goto exit;
+    }
+
+    mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctr_drbg);
+    mbedtls_ssl_conf_read_timeout(&conf, HANDSHAKE_TIMEOUT_MS);
+    mbedtls_ssl_conf_ciphersuites(&conf, ciphersuites);
+    mbedtls_ssl_conf_max_tls_version(&conf, MBEDTLS_SSL_VERSION_TLS1_2);
+#if defined(MBEDTLS_SSL_SRV_C) && defined(MBEDTLS_SSL_DTLS_HELLO_VERIFY)
+    /* One client on a trusted path: skip the cookie exchange */
+    mbedtls_ssl_conf_dtls_cookies(&conf, NULL, NULL, NULL);
+#endif
+
+    if ((ret = mbedtls_ssl_conf_psk(&conf, psk, sizeof(psk),
+                                    (const unsigned char *) psk_identity,
+                                    strlen(psk_identity))) != 0) {
+        mbedtls_printf("  ! mbedtls_ssl_conf_psk returned -0x%x\n",
+                       (unsigned int) -ret);
+        goto exit;
+    }
+
+    if ((ret = mbedtls_ssl_setup(&ssl, &conf)) != 0) {
+        mbedtls_printf("  ! mbedtls_ssl_setup returned -0x%x\n",
+                       (unsigned int) -ret);
+        goto exit;
+    }
+
+    mbedtls_ssl_set_timer_cb(&ssl, &timer, mbedtls_timing_set_delay,
+                             mbedtls_timing_get_delay);
+
+    if (opt.is_server) {
+        mbedtls_printf("  . Waiting for a client on udp/%s/%s ...",
+                       opt.server_addr, opt.server_port);
+        fflush(stdout);
+
+        if ((ret = mbedtls_net_bind(&listen_fd, opt.server_addr,
+                                    opt.server_port,
+                                    MBEDTLS_NET_PROTO_UDP)) != 0 ||
+            (ret = mbedtls_net_accept(&listen_fd, &fd, client_ip,
+                                      sizeof(client_ip), &cliip_len)) != 0) {
+            mbedtls_printf(" failed\n  ! returned -0x%x\n",
+                           (unsigned int) -ret);
+            goto exit;
+        }
+    } else {
+        mbedtls_printf("  . Connecting to udp/%s/%s ...",
+                       opt.server_addr, opt.server_port);
+        fflush(stdout);
+
+        if ((ret = mbedtls_net_connect(&fd, opt.server_addr, opt.server_port,
+                                       MBEDTLS_NET_PROTO_UDP)) != 0) {
+            mbedtls_printf(" failed\n  ! mbedtls_net_connect returned -0x%x\n",
+                           (unsigned int) -ret);
+            goto exit;
+        }
+    }
+
+    mbedtls_ssl_set_bio(&ssl, &fd, mbedtls_net_send, mbedtls_net_recv,
+                        mbedtls_net_recv_timeout);
+
+    do {
+        ret = mbedtls_ssl_handshake(&ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+             ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+    if (ret != 0) {
+        mbedtls_printf(" failed\n  ! mbedtls_ssl_handshake returned -0x%x\n",
+                       (unsigned int) -ret);
+        goto exit;
+    }
+
+    mbedtls_printf(" ok (%s)\n", mbedtls_ssl_get_ciphersuite(&ssl));
+
+    if (opt.is_server) {
+        ret = receive_records(&ssl, &conf);
+    } else {
+        ret = send_records(&ssl);
+    }
+    if (ret != 0) {
+        goto exit;
+    }
+
+    /* No error checking, the peer may be gone already */
+    do {
+        ret = mbedtls_ssl_close_notify(&ssl);
+    } while (ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+
+    exit_code = MBEDTLS_EXIT_SUCCESS;
+
+exit:
+    mbedtls_net_free(&fd);
+    mbedtls_net_free(&listen_fd);
+    mbedtls_ssl_free(&ssl);
+    mbedtls_ssl_config_free(&conf);
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+#if defined(MBEDTLS_USE_PSA_CRYPTO)
+    mbedtls_psa_crypto_free();
+#endif /* MBEDTLS_USE_PSA_CRYPTO */
+
+    mbedtls_exit(exit_code);
+}
+#endif /* MBEDTLS_SSL_SRV_C && MBEDTLS_SSL_CLI_C && MBEDTLS_SSL_PROTO_DTLS &&
+          MBEDTLS_NET_C && MBEDTLS_ENTROPY_C && MBEDTLS_CTR_DRBG_C &&
+          MBEDTLS_TIMING_C && MBEDTLS_KEY_EXCHANGE_PSK_ENABLED */
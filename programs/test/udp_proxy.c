@@ -136,6 +136,9 @@ int main(void)
     "    protect_hvr=0/1     default: 0 (don't protect HelloVerifyRequest)\n" \
     "    protect_len=%%d      default: (don't protect packets of this size)\n" \
     "    inject_clihlo=0/1   default: 0 (don't inject fake ClientHello)\n"  \
+    "    reorder=%%d          default: 0 (don't reorder)\n"                 \
+    "                        hold up to N ApplicationData or CID packets\n" \
+    "                        and forward them in random order\n"           \
     "\n"                                                                    \
     "    seed=%%d             default: (use current time)\n"                \
     USAGE_PACK                                                              \
@@ -146,6 +149,7 @@ int main(void)
  */
 
 #define MAX_DELAYED_HS 10
+#define MAX_REORDERED  1024
 
 static struct options {
     const char *server_addr;    /* address to forward packets to            */
@@ -169,6 +173,7 @@ static struct options {
     int protect_hvr;            /* never drop or delay HelloVerifyRequest   */
     int protect_len;            /* never drop/delay packet of the given size*/
     int inject_clihlo;          /* inject fake ClientHello after handshake  */
+    int reorder;                /* shuffle up to N ApplicationData packets  */
     unsigned pack;              /* merge packets into single datagram for
                                  * at most \c merge milliseconds if > 0     */
     unsigned int seed;          /* seed for "random" events                 */
@@ -306,6 +311,11 @@ static void get_options(int argc, char *argv[])
             if (opt.inject_clihlo < 0 || opt.inject_clihlo > 1) {
                 exit_usage(p, q);
             }
+        } else if (strcmp(p, "reorder") == 0) {
+            opt.reorder = atoi(q);
+            if (opt.reorder < 0 || opt.reorder > MAX_REORDERED) {
+                exit_usage(p, q);
+            }
         } else if (strcmp(p, "seed") == 0) {
             opt.seed = atoi(q);
             if (opt.seed == 0) {
@@ -659,6 +669,56 @@ int send_delayed()
     return 0;
 }
 
+/*
+ * Reordering of application data: packets are held in a pool of opt.reorder
+ * slots. Once the pool is full, each new packet is either forwarded at once
+ * or swapped with a random packet from the pool, so that a packet may arrive
+ * arbitrarily late, but usually within a few times opt.reorder packets.
+ * Anything else going through the proxy first flushes the pool, so that
+ * a closing alert doesn't overtake the data that precedes it.
+ */
+static packet *reordered;
+static size_t reordered_len;
+
+int reorder_packet(packet *cur)
+{
+    int ret;
+    size_t idx;
+
+    if (reordered_len < (size_t) opt.reorder) {
+        memcpy(&reordered[reordered_len++], cur, sizeof(packet));
+        return 0;
+    }
+
+    idx = (size_t) rand() % (reordered_len + 1);
+    if (idx == reordered_len) {
+        return send_packet(cur, "forwarded");
+    }
+
+    if ((ret = send_packet(&reordered[idx], "reordered")) != 0) {
+        return ret;
+    }
+    memcpy(&reordered[idx], cur, sizeof(packet));
+
+    return 0;
+}
+
+int send_reordered(void)
+{
+    int ret;
+
+    while (reordered_len > 0) {
+        size_t idx = (size_t) rand() % reordered_len;
+
+        if ((ret = send_packet(&reordered[idx], "reordered")) != 0) {
+            return ret;
+        }
+        memcpy(&reordered[idx], &reordered[--reordered_len], sizeof(packet));
+    }
+
+    return 0;
+}
+
 /*
  * Avoid dropping or delaying a packet that was already dropped or delayed
  * ("held") twice: this only results in uninteresting timeouts. We can't rely
@@ -729,6 +789,17 @@ int handle_message(const char *way,
         }
     }
 
+    if (opt.reorder != 0) {
+        if (strcmp(cur.type, "CID") == 0 ||
+            strcmp(cur.type, "ApplicationData") == 0) {
+            return reorder_packet(&cur);
+        }
+
+        if ((ret = send_reordered()) != 0) {
+            return ret;
+        }
+    }
+
     /* do we want to drop, delay, or forward it? */
     if ((opt.mtu != 0 &&
          cur.len > (unsigned) opt.mtu) ||
@@ -811,6 +882,14 @@ int main(int argc, char *argv[])
 
     srand(opt.seed);
 
+    if (opt.reorder != 0) {
+        reordered = mbedtls_calloc((size_t) opt.reorder, sizeof(packet));
+        if (reordered == NULL) {
+            mbedtls_printf("  ! Allocation failure\n");
+            goto exit;
+        }
+    }
+
     /*
      * 0. "Connect" to the server
      */
@@ -862,6 +941,7 @@ accept:
      * 3. Forward packets forever (kill the process to terminate it)
      */
     clear_pending();
+    reordered_len = 0;
     memset(held, 0, sizeof(held));
 
     nb_fds = client_fd.fd;
@@ -969,6 +1049,8 @@ exit:
         mbedtls_free(opt.delay_srv[delay_idx]);
     }
 
+    mbedtls_free(reordered);
+
     mbedtls_net_free(&client_fd);
     mbedtls_net_free(&server_fd);
     mbedtls_net_free(&listen_fd);
@@ -209,9 +209,15 @@ EXCLUDE_FROM_FULL = frozenset([
     'MBEDTLS_PSA_CRYPTO_KEY_ID_ENCODES_OWNER', # incompatible with USE_PSA_CRYPTO
     'MBEDTLS_PSA_CRYPTO_SPM', # platform dependency (PSA SPM)
     'MBEDTLS_PSA_INJECT_ENTROPY', # build dependency (hook functions)
+    'MBEDTLS_PSA_ITS_JOURNAL_C', # conflicts with MBEDTLS_PSA_ITS_FILE_C
+    'MBEDTLS_PSA_ITS_MMAP_C', # conflicts with MBEDTLS_PSA_ITS_FILE_C
+    'MBEDTLS_PSA_KEY_CONTEXT_CACHE', # conflicts with MBEDTLS_PSA_CRYPTO_DRIVERS
     'MBEDTLS_RSA_NO_CRT', # influences the use of RSA in X.509 and TLS
     'MBEDTLS_SHA256_USE_A64_CRYPTO_ONLY', # interacts with *_USE_A64_CRYPTO_IF_PRESENT
     'MBEDTLS_SHA512_USE_A64_CRYPTO_ONLY', # interacts with *_USE_A64_CRYPTO_IF_PRESENT
+    'MBEDTLS_SSL_IDLE_BUFFER_RELEASE', # conflicts with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
+    'MBEDTLS_SSL_PARALLEL_ENCRYPTION', # conflicts with MBEDTLS_USE_PSA_CRYPTO
+    'MBEDTLS_SSL_RECORD_BATCHING', # conflicts with MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
     'MBEDTLS_TEST_CONSTANT_FLOW_MEMSAN', # build dependency (clang+memsan)
     'MBEDTLS_TEST_CONSTANT_FLOW_VALGRIND', # build dependency (valgrind headers)
     'MBEDTLS_X509_REMOVE_INFO', # removes a feature
@@ -267,6 +273,11 @@ EXCLUDE_FROM_BAREMETAL = frozenset([
     'MBEDTLS_PSA_CRYPTO_SE_C', # requires a filesystem and PSA_CRYPTO_STORAGE_C
     'MBEDTLS_PSA_CRYPTO_STORAGE_C', # requires a filesystem
     'MBEDTLS_PSA_ITS_FILE_C', # requires a filesystem
+    'MBEDTLS_PSA_ITS_JOURNAL_C', # requires a filesystem
+    'MBEDTLS_PSA_ITS_MMAP_C', # requires a filesystem and mmap()
+    'MBEDTLS_SSL_CACHE_SHM_C', # requires mmap() and pthread
+    'MBEDTLS_SSL_KEY_SHARE_POOL_C', # requires pthread
+    'MBEDTLS_SSL_WORKER_POOL_C', # requires pthread
     'MBEDTLS_THREADING_C', # requires a threading interface
     'MBEDTLS_THREADING_PTHREAD', # requires pthread
     'MBEDTLS_TIMING_C', # requires a clock
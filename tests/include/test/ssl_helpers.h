@@ -44,6 +44,10 @@
 #include "mbedtls/ssl_cache.h"
 #endif
 
+#if defined(MBEDTLS_SSL_BUFFER_POOL_C)
+#include "mbedtls/ssl_buffer_pool.h"
+#endif
+
 #if defined(MBEDTLS_USE_PSA_CRYPTO)
 #define PSA_TO_MBEDTLS_ERR(status) PSA_TO_MBEDTLS_ERR_LIST(status, \
                                                            psa_to_ssl_errors, \
@@ -99,6 +103,9 @@ typedef struct mbedtls_test_handshake_test_options {
 #if defined(MBEDTLS_SSL_CACHE_C)
     mbedtls_ssl_cache_context *cache;
 #endif
+#if defined(MBEDTLS_SSL_IDLE_BUFFER_RELEASE) && defined(MBEDTLS_SSL_BUFFER_POOL_C)
+    mbedtls_ssl_buffer_pool *buffer_pool;
+#endif
 } mbedtls_test_handshake_test_options;
 
 typedef struct mbedtls_test_ssl_buffer {
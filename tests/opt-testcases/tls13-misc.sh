@@ -493,3 +493,37 @@ run_test "TLS 1.3 m->m: Resumption with ticket flags, psk_all/psk_all." \
          -S "No suitable key exchange mode" \
          -s "found matched identity"
 
+
+requires_all_configs_enabled MBEDTLS_SSL_EARLY_DATA MBEDTLS_SSL_EARLY_DATA_REPLAY_C \
+                             MBEDTLS_SSL_SESSION_TICKETS \
+                             MBEDTLS_SSL_SRV_C MBEDTLS_SSL_CLI_C MBEDTLS_DEBUG_C \
+                             MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED \
+                             MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_PSK_EPHEMERAL_ENABLED
+run_test "TLS 1.3 m->m: EarlyData: accepted" \
+         "$P_SRV debug_level=4 crt_file=data_files/server2-sha256.crt key_file=data_files/server2.key force_version=tls13 max_early_data_size=1024" \
+         "$P_CLI debug_level=4 early_data=1 reco_mode=1 reconnect=1" \
+         0 \
+         -c "Reconnecting with saved session" \
+         -c "NewSessionTicket: early_data(42) extension exists." \
+         -c "ClientHello: early_data(42) extension exists." \
+         -c "EncryptedExtensions: early_data(42) extension exists." \
+         -c "bytes of early data accepted" \
+         -s "EarlyData: accepted." \
+         -s "<= parse end_of_early_data"
+
+requires_all_configs_enabled MBEDTLS_SSL_EARLY_DATA MBEDTLS_SSL_EARLY_DATA_REPLAY_C \
+                             MBEDTLS_SSL_SESSION_TICKETS \
+                             MBEDTLS_SSL_SRV_C MBEDTLS_SSL_CLI_C MBEDTLS_DEBUG_C \
+                             MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED \
+                             MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_PSK_EPHEMERAL_ENABLED \
+                             MBEDTLS_ECP_DP_SECP256R1_ENABLED MBEDTLS_ECP_DP_SECP384R1_ENABLED
+run_test "TLS 1.3 m->m: EarlyData: rejected after HelloRetryRequest" \
+         "$P_SRV debug_level=4 crt_file=data_files/server2-sha256.crt key_file=data_files/server2.key force_version=tls13 max_early_data_size=1024 curves=secp384r1" \
+         "$P_CLI debug_level=4 early_data=1 reco_mode=1 reconnect=1 curves=secp256r1,secp384r1" \
+         0 \
+         -c "Reconnecting with saved session" \
+         -c "ClientHello: early_data(42) extension exists." \
+         -c "bytes of early data rejected" \
+         -s "EarlyData: rejected, HelloRetryRequest required." \
+         -s "EarlyData: skip record before the second ClientHello" \
+         -S "EarlyData: accepted."
@@ -1004,6 +1004,49 @@ component_test_psa_crypto_client () {
     make test
 }
 
+component_test_psa_its_journal () {
+    msg "build: default config + PSA_ITS_JOURNAL_C - PSA_ITS_FILE_C, cmake, gcc, ASan"
+    scripts/config.py unset MBEDTLS_PSA_ITS_FILE_C
+    scripts/config.py set MBEDTLS_PSA_ITS_JOURNAL_C
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + PSA_ITS_JOURNAL_C - PSA_ITS_FILE_C, cmake, gcc, ASan"
+    make test
+
+    # Run the journal tests again with the journal on a tmpfs, so that the
+    # crash recovery tests don't depend on the build directory's file system.
+    if [ -d /dev/shm ] && [ -w /dev/shm ]; then
+        msg "test: PSA ITS journal crash recovery on tmpfs"
+        journal_dir=$(mktemp -d /dev/shm/psa_its_journal.XXXXXX)
+        (cd "$journal_dir" &&
+         "$OLDPWD/tests/test_suite_psa_its_journal" \
+             "$OLDPWD/tests/test_suite_psa_its_journal.datax")
+        rm -rf "$journal_dir"
+    fi
+}
+
+component_test_psa_its_mmap () {
+    msg "build: default config + PSA_ITS_MMAP_C - PSA_ITS_FILE_C, cmake, gcc, ASan"
+    scripts/config.py unset MBEDTLS_PSA_ITS_FILE_C
+    scripts/config.py set MBEDTLS_PSA_ITS_MMAP_C
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + PSA_ITS_MMAP_C - PSA_ITS_FILE_C, cmake, gcc, ASan"
+    make test
+}
+
+component_test_psa_key_context_cache () {
+    msg "build: default config + PSA_KEY_CONTEXT_CACHE, cmake, gcc, ASan"
+    scripts/config.py set MBEDTLS_PSA_KEY_CONTEXT_CACHE
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + PSA_KEY_CONTEXT_CACHE, cmake, gcc, ASan"
+    make test
+}
+
 component_test_psa_crypto_rsa_no_genprime() {
     msg "build: default config minus MBEDTLS_GENPRIME"
     scripts/config.py unset MBEDTLS_GENPRIME
@@ -3377,6 +3420,196 @@ component_test_no_max_fragment_length_small_ssl_out_content_len () {
     tests/context-info.sh
 }
 
+component_test_ssl_idle_buffer_release () {
+    msg "build: default config + SSL_IDLE_BUFFER_RELEASE + SSL_BUFFER_POOL_C (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_IDLE_BUFFER_RELEASE
+    scripts/config.py set MBEDTLS_SSL_BUFFER_POOL_C
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_IDLE_BUFFER_RELEASE + SSL_BUFFER_POOL_C"
+    make test
+}
+
+component_test_ssl_record_batching () {
+    msg "build: default config + SSL_RECORD_BATCHING (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_RECORD_BATCHING
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_RECORD_BATCHING"
+    make test
+
+    msg "test: default config + SSL_RECORD_BATCHING - ssl-opt.sh (subset)"
+    tests/ssl-opt.sh -f "Default\|Large packet\|Non-blocking"
+}
+
+component_test_ssl_cache_shm () {
+    msg "build: default config + SSL_CACHE_SHM_C (ASan build)"
+    scripts/config.py set MBEDTLS_THREADING_C
+    scripts/config.py set MBEDTLS_THREADING_PTHREAD
+    scripts/config.py set MBEDTLS_SSL_CACHE_SHM_C
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_CACHE_SHM_C"
+    make test
+}
+
+component_test_ssl_parallel_encryption () {
+    msg "build: default config + SSL_PARALLEL_ENCRYPTION + SSL_WORKER_POOL_C, no USE_PSA (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_RECORD_BATCHING
+    scripts/config.py set MBEDTLS_SSL_PARALLEL_ENCRYPTION
+    scripts/config.py set MBEDTLS_SSL_WORKER_POOL_C
+    scripts/config.py set MBEDTLS_THREADING_C
+    scripts/config.py set MBEDTLS_THREADING_PTHREAD
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    scripts/config.py unset MBEDTLS_USE_PSA_CRYPTO
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_PARALLEL_ENCRYPTION + SSL_WORKER_POOL_C, no USE_PSA"
+    make test
+}
+
+component_test_dtls_buffering_arena () {
+    msg "build: default config + SSL_DTLS_BUFFERING_ARENA (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_DTLS_BUFFERING_ARENA
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_DTLS_BUFFERING_ARENA"
+    make test
+
+    msg "test: ssl-opt.sh DTLS, default config + SSL_DTLS_BUFFERING_ARENA"
+    tests/ssl-opt.sh -f 'DTLS'
+}
+
+component_test_dtls_demux () {
+    msg "build: default config + SSL_DTLS_DEMUX_C (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_DTLS_DEMUX_C
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_DTLS_DEMUX_C"
+    make test
+
+    msg "test: ssl-opt.sh DTLS cookies, default config + SSL_DTLS_DEMUX_C"
+    tests/ssl-opt.sh -f 'DTLS cookie\|reconnect'
+
+    msg "test: DTLS demultiplexer under load, lossy network"
+    tests/scripts/dtls-demux-load.sh -n 64
+}
+
+component_test_ssl_async_batch () {
+    msg "build: default config + SSL_ASYNC_BATCH_C + SSL_DTLS_DEMUX_C (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_ASYNC_PRIVATE
+    scripts/config.py set MBEDTLS_SSL_ASYNC_BATCH_C
+    scripts/config.py set MBEDTLS_SSL_DTLS_DEMUX_C
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_ASYNC_BATCH_C + SSL_DTLS_DEMUX_C"
+    make test
+
+    msg "test: DTLS demultiplexer with batched handshakes under load"
+    tests/scripts/dtls-demux-load.sh -n 64
+}
+
+component_test_ssl_key_share_pool () {
+    msg "build: default config + SSL_KEY_SHARE_POOL_C (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_KEY_SHARE_POOL_C
+    scripts/config.py set MBEDTLS_THREADING_C
+    scripts/config.py set MBEDTLS_THREADING_PTHREAD
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_KEY_SHARE_POOL_C"
+    make test
+}
+
+component_test_ssl_transcript_buffer_small () {
+    msg "build: default config + TLS 1.3 + SSL_TRANSCRIPT_BUFFER_LEN=200 (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    scripts/config.py set MBEDTLS_SSL_TRANSCRIPT_BUFFER_LEN 200
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + TLS 1.3 + SSL_TRANSCRIPT_BUFFER_LEN=200"
+    make test
+
+    msg "test: ssl-opt.sh, default config + TLS 1.3 + SSL_TRANSCRIPT_BUFFER_LEN=200"
+    tests/ssl-opt.sh -f 'TLS 1.3\|Extended Master Secret\|Renegotiation'
+}
+
+component_test_ssl_own_cert_chain_cache () {
+    msg "build: default config + TLS 1.3 + SSL_OWN_CERT_CHAIN_CACHE (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_OWN_CERT_CHAIN_CACHE
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + TLS 1.3 + SSL_OWN_CERT_CHAIN_CACHE"
+    make test
+
+    msg "test: ssl-opt.sh, default config + TLS 1.3 + SSL_OWN_CERT_CHAIN_CACHE"
+    tests/ssl-opt.sh -f 'TLS 1.3\|SNI\|Authentication\|Renegotiation'
+}
+
+component_test_ssl_cert_compression () {
+    msg "build: default config + TLS 1.3 + SSL_CERT_COMPRESSION (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_CERT_COMPRESSION
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + TLS 1.3 + SSL_CERT_COMPRESSION"
+    make test
+
+    msg "test: ssl-opt.sh, default config + TLS 1.3 + SSL_CERT_COMPRESSION"
+    tests/ssl-opt.sh -f 'TLS 1.3'
+}
+
+component_test_ssl_verify_cache () {
+    msg "build: default config + TLS 1.3 + SSL_VERIFY_CACHE_C (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_VERIFY_CACHE_C
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + TLS 1.3 + SSL_VERIFY_CACHE_C"
+    make test
+}
+
+component_test_dtls_replay_window_1024 () {
+    msg "build: default config + SSL_DTLS_REPLAY_WINDOW=1024 (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_DTLS_REPLAY_WINDOW 1024
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_DTLS_REPLAY_WINDOW=1024"
+    make test
+
+    msg "test: ssl-opt.sh DTLS proxy, default config + SSL_DTLS_REPLAY_WINDOW=1024"
+    tests/ssl-opt.sh -f 'DTLS proxy'
+
+    msg "test: DTLS anti-replay under heavy reordering"
+    tests/scripts/dtls-reorder-bench.sh -n 5000
+}
+
+component_test_ssl_ktls () {
+    msg "build: default config + SSL_KTLS + TLS 1.3 (ASan build)"
+    scripts/config.py set MBEDTLS_SSL_KTLS
+    scripts/config.py set MBEDTLS_SSL_PROTO_TLS1_3
+    CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
+    make
+
+    msg "test: default config + SSL_KTLS + TLS 1.3"
+    make test
+}
+
 component_test_variable_ssl_in_out_buffer_len () {
     msg "build: MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH enabled (ASan build)"
     scripts/config.py set MBEDTLS_SSL_VARIABLE_BUFFER_LENGTH
@@ -4045,6 +4278,7 @@ component_test_tls13 () {
     scripts/config.py set MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE
     scripts/config.py set MBEDTLS_SSL_CID_TLS1_3_PADDING_GRANULARITY 1
     scripts/config.py set MBEDTLS_SSL_EARLY_DATA
+    scripts/config.py set MBEDTLS_SSL_EARLY_DATA_REPLAY_C
     CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
     make
     msg "test: default config with MBEDTLS_SSL_PROTO_TLS1_3 enabled, without padding"
@@ -4059,6 +4293,7 @@ component_test_tls13_no_compatibility_mode () {
     scripts/config.py unset MBEDTLS_SSL_TLS1_3_COMPATIBILITY_MODE
     scripts/config.py set   MBEDTLS_SSL_CID_TLS1_3_PADDING_GRANULARITY 1
     scripts/config.py set   MBEDTLS_SSL_EARLY_DATA
+    scripts/config.py set   MBEDTLS_SSL_EARLY_DATA_REPLAY_C
     CC=gcc cmake -D CMAKE_BUILD_TYPE:String=Asan .
     make
     msg "test: default config with MBEDTLS_SSL_PROTO_TLS1_3 enabled, without padding"
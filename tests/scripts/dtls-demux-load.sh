@@ -0,0 +1,117 @@
+#!/bin/sh
+
+# dtls-demux-load.sh
+#
+# Copyright The Mbed TLS Contributors
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Purpose
+#
+# Load test of the DTLS demultiplexer (MBEDTLS_SSL_DTLS_DEMUX_C): starts
+# programs/ssl/dtls_demux_server, then many ssl_client2 clients at once,
+# each behind its own udp_proxy so that the network can be made lossy and
+# every client reaches the server from a different port. Reports how many
+# clients completed their handshake and echo exchange, and how long the run
+# took.
+#
+# Usage: dtls-demux-load.sh [-n CLIENTS] [-p PORT] [-x PROXY_OPTIONS]
+#                           [-c CLIENT_OPTIONS]
+#
+# Run from the root of a build tree (the directory containing programs/).
+
+set -eu
+
+: ${P_SRV:=programs/ssl/dtls_demux_server}
+: ${P_CLI:=programs/ssl/ssl_client2}
+: ${P_PXY:=programs/test/udp_proxy}
+
+CLIENTS=32
+SRV_PORT=4433
+PXY_OPTS="drop=8 delay=8"
+CLI_OPTS="cid=1 hs_timeout=250-10000"
+
+while getopts "n:p:x:c:h" opt; do
+    case $opt in
+        n) CLIENTS=$OPTARG;;
+        p) SRV_PORT=$OPTARG;;
+        x) PXY_OPTS=$OPTARG;;
+        c) CLI_OPTS=$OPTARG;;
+        *) echo "Usage: $0 [-n CLIENTS] [-p PORT] [-x PROXY_OPTIONS]" \
+                "[-c CLIENT_OPTIONS]" >&2
+           exit 1;;
+    esac
+done
+
+for prog in "$P_SRV" "$P_CLI" "$P_PXY"; do
+    if [ ! -x "$prog" ]; then
+        echo "Program not found: $prog" >&2
+        exit 1
+    fi
+done
+
+# dtls_demux_server serves up to 256 clients at a time
+if [ "$CLIENTS" -lt 1 ] || [ "$CLIENTS" -gt 256 ]; then
+    echo "The number of clients must be between 1 and 256" >&2
+    exit 1
+fi
+
+LOGS=$(mktemp -d "${TMPDIR:-/tmp}/dtls-demux-load.XXXXXX")
+PIDS=""
+
+cleanup() {
+    for pid in $PIDS; do
+        kill "$pid" 2>/dev/null || true
+    done
+}
+trap cleanup EXIT INT TERM
+
+"$P_SRV" "$SRV_PORT" > "$LOGS/srv.log" 2>&1 &
+PIDS="$PIDS $!"
+
+i=1
+while [ "$i" -le "$CLIENTS" ]; do
+    # shellcheck disable=SC2086 # $PXY_OPTS is a list of options
+    "$P_PXY" server_addr=127.0.0.1 server_port="$SRV_PORT" \
+        listen_port=$((SRV_PORT + i)) $PXY_OPTS > "$LOGS/pxy$i.log" 2>&1 &
+    PIDS="$PIDS $!"
+    i=$((i + 1))
+done
+
+# Let the server and the proxies bind their sockets
+sleep 1
+
+START=$(date +%s)
+CLI_PIDS=""
+i=1
+while [ "$i" -le "$CLIENTS" ]; do
+    # shellcheck disable=SC2086 # $CLI_OPTS is a list of options
+    "$P_CLI" dtls=1 server_addr=127.0.0.1 server_port=$((SRV_PORT + i)) \
+        $CLI_OPTS > "$LOGS/cli$i.log" 2>&1 &
+    CLI_PIDS="$CLI_PIDS $!"
+    i=$((i + 1))
+done
+
+PASSED=0
+for pid in $CLI_PIDS; do
+    if wait "$pid"; then
+        PASSED=$((PASSED + 1))
+    fi
+done
+END=$(date +%s)
+
+echo "$PASSED/$CLIENTS clients passed in $((END - START))s"
+echo "Logs in $LOGS"
+
+[ "$PASSED" -eq "$CLIENTS" ]
@@ -0,0 +1,117 @@
+#!/bin/sh
+
+# dtls-reorder-bench.sh
+#
+# Copyright The Mbed TLS Contributors
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# Purpose
+#
+# Benchmark of the DTLS anti-replay window (MBEDTLS_SSL_DTLS_REPLAY_WINDOW)
+# under heavy reordering: for each reordering depth, sends a stream of
+# records with programs/test/dtls_reorder_bench through udp_proxy's reorder
+# option, and reports the share of records the receiver dropped as too old
+# and the receiver's CPU time per record.
+#
+# The window size is a compile-time option: run this script from build trees
+# configured with different values to compare them.
+#
+# Usage: dtls-reorder-bench.sh [-n RECORDS] [-p PORT] [-r "DEPTH..."]
+#                              [-s SEED]
+#
+# Run from the root of a build tree (the directory containing programs/).
+
+set -eu
+
+: ${P_BENCH:=programs/test/dtls_reorder_bench}
+: ${P_PXY:=programs/test/udp_proxy}
+
+RECORDS=20000
+SRV_PORT=4433
+DEPTHS="0 16 64 128 256 1024"
+SEED=1
+
+while getopts "n:p:r:s:h" opt; do
+    case $opt in
+        n) RECORDS=$OPTARG;;
+        p) SRV_PORT=$OPTARG;;
+        r) DEPTHS=$OPTARG;;
+        s) SEED=$OPTARG;;
+        *) echo "Usage: $0 [-n RECORDS] [-p PORT] [-r \"DEPTH...\"]" \
+                "[-s SEED]" >&2
+           exit 1;;
+    esac
+done
+
+for prog in "$P_BENCH" "$P_PXY"; do
+    if [ ! -x "$prog" ]; then
+        echo "Program not found: $prog" >&2
+        exit 1
+    fi
+done
+
+LOGS=$(mktemp -d "${TMPDIR:-/tmp}/dtls-reorder-bench.XXXXXX")
+PIDS=""
+
+cleanup() {
+    for pid in $PIDS; do
+        kill "$pid" 2>/dev/null || true
+    done
+}
+trap cleanup EXIT INT TERM
+
+printf "%8s %10s %10s %8s %12s\n" reorder received dropped "drop%" "us/record"
+
+FAILED=0
+for depth in $DEPTHS; do
+    "$P_BENCH" mode=server server_addr=127.0.0.1 server_port="$SRV_PORT" \
+        > "$LOGS/srv$depth.log" 2>&1 &
+    SRV_PID=$!
+    "$P_PXY" server_addr=127.0.0.1 server_port="$SRV_PORT" \
+        listen_addr=127.0.0.1 listen_port=$((SRV_PORT + 1)) \
+        reorder="$depth" seed="$SEED" > "$LOGS/pxy$depth.log" 2>&1 &
+    PXY_PID=$!
+    PIDS="$SRV_PID $PXY_PID"
+
+    # Let the server and the proxy bind their sockets
+    sleep 1
+
+    if ! "$P_BENCH" mode=client server_addr=127.0.0.1 \
+            server_port=$((SRV_PORT + 1)) records="$RECORDS" \
+            > "$LOGS/cli$depth.log" 2>&1 ||
+       ! wait "$SRV_PID"; then
+        echo "reorder=$depth: failed, see $LOGS" >&2
+        FAILED=1
+    fi
+    kill "$PXY_PID" 2>/dev/null || true
+    wait "$PXY_PID" 2>/dev/null || true
+    PIDS=""
+
+    # "  < Received R of N records, D dropped (P%), ..."
+    # "  < CPU time T ms, U us per received record (window W)"
+    sed -n \
+        -e 's/.*Received \([0-9]*\) of [0-9]* records, \([0-9]*\) dropped (\([0-9.]*\)%).*/\1 \2 \3/p' \
+        -e 's/.*CPU time [0-9.]* ms, \([0-9.]*\) us per.*/\1/p' \
+        "$LOGS/srv$depth.log" | tr '\n' ' ' |
+        { read -r received dropped rate cpu || true
+          printf "%8s %10s %10s %8s %12s\n" "$depth" "${received:--}" \
+              "${dropped:--}" "${rate:--}" "${cpu:--}"; }
+done
+
+sed -n 's/.*(window \([0-9]*\)).*/Replay window: \1 records/p' \
+    "$LOGS"/srv*.log | head -n 1
+echo "Logs in $LOGS"
+
+[ "$FAILED" -eq 0 ]
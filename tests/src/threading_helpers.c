@@ -165,7 +165,9 @@ static int mbedtls_test_wrap_mutex_lock(mbedtls_threading_mutex_t *mutex)
 
 static int mbedtls_test_wrap_mutex_unlock(mbedtls_threading_mutex_t *mutex)
 {
-    int ret = mutex_functions.unlock(mutex);
+    int ret;
+    /* Update the state while the mutex is still held: as soon as it is
+     * released, another thread may lock it and check the state. */
     switch (mutex->is_valid) {
         case MUTEX_FREED:
             mbedtls_test_mutex_usage_error(mutex, "unlock without init");
@@ -174,15 +176,17 @@ static int mbedtls_test_wrap_mutex_unlock(mbedtls_threading_mutex_t *mutex)
             mbedtls_test_mutex_usage_error(mutex, "unlock without lock");
             break;
         case MUTEX_LOCKED:
-            if (ret == 0) {
-                mutex->is_valid = MUTEX_IDLE;
+            mutex->is_valid = MUTEX_IDLE;
+            ret = mutex_functions.unlock(mutex);
+            if (ret != 0) {
+                mutex->is_valid = MUTEX_LOCKED;
             }
-            break;
+            return ret;
         default:
             mbedtls_test_mutex_usage_error(mutex, "corrupted state");
             break;
     }
-    return ret;
+    return mutex_functions.unlock(mutex);
 }
 
 void mbedtls_test_mutex_usage_init(void)
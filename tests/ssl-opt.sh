@@ -9185,6 +9185,133 @@ run_test    "SSL async private: renegotiation: server-initiated, decrypt" \
             -s "Async decrypt callback: using key slot " \
             -s "Async resume (slot [0-9]): decrypt done, status=0"
 
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, sign, delay=0" \
+            "$P_SRV debug_level=2 force_version=tls13 \
+             async_operations=s async_private_delay1=0 async_private_delay2=0" \
+            "$P_CLI" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (slot [0-9]): sign done, status=0" \
+            -s "CertificateVerify signature with "
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, sign, delay=2" \
+            "$P_SRV debug_level=2 force_version=tls13 \
+             async_operations=s async_private_delay1=2 async_private_delay2=2" \
+            "$P_CLI" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -U "Async sign callback: using key slot " \
+            -s "Async resume (slot [0-9]): call 1 more times." \
+            -s "Async resume (slot [0-9]): call 0 more times." \
+            -s "resuming signature operation" \
+            -s "Async resume (slot [0-9]): sign done, status=0"
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+requires_config_enabled MBEDTLS_RSA_C
+requires_config_enabled MBEDTLS_PKCS1_V21
+run_test    "SSL async private: TLS 1.3, sign RSA-PSS, delay=1" \
+            "$P_SRV debug_level=2 force_version=tls13 \
+             crt_file=data_files/server2-sha256.crt key_file=data_files/server2.key \
+             async_operations=s async_private_delay1=1 async_private_delay2=1" \
+            "$P_CLI sig_algs=rsa_pss_rsae_sha256" \
+            0 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume (slot [0-9]): call 0 more times." \
+            -s "Async resume (slot [0-9]): sign done, status=0" \
+            -s "CertificateVerify signature with rsa_pss_rsae_sha256"
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, sign, error in resume" \
+            "$P_SRV force_version=tls13 \
+             async_operations=s async_private_delay1=1 async_private_delay2=1 \
+             async_private_error=3" \
+            "$P_CLI" \
+            1 \
+            -s "Async sign callback: using key slot " \
+            -s "Async resume callback: sign done but injected error" \
+            -S "Async cancel" \
+            -s "! mbedtls_ssl_handshake returned"
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_ECDH_C
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, key agreement, delay=0" \
+            "$P_SRV debug_level=2 force_version=tls13 \
+             async_operations=k async_key_agreement_delay=0" \
+            "$P_CLI" \
+            0 \
+            -s "Async key agreement callback: group 0x" \
+            -s "Async resume (slot [0-9]): key agreement done, status=0" \
+            -S "Async resume (slot [0-9]): call 0 more times."
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_ECDH_C
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, key agreement, delay=2" \
+            "$P_SRV debug_level=2 force_version=tls13 \
+             async_operations=k async_key_agreement_delay=2" \
+            "$P_CLI" \
+            0 \
+            -s "Async key agreement callback: group 0x" \
+            -U "Async key agreement callback: group 0x" \
+            -s "Async resume (slot [0-9]): call 1 more times." \
+            -s "Async resume (slot [0-9]): call 0 more times." \
+            -s "Async resume (slot [0-9]): key agreement done, status=0"
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_ECDH_C
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_3
+requires_config_enabled MBEDTLS_SSL_TLS1_3_KEY_EXCHANGE_MODE_EPHEMERAL_ENABLED
+requires_config_enabled MBEDTLS_SSL_SRV_C
+requires_config_enabled MBEDTLS_SSL_CLI_C
+run_test    "SSL async private: TLS 1.3, key agreement, error in resume" \
+            "$P_SRV force_version=tls13 \
+             async_operations=k async_key_agreement_delay=1 async_private_error=3" \
+            "$P_CLI" \
+            1 \
+            -s "Async key agreement callback: group 0x" \
+            -s "Async resume callback: key agreement done but injected error" \
+            -S "Async cancel" \
+            -s "! mbedtls_ssl_handshake returned"
+
+requires_config_enabled MBEDTLS_SSL_ASYNC_PRIVATE
+requires_config_enabled MBEDTLS_ECDH_C
+requires_config_enabled MBEDTLS_SSL_PROTO_TLS1_2
+requires_config_enabled MBEDTLS_KEY_EXCHANGE_ECDHE_RSA_ENABLED
+requires_any_configs_enabled MBEDTLS_USE_PSA_CRYPTO MBEDTLS_SSL_PROTO_TLS1_3
+run_test    "SSL async private: TLS 1.2 ECDHE-RSA, key agreement, delay=1" \
+            "$P_SRV debug_level=2 force_version=tls12 \
+             async_operations=k async_key_agreement_delay=1" \
+            "$P_CLI force_ciphersuite=TLS-ECDHE-RSA-WITH-AES-128-GCM-SHA256" \
+            0 \
+            -s "Async key agreement callback: group 0x" \
+            -s "Async resume (slot [0-9]): call 0 more times." \
+            -s "Async resume (slot [0-9]): key agreement done, status=0"
+
 # Tests for ECC extensions (rfc 4492)
 
 requires_config_enabled MBEDTLS_AES_C